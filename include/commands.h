@@ -0,0 +1,112 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "fancontrol.h"
+#include "overrides.h"
+#include "zones.h"
+
+// Commands from the network side (web handlers on the AsyncTCP task, MQTT) to
+// the control loop, which alone touches FanController, ZoneManager and
+// OverrideManager. A bounded multi-producer, single-consumer ring: producers
+// claim a slot with one compare-and-swap on the head and publish it through
+// the slot's sequence number, so push() never blocks or allocates, and a full
+// queue is refused rather than waited on.
+//
+// push() returns a ticket. The loop applies queued commands with apply(),
+// runs its decision, then complete() records each command's outcome with the
+// state of its fan after that decision. Producers poll() the ticket for the
+// result; nothing waits for it, least of all the AsyncTCP task. Results live in a ring of their own, so one that
+// is collected too late is reported as lost, never as another command's.
+
+#define COMMAND_QUEUE_SIZE 16     // power of two
+
+enum CommandType : uint8_t {
+  CMD_SET_MODE,          // zone, mode, duration; speed for MODE_DIAGNOSTIC
+  CMD_SET_SPEED,         // main fan at speed % (diagnostic mode, no expiry)
+  CMD_ADD_OVERRIDE,      // start, duration, mode, speed
+  CMD_CANCEL_OVERRIDE    // id, 0 = all
+};
+
+struct Command {
+  CommandType type;
+  uint8_t zone;
+  ControlMode mode;
+  uint8_t speed;
+  uint32_t duration;     // minutes
+  uint32_t id;
+  time_t start;
+};
+
+struct CommandResult {
+  bool ok;               // false: no such zone or override, or invalid
+  uint32_t id;           // CMD_ADD_OVERRIDE: the new override's id
+  uint32_t order;        // commands applied so far, this one included
+  ControlMode mode;      // the command's fan after the decision
+  uint8_t speed;
+  RunReason reason;
+};
+
+class CommandQueue {
+public:
+  CommandQueue();
+  // Task woken by push(), i.e. the control loop
+  void setWakeTask(TaskHandle_t task) { wakeTask = task; }
+
+  // Any task: the command's ticket, or 0 if the queue is full
+  uint32_t push(const Command& cmd);
+  // Any task: true once the ticket's command was completed, with its result
+  bool poll(uint32_t ticket, CommandResult& result) const;
+
+  // Control loop only: applies everything queued, returns the count
+  uint8_t apply(ZoneManager& zones, OverrideManager& overrides, FanController& fan);
+  // Control loop only, after the decision that followed apply()
+  void complete(const ZoneManager& zones);
+
+  uint32_t getRefused() const { return refused.load(std::memory_order_relaxed); }
+  // Latest ticket handed out by push()
+  uint32_t getIssued() const { return head.load(std::memory_order_relaxed); }
+  // Latest ticket completed; a ticket COMMAND_QUEUE_SIZE or more behind it
+  // that poll() does not find was collected too late
+  uint32_t getCompleted() const { return completed.load(std::memory_order_acquire); }
+
+  // {"success":true,"mode":"MANUAL_HIGH","speed":100,"reason":...}
+  static size_t formatJSON(const CommandResult& result, char* buf, size_t len);
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    Command cmd;
+  };
+  // A CommandResult in words that may be read while complete() rewrites
+  // them; poll() keeps a copy only if ticket did not change around it
+  struct Done {
+    std::atomic<uint32_t> ticket;   // 0 while being written
+    std::atomic<uint32_t> id;
+    std::atomic<uint32_t> order;
+    std::atomic<uint32_t> state;    // ok, mode, speed, reason
+  };
+  struct Applied {
+    uint32_t ticket;
+    uint8_t zone;
+    CommandResult result;
+  };
+
+  Slot slots[COMMAND_QUEUE_SIZE];
+  std::atomic<uint32_t> head;       // next position to claim
+  uint32_t tail;                    // next position to apply (consumer)
+  Done done[COMMAND_QUEUE_SIZE];
+  Applied applied[COMMAND_QUEUE_SIZE];
+  uint8_t appliedCount;
+  uint32_t order;
+  std::atomic<uint32_t> refused;
+  std::atomic<uint32_t> completed;
+  TaskHandle_t wakeTask;
+
+  void run(const Command& cmd, CommandResult& result, ZoneManager& zones,
+           OverrideManager& overrides, FanController& fan);
+};
+
+#endif
@@ -2,6 +2,9 @@
 #define CONFIG_H
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "schedule.h"
+#include "rules.h"
 
 // Hardware Pin Definitions
 #define PIN_RELAY 5
@@ -27,7 +30,30 @@
 #define SENSOR_READ_INTERVAL 5000
 #define DISPLAY_UPDATE_INTERVAL 2000
 #define MQTT_PUBLISH_INTERVAL 30000
-#define DECISION_INTERVAL 10000
+#define DECISION_INTERVAL 10000   // longest gap between fan decisions
+#define LOOP_IDLE_MAX 50          // loop() polls OTA, MQTT and serial this often
+#define TRACE_SAMPLE_INTERVAL 60000
+#define TRACE_FLUSH_INTERVAL 300000
+#define TRACE_CLOCK_INTERVAL 3600000
+
+// time() before the first NTP sync counts from 1970
+#define CLOCK_VALID_EPOCH 1600000000
+
+// Config persistence: changes from the network side are written by loop(),
+// once they have been quiet for CONFIG_SAVE_DELAY (a slider sends many), but
+// no later than CONFIG_SAVE_MAX_DELAY after the first one
+#define CONFIG_FILE "/config.json"
+#define CONFIG_TEMP_FILE "/config.json.tmp"
+#define CONFIG_SAVE_DELAY 3000
+#define CONFIG_SAVE_MAX_DELAY 30000
+
+// Fan speed modulation
+#define DIMMER_MAX_LEVEL 95   // full speed fluctuates on the triac
+#define SPEED_STEP 5          // modulated speeds are rounded to this
+#define MAX_POWER_POINTS 8    // fan power curve (speed %, watts) pairs
+
+// Zones: the main fan (zone 0, pins above) plus fans configured in "zones"
+#define MAX_ZONES 4
 
 // Control Modes
 enum ControlMode {
@@ -46,7 +72,39 @@ enum RunReason {
   REASON_BOTH,
   REASON_FORCED_CIRCULATION,
   REASON_MANUAL_OVERRIDE,
-  REASON_SAFETY_LIMIT
+  REASON_SAFETY_LIMIT,
+  REASON_RULE                // a site rule runs the fan
+};
+
+// What decided the last fan decision besides the benefit checks
+enum DecisionGate : uint8_t {
+  GATE_NONE,                 // humidity/temperature benefit (or its absence)
+  GATE_MANUAL,               // manual or diagnostic mode
+  GATE_SENSOR_INVALID,
+  GATE_FORCED_CIRCULATION,
+  GATE_OUTSIDE_COLD,
+  GATE_CELLAR_COLD,
+  GATE_DEW_POINT,
+  GATE_SCHEDULE_OFF,
+  GATE_SHORT_CYCLE,          // change held back by min run/idle time
+  GATE_RULE                  // a site rule from config.json (rules.h)
+};
+
+// How a zone's fan decides in AUTO
+enum ZoneRole {
+  ZONE_INDEPENDENT,   // own decision from its own indoor sensor
+  ZONE_FOLLOW         // runs with another zone at its speed x balance
+};
+
+// An additional fan (zone 1..MAX_ZONES-1)
+struct ZoneConfig {
+  String name;
+  uint8_t relay_pin;
+  uint8_t dimmer_pin;
+  uint8_t sensor_channel;   // mux channel of its indoor sensor, 0 = the main one
+  ZoneRole role;
+  uint8_t follow;           // ZONE_FOLLOW: zone id it follows (lower than its own)
+  float balance;            // ZONE_FOLLOW: speed ratio, e.g. exhaust vs supply
 };
 
 // System Configuration Structure
@@ -75,16 +133,64 @@ struct SystemConfig {
   float min_outside_temp;
   float min_cellar_temp;
   float max_dew_point_increase;
+  bool adaptive_differentials;   // start runs on measured efficiency (efficiency.h)
+  float min_dry_rate;            // g/m3 per hour at 100% speed
+  float min_cool_rate;           // °C per hour at 100% speed
   
   // Fan Configuration
   int low_speed;
   int high_speed;
   int min_run_time_sec;
   int min_idle_time_sec;
+  bool modulate_speed;   // PI speed control instead of low/high
+  int min_speed;         // lowest speed the fan starts and runs at reliably
+  float speed_kp;        // % speed per %RH (or °C) above target
+  float speed_ki;        // % speed per %RH-hour above target
+  float airflow_m3h;     // at 100% speed, for water removed (usage.h)
+  uint8_t power_points;
+  int power_speed[MAX_POWER_POINTS];     // ascending
+  float power_watts[MAX_POWER_POINTS];
   
   // Forced Circulation
   int forced_interval_hours;
   int forced_duration_min;
+  
+  // Speed schedule (high/low/off by time of week)
+  WeeklySchedule schedule;
+  
+  // Site rules, compiled to bytecode on load (see rules.h)
+  RuleProgram rules;
+  
+  // Day-ahead ventilation plan from learned weather (see planner.h)
+  bool planner_enabled;
+  
+  // Additional fans (see zones.h)
+  uint8_t zone_count;
+  ZoneConfig zones[MAX_ZONES - 1];
+};
+
+// Scalar settings are described once (src/config.cpp) for loading, saving,
+// GET /api/config and validating PATCH /api/config
+enum ConfigFieldType : uint8_t {
+  CONFIG_BOOL,
+  CONFIG_INT,
+  CONFIG_FLOAT,
+  CONFIG_STRING
+};
+
+#define CONFIG_SECRET 0x01    // never returned by GET /api/config
+#define CONFIG_RESTART 0x02   // read at startup only; a patch is saved, not applied
+
+struct ConfigField {
+  const char* section;        // config.json object, e.g. "thresholds"
+  const char* key;
+  ConfigFieldType type;
+  uint8_t flags;
+  void* value;                // the SystemConfig member
+  float min;                  // numbers: range; strings: length
+  float max;
+  float defaultNumber;
+  const char* defaultText;
 };
 
 // Global Variables
@@ -94,7 +200,22 @@ extern unsigned long manualOverrideUntil;
 
 // Configuration Functions
 bool loadConfig();
-bool saveConfig();
+bool saveConfig();          // write now, through CONFIG_TEMP_FILE and a rename
+void requestConfigSave();   // any task: config changed in RAM, save it soon
+void updateConfigSave();    // loop(): saves once the change has settled
+bool flushConfig();         // save a pending change now (before OTA or restart)
+void lockConfig();          // recursive; loop() holds it for a decision
+void unlockConfig();
+// The whole config as in config.json, without CONFIG_SECRET fields unless
+// secrets. CONFIG_RESTART fields as patched, i.e. as after a restart.
+void buildConfigJSON(JsonDocument& doc, bool secrets);
+// ArduinoJson filter keeping only the fields patchConfig() knows
+void buildConfigFilter(JsonDocument& filter);
+// Validates every field in patch against its range, then applies them all
+// under the lock; false with error (nothing applied) if any is invalid.
+// changes gets {"section":{"key":{"old":..,"new":..}}} for what differed.
+// CONFIG_RESTART fields only go to the saved file, and set restart.
+bool patchConfig(JsonObjectConst patch, JsonObject changes, String& error, bool& restart);
 void printConfig();
 
 #endif
\ No newline at end of file
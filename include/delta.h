@@ -0,0 +1,105 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp32/rom/miniz.h>
+
+// Delta firmware patches, applied by OtaUpdater as they stream in. A patch is
+// built on a host by tools/ota_delta.cpp from the image the device runs (the
+// base) and the new one, and is usually a few percent of a full image.
+//
+// Layout: DeltaHeader, then a raw deflate stream of ops:
+//   DELTA_ADD     u32 offset, u32 length, then length bytes added (mod 256)
+//                 to the base from offset: code that only moved or had a few
+//                 addresses change turns into runs of zeros
+//   DELTA_INSERT  u32 length, then length bytes of new image
+//   DELTA_END
+// all little-endian. The decoder inflates with the ROM's tinfl into a ring of
+// 2^windowBits bytes, which the tool's deflate window never exceeds, and
+// reads the base from the running partition as it goes. Nothing needs the
+// whole image in RAM: about 11 KB of decompressor state, the ring, and a
+// small read buffer.
+//
+// The base is hashed before anything is decoded, so a patch for another
+// firmware is refused up front; the image it produces is checked against
+// imageSha256 by OtaUpdater before it may boot.
+
+#define DELTA_MAGIC 0x544C4443   // "CDLT"; an app image starts with 0xE9
+#define DELTA_VERSION 1
+#define DELTA_WINDOW_BITS 12     // largest deflate window accepted: 4 KB ring
+#define DELTA_READ_CHUNK 256     // base bytes read from flash at a time
+
+enum DeltaOp : uint8_t {
+  DELTA_END,
+  DELTA_ADD,
+  DELTA_INSERT
+};
+
+struct DeltaHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t windowBits;
+  uint16_t reserved;
+  uint32_t baseSize;
+  uint32_t imageSize;
+  uint8_t baseSha256[32];
+  uint8_t imageSha256[32];
+};
+
+class DeltaDecoder {
+public:
+  // Receives decoded image bytes; false stops the decoder
+  typedef bool (*Sink)(void* context, const uint8_t* data, size_t len);
+
+  DeltaDecoder();
+  ~DeltaDecoder();
+
+  // Starts with a DeltaHeader of the current version
+  static bool isPatch(const uint8_t* data, size_t len);
+
+  // Decompressor state and ring; false if out of memory
+  bool allocate();
+  // Checks the header against base (hashing its first baseSize bytes) and
+  // resets the decoder; false with getError() if the patch does not apply
+  bool begin(const DeltaHeader& header, const esp_partition_t* base);
+  // Compressed patch bytes, header excluded. Decoded bytes go to sink in
+  // pieces of at most 2^windowBits.
+  bool write(const uint8_t* data, size_t len, Sink sink, void* context);
+  // The whole patch was decoded: the deflate stream and the ops ended
+  bool isComplete() const { return phase == PHASE_DONE && inflated; }
+  void release();
+
+  const char* getError() const { return error; }
+
+private:
+  enum Phase : uint8_t {
+    PHASE_OP,
+    PHASE_FIELDS,     // the op's u32s
+    PHASE_PAYLOAD,
+    PHASE_DONE        // DELTA_END seen
+  };
+
+  tinfl_decompressor* inflater;
+  uint8_t* ring;
+  size_t ringSize;
+  size_t ringPos;
+  bool inflated;      // tinfl reached the end of the deflate stream
+
+  const esp_partition_t* base;
+  uint32_t baseSize;
+  Phase phase;
+  uint8_t op;
+  uint8_t fields[8];
+  uint8_t fieldLen;
+  uint8_t fieldNeed;
+  uint32_t offset;    // DELTA_ADD: next base byte
+  uint32_t remaining; // payload bytes left in the op
+  const char* error;
+  uint8_t baseChunk[DELTA_READ_CHUNK];
+
+  bool decode(const uint8_t* data, size_t len, Sink sink, void* context);
+  bool startOp();
+};
+
+#endif
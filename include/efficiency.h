@@ -0,0 +1,72 @@
+#ifndef EFFICIENCY_H
+#define EFFICIENCY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors.h"
+
+// Measured benefit of fan runs. For every run of at least
+// EFFICIENCY_MIN_RUN_MIN the drop in cellar absolute humidity (and
+// temperature) per hour of runtime, scaled to 100% speed, is regressed
+// against the mean inside-outside gap over the run:
+//
+//   rate = intercept + slope * gap
+//
+// The fit uses exponentially weighted sums, so older runs fade out as the
+// walls and seasons change. The intercept is negative when moisture keeps
+// entering during runs; -intercept / slope is the gap at which a run breaks
+// even. With "adaptive_differentials", FanController starts runs on the
+// predicted rate (min_dry_rate, min_cool_rate) instead of the fixed
+// humidity_differential and temp_differential once a fit is ready.
+
+#define EFFICIENCY_FILE "/efficiency.bin"
+#define EFFICIENCY_MAGIC 0x31464645   // "EFF1"
+#define EFFICIENCY_MIN_RUN_MIN 5
+#define EFFICIENCY_MIN_RUNS 10
+#define EFFICIENCY_FORGET 0.97f      // weight kept by older runs per new run
+
+enum EfficiencyKind {
+  EFFICIENCY_DRY,    // g/m3 per hour vs absolute humidity gap (g/m3)
+  EFFICIENCY_COOL,   // °C per hour vs temperature gap (°C)
+  EFFICIENCY_KINDS
+};
+
+struct EfficiencyFit {
+  float sw, sx, sy, sxx, sxy;   // weighted sums of 1, gap, rate, gap², gap*rate
+  uint32_t runs;
+};
+
+class EfficiencyEstimator {
+public:
+  EfficiencyEstimator();
+  void begin();   // restores the fits from LittleFS
+
+  // Call after every decision with the speed it chose
+  void update(const SensorData& internal, const SensorData& external, int fanSpeed);
+
+  // Rate at 100% speed for a gap; false until the fit has enough varied runs
+  bool predict(EfficiencyKind kind, float gap, float& rate) const;
+  bool getCoefficients(EfficiencyKind kind, float& intercept, float& slope) const;
+  String getJSON() const;
+
+private:
+  EfficiencyFit fits[EFFICIENCY_KINDS];
+  bool persistent;
+
+  // Run in progress
+  bool inRun;
+  unsigned long runStart;
+  unsigned long lastUpdate;
+  float startAh, startTemp;
+  float lastAh, lastTemp;
+  float gapSum[EFFICIENCY_KINDS];
+  float speedSum;
+  uint32_t samples;
+
+  void finishRun();
+  static void addRun(EfficiencyFit& fit, float gap, float rate);
+  bool load();
+  bool save() const;
+};
+
+#endif
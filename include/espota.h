@@ -0,0 +1,81 @@
+#ifndef ESPOTA_H
+#define ESPOTA_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <functional>
+#include "ota.h"
+
+// Push updates from PlatformIO and the Arduino IDE (`pio run --target upload
+// --upload-port cellar-fan.local`, or espota.py itself), in place of
+// ArduinoOTA and speaking its protocol: an invitation "command port size md5"
+// on UDP, an MD5 challenge when a password is set, then the device connects
+// back to the host's TCP port, acknowledges each piece it reads with its
+// length, and answers "OK" once the update is in place.
+//
+// ArduinoOTA hands every byte to the core's Update, which takes app images
+// only. Firmware goes through OtaUpdater here instead, so a delta patch
+// (delta.h) is applied as on POST /update, by the same writer and with the
+// same checks; a filesystem image still goes through Update. Like
+// ArduinoOTA, handle() runs the whole transfer, so loop() stops meanwhile.
+
+#define ESPOTA_PORT 3232
+#define ESPOTA_FLASH 0               // invitation commands, as U_FLASH and U_SPIFFS
+#define ESPOTA_FILESYSTEM 100
+#define ESPOTA_AUTH 200              // the host's answer to the challenge
+#define ESPOTA_CHUNK 1460            // read from the host at a time
+#define ESPOTA_READ_WAIT_MS 1000     // nothing to read this long: acknowledge again
+#define ESPOTA_READ_RETRIES 3        // then give up
+#define ESPOTA_AUTH_WAIT_MS 10000    // a challenge left unanswered expires
+
+class EspotaReceiver {
+public:
+  typedef std::function<void(bool firmware)> StartHandler;
+  typedef std::function<void(uint32_t received, uint32_t total)> ProgressHandler;
+  typedef std::function<void(const char* error)> EndHandler;   // null error: success
+
+  explicit EspotaReceiver(OtaUpdater& ota);
+
+  void onStart(StartHandler handler) { startHandler = handler; }
+  void onProgress(ProgressHandler handler) { progressHandler = handler; }
+  void onEnd(EndHandler handler) { endHandler = handler; }
+
+  // password as given to espota.py (-a, upload_flags --auth), "" for none
+  void begin(const char* password, uint16_t port = ESPOTA_PORT);
+  // loop(): answers invitations and runs an accepted transfer to its end.
+  // Firmware reboots through OtaUpdater::isRebootDue(), a filesystem at once.
+  void handle();
+
+private:
+  enum State : uint8_t {
+    ESPOTA_IDLE,
+    ESPOTA_WAIT_AUTH
+  };
+
+  OtaUpdater& ota;
+  WiFiUDP udp;
+  bool listening;
+  String passwordMd5;          // hex, as the host hashes it
+  State state;
+  char nonce[33];
+  unsigned long challengedAt;
+
+  int command;
+  IPAddress host;
+  uint16_t hostPort;
+  uint32_t size;
+  char md5[33];                // of the file, hex
+
+  StartHandler startHandler;
+  ProgressHandler progressHandler;
+  EndHandler endHandler;
+
+  void reply(const char* text);
+  void onInvitation(const char* packet);
+  void onAuth(const char* packet);
+  void run();
+  const char* receive(WiFiClient& client, uint32_t session);
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include "rbdimmerESP32.h"
 #include "config.h"
 #include "sensors.h"
+#include "planner.h"
+#include "efficiency.h"
 
 // Forward declaration to help IntelliSense
 #ifndef rbdimmer_channel_t
@@ -14,7 +16,10 @@ typedef struct rbdimmer_channel_s rbdimmer_channel_t;
 
 class FanController {
 public:
-  FanController();
+  // The main fan uses the global mode and override; other zones (zones.h)
+  // bring their own pins and mode state
+  FanController(uint8_t relayPin = PIN_RELAY, uint8_t dimmerPin = PIN_DIMMER_PSM,
+                ControlMode& mode = currentMode, unsigned long& overrideUntil = manualOverrideUntil);
   bool begin();
   void update(const SensorData& internal, const SensorData& external);
   
@@ -24,26 +29,73 @@ public:
   
   int getCurrentSpeed() const { return currentSpeed; }
   RunReason getRunReason() const { return runReason; }
+  DecisionGate getGate() const { return gate; }
+  static const char* gateName(DecisionGate gate);
   String getStatusText() const;
+  static const char* reasonText(RunReason reason);
   unsigned long getNextForcedRun() const;
   bool isForcedRunActive() const { return forcedRunActive; }
   unsigned long getTimeSinceStateChange() const;
+  uint32_t getRelayCycles() const { return relayCycles; }   // switch-ons since boot
+  static uint32_t getZeroCrossings();   // mains zero crossings, all channels
+  
+  // Event-driven evaluation: commands request an update and wake the loop
+  // task; otherwise update() is due again at getNextDeadline() (millis)
+  void setWakeTask(TaskHandle_t task) { wakeTask = task; }
+  void requestUpdate();
+  bool isUpdatePending() const { return updatePending; }
+  unsigned long getNextDeadline() const;
+  
+  // AUTO follows the planner's day-ahead plan for humidity runs when it has one
+  void setPlanner(const VentilationPlanner* p) { planner = p; }
+  // With adaptive_differentials, measured run efficiency decides if a run helps
+  void setEstimator(const EfficiencyEstimator* e) { estimator = e; }
+  // AUTO mirrors another zone's fan at its speed x balance (supply/exhaust pairs)
+  void setLeader(const FanController* l, float ratio) { leader = l; balance = ratio; }
+  
+  // Site rule that decided the last AUTO decision (-1 = none) and its engine
+  int getActiveRule() const { return gate == GATE_RULE ? activeRule : -1; }
+  const RuleEngine& getRuleEngine() const { return rules; }
+  
+  ControlMode getMode() const { return controlMode; }
+  unsigned long getOverrideUntil() const { return overrideUntil; }
   
 private:
+  uint8_t relayPin;
+  uint8_t dimmerPin;
+  ControlMode& controlMode;
+  unsigned long& overrideUntil;
   rbdimmer_channel_t* dimmerChannel;
   int currentSpeed;
   RunReason runReason;
+  DecisionGate gate;
   unsigned long lastStateChange;
   unsigned long lastForcedRun;
   bool relayState;
+  uint32_t relayCycles;
   bool forcedRunActive;
   unsigned long forcedRunStart;
+  float speedIntegral;
+  unsigned long lastModulation;
+  volatile bool updatePending;
+  bool changeBlocked;
+  TaskHandle_t wakeTask;
+  const VentilationPlanner* planner;
+  const EfficiencyEstimator* estimator;
+  const FanController* leader;
+  float balance;
+  RuleEngine rules;
+  int activeRule;
   
   bool shouldRun(const SensorData& internal, const SensorData& external);
-  bool isHighSpeedAllowed() const;
+  bool humidityBenefit(const SensorData& internal, const SensorData& external) const;
+  bool tempBenefit(const SensorData& internal, const SensorData& external) const;
   bool checkDewPointSafety(const SensorData& internal, const SensorData& external) const;
   bool checkForcedCirculation();
+  int ruleSpeed(const Rule& rule, SpeedLimit limit) const;
+  int modulatedSpeed(const SensorData& internal, const SensorData& external, int maxSpeed);
   void setFanSpeed(int speed, RunReason reason);
+  void applyLevel(int speed);
   void setRelay(bool state);
   bool canChangeState() const;
 };
@@ -0,0 +1,120 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "trace.h"
+
+// History query over the trace files (trace.h): the SAMPLE records of
+// TRACE_OLD_FILE then TRACE_FILE, placed in wall time by their BOOT/CLOCK
+// records and aggregated to min/mean/max per step as they are read. Output is
+// produced a piece at a time by read(), for a chunked HTTP response, so
+// neither the files nor the result are ever held whole. Samples recorded
+// before the clock was set have no wall time and are left out, and the last
+// TRACE_FLUSH_INTERVAL may still be in the recorder's RAM buffer.
+//
+// CSV: "time,in_rh_min,in_rh_mean,in_rh_max,..." then one row per step that
+// has samples, time = step start (epoch); a field without valid samples in a
+// step is empty.
+//
+// Binary (little-endian): HistoryHeader, the field ids (one byte each, padded
+// with 0xFF to a multiple of 4), then per step a uint32 time and an int16
+// min, mean and max per field, x100; HISTORY_NO_VALUE where CSV is empty.
+
+#define HISTORY_MAGIC 0x31534843       // "CHS1"
+#define HISTORY_VERSION 1
+#define HISTORY_MIN_STEP 60            // s, the trace's sample interval
+#define HISTORY_DEFAULT_POINTS 288     // steps when ?step= is not given
+#define HISTORY_MAX_POINTS 2000        // larger steps are used beyond this
+#define HISTORY_READ_RECORDS 16
+#define HISTORY_ROW_MAX 256            // longest CSV row
+#define HISTORY_NO_VALUE -32768
+
+enum HistoryField : uint8_t {
+  HISTORY_IN_TEMP,
+  HISTORY_IN_RH,
+  HISTORY_IN_DP,
+  HISTORY_OUT_TEMP,
+  HISTORY_OUT_RH,
+  HISTORY_OUT_DP,
+  HISTORY_SPEED,       // fan speed % in effect at the sample
+  HISTORY_FIELDS
+};
+
+enum HistoryFormat : uint8_t {
+  HISTORY_CSV,
+  HISTORY_BINARY
+};
+
+struct HistoryHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t fieldCount;
+  uint8_t reserved;
+  uint32_t from;       // epoch of the first step
+  uint32_t step;       // s
+};
+
+static_assert(sizeof(HistoryHeader) == 16, "history header layout changed");
+
+class HistoryStream {
+public:
+  HistoryStream();
+
+  // Comma-separated field names; false (with the reason in error) on an
+  // unknown or repeated name
+  bool setFields(const String& list, String& error);
+  void setRange(uint32_t from, uint32_t to, uint32_t step);
+  void setFormat(HistoryFormat format) { this->format = format; }
+
+  // Next output bytes, 0 once everything was returned
+  size_t read(uint8_t* buf, size_t maxLen);
+
+  uint32_t getStep() const { return step; }
+  static const char* fieldName(HistoryField field);
+
+  // ?step= for a range: the requested step (0 = default) raised to
+  // HISTORY_MIN_STEP and so that at most HISTORY_MAX_POINTS steps result
+  static uint32_t chooseStep(uint32_t from, uint32_t to, uint32_t requested);
+
+private:
+  HistoryField fields[HISTORY_FIELDS];
+  uint8_t fieldCount;
+  HistoryFormat format;
+  uint32_t from;
+  uint32_t to;
+  uint32_t step;
+
+  // Trace reader
+  File file;
+  uint8_t fileIndex;       // next of TRACE_OLD_FILE, TRACE_FILE to open
+  TraceRecord records[HISTORY_READ_RECORDS];
+  uint8_t recordCount;
+  uint8_t recordPos;
+  uint32_t anchorEpoch;    // wall clock at anchorMs, 0 while unknown
+  uint32_t anchorMs;
+  uint16_t speed;
+
+  // Step being aggregated
+  bool bucketOpen;
+  uint32_t bucketStart;
+  float minimum[HISTORY_FIELDS];
+  float maximum[HISTORY_FIELDS];
+  float sum[HISTORY_FIELDS];
+  uint16_t count[HISTORY_FIELDS];
+
+  // Output not yet returned
+  uint8_t out[2 * HISTORY_ROW_MAX];
+  size_t outLen;
+  size_t outPos;
+  bool started;
+  bool done;
+
+  void writeHeader();
+  bool nextRecord(TraceRecord& rec);
+  void add(const TraceRecord& rec, uint32_t epoch);
+  void emitBucket();
+  void finish();
+};
+
+#endif
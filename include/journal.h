@@ -0,0 +1,96 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+
+// Decision journal: one fixed-size record per fan decision (mode, inputs,
+// the gate that fired and the outcome) in a ring file that survives reboots.
+// Unlike the trace (trace.h), which is for replay, it is meant to answer
+// "why didn't the fan run" on site, by time range over HTTP.
+//
+// Consecutive identical decisions (same mode, gate, reason, speed and sensor
+// validity) are folded into one record with a count for up to
+// JOURNAL_MERGE_MS; its inputs are those of the first decision. Records are
+// collected in a RAM page and written one page at a time, at an offset that
+// follows from the record's sequence number, so the file never needs
+// rewriting or rotation.
+
+#define JOURNAL_FILE "/journal.bin"
+#define JOURNAL_VERSION 1
+#define JOURNAL_PAGE_RECORDS 128              // 4 KB, one flash block per write
+#define JOURNAL_PAGES 48                      // 192 KB, ~3 weeks typical
+#define JOURNAL_SLOTS (JOURNAL_PAGE_RECORDS * JOURNAL_PAGES)
+#define JOURNAL_MERGE_MS 300000
+#define JOURNAL_FLUSH_INTERVAL 600000         // a partial page is written this often
+#define JOURNAL_QUERY_LIMIT 5000              // records per HTTP query
+#define JOURNAL_JSON_MAX 288                  // formatJSON() output per record
+
+#define JOURNAL_INTERNAL_VALID 0x01
+#define JOURNAL_EXTERNAL_VALID 0x02
+#define JOURNAL_BOOT 0x04                     // first decision after a restart
+
+struct JournalRecord {
+  uint32_t seq;          // 1, 2, ... ; 0 = empty slot
+  uint32_t epoch;        // time() of the first decision, 0 before NTP sync
+  uint32_t ms;           // millis() of the first decision
+  int16_t centi[6];      // in temp, RH, dew point, out temp, RH, dew point (x100)
+  uint16_t decisions;    // identical decisions folded into this record
+  uint8_t mode;          // ControlMode
+  uint8_t gate;          // DecisionGate
+  uint8_t reason;        // RunReason after the decision
+  uint8_t speed;         // fan speed after the decision
+  uint8_t flags;
+  uint8_t check;         // JOURNAL_VERSION + sum of the other bytes
+};
+
+static_assert(sizeof(JournalRecord) == 32, "journal record layout changed");
+
+class DecisionJournal {
+public:
+  DecisionJournal();
+  bool begin();
+
+  // Called after every control decision with the inputs it used
+  void update(const SensorData& internal, const SensorData& external, const FanController& fan);
+  void flush();
+
+  // Records still in the ring are [getOldestSeq(), getNextSeq())
+  uint32_t getOldestSeq() const;
+  uint32_t getNextSeq() const { return nextSeq; }
+
+  // Reader side, for the web server task: up to max records from seq on,
+  // from the file or from the RAM page if not written yet. Slots overwritten
+  // meanwhile fail isValid() or carry another seq; callers skip those.
+  size_t read(File& file, uint32_t seq, JournalRecord* out, size_t max) const;
+
+  // First seq at or after epoch, by binary search (records before NTP sync
+  // have no epoch and are placed by their successors)
+  uint32_t findEpoch(File& file, uint32_t epoch) const;
+
+  static bool isValid(const JournalRecord& rec);
+  static size_t formatJSON(const JournalRecord& rec, char* buf, size_t len);
+
+private:
+  JournalRecord page[JOURNAL_PAGE_RECORDS];
+  uint16_t pageIndex;      // ring page held in page[]
+  uint8_t used;            // records in page[]
+  uint32_t nextSeq;
+  bool ready;
+  bool dirty;
+  bool merging;            // page[used - 1] may still take identical decisions
+  bool booted;
+  unsigned long lastFlush;
+
+  static uint8_t checksum(const JournalRecord& rec);
+  void append(const JournalRecord& rec);
+  bool writePage();
+  void recover(File& file, size_t fileSize);
+};
+
+extern DecisionJournal decisionJournal;
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+
+class MQTTManager;
+
+// Prometheus text exposition (format 0.0.4) for GET /metrics. The metrics are
+// a static table in flash: family name, labels, type, help and a reader. A
+// scrape walks the table and formats a few samples at a time into the
+// stream's fixed buffer as the chunked response asks for more, so adding a
+// metric costs a table row and no heap at scrape time.
+
+#define METRICS_BUFFER 1024
+#define METRICS_LINE_MAX 256   // longest HELP/TYPE header plus one sample
+
+// loop() timing, kept by main.cpp and read by the network task
+struct LoopStats {
+  volatile uint32_t passes;
+  volatile uint32_t lastUs;
+  volatile uint32_t maxUs;
+  volatile uint64_t totalUs;   // two words: read until two reads agree
+};
+
+// What the readers look at; mqtt and loop may be null (not running / not
+// measured), and their metrics are then left out
+struct MetricsSources {
+  const SensorManager* sensors;
+  const FanController* fan;
+  MQTTManager* mqtt;
+  const LoopStats* loop;
+};
+
+enum MetricType : uint8_t {
+  METRIC_GAUGE,
+  METRIC_COUNTER
+};
+
+struct Metric {
+  const char* name;     // rows of one family are adjacent and share HELP/TYPE
+  const char* labels;   // without braces, "" for none
+  MetricType type;
+  const char* help;
+  uint8_t arg;          // passed to read(): location, mode, reason...
+  // false: no sample now (sensor invalid, source missing)
+  bool (*read)(const MetricsSources& sources, uint8_t arg, double& value);
+};
+
+class MetricsStream {
+public:
+  explicit MetricsStream(const MetricsSources& sources);
+
+  // Next output bytes, 0 once every metric was returned
+  size_t read(uint8_t* buf, size_t maxLen);
+
+  static size_t getMetricCount();
+
+private:
+  MetricsSources sources;
+  size_t index;
+  const char* family;   // name of the last HELP/TYPE written
+  char out[METRICS_BUFFER];
+  size_t outLen;
+  size_t outPos;
+
+  void format(const Metric& metric);
+};
+
+#endif
@@ -8,28 +8,50 @@
 #include "config.h"
 #include "sensors.h"
 #include "fancontrol.h"
+#include "overrides.h"
+#include "usage.h"
+#include "zones.h"
+#include "commands.h"
+
+#define MQTT_BUFFER_SIZE 1024
 
 class MQTTManager {
 public:
-  MQTTManager(SensorManager& sensors, FanController& fan);
+  MQTTManager(SensorManager& sensors, FanController& fan, OverrideManager& overrides,
+              const UsageMeter& usage, ZoneManager& zones, CommandQueue& commands);
   void begin();
   void loop();
   bool isConnected() { return mqttClient.connected(); }
+  uint32_t getReconnects() const { return connects > 0 ? connects - 1 : 0; }
   
 private:
   WiFiClient wifiClient;
   PubSubClient mqttClient;
   SensorManager& sensorManager;
   FanController& fanController;
+  OverrideManager& overrideManager;
+  const UsageMeter& usage;
+  ZoneManager& zones;
+  CommandQueue& commands;
   unsigned long lastPublish;
   unsigned long lastReconnectAttempt;
   bool discoveryPublished;
+  uint32_t connects;
+  uint32_t publishedOverrides;
+  uint32_t pendingTicket;    // last command queued, result not published yet
   
   void reconnect();
   void callback(char* topic, byte* payload, unsigned int length);
   void publishDiscovery();
   void publishSensors();
   void publishStatus();
+  void publishUsage();
+  void publishZones();
+  void handleZoneCommand(const String& message);
+  void publishOverrides();
+  void handleOverrideCommand(const String& message);
+  void queueCommand(const Command& cmd);
+  void publishCommandResult();
   
   String getDeviceId() const;
 };
@@ -0,0 +1,147 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+#include <Update.h>
+#include <atomic>
+#include <esp_ota_ops.h>
+#include <freertos/queue.h>
+#include <mbedtls/sha256.h>
+#include "delta.h"
+
+// Firmware upload over HTTP (POST /update). The upload handler runs on the
+// network task and only copies TCP segments into flash-sector sized blocks;
+// a writer task hashes each full block with SHA-256 and writes it to the
+// next OTA partition in one aligned write. With OTA_BLOCKS blocks in flight
+// the network keeps receiving while the flash is busy, and a sender faster
+// than the flash is held back by the handler waiting for a free block.
+//
+// The writer erases ahead in 64 KB blocks: one block erase takes about as
+// long as four sector erases, and erasing dominates the time of writing an
+// image (Update erases sector by sector). The partition only becomes the
+// boot partition at the end, after esp_ota_set_boot_partition() validated
+// the image, so a failed upload leaves the running firmware as it was.
+//
+// The body may also be a delta patch against the running firmware (delta.h),
+// told apart by its first bytes. The writer then decodes it into a sector
+// buffer and writes that the same way; the image it produces has to match
+// the size and SHA-256 the patch names.
+//
+// Given an expected digest (X-Update-SHA256 header or ?sha256=), an image
+// that does not match is refused as well; for a patch the digest is the
+// resulting image's, as for a full upload. The digest of an accepted image
+// is reported either way. A good upload only schedules the reboot: loop()
+// restarts once isRebootDue(), after the reply had time to go out.
+
+#define OTA_BLOCK_SIZE 4096          // one flash sector
+#define OTA_BLOCKS 4                 // 16 KB of heap while an upload runs
+#define OTA_ERASE_SIZE 65536         // erased ahead of the writes at a time
+#define OTA_IMAGE_MAGIC 0xE9         // first byte of an app image
+#define OTA_WRITER_STACK 4096
+#define OTA_WRITER_PRIORITY 2        // above loop(), below the network task
+#define OTA_BLOCK_WAIT_MS 5000       // no free block for this long: flash stuck
+#define OTA_FINISH_WAIT_MS 10000
+#define OTA_PROGRESS_INTERVAL 500    // "ota" events while receiving
+#define OTA_REBOOT_DELAY 1000
+
+enum OtaState : uint8_t {
+  OTA_IDLE,
+  OTA_RECEIVING,
+  OTA_SUCCESS,        // reboot scheduled
+  OTA_FAILED
+};
+
+struct OtaProgress {
+  OtaState state;
+  uint32_t received;     // bytes from the network
+  uint32_t written;      // bytes in flash
+  uint32_t total;        // request body size (a little above the image), 0 if unknown
+  uint32_t elapsedMs;
+  uint32_t rate;         // bytes written per second
+  const char* error;     // OTA_FAILED
+  bool rejected;         // the request or image was at fault, not the device
+  bool delta;            // the body is a patch: written runs ahead of received
+  const char* sha256;    // hex digest of the image once written, "" before
+};
+
+class OtaUpdater {
+public:
+  OtaUpdater();
+
+  // Upload handler (network task, or loop() for espota). expectedSha256: 64
+  // hex digits, or null or "" to accept any image. Returns the upload's
+  // session, which write(), end() and abort() take, or 0 while another
+  // upload runs or a verified one waits for the reboot. A session refused
+  // by a check here is still returned; its progress has the reason.
+  uint32_t begin(size_t total, const char* expectedSha256);
+  // false once the upload failed or for another session; the rest of the
+  // body can be dropped
+  bool write(uint32_t session, const uint8_t* data, size_t len);
+  // Writes the last block and waits for the writer: true if the image was
+  // verified and will boot
+  bool end(uint32_t session);
+  // Only while session is the one receiving
+  void abort(uint32_t session, const char* reason);
+
+  // Any task
+  bool isReceiving() const { return state.load(std::memory_order_acquire) == OTA_RECEIVING; }
+  OtaProgress getProgress() const;
+  size_t formatJSON(char* buf, size_t len) const;
+
+  // loop(): a verified image waits for the restart
+  bool isRebootDue() const;
+
+private:
+  struct Block {
+    uint16_t len;
+    uint8_t flags;
+    uint8_t data[OTA_BLOCK_SIZE];
+  };
+
+  QueueHandle_t freeBlocks;    // Block*, back from the writer
+  QueueHandle_t fullBlocks;    // Block*, to the writer
+  QueueHandle_t doneQueue;     // bool, the writer's verdict on the last block
+  Block* current;              // filled by the handler
+
+  // Writer task
+  const esp_partition_t* partition;
+  size_t erased;               // bytes of the partition erased so far
+  mbedtls_sha256_context sha;
+  uint8_t expected[32];
+  bool verify;
+  bool firstBlock;             // image or patch not yet told apart
+  DeltaDecoder patch;
+  uint8_t* staging;            // decoded image, written a sector at a time
+  size_t staged;
+  uint32_t patchedSize;        // what the patch says it makes
+  uint8_t patchedSha[32];
+
+  std::atomic<uint8_t> state;
+  std::atomic<uint32_t> session;     // the upload begin() handed out last
+  std::atomic<uint32_t> received;
+  std::atomic<uint32_t> written;     // also the writer's partition offset
+  std::atomic<const char*> error;    // first failure, may be set while receiving
+  std::atomic<bool> rejected;
+  std::atomic<bool> patching;
+  uint32_t total;
+  unsigned long startMs;
+  std::atomic<uint32_t> elapsedMs;   // set once the upload is over
+  unsigned long rebootAt;
+  char digest[65];
+
+  bool startWriter();
+  bool allocateBlocks();
+  void freeBlocksAll();
+  bool owns(uint32_t session) const;
+  bool finish(uint8_t flags);
+  void fail(const char* reason);
+  void reject(const char* reason);
+  static void writerTask(void* arg);
+  void writeBlock(Block* block);
+  size_t startPatch(const uint8_t* data, size_t len);
+  void finishPatch(bool complete);
+  static bool stageImage(void* context, const uint8_t* data, size_t len);
+  bool program(const uint8_t* data, size_t len);
+};
+
+#endif
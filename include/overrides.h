@@ -0,0 +1,71 @@
+#ifndef OVERRIDES_H
+#define OVERRIDES_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "config.h"
+#include "fancontrol.h"
+
+// Queue of future manual commands ("high tomorrow 22:00 for 3 h", "off during
+// the painting job"), kept as a binary min-heap on start time so loop() only
+// ever looks at the earliest one. Saved to LittleFS on every change.
+//
+// A command that comes due is removed from the queue and applied through
+// FanController::setMode()/setManualSpeed() with manualOverrideUntil set to
+// its end, so expiry back to AUTO works as for any manual override. Commands
+// need the wall clock: nothing starts before the first NTP sync.
+
+#define OVERRIDES_FILE "/overrides.json"
+#define MAX_OVERRIDES 16
+#define MAX_OVERRIDE_MIN (7 * 24 * 60)
+
+struct ScheduledOverride {
+  uint32_t id;
+  time_t start;          // wall clock
+  uint16_t durationMin;  // ignored for MODE_AUTO
+  ControlMode mode;      // MODE_DIAGNOSTIC runs at a fixed speed
+  uint8_t speed;
+};
+
+class OverrideManager {
+public:
+  OverrideManager();
+  void begin();
+
+  // Applies the earliest command once it is due; true if one was started
+  bool update(time_t now, FanController& fan);
+  // millis() at which the earliest command is due (false if none or no clock)
+  bool getNextDeadline(unsigned long& deadline) const;
+
+  // Returns the new id, or 0 if the command is invalid or the queue is full
+  uint32_t add(time_t start, unsigned long durationMin, ControlMode mode, int speed = 0);
+  bool cancel(uint32_t id);
+  void clear();
+
+  uint8_t getCount() const { return count; }
+  uint32_t getVersion() const { return version; }  // bumps on every change
+  String getJSON() const;                          // sorted by start
+
+  // "off", "low", "high", "auto" or "speed"
+  static bool parseMode(const String& name, ControlMode& mode);
+  static const char* modeName(ControlMode mode);
+  // Epoch seconds or local "YYYY-MM-DD HH:MM"; 0 if unparseable
+  static time_t parseTime(const String& text);
+
+private:
+  ScheduledOverride heap[MAX_OVERRIDES];
+  uint8_t count;
+  uint32_t nextId;
+  uint32_t version;
+
+  static bool before(const ScheduledOverride& a, const ScheduledOverride& b);
+  void siftUp(uint8_t i);
+  void siftDown(uint8_t i);
+  void removeAt(uint8_t i);
+  bool push(const ScheduledOverride& cmd);
+  void apply(const ScheduledOverride& cmd, time_t now, FanController& fan);
+  bool load();
+  bool save() const;
+};
+
+#endif
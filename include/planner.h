@@ -0,0 +1,115 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "config.h"
+#include "sensors.h"
+
+// Day-ahead ventilation plan. The planner learns the site's outdoor climate
+// as an hourly profile per season and weekday, and a two-parameter moisture
+// model of the cellar (absolute humidity rise per hour with the fan off, and
+// the share of the inside/outside gap removed per hour at 100% speed).
+//
+// Every hour it plans the next 24 h in 15-minute steps by dynamic
+// programming over the cellar's absolute humidity: the fewest fan hours (and
+// starts) that keep it under target_humidity at the current cellar
+// temperature, with speeds and off times from the weekly schedule. The DP
+// runs backwards a few steps per call so no loop() pass takes long; the
+// previous plan stays in force until the new one is complete.
+//
+// With "planner": {"enabled": true}, AUTO follows the plan for humidity runs
+// once PLAN_MIN_HOURS of history are learned. Safety limits, dew point
+// protection, forced circulation and cooling work as before.
+
+#define PLANNER_FILE "/planner.bin"
+#define PLANNER_MAGIC 0x314E4C50   // "PLN1"
+#define PLAN_STEP_MIN SCHEDULE_SLOT_MIN
+#define PLAN_STEPS (24 * 60 / PLAN_STEP_MIN)    // 96
+#define PLAN_BINS 64
+#define PLAN_BIN_G 0.08f           // g/m3 per humidity bin
+#define PLAN_STEPS_PER_CALL 8      // DP stages per update() call
+#define PLAN_MIN_HOURS 24          // learned hours before the plan is followed
+#define PLAN_SAVE_HOURS 6
+#define PROFILE_SEASONS 4
+
+struct ProfileCell {
+  int16_t temp;      // outdoor °C x100
+  int16_t ah;        // outdoor g/m3 x100
+  uint8_t samples;   // hours averaged in, saturating
+};
+
+struct MoistureModel {
+  float ingress;     // g/m3 per hour with the fan off
+  float exchange;    // share of the inside/outside gap removed per hour at 100%
+  uint32_t hours;    // hours learned
+};
+
+class VentilationPlanner {
+public:
+  VentilationPlanner();
+  void begin();   // restores the learned profile and model from LittleFS
+
+  // Call after every decision: learns, rolls over hours and advances the DP
+  void update(const SensorData& internal, const SensorData& external, int fanSpeed);
+
+  // False without a plan for now (disabled, learning, no clock); otherwise
+  // run tells whether the plan ventilates in the current step
+  bool getPlanned(time_t now, bool& run) const;
+  // Wall clock of the next plan step, 0 without a plan
+  time_t nextStep(time_t now) const;
+
+  const MoistureModel& getModel() const { return model; }
+  String getJSON() const;
+
+private:
+  ProfileCell profile[PROFILE_SEASONS][7][24];
+  MoistureModel model;
+  bool persistent;
+
+  // Current hour's observations
+  int hourKey;             // yday * 24 + hour, -1 before the first sample
+  time_t firstSample, lastSample;
+  float outTempSum, outAhSum;
+  float inAhFirst, inAhLast, inTempLast;
+  uint32_t samples;
+  float runHours;          // speed-weighted fan hours this hour
+  unsigned long lastUpdate;
+  int lastSpeed;
+  float lastOutTemp, lastOutAh;
+  uint32_t hoursSinceSave;
+
+  // DP in progress
+  bool planning;
+  int stage;
+  time_t workStart;
+  float workLo, workLimit, workAh;
+  float outAh[PLAN_STEPS];
+  float removal[PLAN_STEPS];               // share of the gap one run step removes
+  float value[2][PLAN_BINS][2];            // [parity][bin][was running]
+  uint8_t policy[PLAN_STEPS][PLAN_BINS];   // bit per "was running": run now
+  unsigned long workMicros;
+
+  // Plan in force
+  bool planValid;
+  time_t planStart;
+  uint32_t planBits[PLAN_STEPS / 32];
+  float planAh[PLAN_STEPS];
+  float planLimit;
+  float planRunHours;
+  unsigned long planMicros;
+
+  void closeHour(time_t now);
+  void learn(float rate, float runFrac, float gap);
+  bool forecast(time_t at, float& temp, float& ah) const;
+  void startPlan(time_t now);
+  void stepPlan();
+  void finishPlan();
+  float lookup(int parity, float ah, int wasRunning) const;
+  float advance(float ah, int step, bool run) const;
+  static int seasonOf(const struct tm& t);
+  bool load();
+  bool save() const;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+
+// Site rules from config.json, e.g.
+//   {"name": "fog", "when": "out.rh > 90", "then": "off"}
+//   {"name": "boost", "when": "in.rh_rate > 5 and hour >= 8", "then": "high"}
+// compiled on load into stack-machine bytecode. The first rule whose
+// condition holds decides: "off" stops the fan ahead of forced circulation,
+// "low", "high" or a speed % run it once the safety checks pass (within the
+// schedule's limit). A rule with an input that is not known yet (rates in the
+// first 20 minutes, hour and weekday before NTP) does not hold.
+//
+// Conditions use + - * /, < <= > >= == !=, and or not (also && || !),
+// parentheses, abs() min() max() and the inputs below.
+
+#define RULE_MAX 8
+#define RULE_CODE_BYTES 256     // bytecode of all rules
+#define RULE_MAX_CONSTS 32
+#define RULE_STACK 8
+#define RULE_RATE_STEP 600000   // rate history sample spacing (ms)
+#define RULE_RATE_SAMPLES 7     // one hour back
+#define RULE_RATE_MIN_AGE 1200000
+
+enum RuleInput : uint8_t {
+  INPUT_IN_TEMP,
+  INPUT_IN_RH,
+  INPUT_IN_DP,
+  INPUT_IN_AH,
+  INPUT_OUT_TEMP,
+  INPUT_OUT_RH,
+  INPUT_OUT_DP,
+  INPUT_OUT_AH,
+  INPUT_IN_TEMP_RATE,   // °C per hour
+  INPUT_IN_RH_RATE,     // %RH per hour
+  INPUT_HOUR,           // local time of day, 13.5 = 13:30
+  INPUT_WEEKDAY,        // 1 = Monday ... 7 = Sunday
+  INPUT_SPEED,          // fan speed % before this decision
+  RULE_INPUTS
+};
+
+enum RuleAction : uint8_t {
+  ACTION_OFF,
+  ACTION_LOW,
+  ACTION_HIGH,
+  ACTION_SPEED
+};
+
+enum RuleOp : uint8_t {
+  OP_CONST,    // + constant index
+  OP_INPUT,    // + RuleInput
+  OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_NEG,
+  OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+  OP_AND, OP_OR, OP_NOT,
+  OP_ABS, OP_MIN, OP_MAX
+};
+
+struct Rule {
+  String name;
+  String when;        // source, kept for saving and the API
+  RuleAction action;
+  uint8_t speed;      // ACTION_SPEED
+  uint8_t codeStart;
+  uint16_t codeLength; // up to RULE_CODE_BYTES: one rule may fill the buffer
+  uint16_t inputs;    // bit per RuleInput the condition reads
+};
+
+class RuleProgram {
+public:
+  RuleProgram();
+  void clear();
+
+  // Compiles and appends a rule; false (with the reason in error) if it
+  // does not parse or does not fit
+  bool addRule(const String& name, const String& when, const String& then, String& error);
+
+  uint8_t getCount() const { return count; }
+  const Rule& getRule(uint8_t i) const { return rules[i]; }
+  String getAction(uint8_t i) const;
+  uint16_t getInputs() const { return inputs; }    // union of all rules
+  uint16_t getCodeSize() const { return codeSize; }
+  uint16_t getGeneration() const { return generation; }
+
+  // Runs rule i on a full set of inputs
+  bool run(uint8_t i, const float* values) const;
+
+  static const char* inputName(RuleInput input);
+
+private:
+  Rule rules[RULE_MAX];
+  uint8_t count;
+  uint8_t code[RULE_CODE_BYTES];
+  uint16_t codeSize;
+  float consts[RULE_MAX_CONSTS];
+  uint8_t constCount;
+  uint16_t inputs;
+  uint16_t generation;   // changes on every clear()/addRule()
+
+  friend class RuleCompiler;
+};
+
+struct SensorData;
+
+// Per-fan evaluation state: input values, the rate history and each rule's
+// last result, which is reused until one of the inputs it reads changes
+class RuleEngine {
+public:
+  RuleEngine();
+
+  // First rule that holds, or -1; only inputs some rule reads are computed
+  int evaluate(const RuleProgram& program, const SensorData& internal,
+               const SensorData& external, int speed);
+
+  uint32_t getRuns() const { return runs; }         // conditions executed
+  uint32_t getReuses() const { return reuses; }     // cached results used
+
+private:
+  float values[RULE_INPUTS];
+  bool results[RULE_MAX];
+  bool fresh;             // no results cached yet
+  uint16_t generation;
+  uint32_t runs;
+  uint32_t reuses;
+
+  struct RateSample {
+    unsigned long ms;
+    float temp;
+    float rh;
+  };
+  RateSample history[RULE_RATE_SAMPLES];
+  uint8_t historyCount;
+  uint8_t historyHead;   // newest
+
+  void track(const SensorData& internal, unsigned long now);
+  float rate(bool humidity, const SensorData& internal, unsigned long now) const;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// Weekly speed schedule compiled from config.json rules into one bitmap per
+// class, at 15-minute resolution. A slot in the "off" bitmap allows no
+// ventilation runs, one in the "high" bitmap allows high speed, anything else
+// is capped at low speed. Holidays use the slots of a chosen weekday.
+//
+// Rules look like "mon-thu 00:00-15:00", "sat,sun 08:00-20:00" or
+// "daily 22:00-06:00" (an end at or before the start runs into the next day).
+
+#define SCHEDULE_SLOT_MIN 15
+#define SCHEDULE_SLOTS_PER_DAY (24 * 60 / SCHEDULE_SLOT_MIN)
+#define SCHEDULE_SLOTS (7 * SCHEDULE_SLOTS_PER_DAY)   // 672
+#define SCHEDULE_WORDS (SCHEDULE_SLOTS / 32)
+#define SCHEDULE_MAX_RULES 8
+#define SCHEDULE_MAX_HOLIDAYS 16
+
+enum ScheduleClass {
+  SCHEDULE_HIGH,
+  SCHEDULE_OFF,
+  SCHEDULE_CLASSES
+};
+
+enum SpeedLimit {
+  LIMIT_OFF,
+  LIMIT_LOW,
+  LIMIT_HIGH
+};
+
+struct Holiday {
+  uint16_t year;   // 0 = every year
+  uint8_t month;
+  uint8_t day;
+};
+
+class WeeklySchedule {
+public:
+  WeeklySchedule();
+  void clear();
+  void setDefaults();  // high speed Mon-Thu 22:00-15:00 and Fri from 22:00
+
+  bool addRule(ScheduleClass cls, const String& rule);
+  bool addHoliday(const String& date);
+  bool setHolidayWeekday(const String& day);
+
+  // O(1) after the first call: localtime_r only runs again once the cached
+  // slot run ends (at the latest, local midnight). Not thread-safe: for the
+  // decision path in loop() only
+  SpeedLimit limitAt(time_t now);
+  // Uncached and const, for other tasks and lookahead: the limit at now and
+  // when its run of equal slots ends
+  SpeedLimit evaluate(time_t now, time_t& until) const;
+  // Earliest time the limit may change (transition or local midnight)
+  time_t nextBoundary(time_t now);
+  // Next actual change of limit, searched up to 8 days ahead (0 if none)
+  time_t nextChange(time_t now) const;
+
+  SpeedLimit slotLimit(int slot) const;
+  const uint32_t* bitmap(ScheduleClass cls) const { return bits[cls]; }
+  uint8_t getRuleCount(ScheduleClass cls) const { return ruleCount[cls]; }
+  const String& getRule(ScheduleClass cls, uint8_t i) const { return rules[cls][i]; }
+  uint8_t getHolidayCount() const { return holidayCount; }
+  String getHoliday(uint8_t i) const;
+  String getHolidayWeekday() const;
+
+  static const char* className(ScheduleClass cls);
+  static const char* limitName(SpeedLimit limit);
+
+private:
+  uint32_t bits[SCHEDULE_CLASSES][SCHEDULE_WORDS];
+  String rules[SCHEDULE_CLASSES][SCHEDULE_MAX_RULES];
+  uint8_t ruleCount[SCHEDULE_CLASSES];
+  Holiday holidays[SCHEDULE_MAX_HOLIDAYS];
+  uint8_t holidayCount;
+  uint8_t holidayWeekday;
+
+  time_t cacheFrom;
+  time_t cacheUntil;
+  SpeedLimit cached;
+
+  void setSlots(ScheduleClass cls, uint8_t dayMask, int startSlot, int slotCount);
+  bool isHoliday(const struct tm& t) const;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef SENSOR_DRIVERS_H
+#define SENSOR_DRIVERS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Register-level drivers for the climate sensors we fit. Every device runs in
+// forced (one-shot) mode: a sample is one trigger write followed by one burst
+// read, and the parts sleep between samples.
+
+#define AHT20_ADDR 0x38
+#define SHT4X_ADDR 0x44
+
+struct SensorSample {
+  float temperature;
+  float humidity;
+  float pressure;   // hPa
+};
+
+// Bosch BMP280 / BME280 (same register map, BME280 adds humidity)
+class Bmx280 {
+public:
+  Bmx280();
+  bool begin(TwoWire& wire, uint8_t addr);
+  bool trigger();
+  bool read(SensorSample& out, bool withHumidity);
+  bool hasHumidity() const { return chipId == 0x60; }
+  uint16_t conversionTimeMs() const;
+
+private:
+  TwoWire* wire;
+  uint8_t addr;
+  uint8_t chipId;
+
+  uint16_t dig_T1;
+  int16_t dig_T2, dig_T3;
+  uint16_t dig_P1;
+  int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
+  uint8_t dig_H1, dig_H3;
+  int16_t dig_H2, dig_H4, dig_H5;
+  int8_t dig_H6;
+
+  bool readCalibration();
+};
+
+// Sensirion SHT40/41/45
+class Sht4x {
+public:
+  Sht4x();
+  bool begin(TwoWire& wire, uint8_t addr = SHT4X_ADDR);
+  bool trigger();
+  bool read(SensorSample& out);
+  uint16_t conversionTimeMs() const { return 9; }
+
+private:
+  TwoWire* wire;
+  uint8_t addr;
+};
+
+// ASAIR AHT20
+class Aht20 {
+public:
+  Aht20();
+  bool begin(TwoWire& wire, uint8_t addr = AHT20_ADDR);
+  bool trigger();
+  bool read(SensorSample& out);
+  uint16_t conversionTimeMs() const { return 80; }
+
+private:
+  TwoWire* wire;
+  uint8_t addr;
+};
+
+// Driver combinations selectable with -DSENSOR_DRIVER=<name>. Each one exposes
+// begin(wire, boschAddr)/sample() and is plugged into SensorManager at compile
+// time.
+
+// AHT20 for temperature/humidity + BMP280 for pressure (original modules)
+class AhtBmpDriver {
+public:
+  static const char* name() { return "AHT20+BMP280"; }
+  bool begin(TwoWire& wire, uint8_t bmpAddr);
+  bool sample(SensorSample& out);
+
+private:
+  Aht20 aht;
+  Bmx280 bmp;
+  bool bmpPresent = false;
+};
+
+// Single BME280: temperature, humidity and pressure in one burst
+class Bme280Driver {
+public:
+  static const char* name() { return "BME280"; }
+  bool begin(TwoWire& wire, uint8_t bmeAddr);
+  bool sample(SensorSample& out);
+
+private:
+  Bmx280 bme;
+};
+
+// SHT4x for temperature/humidity + BMP280 for pressure
+class Sht4xBmpDriver {
+public:
+  static const char* name() { return "SHT4x+BMP280"; }
+  bool begin(TwoWire& wire, uint8_t bmpAddr);
+  bool sample(SensorSample& out);
+
+private:
+  Sht4x sht;
+  Bmx280 bmp;
+  bool bmpPresent = false;
+};
+
+#ifndef SENSOR_DRIVER
+#define SENSOR_DRIVER AhtBmpDriver
+#endif
+
+#endif
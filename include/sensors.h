@@ -3,8 +3,8 @@
 
 #include <Arduino.h>
 #include <Wire.h>
-#include <Adafruit_AHTX0.h>
-#include <Adafruit_BMP280.h>
+#include "config.h"
+#include "sensor_drivers.h"
 
 struct SensorData {
   float temperature;
@@ -13,35 +13,131 @@ struct SensorData {
   float dewPoint;
   bool valid;
   unsigned long lastUpdate;
-  
-  SensorData() : temperature(0), humidity(0), pressure(0), 
+
+  SensorData() : temperature(0), humidity(0), pressure(0),
                  dewPoint(0), valid(false), lastUpdate(0) {}
 };
 
-class SensorManager {
+// Driver-independent part of the sensor manager
+class SensorManagerBase {
 public:
-  SensorManager();
-  bool begin();
-  void update();
-  
   SensorData getInternalData() const { return internal; }
   SensorData getExternalData() const { return external; }
-  
+  // Indoor sensors of other zones (see zones.h), read along with the main pair
+  SensorData getZoneData(uint8_t location) const { return zoneData[location]; }
+
   static float calculateDewPoint(float temp, float humidity);
+  static float calculateAbsoluteHumidity(float temp, float humidity);
   bool isDataFresh(unsigned long maxAge = 30000) const;
-  
-private:
-  Adafruit_AHTX0 aht_internal;
-  Adafruit_AHTX0 aht_external;
-  Adafruit_BMP280 bmp_internal;
-  Adafruit_BMP280 bmp_external;
-  
+  // Failed multiplexer selects and sensor reads since boot
+  uint32_t getI2CErrors() const { return i2cErrors; }
+
+protected:
   SensorData internal;
   SensorData external;
-  
+  SensorData zoneData[MAX_ZONES - 1];
+  uint8_t zoneChannels[MAX_ZONES - 1];
+  uint8_t zoneLocations = 0;
+  uint32_t i2cErrors = 0;
+
   void selectMuxChannel(uint8_t channel);
-  void readInternalSensors();
-  void readExternalSensors();
+  void storeSample(SensorData& data, const SensorSample& sample);
+};
+
+// Sensor manager parameterised on the driver combination fitted at the site
+// (see sensor_drivers.h). Both locations sit behind the TCA9548A on Wire.
+template <typename Driver>
+class BasicSensorManager : public SensorManagerBase {
+public:
+  bool begin();
+  void update();
+  // Extra indoor sensor on another mux channel; its location index or -1
+  int addZoneSensor(uint8_t muxChannel);
+
+  static const char* driverName() { return Driver::name(); }
+
+private:
+  Driver internalDriver;
+  Driver externalDriver;
+  Driver zoneDrivers[MAX_ZONES - 1];
+
+  void readLocation(Driver& driver, uint8_t muxChannel, SensorData& data, const char* label);
 };
 
-#endif
\ No newline at end of file
+template <typename Driver>
+bool BasicSensorManager<Driver>::begin() {
+  bool success = true;
+
+  // Initialize internal I2C bus (Wire) with multiplexer
+  Wire.begin(PIN_INTERNAL_SDA, PIN_INTERNAL_SCL);
+  Wire.setClock(100000);
+  delay(100);
+
+  Serial.printf("  Sensor driver: %s\n", Driver::name());
+
+  // Initialize internal sensors on MUX channel 0
+  selectMuxChannel(MUX_CHANNEL_INTERNAL);
+  if (!internalDriver.begin(Wire, BMP280_ADDR_INTERNAL)) {
+    Serial.printf("❌ Internal %s not found\n", Driver::name());
+    success = false;
+  } else {
+    Serial.printf("✓ Internal %s initialized\n", Driver::name());
+  }
+
+  // Initialize external sensors on MUX channel 1
+  selectMuxChannel(MUX_CHANNEL_EXTERNAL);
+  if (!externalDriver.begin(Wire, BMP280_ADDR_EXTERNAL)) {
+    Serial.printf("❌ External %s not found\n", Driver::name());
+    success = false;
+  } else {
+    Serial.printf("✓ External %s initialized\n", Driver::name());
+  }
+
+  return success;
+}
+
+template <typename Driver>
+int BasicSensorManager<Driver>::addZoneSensor(uint8_t muxChannel) {
+  for (uint8_t i = 0; i < zoneLocations; i++) {
+    if (zoneChannels[i] == muxChannel) return i;
+  }
+  if (zoneLocations >= MAX_ZONES - 1) return -1;
+
+  uint8_t index = zoneLocations++;
+  zoneChannels[index] = muxChannel;
+  selectMuxChannel(muxChannel);
+  if (zoneDrivers[index].begin(Wire, BMP280_ADDR_INTERNAL)) {
+    Serial.printf("✓ Zone %s on mux channel %u initialized\n", Driver::name(), muxChannel);
+  } else {
+    Serial.printf("❌ Zone %s on mux channel %u not found\n", Driver::name(), muxChannel);
+  }
+  return index;
+}
+
+template <typename Driver>
+void BasicSensorManager<Driver>::update() {
+  readLocation(internalDriver, MUX_CHANNEL_INTERNAL, internal, "internal");
+  readLocation(externalDriver, MUX_CHANNEL_EXTERNAL, external, "external");
+  for (uint8_t i = 0; i < zoneLocations; i++) {
+    readLocation(zoneDrivers[i], zoneChannels[i], zoneData[i], "zone");
+  }
+}
+
+template <typename Driver>
+void BasicSensorManager<Driver>::readLocation(Driver& driver, uint8_t muxChannel,
+                                              SensorData& data, const char* label) {
+  selectMuxChannel(muxChannel);
+  SensorSample sample;
+
+  if (driver.sample(sample)) {
+    storeSample(data, sample);
+  } else {
+    Serial.printf("⚠️ Failed to read %s sensors\n", label);
+    data.valid = false;
+    i2cErrors++;
+  }
+}
+
+typedef BasicSensorManager<SENSOR_DRIVER> SensorManager;
+
+#endif
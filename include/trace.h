@@ -0,0 +1,87 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+
+// Binary trace of sensor snapshots, mode changes and fan decisions, appended to
+// LittleFS so a host can replay real data through FanController
+// (tools/trace_replay.cpp). When TRACE_FILE reaches TRACE_MAX_BYTES it is
+// rotated to TRACE_OLD_FILE.
+//
+// File layout: TraceHeader, then fixed-size TraceRecords in time order.
+
+#define TRACE_FILE "/trace.bin"
+#define TRACE_OLD_FILE "/trace.old"
+#define TRACE_MAGIC 0x31525443  // "CTR1"
+#define TRACE_VERSION 1
+#define TRACE_MAX_BYTES 262144       // ~11 days at one sample per minute
+#define TRACE_BUFFER_RECORDS 32
+
+enum TraceRecordType : uint8_t {
+  TRACE_BOOT = 1,    // millis() restarted; epoch set if the clock was valid
+  TRACE_CLOCK,       // wall clock at ms (on NTP sync, then hourly)
+  TRACE_SAMPLE,      // inputs of the decision at ms
+  TRACE_MODE,        // currentMode changed
+  TRACE_DECISION     // fan speed or reason changed
+};
+
+#define TRACE_INTERNAL_VALID 0x01
+#define TRACE_EXTERNAL_VALID 0x02
+
+struct TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+};
+
+struct TraceRecord {
+  uint8_t type;
+  uint8_t flags;     // SAMPLE: valid bits, MODE: ControlMode, DECISION: RunReason
+  uint16_t value;    // MODE: override minutes left, DECISION: speed
+  uint32_t ms;       // millis() at the event
+  union {
+    int16_t centi[4];  // SAMPLE: in temp, in RH, out temp, out RH (x100)
+    uint32_t epoch;    // BOOT/CLOCK: time() at ms, 0 if not synced
+  } data;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace record layout changed");
+
+class TraceRecorder {
+public:
+  TraceRecorder();
+  bool begin();
+
+  // Called after every control decision with the inputs it used
+  void update(const SensorData& internal, const SensorData& external, const FanController& fan);
+  void flush();
+
+  size_t getFileSize() const { return fileBytes + buffered * sizeof(TraceRecord); }
+  uint32_t getRecordCount() const { return records; }
+
+private:
+  TraceRecord buffer[TRACE_BUFFER_RECORDS];
+  uint8_t buffered;
+  size_t fileBytes;
+  uint32_t records;
+  bool ready;
+
+  unsigned long lastSample;
+  unsigned long lastClock;
+  unsigned long lastFlush;
+  bool clockValid;
+  ControlMode lastMode;
+  int lastSpeed;
+  RunReason lastReason;
+
+  void append(const TraceRecord& rec);
+  void recordClock(uint8_t type, unsigned long now);
+  bool startFile();
+};
+
+extern TraceRecorder traceRecorder;
+
+#endif
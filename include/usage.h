@@ -0,0 +1,73 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+
+// Fan usage accounting: runtime per RunReason and per 10% speed band, starts,
+// energy from the configured power curve and water removed (airflow times
+// the inside-outside absolute humidity gap). Counters are integrated on every
+// decision, rolled up per local day and month, and written to LittleFS in one
+// batch every USAGE_SAVE_INTERVAL and at each day change.
+
+#define USAGE_FILE "/usage.bin"
+#define USAGE_MAGIC 0x32475355   // "USG2"
+#define USAGE_SPEED_BANDS 10      // 1-10%, 11-20%, ... 91-100%
+#define USAGE_REASONS 8           // RunReason values
+#define USAGE_DAYS 31
+#define USAGE_MONTHS 12
+#define USAGE_SAVE_INTERVAL 3600000   // ms
+
+struct UsageCounters {
+  uint32_t reasonSeconds[USAGE_REASONS];
+  uint32_t speedSeconds[USAGE_SPEED_BANDS];
+  uint32_t starts;
+  double energyWh;   // double: small increments onto years of totals
+  double waterG;
+};
+
+struct UsagePeriod {
+  uint32_t key;   // YYYYMMDD or YYYYMM, 0 = unused
+  UsageCounters counters;
+};
+
+class UsageMeter {
+public:
+  UsageMeter();
+  void begin();
+  void update(const SensorData& internal, const SensorData& external, const FanController& fan);
+  void flush();   // write pending counters now (before OTA or restart)
+
+  // {"total", "today", "month"} in full; with history, per-day and per-month
+  // runtime, energy, water and starts instead
+  String getJSON(bool history) const;
+  String getSummaryJSON() const;   // for MQTT
+
+  static float fanWatts(int speed);
+
+private:
+  UsageCounters total;
+  UsagePeriod days[USAGE_DAYS];       // ring, days[dayHead] is today
+  UsagePeriod months[USAGE_MONTHS];   // ring, months[monthHead] is this month
+  uint8_t dayHead;
+  uint8_t monthHead;
+
+  bool persistent;
+  bool dirty;
+  unsigned long lastUpdate;
+  unsigned long carryMs;
+  unsigned long lastSave;
+  int lastSpeed;
+  RunReason lastReason;
+
+  void add(UsageCounters& c, uint32_t seconds, double wh, double water) const;
+  void countStart();
+  bool rollover(time_t now);
+  bool load();
+  bool save();
+};
+
+#endif
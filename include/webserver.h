@@ -22,26 +22,108 @@
 #include "config.h"
 #include "sensors.h"
 #include "fancontrol.h"
+#include "overrides.h"
+#include "planner.h"
+#include "efficiency.h"
+#include "usage.h"
+#include "zones.h"
+#include "commands.h"
+#include "metrics.h"
+#include "ota.h"
+
+// GET /api/status serves a snapshot serialized once per change by update()
+// into a fixed buffer, with a version ETag (a per-boot tag plus a counter)
+// so pollers can revalidate with If-None-Match. RSSI, uptime and free heap
+// in it are refreshed every STATUS_SYSTEM_INTERVAL, not per request.
+#define STATUS_JSON_MAX 768
+#define STATUS_SYSTEM_INTERVAL 30000   // also the events keep-alive
+
+// Status push on /api/events (Server-Sent Events): a "status" snapshot when a
+// client connects, then "delta" events with only the top-level status
+// sections that changed. Each delta is encoded once for all clients; a
+// client that falls EVENTS_CLIENT_BACKLOG messages behind is disconnected
+// (the browser reconnects and starts over from a snapshot).
+#define EVENTS_MAX_CLIENTS 4
+#define EVENTS_CLIENT_BACKLOG 8
+#define EVENTS_SECTIONS 4
+
+// PATCH /api/config bodies above this are refused (413)
+#define CONFIG_PATCH_MAX 2048
+
+#define OTA_JSON_MAX 320   // GET /api/ota and "ota" events
 
 class WebServerManager {
 public:
-  WebServerManager(SensorManager& sensors, FanController& fan);
+  WebServerManager(SensorManager& sensors, FanController& fan, OverrideManager& overrides,
+                   const VentilationPlanner& planner, const EfficiencyEstimator& efficiency,
+                   const UsageMeter& usage, ZoneManager& zones, CommandQueue& commands,
+                   OtaUpdater& ota);
   void begin();
   
+  // Call after each control decision: refreshes the status snapshot and
+  // pushes what changed to event stream clients, if any
+  void update();
+  
+  // Optional sources for /metrics
+  void setMQTT(MQTTManager* mqtt) { metricsSources.mqtt = mqtt; }
+  void setLoopStats(const LoopStats* loop) { metricsSources.loop = loop; }
+  
 private:
   AsyncWebServer server;
+  AsyncEventSource events;
+  SemaphoreHandle_t eventsLock;   // eventClients, shared with the network task
+  AsyncEventSourceClient* eventClients[EVENTS_MAX_CLIENTS];
+  uint8_t eventClientCount;
+  uint32_t sectionHash[EVENTS_SECTIONS];
+  uint32_t eventId;
+  
+  SemaphoreHandle_t statusLock;   // statusJSON, read by the network task
+  char statusJSON[STATUS_JSON_MAX];
+  size_t statusLength;
+  uint32_t statusVersion;
+  uint32_t statusTag;             // differs per boot, so old ETags never match
+  unsigned long lastSystemRefresh;
+  int8_t systemRssi;
+  uint32_t systemUptime;
+  uint32_t systemHeap;
   SensorManager& sensorManager;
   FanController& fanController;
+  OverrideManager& overrideManager;
+  const VentilationPlanner& planner;
+  const EfficiencyEstimator& efficiency;
+  const UsageMeter& usage;
+  ZoneManager& zones;
+  CommandQueue& commands;
+  OtaUpdater& ota;
+  unsigned long lastOtaEvent;     // network task
+  MetricsSources metricsSources;
   
   void setupRoutes();
-  String getMainHTML() const;
+  void buildStatus(JsonDocument& doc) const;
   String getStatusJSON() const;
+  void publishEvents(JsonDocument& doc, bool system);
+  void dropSlowClients();
   String getConfigJSON() const;
+  String getScheduleJSON() const;
+  String getRulesJSON() const;
   
+  void handleDashboard(AsyncWebServerRequest *request);
+  void handleStatus(AsyncWebServerRequest *request);
   void handleSetMode(AsyncWebServerRequest *request);
+  void sendCommand(AsyncWebServerRequest *request, const Command& cmd);
+  void handleGetCommand(AsyncWebServerRequest *request);
   void handleSetConfig(AsyncWebServerRequest *request);
+  void handlePatchConfig(AsyncWebServerRequest *request);
+  void handleAddOverride(AsyncWebServerRequest *request);
+  void handleCancelOverride(AsyncWebServerRequest *request);
+  void handleJournal(AsyncWebServerRequest *request);
+  void handleHistory(AsyncWebServerRequest *request);
+  void handleMetrics(AsyncWebServerRequest *request);
+  void handleSetZoneMode(AsyncWebServerRequest *request);
   void handleOTAUpload(AsyncWebServerRequest *request, String filename, 
                       size_t index, uint8_t *data, size_t len, bool final);
+  void handleOTAResult(AsyncWebServerRequest *request);
+  void publishOtaProgress(bool force);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+
+// Additional fans ("zones" in config.json). Zone 0 is the main fan, driven
+// by main.cpp with the global mode and override. Zones 1.. each get their
+// own FanController with their own relay and dimmer channel (sharing the
+// zero-cross detector), indoor sensor, mode and manual override expiry.
+//
+// All zones are updated in the same pass right after the main fan, in id
+// order, so a ZONE_FOLLOW fan always sees its leader's decision of this
+// pass: an exhaust fan following the supply fan at a fixed ratio keeps the
+// cellar at balanced pressure and never runs alone.
+
+struct Zone {
+  FanController* fan;
+  ControlMode mode;
+  unsigned long overrideUntil;
+  int8_t sensor;   // SensorManager zone location, -1 = the main indoor sensor
+};
+
+class ZoneManager {
+public:
+  ZoneManager();
+  void begin(SensorManager& sensors, FanController& mainFan);
+
+  // Call right after the main fan's update(), with its inputs
+  void update(const SensorData& internal, const SensorData& external);
+  bool isUpdatePending() const;
+  // Moves deadline (millis) earlier if a zone needs an update sooner
+  void getNextDeadline(unsigned long& deadline) const;
+
+  uint8_t getCount() const { return count + 1; }   // including the main fan
+  // Manual mode for zone id (0 = main fan); speed only for MODE_DIAGNOSTIC
+  bool setMode(uint8_t id, ControlMode mode, unsigned long durationMin, int speed = 0);
+  const FanController* getFan(uint8_t id) const { return fanOf(id); }   // nullptr if none
+  void stopAll();   // zones 1.. off, e.g. for OTA
+  String getJSON() const;
+
+private:
+  SensorManager* sensors;
+  FanController* mainFan;
+  Zone zones[MAX_ZONES - 1];   // zones[i] is zone id i + 1
+  uint8_t count;
+
+  FanController* fanOf(uint8_t id) const;
+};
+
+#endif
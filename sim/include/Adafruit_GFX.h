@@ -0,0 +1,36 @@
+#ifndef SIM_ADAFRUIT_GFX_H
+#define SIM_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+// Text and line drawing only; pixels are discarded
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t w, int16_t h) : width_(w), height_(h) {}
+
+  size_t write(uint8_t c) override { (void)c; return 1; }
+  using Print::write;
+
+  void setTextSize(uint8_t s) { (void)s; }
+  void setTextColor(uint16_t c) { (void)c; }
+  void setTextColor(uint16_t c, uint16_t bg) { (void)c; (void)bg; }
+  void setCursor(int16_t x, int16_t y) { (void)x; (void)y; }
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    (void)x0; (void)y0; (void)x1; (void)y1; (void)color;
+  }
+  void drawPixel(int16_t x, int16_t y, uint16_t color) { (void)x; (void)y; (void)color; }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    (void)x; (void)y; (void)w; (void)h; (void)color;
+  }
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    (void)x; (void)y; (void)w; (void)h; (void)color;
+  }
+  int16_t width() const { return width_; }
+  int16_t height() const { return height_; }
+
+private:
+  int16_t width_;
+  int16_t height_;
+};
+
+#endif
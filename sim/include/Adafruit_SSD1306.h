@@ -0,0 +1,36 @@
+#ifndef SIM_ADAFRUIT_SSD1306_H
+#define SIM_ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC 0x01
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi = &Wire, int8_t rst = -1)
+    : Adafruit_GFX(w, h), frames(0) {
+    (void)twi;
+    (void)rst;
+  }
+
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0) {
+    (void)switchvcc;
+    (void)i2caddr;
+    return true;
+  }
+  void clearDisplay() {}
+  void display() { frames++; }
+
+  // Simulation hooks
+  uint32_t simFrames() const { return frames; }
+
+private:
+  uint32_t frames;
+};
+
+#endif
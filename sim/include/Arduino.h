@@ -0,0 +1,271 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Host stand-in for the Arduino-ESP32 core, used by the native environments.
+// Only what the firmware actually uses is provided.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <string>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <algorithm>
+
+// As in the ESP32 core: min()/max() are the std templates, not macros
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+// Simulated clock: delay() advances it instead of sleeping
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+
+// SNTP is not simulated: the clock is already set (see sim::setEpoch)
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// ============================================================================
+// String
+// ============================================================================
+
+class String {
+public:
+  String() {}
+  String(const char* s) : str(s ? s : "") {}
+  String(const std::string& s) : str(s) {}
+  explicit String(char c) : str(1, c) {}
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimals = 2);
+  explicit String(double value, unsigned int decimals = 2);
+
+  const char* c_str() const { return str.c_str(); }
+  unsigned int length() const { return (unsigned int)str.size(); }
+  bool isEmpty() const { return str.empty(); }
+  bool reserve(unsigned int size) { str.reserve(size); return true; }
+
+  bool concat(const String& s) { str += s.str; return true; }
+  bool concat(const char* s) { if (s) str += s; return true; }
+  bool concat(const char* s, unsigned int len) { if (s) str.append(s, len); return true; }
+  bool concat(char c) { str += c; return true; }
+  bool concat(int v) { return concat(String(v)); }
+  bool concat(unsigned int v) { return concat(String(v)); }
+  bool concat(long v) { return concat(String(v)); }
+  bool concat(unsigned long v) { return concat(String(v)); }
+  bool concat(float v) { return concat(String(v)); }
+  bool concat(double v) { return concat(String(v)); }
+
+  template <typename T>
+  String& operator+=(const T& v) { concat(v); return *this; }
+
+  bool operator==(const String& o) const { return str == o.str; }
+  bool operator==(const char* s) const { return str == (s ? s : ""); }
+  bool operator!=(const String& o) const { return str != o.str; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+  bool operator<(const String& o) const { return str < o.str; }
+  bool equals(const String& o) const { return str == o.str; }
+  bool equalsIgnoreCase(const String& o) const;
+
+  char charAt(unsigned int i) const { return i < str.size() ? str[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { return str[i]; }
+  void setCharAt(unsigned int i, char c) { if (i < str.size()) str[i] = c; }
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String& s, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  bool startsWith(const String& prefix) const { return str.compare(0, prefix.str.size(), prefix.str) == 0; }
+  bool endsWith(const String& suffix) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+  void replace(const String& find, const String& with);
+  void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+  long toInt() const { return strtol(str.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(str.c_str(), nullptr); }
+  double toDouble() const { return strtod(str.c_str(), nullptr); }
+  void toCharArray(char* buf, unsigned int size) const;
+
+private:
+  std::string str;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
+String operator+(const String& a, int b);
+String operator+(const String& a, unsigned int b);
+String operator+(const String& a, long b);
+String operator+(const String& a, unsigned long b);
+String operator+(const String& a, float b);
+String operator+(const String& a, double b);
+
+// ============================================================================
+// Print / Stream / Serial
+// ============================================================================
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = 10) { return print(String(v, base)); }
+  size_t print(unsigned int v, int base = 10) { return print(String(v, base)); }
+  size_t print(long v, int base = 10) { return print(String(v, base)); }
+  size_t print(unsigned long v, int base = 10) { return print(String(v, base)); }
+  size_t print(double v, int digits = 2) { return print(String(v, digits)); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T>
+  size_t println(const T& v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+  size_t printf(const char* format, ...);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+
+  void setTimeout(unsigned long ms) { (void)ms; }
+  size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  String readStringUntil(char terminator);
+  String readString();
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  operator bool() const { return true; }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+
+  // Simulation hooks
+  void setMuted(bool muted) { this->muted = muted; }
+  bool isMuted() const { return muted; }
+  void inject(const char* input) { rx += input; }
+
+private:
+  bool muted = false;
+  std::string rx;
+};
+
+extern HardwareSerial Serial;
+
+// ============================================================================
+// IPAddress
+// ============================================================================
+
+class IPAddress {
+public:
+  IPAddress() : addr(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : addr((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+  bool fromString(const char* s);
+  bool fromString(const String& s) { return fromString(s.c_str()); }
+  String toString() const;
+  operator uint32_t() const { return addr; }
+  uint8_t operator[](int i) const { return (addr >> (8 * i)) & 0xFF; }
+
+private:
+  uint32_t addr;
+};
+
+// ============================================================================
+// ESP
+// ============================================================================
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getHeapSize() { return 327680; }
+  const char* getChipModel() { return "ESP32-D0WDQ6 (host sim)"; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+  uint32_t getSketchSize() { return 1200 * 1024; }
+  uint32_t getFreeSketchSpace() { return 1920 * 1024; }
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  void restart();
+};
+
+extern EspClass ESP;
+
+// ============================================================================
+// Simulation control
+// ============================================================================
+
+namespace sim {
+  uint64_t nowUs();
+  void advanceUs(uint64_t us);
+
+  // Wall-clock epoch that time() reports at millis() == 0
+  void setEpoch(time_t epoch);
+  time_t epoch();
+
+  // Moves the clock to an absolute point, e.g. back to 0 for a replayed reboot
+  void setNowUs(uint64_t us);
+
+  // Heap counters reported by ESP.getFreeHeap()/getMinFreeHeap()
+  void setFreeHeap(uint32_t bytes);
+
+  int pinState(uint8_t pin);
+  bool restartRequested();
+}
+
+#endif
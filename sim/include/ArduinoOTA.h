@@ -0,0 +1,42 @@
+#ifndef SIM_ARDUINOOTA_H
+#define SIM_ARDUINOOTA_H
+
+#include <Arduino.h>
+#include <Update.h>
+
+typedef enum {
+  OTA_AUTH_ERROR,
+  OTA_BEGIN_ERROR,
+  OTA_CONNECT_ERROR,
+  OTA_RECEIVE_ERROR,
+  OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+  typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+  ArduinoOTAClass& setHostname(const char* hostname) { (void)hostname; return *this; }
+  ArduinoOTAClass& setPassword(const char* password) { (void)password; return *this; }
+  ArduinoOTAClass& setPort(uint16_t port) { (void)port; return *this; }
+  ArduinoOTAClass& onStart(THandlerFunction fn) { startCb = fn; return *this; }
+  ArduinoOTAClass& onEnd(THandlerFunction fn) { endCb = fn; return *this; }
+  ArduinoOTAClass& onError(THandlerFunction_Error fn) { errorCb = fn; return *this; }
+  ArduinoOTAClass& onProgress(THandlerFunction_Progress fn) { progressCb = fn; return *this; }
+  void begin() {}
+  void end() {}
+  void handle() {}
+  int getCommand() { return U_FLASH; }
+
+private:
+  THandlerFunction startCb;
+  THandlerFunction endCb;
+  THandlerFunction_Error errorCb;
+  THandlerFunction_Progress progressCb;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef SIM_ESPASYNCWEBSERVER_H
+#define SIM_ESPASYNCWEBSERVER_H
+
+// Host stand-in for ESPAsyncWebServer. Routes are registered as on the device
+// and can be exercised with AsyncWebServer::simRequest(); responses are
+// captured on the request object instead of going to a socket.
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+#include <deque>
+#include <memory>
+
+#ifndef HTTP_GET
+#define HTTP_GET 1
+#define HTTP_POST 2
+#define HTTP_DELETE 3
+#define HTTP_PUT 4
+#define HTTP_PATCH 5
+#define HTTP_HEAD 6
+#define HTTP_OPTIONS 7
+#define HTTP_ANY 255
+#endif
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool)>
+    ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value, bool form = false)
+    : _name(name), _value(value), _form(form) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  bool isPost() const { return _form; }
+
+private:
+  String _name;
+  String _value;
+  bool _form;
+};
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+
+private:
+  String _name;
+  String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+  AsyncWebServerResponse(int code, const String& contentType) : _code(code), _contentType(contentType) {}
+  virtual ~AsyncWebServerResponse() {}
+  void addHeader(const char* name, const char* value) { _headers.emplace_back(name, value); }
+  void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+  void setCode(int code) { _code = code; }
+  void setContentType(const String& type) { _contentType = type; }
+
+  int code() const { return _code; }
+  const String& contentType() const { return _contentType; }
+  const std::vector<AsyncWebHeader>& headers() const { return _headers; }
+
+  // Drains the body the way the TCP layer would: in chunks of up to maxLen
+  virtual size_t fill(uint8_t* buf, size_t maxLen, size_t index) = 0;
+
+protected:
+  int _code;
+  String _contentType;
+  std::vector<AsyncWebHeader> _headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse {
+public:
+  AsyncBasicResponse(int code, const String& contentType, const uint8_t* data, size_t len)
+    : AsyncWebServerResponse(code, contentType), body((const char*)data, len) {}
+  size_t fill(uint8_t* buf, size_t maxLen, size_t index) override;
+
+private:
+  std::string body;
+};
+
+class AsyncChunkedResponse : public AsyncWebServerResponse {
+public:
+  AsyncChunkedResponse(int code, const String& contentType, AwsResponseFiller filler)
+    : AsyncWebServerResponse(code, contentType), filler(filler) {}
+  size_t fill(uint8_t* buf, size_t maxLen, size_t index) override { return filler(buf, maxLen, index); }
+
+private:
+  AwsResponseFiller filler;
+};
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(WebRequestMethodComposite method, const String& url)
+    : _method(method), _url(url) {}
+  ~AsyncWebServerRequest();
+
+  WebRequestMethodComposite method() const { return _method; }
+  const String& url() const { return _url; }
+  size_t contentLength() const { return _body.size(); }
+
+  bool hasParam(const char* name, bool post = false, bool file = false) const;
+  bool hasParam(const String& name, bool post = false, bool file = false) const {
+    return hasParam(name.c_str(), post, file);
+  }
+  const AsyncWebParameter* getParam(const char* name, bool post = false, bool file = false) const;
+  const AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const {
+    return getParam(name.c_str(), post, file);
+  }
+  size_t params() const { return _params.size(); }
+  const AsyncWebParameter* getParam(size_t i) const { return i < _params.size() ? &_params[i] : nullptr; }
+  bool hasArg(const char* name) const { return hasParam(name) || hasParam(name, true); }
+  const String& arg(const char* name) const;
+
+  bool hasHeader(const char* name) const;
+  const AsyncWebHeader* getHeader(const char* name) const;
+  String header(const char* name) const;
+
+  AsyncWebServerResponse* beginResponse(int code, const char* contentType = "", const String& content = String());
+  AsyncWebServerResponse* beginResponse(int code, const char* contentType, const uint8_t* content, size_t len);
+  AsyncWebServerResponse* beginChunkedResponse(const char* contentType, AwsResponseFiller filler);
+  AsyncWebServerResponse* beginResponse(fs::FS& fs, const String& path, const String& contentType = String(),
+                                        bool download = false);
+
+  void send(AsyncWebServerResponse* response);
+  void send(int code, const char* contentType = "", const String& content = String()) {
+    send(beginResponse(code, contentType, content));
+  }
+  void send(fs::FS& fs, const String& path, const String& contentType = String(), bool download = false) {
+    send(beginResponse(fs, path, contentType, download));
+  }
+
+  void onDisconnect(std::function<void()> fn) { _onDisconnect = fn; }
+
+  // Handler scratch (e.g. a body being assembled); free()d with the request
+  void* _tempObject = nullptr;
+
+  // Simulation hooks
+  void simAddParam(const String& name, const String& value, bool post = false) {
+    _params.emplace_back(name, value, post);
+  }
+  void simAddHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+  void simSetBody(const std::string& body) { _body = body; }
+  const std::string& simBody() const { return _body; }
+  int simResponseCode() const { return _sent ? _sent->code() : 0; }
+  const std::string& simResponseBody() const { return _responseBody; }
+  String simResponseHeader(const char* name) const;
+
+private:
+  WebRequestMethodComposite _method;
+  String _url;
+  std::vector<AsyncWebParameter> _params;
+  std::vector<AsyncWebHeader> _headers;
+  std::string _body;
+  std::unique_ptr<AsyncWebServerResponse> _sent;
+  std::string _responseBody;
+  std::function<void()> _onDisconnect;
+};
+
+class AsyncEventSource;
+
+// Server-Sent Events. A broadcast is encoded once and the same buffer is
+// queued to every client; the "network" takes queued messages with
+// simDrain(), so a client that is never drained backs up like a slow one.
+class AsyncEventSourceClient {
+public:
+  AsyncEventSourceClient(AsyncEventSource* source) : _source(source) {}
+
+  void send(const char* message, const char* event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
+  size_t packetsWaiting() const { return _queue.size(); }
+  bool connected() const { return _connected; }
+  void close();   // disconnects (and deletes) the client before returning
+
+  // Simulation hooks
+  void simQueue(std::shared_ptr<const std::string> message) { _queue.push_back(message); }
+  std::vector<std::string> simDrain();
+
+private:
+  AsyncEventSource* _source;
+  std::deque<std::shared_ptr<const std::string>> _queue;
+  bool _connected = true;
+};
+
+typedef std::function<void(AsyncEventSourceClient*)> ArEventHandlerFunction;
+
+class AsyncEventSource {
+public:
+  AsyncEventSource(const String& url) : _url(url) {}
+
+  const String& url() const { return _url; }
+  void onConnect(ArEventHandlerFunction cb) { _connectcb = cb; }
+  void onDisconnect(ArEventHandlerFunction cb) { _disconnectcb = cb; }
+  void send(const char* message, const char* event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
+  size_t count() const { return _clients.size(); }
+
+  static std::string encode(const char* message, const char* event, uint32_t id, uint32_t reconnect);
+
+  // Simulation hooks: a browser opening or leaving the stream. The client
+  // pointer is only valid while it stays connected.
+  AsyncEventSourceClient* simConnect();
+  void simDisconnect(AsyncEventSourceClient* client);
+
+private:
+  String _url;
+  std::vector<std::unique_ptr<AsyncEventSourceClient>> _clients;
+  ArEventHandlerFunction _connectcb;
+  ArEventHandlerFunction _disconnectcb;
+};
+
+class AsyncWebServer {
+public:
+  AsyncWebServer(uint16_t port) : _port(port) {}
+  ~AsyncWebServer() { end(); }
+
+  void begin();
+  void end();
+  void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+  void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+          ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr);
+  void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+  void addHandler(AsyncEventSource* source) { _eventSources.push_back(source); }
+
+  // Simulation hooks: dispatches the request (and its body, if any) to the
+  // matching route, then drains the response into the request object.
+  void simRequest(AsyncWebServerRequest& request);
+  // The started server on a port, for tools that only hold the firmware's
+  // owner object (nullptr if none)
+  static AsyncWebServer* simOnPort(uint16_t port);
+  // Paces request bodies in wall time like a TCP link of this rate: a piece
+  // arrives no sooner than the link carries it, nor before the handler took
+  // the one a receive window earlier (0 = instant, the default)
+  void simSetLink(uint32_t bytesPerSecond, uint32_t windowBytes);
+
+private:
+  struct Route {
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction onRequest;
+    ArUploadHandlerFunction onUpload;
+    ArBodyHandlerFunction onBody;
+  };
+
+  uint16_t _port;
+  std::vector<Route> _routes;
+  std::vector<AsyncEventSource*> _eventSources;
+  ArRequestHandlerFunction _notFound;
+  uint32_t _linkRate = 0;
+  uint32_t _linkWindow = 0;
+
+  void deliverBody(AsyncWebServerRequest& request, const std::string& body,
+                   const std::function<void(size_t index, size_t len)>& handler);
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+// Host stand-in for the ESP32 LittleFS, backed by a directory on the host
+// (default .pio/simfs, see LittleFS.simSetRoot()).
+
+#include <FS.h>
+
+class LittleFSFS : public fs::FS {
+public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+  void end() {}
+  bool format();
+  size_t totalBytes() { return 1408 * 1024; }
+  size_t usedBytes();
+
+  // Simulation hooks
+  void simSetRoot(const char* dir) { root = dir; }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
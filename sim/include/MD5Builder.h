@@ -0,0 +1,29 @@
+#ifndef SIM_MD5BUILDER_H
+#define SIM_MD5BUILDER_H
+
+// Host stand-in for the Arduino core's MD5Builder (the ROM's MD5 on the
+// ESP32): a plain RFC 1321 implementation
+
+#include <Arduino.h>
+
+class MD5Builder {
+public:
+  void begin();
+  void add(const uint8_t* data, size_t len);
+  void add(const char* data) { add((const uint8_t*)data, strlen(data)); }
+  void add(const String& data) { add((const uint8_t*)data.c_str(), data.length()); }
+  void calculate();
+  void getBytes(uint8_t* output) const { memcpy(output, digest, sizeof(digest)); }
+  void getChars(char* output) const;   // 32 hex digits and a terminator
+  String toString() const;
+
+private:
+  uint32_t state[4];
+  uint64_t total;
+  uint8_t buffer[64];
+  uint8_t digest[16];
+
+  void transform(const uint8_t* block);
+};
+
+#endif
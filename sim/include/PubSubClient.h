@@ -0,0 +1,70 @@
+#ifndef SIM_PUBSUBCLIENT_H
+#define SIM_PUBSUBCLIENT_H
+
+// Host stand-in for PubSubClient. Disconnected unless the simulator says a
+// broker is reachable; published messages are counted, not sent.
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient {
+public:
+  PubSubClient(Client& client) { (void)client; }
+
+  PubSubClient& setServer(const char* domain, uint16_t port) { (void)domain; (void)port; return *this; }
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) { this->callback = callback; return *this; }
+  bool setBufferSize(uint16_t size) { (void)size; return true; }
+  PubSubClient& setKeepAlive(uint16_t keepAlive) { (void)keepAlive; return *this; }
+
+  bool connect(const char* id) { (void)id; return connectImpl(); }
+  bool connect(const char* id, const char* user, const char* pass) {
+    (void)id; (void)user; (void)pass;
+    return connectImpl();
+  }
+  void disconnect() { isConnected = false; }
+  bool connected() { return isConnected; }
+  bool loop() { return isConnected; }
+  int state() { return isConnected ? MQTT_CONNECTED : MQTT_CONNECTION_TIMEOUT; }
+
+  bool subscribe(const char* topic) { (void)topic; return isConnected; }
+  bool publish(const char* topic, const char* payload) { return publish(topic, payload, false); }
+  bool publish(const char* topic, const char* payload, bool retained) {
+    (void)topic; (void)retained;
+    if (!isConnected) return false;
+    published++;
+    publishedBytes += payload ? strlen(payload) : 0;
+    return true;
+  }
+
+  // Simulation hooks
+  static void simSetBrokerReachable(bool reachable) { brokerReachable() = reachable; }
+  void simDeliver(const char* topic, const char* payload) {
+    if (!callback) return;
+    std::string t(topic);
+    callback(&t[0], (uint8_t*)payload, (unsigned int)strlen(payload));
+  }
+  uint32_t simPublished() const { return published; }
+  uint32_t simPublishedBytes() const { return publishedBytes; }
+
+private:
+  std::function<void(char*, uint8_t*, unsigned int)> callback;
+  bool isConnected = false;
+  uint32_t published = 0;
+  uint32_t publishedBytes = 0;
+
+  static bool& brokerReachable() {
+    static bool reachable = false;
+    return reachable;
+  }
+  bool connectImpl() {
+    isConnected = brokerReachable();
+    return isConnected;
+  }
+};
+
+#endif
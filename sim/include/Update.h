@@ -0,0 +1,62 @@
+#ifndef SIM_UPDATE_H
+#define SIM_UPDATE_H
+
+// Host stand-in for the ESP32 Update class: accepts an image into memory.
+// Like the real one it collects writes into a flash-sector buffer and erases
+// and programs a sector whenever that fills, at the cost set with
+// simSetFlashTiming() (esp_partition.h).
+
+#include <Arduino.h>
+#include <vector>
+#include <esp_partition.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_WRITE 1
+#define UPDATE_ERROR_SPACE 4
+#define UPDATE_ERROR_SIZE 5
+#define UPDATE_ERROR_ABORT 8
+#define UPDATE_ERROR_MAGIC_BYTE 10   // U_FLASH data not starting like an app image
+
+class UpdateClass {
+public:
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1,
+             uint8_t ledOn = LOW, const char* label = nullptr);
+  size_t write(uint8_t* data, size_t len);
+  bool end(bool evenIfRemaining = false);
+  void abort();
+  bool hasError() const { return error != UPDATE_ERROR_OK; }
+  uint8_t getError() const { return error; }
+  const char* errorString() const;
+  void printError(Print& out);
+  bool isRunning() const { return running; }
+  bool isFinished() const { return finished; }
+  size_t size() const { return expected; }
+  size_t progress() const { return image.size(); }
+  size_t remaining() const { return expected == UPDATE_SIZE_UNKNOWN ? 0 : expected - image.size(); }
+
+  // Simulation hooks
+  const std::vector<uint8_t>& simImage() const { return image; }
+  uint32_t simWriteCalls() const { return writeCalls; }
+  uint32_t simSectorWrites() const { return sectorWrites; }
+
+private:
+  std::vector<uint8_t> image;
+  size_t expected = 0;
+  uint8_t error = UPDATE_ERROR_OK;
+  bool running = false;
+  bool flash = true;
+  bool finished = false;
+  uint32_t writeCalls = 0;
+  uint32_t sectorWrites = 0;
+  size_t buffered = 0;   // bytes in the sector buffer
+
+  void flushSector();
+};
+
+extern UpdateClass Update;
+
+#endif
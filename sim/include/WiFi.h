@@ -0,0 +1,80 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+class Client : public Stream {
+public:
+  virtual int connect(const char* host, uint16_t port) = 0;
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+  virtual operator bool() = 0;
+};
+
+// Never reaches a peer: the simulator has no network underneath
+class WiFiClient : public Client {
+public:
+  int connect(const char* host, uint16_t port) override { (void)host; (void)port; return 0; }
+  int connect(IPAddress ip, uint16_t port) { (void)ip; (void)port; return 0; }
+  uint8_t connected() override { return 0; }
+  void stop() override {}
+  operator bool() override { return false; }
+  size_t write(uint8_t c) override { (void)c; return 0; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t* buf, size_t size) { (void)buf; (void)size; return -1; }
+  int peek() override { return -1; }
+};
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m) { (void)m; return true; }
+  bool setHostname(const char* name) { (void)name; return true; }
+  bool config(IPAddress ip, IPAddress gateway, IPAddress subnet) {
+    localAddress = ip;
+    (void)gateway;
+    (void)subnet;
+    return true;
+  }
+  wl_status_t begin(const char* ssid, const char* password = nullptr) {
+    (void)ssid;
+    (void)password;
+    return status();
+  }
+  wl_status_t status() { return linkUp ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool isConnected() { return linkUp; }
+  IPAddress localIP() { return localAddress; }
+  int8_t RSSI() { return linkUp ? rssi : 0; }
+  String macAddress() { return String("A1:B2:C3:D4:E5:F6"); }
+
+  // Simulation hooks
+  void simSetLink(bool up, int8_t signal = -62) {
+    linkUp = up;
+    rssi = signal;
+  }
+
+private:
+  bool linkUp = true;
+  int8_t rssi = -62;
+  IPAddress localAddress = IPAddress(192, 168, 0, 139);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef SIM_WIFIUDP_H
+#define SIM_WIFIUDP_H
+
+#include <Arduino.h>
+
+// Never receives a packet: the simulator has no network underneath
+class WiFiUDP : public Stream {
+public:
+  uint8_t begin(uint16_t port) { (void)port; return 1; }
+  void stop() {}
+  int parsePacket() { return 0; }
+  IPAddress remoteIP() { return IPAddress(); }
+  uint16_t remotePort() { return 0; }
+  int beginPacket(IPAddress ip, uint16_t port) { (void)ip; (void)port; return 1; }
+  int endPacket() { return 1; }
+  size_t write(uint8_t c) override { (void)c; return 1; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t* buffer, size_t len) { (void)buffer; (void)len; return 0; }
+  int read(char* buffer, size_t len) { return read((uint8_t*)buffer, len); }
+  int peek() override { return -1; }
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+// Host stand-in for the ESP32 TwoWire. Transactions are routed to attached
+// device models and accounted for, so host tools can report bus occupancy.
+
+#include <Arduino.h>
+
+class SimI2cDevice {
+public:
+  virtual ~SimI2cDevice() {}
+  virtual void onWrite(const uint8_t* data, size_t len) = 0;
+  virtual size_t onRead(uint8_t* data, size_t len) = 0;
+};
+
+struct SimI2cStats {
+  uint32_t transactions;
+  uint32_t bytes;
+  uint64_t busBits;   // SCL clocks incl. start/stop and ACK bits
+};
+
+class TwoWire {
+public:
+  TwoWire(uint8_t busNum);
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() const { return clock; }
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t* data, size_t len);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t len, bool sendStop = true);
+  int available();
+  int read();
+
+  // Simulation hooks
+  void attach(uint8_t address, SimI2cDevice* device);
+  void detachAll();
+  const SimI2cStats& stats() const { return busStats; }
+  void resetStats();
+  uint64_t busTimeUs() const;
+
+private:
+  static const int MAX_DEVICES = 16;
+  static const size_t BUFFER_SIZE = 128;
+
+  uint32_t clock;
+  uint8_t deviceAddr[MAX_DEVICES];
+  SimI2cDevice* devices[MAX_DEVICES];
+  int deviceCount;
+
+  uint8_t txAddr;
+  uint8_t txBuf[BUFFER_SIZE];
+  size_t txLen;
+  uint8_t rxBuf[BUFFER_SIZE];
+  size_t rxLen;
+  size_t rxPos;
+  SimI2cStats busStats;
+
+  SimI2cDevice* find(uint8_t address);
+  void account(size_t payloadBytes);
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SIM_ROM_MINIZ_H
+#define SIM_ROM_MINIZ_H
+
+// Host stand-in for the ESP32 ROM's tinfl (miniz inflate), on zlib. Same
+// calling convention: the caller's output is a ring of a power-of-two size
+// and tinfl_decompress() fills it from pOut_buf_next; zlib keeps its own
+// window, so the ring is only written here, never read back.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef struct {
+  uint32_t m_state;
+  uint8_t m_opaque[10984];   // the ROM decoder's tables, for its size
+} tinfl_decompressor;
+
+// Raw deflate unless TINFL_FLAG_PARSE_ZLIB_HEADER; a decoder re-initialised
+// or reallocated at the same address drops its previous zlib stream
+void simTinflInit(tinfl_decompressor* r);
+#define tinfl_init(r) simTinflInit(r)
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const uint32_t decomp_flags);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef SIM_ESP_OTA_OPS_H
+#define SIM_ESP_OTA_OPS_H
+
+// Host stand-in for the ESP-IDF OTA partition calls the firmware uses
+
+#include "esp_partition.h"
+
+// app0, holding what simSetRunningImage() put there
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from);
+// Validates the image first: only the app magic byte here
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+
+// Simulation hooks
+const esp_partition_t* simBootPartition();
+void simResetBootPartition();
+// The firmware that runs: delta patches apply against it
+void simSetRunningImage(const uint8_t* image, size_t size);
+
+#endif
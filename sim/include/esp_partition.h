@@ -0,0 +1,39 @@
+#ifndef SIM_ESP_PARTITION_H
+#define SIM_ESP_PARTITION_H
+
+// Host stand-in for ESP-IDF partition access, with the running app partition
+// and one OTA app partition in memory. Flash is modelled as such: erasing sets bytes to 0xFF and a write
+// can only clear bits, so writing unerased flash corrupts the data.
+// simSetFlashTiming() makes erases and writes cost wall time, for upload
+// benchmarks; UpdateClass uses the same model.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+#define SIM_FLASH_BLOCK 65536
+#define SIM_FLASH_PAGE 256
+
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size);
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size);
+
+// Simulation hooks
+void simSetFlashTiming(uint32_t sectorEraseUs, uint32_t blockEraseUs, uint32_t pageProgramUs);
+// Wall time of erasing a range: 64 KB blocks where aligned, sectors elsewhere
+void simFlashEraseDelay(size_t offset, size_t size);
+void simFlashProgramDelay(size_t size);
+// The OTA partition
+const std::vector<uint8_t>& simPartitionData();
+uint32_t simFlashErases();
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// Host stand-in for the FreeRTOS types and macros the firmware uses. The
+// simulation runs setup()/loop() as the only task.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimTask* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+// Direct-to-task notifications. A take with nothing pending advances the
+// simulated clock by the whole timeout, as nothing else can give meanwhile.
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+// Other tasks run on host threads of their own; they may only share queues
+// (freertos/queue.h) with the loop task, not the simulated clock
+typedef void (*TaskFunction_t)(void*);
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef RBDIMMER_H
+#define RBDIMMER_H
+
+// Host stand-in for lib/RBDdimmer/rbdimmerESP32: same API, channel levels are
+// only stored so the simulator can read them back.
+
+#include <Arduino.h>
+
+#define RBDIMMER_MAX_PHASES 4
+#define RBDIMMER_MAX_CHANNELS 8
+
+typedef enum {
+  RBDIMMER_CURVE_LINEAR,
+  RBDIMMER_CURVE_RMS,
+  RBDIMMER_CURVE_LOGARITHMIC,
+  RBDIMMER_CURVE_CUSTOM
+} rbdimmer_curve_t;
+
+typedef enum {
+  RBDIMMER_OK = 0,
+  RBDIMMER_ERR_INVALID_ARG,
+  RBDIMMER_ERR_NO_MEMORY,
+  RBDIMMER_ERR_NOT_FOUND,
+  RBDIMMER_ERR_ALREADY_EXIST,
+  RBDIMMER_ERR_TIMER_FAILED,
+  RBDIMMER_ERR_GPIO_FAILED
+} rbdimmer_err_t;
+
+typedef struct rbdimmer_channel_s rbdimmer_channel_t;
+
+typedef struct {
+  uint8_t gpio_pin;
+  uint8_t phase;
+  uint8_t initial_level;
+  rbdimmer_curve_t curve_type;
+} rbdimmer_config_t;
+
+rbdimmer_err_t rbdimmer_init(void);
+rbdimmer_err_t rbdimmer_register_zero_cross(uint8_t pin, uint8_t phase, uint16_t frequency);
+rbdimmer_err_t rbdimmer_create_channel(rbdimmer_config_t* config, rbdimmer_channel_t** channel);
+rbdimmer_err_t rbdimmer_set_level(rbdimmer_channel_t* channel, uint8_t level_percent);
+rbdimmer_err_t rbdimmer_set_level_transition(rbdimmer_channel_t* channel, uint8_t level_percent, uint32_t transition_ms);
+rbdimmer_err_t rbdimmer_set_curve(rbdimmer_channel_t* channel, rbdimmer_curve_t curve_type);
+rbdimmer_err_t rbdimmer_set_active(rbdimmer_channel_t* channel, bool active);
+uint8_t rbdimmer_get_level(rbdimmer_channel_t* channel);
+uint16_t rbdimmer_get_frequency(uint8_t phase);
+rbdimmer_err_t rbdimmer_set_callback(uint8_t phase, void (*callback)(void*), void* user_data);
+rbdimmer_err_t rbdimmer_update_all(void);
+rbdimmer_err_t rbdimmer_delete_channel(rbdimmer_channel_t* channel);
+rbdimmer_err_t rbdimmer_deinit(void);
+bool rbdimmer_is_active(rbdimmer_channel_t* channel);
+rbdimmer_curve_t rbdimmer_get_curve(rbdimmer_channel_t* channel);
+uint32_t rbdimmer_get_delay(rbdimmer_channel_t* channel);
+
+// Simulation hooks
+int sim_rbdimmer_channel_count(void);
+rbdimmer_channel_t* sim_rbdimmer_channel(int index);
+uint8_t sim_rbdimmer_gpio(rbdimmer_channel_t* channel);
+
+#endif
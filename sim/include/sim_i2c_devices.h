@@ -0,0 +1,73 @@
+#ifndef SIM_I2C_DEVICES_H
+#define SIM_I2C_DEVICES_H
+
+// Register-level models of the I2C parts on the sensor bus
+
+#include <Wire.h>
+
+// TCA9548A: one control byte selects the downstream channels
+class SimTca9548a : public SimI2cDevice {
+public:
+  SimTca9548a() : mask(0) {}
+  void onWrite(const uint8_t* data, size_t len) override { mask = data[len - 1]; }
+  size_t onRead(uint8_t* data, size_t len) override;
+  uint8_t channelMask() const { return mask; }
+
+private:
+  uint8_t mask;
+};
+
+// Same address on several mux channels: dispatch to the selected one
+class SimMuxedDevice : public SimI2cDevice {
+public:
+  SimMuxedDevice(const SimTca9548a& mux);
+  void bind(uint8_t channel, SimI2cDevice* device);
+  void onWrite(const uint8_t* data, size_t len) override;
+  size_t onRead(uint8_t* data, size_t len) override;
+
+private:
+  const SimTca9548a& mux;
+  SimI2cDevice* channels[8];
+  SimI2cDevice* selected();
+};
+
+class SimAht20 : public SimI2cDevice {
+public:
+  SimAht20();
+  void setReading(float temperature, float humidity);
+  void onWrite(const uint8_t* data, size_t len) override;
+  size_t onRead(uint8_t* data, size_t len) override;
+
+private:
+  float temperature;
+  float humidity;
+  bool measured;
+};
+
+class SimSht4x : public SimI2cDevice {
+public:
+  SimSht4x();
+  void setReading(float temperature, float humidity);
+  void onWrite(const uint8_t* data, size_t len) override;
+  size_t onRead(uint8_t* data, size_t len) override;
+
+private:
+  float temperature;
+  float humidity;
+  uint8_t lastCommand;
+};
+
+// BMP280 (chip id 0x58) or BME280 (0x60). Returns the datasheet example
+// calibration and raw values: 25.08 degC, 1006.53 hPa (~52 %RH on BME280).
+class SimBmx280 : public SimI2cDevice {
+public:
+  SimBmx280(uint8_t chipId);
+  void onWrite(const uint8_t* data, size_t len) override;
+  size_t onRead(uint8_t* data, size_t len) override;
+
+private:
+  uint8_t regs[256];
+  uint8_t pointer;
+};
+
+#endif
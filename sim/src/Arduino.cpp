@@ -0,0 +1,307 @@
+#include <Arduino.h>
+#include <ctype.h>
+
+static uint64_t simTimeUs = 0;
+static time_t simEpoch = 1767225600;  // 2026-01-01 00:00:00 UTC
+static uint8_t pins[64];
+static uint32_t freeHeap = 240000;
+static uint32_t minFreeHeap = 240000;
+static bool restartFlag = false;
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace sim {
+  uint64_t nowUs() { return simTimeUs; }
+  void advanceUs(uint64_t us) { simTimeUs += us; }
+  void setNowUs(uint64_t us) { simTimeUs = us; }
+  void setEpoch(time_t e) { simEpoch = e; }
+  time_t epoch() { return simEpoch; }
+
+  void setFreeHeap(uint32_t bytes) {
+    freeHeap = bytes;
+    if (bytes < minFreeHeap) minFreeHeap = bytes;
+  }
+
+  int pinState(uint8_t pin) { return pin < sizeof(pins) ? pins[pin] : 0; }
+  bool restartRequested() { return restartFlag; }
+}
+
+// The firmware reads wall time through time(); keep it on the simulated clock
+extern "C" time_t time(time_t* out) {
+  time_t now = simEpoch + (time_t)(simTimeUs / 1000000ULL);
+  if (out) *out = now;
+  return now;
+}
+
+unsigned long millis() { return (unsigned long)(simTimeUs / 1000); }
+unsigned long micros() { return (unsigned long)simTimeUs; }
+void delay(unsigned long ms) { simTimeUs += (uint64_t)ms * 1000; }
+void delayMicroseconds(unsigned int us) { simTimeUs += us; }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < sizeof(pins)) pins[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return sim::pinState(pin);
+}
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2, const char* server3) {
+  (void)gmtOffsetSec;
+  (void)daylightOffsetSec;
+  (void)server1;
+  (void)server2;
+  (void)server3;
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+  (void)ms;
+  time_t now = time(nullptr);
+  localtime_r(&now, info);
+  return true;
+}
+
+// ============================================================================
+// String
+// ============================================================================
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  int pos = sizeof(buf) - 1;
+  buf[pos] = 0;
+  do {
+    int digit = (int)(value % base);
+    buf[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    value /= base;
+  } while (value);
+  if (negative) buf[--pos] = '-';
+  return std::string(buf + pos);
+}
+
+String::String(int value, unsigned char base)
+  : str(base == 10 ? formatInteger(value < 0 ? -(long long)value : value, value < 0, 10)
+                   : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : str(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base)
+  : str(base == 10 ? formatInteger(value < 0 ? -(long long)value : value, value < 0, 10)
+                   : formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : str(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned int decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+  str = buf;
+}
+
+bool String::equalsIgnoreCase(const String& o) const {
+  if (str.size() != o.str.size()) return false;
+  for (size_t i = 0; i < str.size(); i++) {
+    if (tolower((unsigned char)str[i]) != tolower((unsigned char)o.str[i])) return false;
+  }
+  return true;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = str.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& s, unsigned int from) const {
+  size_t pos = str.find(s.str, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = str.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return str.size() >= suffix.str.size() &&
+         str.compare(str.size() - suffix.str.size(), suffix.str.size(), suffix.str) == 0;
+}
+
+String String::substring(unsigned int from) const {
+  return from >= str.size() ? String() : String(str.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int t = from;
+    from = to;
+    to = t;
+  }
+  if (from >= str.size()) return String();
+  return String(str.substr(from, to - from));
+}
+
+void String::trim() {
+  size_t start = 0;
+  while (start < str.size() && isspace((unsigned char)str[start])) start++;
+  size_t end = str.size();
+  while (end > start && isspace((unsigned char)str[end - 1])) end--;
+  str = str.substr(start, end - start);
+}
+
+void String::toLowerCase() {
+  for (auto& c : str) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (auto& c : str) c = (char)toupper((unsigned char)c);
+}
+
+void String::replace(const String& find, const String& with) {
+  if (find.str.empty()) return;
+  size_t pos = 0;
+  while ((pos = str.find(find.str, pos)) != std::string::npos) {
+    str.replace(pos, find.str.size(), with.str);
+    pos += with.str.size();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < str.size()) str.erase(index, count);
+}
+
+void String::toCharArray(char* buf, unsigned int size) const {
+  if (!size) return;
+  size_t n = str.size() < size - 1 ? str.size() : size - 1;
+  memcpy(buf, str.data(), n);
+  buf[n] = 0;
+}
+
+String operator+(const String& a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, const char* b) { String r(a); r.concat(b); return r; }
+String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, char b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, int b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, unsigned int b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, long b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, unsigned long b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, float b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, double b) { String r(a); r.concat(b); return r; }
+
+// ============================================================================
+// Print / Stream / Serial
+// ============================================================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(stackBuf)) {
+    return write((const uint8_t*)stackBuf, len);
+  }
+  std::string big(len + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&big[0], big.size(), format, args);
+  va_end(args);
+  return write((const uint8_t*)big.data(), len);
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = read();
+    if (c < 0) break;
+    buffer[n++] = (char)c;
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String s;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) s.concat((char)c);
+  return s;
+}
+
+String Stream::readString() {
+  String s;
+  int c;
+  while ((c = read()) >= 0) s.concat((char)c);
+  return s;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!muted) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (!muted) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+int HardwareSerial::available() {
+  return (int)rx.size();
+}
+
+int HardwareSerial::read() {
+  if (rx.empty()) return -1;
+  int c = (uint8_t)rx[0];
+  rx.erase(0, 1);
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return rx.empty() ? -1 : (uint8_t)rx[0];
+}
+
+// ============================================================================
+// IPAddress / ESP
+// ============================================================================
+
+bool IPAddress::fromString(const char* s) {
+  unsigned a, b, c, d;
+  if (!s || sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return false;
+  if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+  *this = IPAddress(a, b, c, d);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+uint32_t EspClass::getFreeHeap() { return freeHeap; }
+uint32_t EspClass::getMinFreeHeap() { return minFreeHeap; }
+uint32_t EspClass::getMaxAllocHeap() { return freeHeap / 2; }
+
+void EspClass::restart() {
+  restartFlag = true;
+}
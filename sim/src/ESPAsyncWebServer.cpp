@@ -0,0 +1,236 @@
+#include <ESPAsyncWebServer.h>
+#include <strings.h>
+#include <chrono>
+#include <thread>
+
+size_t AsyncBasicResponse::fill(uint8_t* buf, size_t maxLen, size_t index) {
+  if (index >= body.size()) return 0;
+  size_t n = body.size() - index;
+  if (n > maxLen) n = maxLen;
+  memcpy(buf, body.data() + index, n);
+  return n;
+}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+  if (_onDisconnect) _onDisconnect();
+  free(_tempObject);
+}
+
+bool AsyncWebServerRequest::hasParam(const char* name, bool post, bool file) const {
+  return getParam(name, post, file) != nullptr;
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const char* name, bool post, bool file) const {
+  (void)file;
+  for (const auto& p : _params) {
+    if (p.isPost() == post && p.name() == name) return &p;
+  }
+  return nullptr;
+}
+
+const String& AsyncWebServerRequest::arg(const char* name) const {
+  static const String empty;
+  const AsyncWebParameter* p = getParam(name);
+  if (!p) p = getParam(name, true);
+  return p ? p->value() : empty;
+}
+
+bool AsyncWebServerRequest::hasHeader(const char* name) const {
+  return getHeader(name) != nullptr;
+}
+
+const AsyncWebHeader* AsyncWebServerRequest::getHeader(const char* name) const {
+  for (const auto& h : _headers) {
+    if (strcasecmp(h.name().c_str(), name) == 0) return &h;
+  }
+  return nullptr;
+}
+
+String AsyncWebServerRequest::header(const char* name) const {
+  const AsyncWebHeader* h = getHeader(name);
+  return h ? h->value() : String();
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const char* contentType,
+                                                             const String& content) {
+  return new AsyncBasicResponse(code, contentType, (const uint8_t*)content.c_str(), content.length());
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const char* contentType,
+                                                             const uint8_t* content, size_t len) {
+  return new AsyncBasicResponse(code, contentType, content, len);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const char* contentType,
+                                                                    AwsResponseFiller filler) {
+  return new AsyncChunkedResponse(200, contentType, filler);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(fs::FS& fs, const String& path,
+                                                             const String& contentType, bool download) {
+  (void)download;
+  File f = fs.open(path, "r");
+  if (!f) return new AsyncBasicResponse(404, "text/plain", nullptr, 0);
+  std::string body(f.size(), '\0');
+  f.read((uint8_t*)&body[0], body.size());
+  return new AsyncBasicResponse(200, contentType.isEmpty() ? "application/octet-stream" : contentType,
+                                (const uint8_t*)body.data(), body.size());
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response) {
+  _sent.reset(response);
+  _responseBody.clear();
+  if (!response) return;
+
+  // TCP-segment sized reads, like AsyncTCP's send window
+  uint8_t buf[1436];
+  size_t index = 0;
+  size_t n;
+  while ((n = response->fill(buf, sizeof(buf), index)) > 0) {
+    _responseBody.append((const char*)buf, n);
+    index += n;
+  }
+}
+
+String AsyncWebServerRequest::simResponseHeader(const char* name) const {
+  if (!_sent) return String();
+  for (const auto& h : _sent->headers()) {
+    if (strcasecmp(h.name().c_str(), name) == 0) return h.value();
+  }
+  return String();
+}
+
+static std::vector<AsyncWebServer*> startedServers;
+
+void AsyncWebServer::begin() {
+  end();
+  startedServers.push_back(this);
+}
+
+void AsyncWebServer::end() {
+  for (size_t i = 0; i < startedServers.size(); i++) {
+    if (startedServers[i] == this) {
+      startedServers.erase(startedServers.begin() + i);
+      return;
+    }
+  }
+}
+
+AsyncWebServer* AsyncWebServer::simOnPort(uint16_t port) {
+  for (AsyncWebServer* server : startedServers) {
+    if (server->_port == port) return server;
+  }
+  return nullptr;
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+  on(uri, method, onRequest, nullptr, nullptr);
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                        ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+  _routes.push_back(Route{uri, method, onRequest, onUpload, onBody});
+}
+
+void AsyncWebServer::simRequest(AsyncWebServerRequest& request) {
+  for (auto& route : _routes) {
+    // As AsyncCallbackWebHandler: the path itself or anything below it
+    if (route.uri != request.url() && !request.url().startsWith(route.uri + "/")) continue;
+    if (route.method != HTTP_ANY && route.method != request.method()) continue;
+
+    // Bodies arrive in TCP segment sized pieces, as on the device
+    const std::string& body = request.simBody();
+    if (!body.empty() && route.onBody) {
+      deliverBody(request, body, [&](size_t index, size_t len) {
+        route.onBody(&request, (uint8_t*)body.data() + index, len, index, body.size());
+      });
+    }
+    if (!body.empty() && route.onUpload) {
+      deliverBody(request, body, [&](size_t index, size_t len) {
+        route.onUpload(&request, "firmware.bin", index, (uint8_t*)body.data() + index, len,
+                       index + len >= body.size());
+      });
+    }
+    if (route.onRequest) route.onRequest(&request);
+    return;
+  }
+  if (_notFound) _notFound(&request);
+}
+
+void AsyncWebServer::simSetLink(uint32_t bytesPerSecond, uint32_t windowBytes) {
+  _linkRate = bytesPerSecond;
+  _linkWindow = windowBytes;
+}
+
+void AsyncWebServer::deliverBody(AsyncWebServerRequest& request, const std::string& body,
+                                 const std::function<void(size_t index, size_t len)>& handler) {
+  (void)request;
+  typedef std::chrono::steady_clock Clock;
+  const size_t segment = 1436;
+  // Handler completion times of the pieces still inside the receive window
+  std::deque<std::pair<size_t, Clock::time_point>> unacked;
+  Clock::time_point sent = Clock::now();
+  for (size_t index = 0; index < body.size(); index += segment) {
+    size_t len = body.size() - index < segment ? body.size() - index : segment;
+    if (_linkRate) {
+      while (!unacked.empty() && unacked.front().first + _linkWindow <= index + len) {
+        if (unacked.front().second > sent) sent = unacked.front().second;
+        unacked.pop_front();
+      }
+      sent += std::chrono::microseconds((uint64_t)len * 1000000 / _linkRate);
+      std::this_thread::sleep_until(sent);
+    }
+    handler(index, len);
+    if (_linkRate) unacked.emplace_back(index + len, Clock::now());
+  }
+}
+
+std::string AsyncEventSource::encode(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
+  std::string out;
+  if (reconnect) out += "retry: " + std::to_string(reconnect) + "\n";
+  if (id) out += "id: " + std::to_string(id) + "\n";
+  if (event) out += std::string("event: ") + event + "\n";
+  out += std::string("data: ") + (message ? message : "") + "\n\n";
+  return out;
+}
+
+void AsyncEventSourceClient::send(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
+  if (!_connected) return;
+  _queue.push_back(std::make_shared<const std::string>(AsyncEventSource::encode(message, event, id, reconnect)));
+}
+
+std::vector<std::string> AsyncEventSourceClient::simDrain() {
+  std::vector<std::string> out;
+  for (const auto& message : _queue) out.push_back(*message);
+  _queue.clear();
+  return out;
+}
+
+void AsyncEventSourceClient::close() {
+  if (_connected) _source->simDisconnect(this);
+}
+
+void AsyncEventSource::send(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
+  auto shared = std::make_shared<const std::string>(encode(message, event, id, reconnect));
+  for (auto& client : _clients) client->simQueue(shared);
+}
+
+AsyncEventSourceClient* AsyncEventSource::simConnect() {
+  _clients.emplace_back(new AsyncEventSourceClient(this));
+  AsyncEventSourceClient* client = _clients.back().get();
+  if (_connectcb) _connectcb(client);
+  // The handler may have closed it again
+  for (auto& c : _clients) {
+    if (c.get() == client) return client;
+  }
+  return nullptr;
+}
+
+void AsyncEventSource::simDisconnect(AsyncEventSourceClient* client) {
+  for (size_t i = 0; i < _clients.size(); i++) {
+    if (_clients[i].get() != client) continue;
+    if (_disconnectcb) _disconnectcb(client);
+    _clients.erase(_clients.begin() + i);
+    return;
+  }
+}
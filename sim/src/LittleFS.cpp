@@ -0,0 +1,201 @@
+#include <LittleFS.h>
+#include <filesystem>
+#include <vector>
+
+namespace stdfs = std::filesystem;
+
+LittleFSFS LittleFS;
+
+namespace fs {
+
+class FileImpl {
+public:
+  FILE* fp = nullptr;
+  std::string fsPath;
+  std::string fileName;
+  bool directory = false;
+  std::vector<std::string> entries;  // Directory listing (fs paths)
+  size_t nextEntry = 0;
+  const FS* owner = nullptr;
+
+  ~FileImpl() {
+    if (fp) fclose(fp);
+  }
+};
+
+static std::string baseName(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!impl || !impl->fp) return 0;
+  return fwrite(buf, 1, size, impl->fp);
+}
+
+int File::available() {
+  if (!impl || !impl->fp) return 0;
+  long pos = ftell(impl->fp);
+  return (int)(size() - (size_t)pos);
+}
+
+int File::read() {
+  if (!impl || !impl->fp) return -1;
+  int c = fgetc(impl->fp);
+  return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+  if (!impl || !impl->fp) return -1;
+  int c = fgetc(impl->fp);
+  if (c == EOF) return -1;
+  ungetc(c, impl->fp);
+  return c;
+}
+
+void File::flush() {
+  if (impl && impl->fp) fflush(impl->fp);
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!impl || !impl->fp) return 0;
+  return fread(buf, 1, size, impl->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!impl || !impl->fp) return false;
+  int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+  return fseek(impl->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!impl || !impl->fp) return 0;
+  return (size_t)ftell(impl->fp);
+}
+
+size_t File::size() const {
+  if (!impl || !impl->fp) return 0;
+  long cur = ftell(impl->fp);
+  fseek(impl->fp, 0, SEEK_END);
+  long end = ftell(impl->fp);
+  fseek(impl->fp, cur, SEEK_SET);
+  return (size_t)end;
+}
+
+void File::close() {
+  impl.reset();
+}
+
+File::operator bool() const {
+  return impl && (impl->fp || impl->directory);
+}
+
+const char* File::name() const {
+  return impl ? impl->fileName.c_str() : "";
+}
+
+const char* File::path() const {
+  return impl ? impl->fsPath.c_str() : "";
+}
+
+bool File::isDirectory() const {
+  return impl && impl->directory;
+}
+
+File File::openNextFile(const char* mode) {
+  if (!impl || !impl->directory || impl->nextEntry >= impl->entries.size()) {
+    return File();
+  }
+  return const_cast<FS*>(impl->owner)->open(impl->entries[impl->nextEntry++].c_str(), mode);
+}
+
+std::string FS::hostPath(const char* path) const {
+  std::string p = path ? path : "/";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  return root + p;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+  (void)create;
+  std::string host = hostPath(path);
+  auto impl = std::make_shared<FileImpl>();
+  impl->fsPath = path;
+  impl->fileName = baseName(path);
+  impl->owner = this;
+
+  std::error_code ec;
+  if (stdfs::is_directory(host, ec)) {
+    impl->directory = true;
+    for (const auto& entry : stdfs::directory_iterator(host, ec)) {
+      std::string child = impl->fsPath;
+      if (child.empty() || child.back() != '/') child += "/";
+      impl->entries.push_back(child + entry.path().filename().string());
+    }
+    return File(impl);
+  }
+
+  std::string m = mode ? mode : "r";
+  if (m[0] != 'r') {
+    stdfs::create_directories(stdfs::path(host).parent_path(), ec);
+  }
+  // Binary mode, and keep "r+" semantics for in-place rewrites
+  std::string hostMode = m;
+  if (hostMode.find('b') == std::string::npos) hostMode += "b";
+  impl->fp = fopen(host.c_str(), hostMode.c_str());
+  if (!impl->fp) return File();
+  return File(impl);
+}
+
+bool FS::exists(const char* path) {
+  std::error_code ec;
+  return stdfs::exists(hostPath(path), ec);
+}
+
+bool FS::remove(const char* path) {
+  std::error_code ec;
+  return stdfs::remove(hostPath(path), ec);
+}
+
+bool FS::rename(const char* from, const char* to) {
+  std::error_code ec;
+  stdfs::rename(hostPath(from), hostPath(to), ec);
+  return !ec;
+}
+
+bool FS::mkdir(const char* path) {
+  std::error_code ec;
+  return stdfs::create_directories(hostPath(path), ec) || stdfs::is_directory(hostPath(path), ec);
+}
+
+}  // namespace fs
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles,
+                       const char* partitionLabel) {
+  (void)formatOnFail;
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  std::error_code ec;
+  stdfs::create_directories(root, ec);
+  return !ec;
+}
+
+bool LittleFSFS::format() {
+  std::error_code ec;
+  stdfs::remove_all(root, ec);
+  stdfs::create_directories(root, ec);
+  return !ec;
+}
+
+size_t LittleFSFS::usedBytes() {
+  size_t used = 0;
+  std::error_code ec;
+  for (const auto& entry : stdfs::recursive_directory_iterator(root, ec)) {
+    if (entry.is_regular_file(ec)) used += (size_t)entry.file_size(ec);
+  }
+  return used;
+}
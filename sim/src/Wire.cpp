@@ -0,0 +1,112 @@
+#include <Wire.h>
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+TwoWire::TwoWire(uint8_t busNum)
+  : clock(100000), deviceCount(0), txAddr(0), txLen(0), rxLen(0), rxPos(0) {
+  (void)busNum;
+  resetStats();
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  if (frequency) clock = frequency;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock = frequency;
+  return true;
+}
+
+void TwoWire::attach(uint8_t address, SimI2cDevice* device) {
+  for (int i = 0; i < deviceCount; i++) {
+    if (deviceAddr[i] == address) {
+      devices[i] = device;
+      return;
+    }
+  }
+  if (deviceCount < MAX_DEVICES) {
+    deviceAddr[deviceCount] = address;
+    devices[deviceCount] = device;
+    deviceCount++;
+  }
+}
+
+void TwoWire::detachAll() {
+  deviceCount = 0;
+}
+
+SimI2cDevice* TwoWire::find(uint8_t address) {
+  for (int i = 0; i < deviceCount; i++) {
+    if (deviceAddr[i] == address) return devices[i];
+  }
+  return nullptr;
+}
+
+void TwoWire::resetStats() {
+  memset(&busStats, 0, sizeof(busStats));
+}
+
+void TwoWire::account(size_t payloadBytes) {
+  // START + address byte + payload, 9 clocks per byte (8 data + ACK) + STOP
+  busStats.transactions++;
+  busStats.bytes += (uint32_t)(payloadBytes + 1);
+  busStats.busBits += 2 + 9 * (payloadBytes + 1);
+}
+
+uint64_t TwoWire::busTimeUs() const {
+  return busStats.busBits * 1000000ULL / clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddr = address;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen >= BUFFER_SIZE) return 0;
+  txBuf[txLen++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  account(txLen);
+  SimI2cDevice* dev = find(txAddr);
+  if (!dev) return 2;  // NACK on address
+  if (txLen) dev->onWrite(txBuf, txLen);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len, bool sendStop) {
+  (void)sendStop;
+  rxLen = 0;
+  rxPos = 0;
+  SimI2cDevice* dev = find(address);
+  if (!dev) {
+    account(0);
+    return 0;
+  }
+  if (len > BUFFER_SIZE) len = BUFFER_SIZE;
+  rxLen = dev->onRead(rxBuf, len);
+  account(rxLen);
+  return (uint8_t)rxLen;
+}
+
+int TwoWire::available() {
+  return (int)(rxLen - rxPos);
+}
+
+int TwoWire::read() {
+  if (rxPos >= rxLen) return -1;
+  return rxBuf[rxPos++];
+}
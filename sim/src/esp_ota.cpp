@@ -0,0 +1,129 @@
+#include <esp_ota_ops.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#define SIM_OTA_PARTITION_SIZE 0x140000   // app0 and app1 of the default partition table
+
+static const esp_partition_t runningPartition = { 0x10000, SIM_OTA_PARTITION_SIZE, "app0", false };
+static const esp_partition_t otaPartition = { 0x150000, SIM_OTA_PARTITION_SIZE, "app1", false };
+static std::vector<uint8_t> runningFlash(SIM_OTA_PARTITION_SIZE, 0xFF);
+static std::vector<uint8_t> flash(SIM_OTA_PARTITION_SIZE, 0xFF);
+static const esp_partition_t* bootPartition = nullptr;
+static uint32_t sectorEraseUs = 0;
+static uint32_t blockEraseUs = 0;
+static uint32_t pageProgramUs = 0;
+static uint32_t erases = 0;
+
+const char* esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_OTA_VALIDATE_FAILED: return "ESP_ERR_OTA_VALIDATE_FAILED";
+    default: return "UNKNOWN ERROR";
+  }
+}
+
+static void sleepUs(uint64_t us) {
+  if (us) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void simSetFlashTiming(uint32_t sectorUs, uint32_t blockUs, uint32_t pageUs) {
+  sectorEraseUs = sectorUs;
+  blockEraseUs = blockUs;
+  pageProgramUs = pageUs;
+}
+
+void simFlashEraseDelay(size_t offset, size_t size) {
+  uint64_t us = 0;
+  size_t end = offset + size;
+  while (offset < end) {
+    erases++;
+    if (offset % SIM_FLASH_BLOCK == 0 && end - offset >= SIM_FLASH_BLOCK) {
+      us += blockEraseUs;
+      offset += SIM_FLASH_BLOCK;
+    } else {
+      us += sectorEraseUs;
+      offset += SPI_FLASH_SEC_SIZE;
+    }
+  }
+  sleepUs(us);
+}
+
+void simFlashProgramDelay(size_t size) {
+  sleepUs((uint64_t)(size + SIM_FLASH_PAGE - 1) / SIM_FLASH_PAGE * pageProgramUs);
+}
+
+const std::vector<uint8_t>& simPartitionData() {
+  return flash;
+}
+
+uint32_t simFlashErases() {
+  return erases;
+}
+
+void simSetRunningImage(const uint8_t* image, size_t size) {
+  std::fill(runningFlash.begin(), runningFlash.end(), 0xFF);
+  memcpy(runningFlash.data(), image, std::min(size, runningFlash.size()));
+}
+
+static std::vector<uint8_t>* partitionData(const esp_partition_t* partition) {
+  if (partition == &otaPartition) return &flash;
+  if (partition == &runningPartition) return &runningFlash;
+  return nullptr;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+  std::vector<uint8_t>* data = partitionData(partition);
+  if (!data) return ESP_ERR_INVALID_ARG;
+  if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE) return ESP_ERR_INVALID_SIZE;
+  if (offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+  simFlashEraseDelay(partition->address + offset, size);
+  memset(data->data() + offset, 0xFF, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+  std::vector<uint8_t>* data = partitionData(partition);
+  if (!data) return ESP_ERR_INVALID_ARG;
+  if (dst_offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+  simFlashProgramDelay(size);
+  const uint8_t* bytes = (const uint8_t*)src;
+  for (size_t i = 0; i < size; i++) (*data)[dst_offset + i] &= bytes[i];
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+  std::vector<uint8_t>* data = partitionData(partition);
+  if (!data) return ESP_ERR_INVALID_ARG;
+  if (src_offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, data->data() + src_offset, size);
+  return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+  return &runningPartition;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from) {
+  (void)start_from;
+  return &otaPartition;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+  if (partition != &otaPartition) return ESP_ERR_INVALID_ARG;
+  if (flash[0] != 0xE9) return ESP_ERR_OTA_VALIDATE_FAILED;
+  bootPartition = partition;
+  return ESP_OK;
+}
+
+const esp_partition_t* simBootPartition() {
+  return bootPartition;
+}
+
+void simResetBootPartition() {
+  bootPartition = nullptr;
+}
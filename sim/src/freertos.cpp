@@ -0,0 +1,137 @@
+#include <Arduino.h>
+#include <freertos/queue.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SimTask {
+  uint32_t notifications;
+};
+
+static SimTask loopTask = { 0 };
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return &loopTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (task) task->notifications++;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+  uint32_t count = loopTask.notifications;
+  if (count == 0) {
+    if (ticksToWait != portMAX_DELAY) sim::advanceUs((uint64_t)ticksToWait * portTICK_PERIOD_MS * 1000);
+    return 0;
+  }
+  loopTask.notifications = clearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+struct SimSemaphore {
+  uint32_t depth;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new SimSemaphore{0};
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  // Taking a plain mutex twice deadlocks on the device
+  if (mutex->depth > 0) return pdFALSE;
+  mutex->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  if (mutex->depth == 0) return pdFALSE;
+  mutex->depth = 0;
+  return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+  return new SimSemaphore{0};
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  mutex->depth++;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) {
+  if (mutex->depth == 0) return pdFALSE;
+  mutex->depth--;
+  return pdTRUE;
+}
+
+struct SimQueue {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+// Ticks are milliseconds (portTICK_PERIOD_MS); waits are in wall time
+template <typename Ready>
+static bool waitFor(SimQueue* queue, std::unique_lock<std::mutex>& held, TickType_t ticksToWait, Ready ready) {
+  if (ticksToWait == portMAX_DELAY) {
+    queue->changed.wait(held, ready);
+    return true;
+  }
+  return queue->changed.wait_for(held, std::chrono::milliseconds(ticksToWait), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  SimQueue* queue = new SimQueue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> held(queue->lock);
+  if (!waitFor(queue, held, ticksToWait, [queue]() { return queue->items.size() < queue->length; })) {
+    return pdFALSE;
+  }
+  const uint8_t* bytes = (const uint8_t*)item;
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> held(queue->lock);
+  if (!waitFor(queue, held, ticksToWait, [queue]() { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> held(queue->lock);
+  return queue->items.size();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask) {
+  (void)name;
+  (void)stackDepth;
+  (void)priority;
+  std::thread(code, parameters).detach();
+  if (createdTask) *createdTask = new SimTask{0};
+  return pdPASS;
+}
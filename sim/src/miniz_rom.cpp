@@ -0,0 +1,78 @@
+#include <esp32/rom/miniz.h>
+#include <map>
+#include <zlib.h>
+
+// By decoder address; ended at TINFL_STATUS_DONE or at the next init there
+static std::map<const tinfl_decompressor*, z_stream*> streams;
+
+static void endStream(const tinfl_decompressor* r) {
+  auto it = streams.find(r);
+  if (it == streams.end()) return;
+  inflateEnd(it->second);
+  delete it->second;
+  streams.erase(it);
+}
+
+void simTinflInit(tinfl_decompressor* r) {
+  endStream(r);
+  r->m_state = 0;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const uint32_t decomp_flags) {
+  size_t ringSize = (size_t)(pOut_buf_next - pOut_buf_start) + *pOut_buf_size;
+  if (pOut_buf_next < pOut_buf_start ||
+      (!(decomp_flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) && (ringSize & (ringSize - 1)))) {
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    return TINFL_STATUS_BAD_PARAM;
+  }
+  if (r->m_state != 0) {   // ended
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    return r->m_state == 1 ? TINFL_STATUS_DONE : TINFL_STATUS_FAILED;
+  }
+
+  z_stream* stream;
+  auto it = streams.find(r);
+  if (it == streams.end()) {
+    stream = new z_stream();
+    // Like the ROM, distances beyond the ring are an error
+    int windowBits = 15;
+    if (!(decomp_flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF)) {
+      windowBits = 8;
+      while (windowBits < 15 && ((size_t)1 << windowBits) < ringSize) windowBits++;
+    }
+    if (!(decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER)) windowBits = -windowBits;
+    if (inflateInit2(stream, windowBits) != Z_OK) {
+      delete stream;
+      return TINFL_STATUS_FAILED;
+    }
+    streams[r] = stream;
+  } else {
+    stream = it->second;
+  }
+
+  stream->next_in = (Bytef*)pIn_buf_next;
+  stream->avail_in = (uInt)*pIn_buf_size;
+  stream->next_out = pOut_buf_next;
+  stream->avail_out = (uInt)*pOut_buf_size;
+  int result = inflate(stream, Z_NO_FLUSH);
+  *pIn_buf_size -= stream->avail_in;
+  *pOut_buf_size -= stream->avail_out;
+
+  if (result == Z_STREAM_END) {
+    endStream(r);
+    r->m_state = 1;
+    return TINFL_STATUS_DONE;
+  }
+  if (result != Z_OK && result != Z_BUF_ERROR) {
+    endStream(r);
+    r->m_state = 2;
+    return TINFL_STATUS_FAILED;
+  }
+  if (stream->avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+  if (!(decomp_flags & TINFL_FLAG_HAS_MORE_INPUT)) return TINFL_STATUS_FAILED;   // truncated
+  return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
@@ -0,0 +1,88 @@
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include <ArduinoOTA.h>
+#include <Update.h>
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+ArduinoOTAClass ArduinoOTA;
+UpdateClass Update;
+
+// Erases each sector as it writes it, as the Arduino core's Update does
+void UpdateClass::flushSector() {
+  if (buffered == 0) return;
+  sectorWrites++;
+  simFlashEraseDelay((size_t)(sectorWrites - 1) * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE);
+  simFlashProgramDelay(buffered);
+  buffered = 0;
+}
+
+bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, const char* label) {
+  (void)ledPin;
+  (void)ledOn;
+  (void)label;
+  image.clear();
+  writeCalls = 0;
+  sectorWrites = 0;
+  buffered = 0;
+  expected = size;
+  flash = command == U_FLASH;
+  finished = false;
+  if (size != UPDATE_SIZE_UNKNOWN && size > ESP.getFreeSketchSpace()) {
+    error = UPDATE_ERROR_SPACE;
+    return false;
+  }
+  error = UPDATE_ERROR_OK;
+  running = true;
+  return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+  if (!running || hasError()) return 0;
+  if (flash && image.empty() && len > 0 && data[0] != 0xE9) {
+    error = UPDATE_ERROR_MAGIC_BYTE;
+    return 0;
+  }
+  writeCalls++;
+  image.insert(image.end(), data, data + len);
+  for (size_t left = len; left > 0;) {
+    size_t n = std::min(left, (size_t)SPI_FLASH_SEC_SIZE - buffered);
+    buffered += n;
+    left -= n;
+    if (buffered == SPI_FLASH_SEC_SIZE) flushSector();
+  }
+  return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+  if (!running || hasError()) return false;
+  if (!evenIfRemaining && expected != UPDATE_SIZE_UNKNOWN && image.size() != expected) {
+    error = UPDATE_ERROR_SIZE;
+    return false;
+  }
+  flushSector();
+  running = false;
+  finished = !image.empty();
+  return finished;
+}
+
+void UpdateClass::abort() {
+  running = false;
+  error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() const {
+  switch (error) {
+    case UPDATE_ERROR_OK: return "No Error";
+    case UPDATE_ERROR_WRITE: return "Flash Write Failed";
+    case UPDATE_ERROR_SPACE: return "Not Enough Space";
+    case UPDATE_ERROR_SIZE: return "Bad Size Given";
+    case UPDATE_ERROR_ABORT: return "Update Aborted";
+    case UPDATE_ERROR_MAGIC_BYTE: return "Wrong Magic Byte";
+    default: return "UNKNOWN";
+  }
+}
+
+void UpdateClass::printError(Print& out) {
+  out.println(errorString());
+}
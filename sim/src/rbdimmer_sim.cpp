@@ -0,0 +1,120 @@
+#include "rbdimmerESP32.h"
+
+struct rbdimmer_channel_s {
+  uint8_t gpio_pin;
+  uint8_t phase;
+  uint8_t level_percent;
+  bool is_active;
+  rbdimmer_curve_t curve_type;
+};
+
+static rbdimmer_channel_s channels[RBDIMMER_MAX_CHANNELS];
+static int channelCount = 0;
+static uint16_t phaseFrequency[RBDIMMER_MAX_PHASES];
+static bool initialized = false;
+
+rbdimmer_err_t rbdimmer_init(void) {
+  initialized = true;
+  channelCount = 0;
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_register_zero_cross(uint8_t pin, uint8_t phase, uint16_t frequency) {
+  (void)pin;
+  if (!initialized || phase >= RBDIMMER_MAX_PHASES) return RBDIMMER_ERR_INVALID_ARG;
+  phaseFrequency[phase] = frequency ? frequency : 50;
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_create_channel(rbdimmer_config_t* config, rbdimmer_channel_t** channel) {
+  if (!config || !channel) return RBDIMMER_ERR_INVALID_ARG;
+  if (channelCount >= RBDIMMER_MAX_CHANNELS) return RBDIMMER_ERR_NO_MEMORY;
+  rbdimmer_channel_s* ch = &channels[channelCount++];
+  ch->gpio_pin = config->gpio_pin;
+  ch->phase = config->phase;
+  ch->level_percent = config->initial_level;
+  ch->is_active = true;
+  ch->curve_type = config->curve_type;
+  *channel = ch;
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_set_level(rbdimmer_channel_t* channel, uint8_t level_percent) {
+  if (!channel) return RBDIMMER_ERR_INVALID_ARG;
+  channel->level_percent = level_percent > 100 ? 100 : level_percent;
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_set_level_transition(rbdimmer_channel_t* channel, uint8_t level_percent,
+                                             uint32_t transition_ms) {
+  (void)transition_ms;
+  return rbdimmer_set_level(channel, level_percent);
+}
+
+rbdimmer_err_t rbdimmer_set_curve(rbdimmer_channel_t* channel, rbdimmer_curve_t curve_type) {
+  if (!channel) return RBDIMMER_ERR_INVALID_ARG;
+  channel->curve_type = curve_type;
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_set_active(rbdimmer_channel_t* channel, bool active) {
+  if (!channel) return RBDIMMER_ERR_INVALID_ARG;
+  channel->is_active = active;
+  return RBDIMMER_OK;
+}
+
+uint8_t rbdimmer_get_level(rbdimmer_channel_t* channel) {
+  return channel ? channel->level_percent : 0;
+}
+
+uint16_t rbdimmer_get_frequency(uint8_t phase) {
+  return phase < RBDIMMER_MAX_PHASES ? phaseFrequency[phase] : 0;
+}
+
+rbdimmer_err_t rbdimmer_set_callback(uint8_t phase, void (*callback)(void*), void* user_data) {
+  (void)callback;
+  (void)user_data;
+  return phase < RBDIMMER_MAX_PHASES ? RBDIMMER_OK : RBDIMMER_ERR_INVALID_ARG;
+}
+
+rbdimmer_err_t rbdimmer_update_all(void) {
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_delete_channel(rbdimmer_channel_t* channel) {
+  if (!channel) return RBDIMMER_ERR_INVALID_ARG;
+  channel->is_active = false;
+  return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_deinit(void) {
+  initialized = false;
+  channelCount = 0;
+  return RBDIMMER_OK;
+}
+
+bool rbdimmer_is_active(rbdimmer_channel_t* channel) {
+  return channel && channel->is_active;
+}
+
+rbdimmer_curve_t rbdimmer_get_curve(rbdimmer_channel_t* channel) {
+  return channel ? channel->curve_type : RBDIMMER_CURVE_LINEAR;
+}
+
+uint32_t rbdimmer_get_delay(rbdimmer_channel_t* channel) {
+  if (!channel || !phaseFrequency[channel->phase]) return 0;
+  uint32_t halfCycleUs = 500000 / phaseFrequency[channel->phase];
+  return halfCycleUs * (100 - channel->level_percent) / 100;
+}
+
+int sim_rbdimmer_channel_count(void) {
+  return channelCount;
+}
+
+rbdimmer_channel_t* sim_rbdimmer_channel(int index) {
+  return index >= 0 && index < channelCount ? &channels[index] : nullptr;
+}
+
+uint8_t sim_rbdimmer_gpio(rbdimmer_channel_t* channel) {
+  return channel ? channel->gpio_pin : 0;
+}
@@ -0,0 +1,171 @@
+#include "sim_i2c_devices.h"
+
+static uint8_t simCrc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static void put16(uint8_t* regs, uint8_t reg, uint16_t value) {
+  regs[reg] = value & 0xFF;
+  regs[reg + 1] = value >> 8;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t SimTca9548a::onRead(uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) data[i] = mask;
+  return len;
+}
+
+SimMuxedDevice::SimMuxedDevice(const SimTca9548a& m) : mux(m) {
+  for (int i = 0; i < 8; i++) channels[i] = nullptr;
+}
+
+void SimMuxedDevice::bind(uint8_t channel, SimI2cDevice* device) {
+  if (channel < 8) channels[channel] = device;
+}
+
+SimI2cDevice* SimMuxedDevice::selected() {
+  for (int i = 0; i < 8; i++) {
+    if ((mux.channelMask() & (1 << i)) && channels[i]) return channels[i];
+  }
+  return nullptr;
+}
+
+void SimMuxedDevice::onWrite(const uint8_t* data, size_t len) {
+  SimI2cDevice* dev = selected();
+  if (dev) dev->onWrite(data, len);
+}
+
+size_t SimMuxedDevice::onRead(uint8_t* data, size_t len) {
+  SimI2cDevice* dev = selected();
+  return dev ? dev->onRead(data, len) : 0;
+}
+
+// ----------------------------------------------------------------------------
+
+SimAht20::SimAht20() : temperature(20.0f), humidity(50.0f), measured(false) {
+}
+
+void SimAht20::setReading(float t, float rh) {
+  temperature = t;
+  humidity = rh;
+}
+
+void SimAht20::onWrite(const uint8_t* data, size_t len) {
+  if (len >= 1 && data[0] == 0xAC) measured = true;
+}
+
+size_t SimAht20::onRead(uint8_t* data, size_t len) {
+  uint8_t d[7];
+  float rh = humidity < 0 ? 0 : (humidity > 100 ? 100 : humidity);
+  uint32_t rawH = (uint32_t)(rh / 100.0f * 1048575.0f);
+  uint32_t rawT = (uint32_t)((temperature + 50.0f) / 200.0f * 1048575.0f);
+  d[0] = 0x18;  // Idle, calibrated
+  d[1] = (rawH >> 12) & 0xFF;
+  d[2] = (rawH >> 4) & 0xFF;
+  d[3] = (uint8_t)(((rawH & 0x0F) << 4) | ((rawT >> 16) & 0x0F));
+  d[4] = (rawT >> 8) & 0xFF;
+  d[5] = rawT & 0xFF;
+  d[6] = simCrc8(d, 6);
+  if (!measured && len > 1) d[0] |= 0x80;
+  if (len > sizeof(d)) len = sizeof(d);
+  memcpy(data, d, len);
+  return len;
+}
+
+// ----------------------------------------------------------------------------
+
+SimSht4x::SimSht4x() : temperature(20.0f), humidity(50.0f), lastCommand(0) {
+}
+
+void SimSht4x::setReading(float t, float rh) {
+  temperature = t;
+  humidity = rh;
+}
+
+void SimSht4x::onWrite(const uint8_t* data, size_t len) {
+  if (len >= 1) lastCommand = data[0];
+}
+
+size_t SimSht4x::onRead(uint8_t* data, size_t len) {
+  uint8_t d[6];
+  uint16_t a, b;
+  if (lastCommand == 0x89) {
+    a = 0x1234;
+    b = 0x5678;
+  } else {
+    a = (uint16_t)((temperature + 45.0f) / 175.0f * 65535.0f);
+    b = (uint16_t)((humidity + 6.0f) / 125.0f * 65535.0f);
+  }
+  d[0] = a >> 8;
+  d[1] = a & 0xFF;
+  d[2] = simCrc8(d, 2);
+  d[3] = b >> 8;
+  d[4] = b & 0xFF;
+  d[5] = simCrc8(d + 3, 2);
+  if (len > sizeof(d)) len = sizeof(d);
+  memcpy(data, d, len);
+  return len;
+}
+
+// ----------------------------------------------------------------------------
+
+SimBmx280::SimBmx280(uint8_t chipId) : pointer(0) {
+  memset(regs, 0, sizeof(regs));
+  regs[0xD0] = chipId;
+
+  // Datasheet section 8.2 example calibration
+  put16(regs, 0x88, 27504);
+  put16(regs, 0x8A, (uint16_t)26435);
+  put16(regs, 0x8C, (uint16_t)-1000);
+  put16(regs, 0x8E, 36477);
+  put16(regs, 0x90, (uint16_t)-10685);
+  put16(regs, 0x92, 3024);
+  put16(regs, 0x94, 2855);
+  put16(regs, 0x96, 140);
+  put16(regs, 0x98, (uint16_t)-7);
+  put16(regs, 0x9A, 15500);
+  put16(regs, 0x9C, (uint16_t)-14600);
+  put16(regs, 0x9E, 6000);
+
+  // Typical BME280 humidity calibration
+  regs[0xA1] = 75;
+  put16(regs, 0xE1, 362);
+  regs[0xE3] = 0;
+  regs[0xE4] = 324 >> 4;
+  regs[0xE5] = 324 & 0x0F;
+  regs[0xE6] = 0;
+  regs[0xE7] = 30;
+
+  // adc_P = 415148, adc_T = 519888, adc_H = 30000
+  regs[0xF7] = 415148 >> 12;
+  regs[0xF8] = (415148 >> 4) & 0xFF;
+  regs[0xF9] = (415148 & 0x0F) << 4;
+  regs[0xFA] = 519888 >> 12;
+  regs[0xFB] = (519888 >> 4) & 0xFF;
+  regs[0xFC] = (519888 & 0x0F) << 4;
+  regs[0xFD] = 30000 >> 8;
+  regs[0xFE] = 30000 & 0xFF;
+}
+
+void SimBmx280::onWrite(const uint8_t* data, size_t len) {
+  pointer = data[0];
+  // Register writes come as (reg, value) pairs; data registers are read-only
+  for (size_t i = 1; i < len; i += 2) {
+    if (data[i - 1] < 0xF7) regs[data[i - 1]] = data[i];
+  }
+}
+
+size_t SimBmx280::onRead(uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    data[i] = regs[(uint8_t)(pointer + i)];
+  }
+  return len;
+}
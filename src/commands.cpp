@@ -0,0 +1,143 @@
+#include "commands.h"
+
+static const char* modeNames[] = {"AUTO", "MANUAL_OFF", "MANUAL_LOW", "MANUAL_HIGH", "DIAGNOSTIC"};
+
+CommandQueue::CommandQueue() {
+  for (uint32_t i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+    done[i].ticket.store(0, std::memory_order_relaxed);
+    done[i].id.store(0, std::memory_order_relaxed);
+    done[i].order.store(0, std::memory_order_relaxed);
+    done[i].state.store(0, std::memory_order_relaxed);
+  }
+  head.store(0, std::memory_order_relaxed);
+  tail = 0;
+  appliedCount = 0;
+  order = 0;
+  refused.store(0, std::memory_order_relaxed);
+  completed.store(0, std::memory_order_relaxed);
+  wakeTask = nullptr;
+}
+
+uint32_t CommandQueue::push(const Command& cmd) {
+  // A slot is free for position pos when its sequence equals pos; the
+  // consumer hands it back one lap later (pos + COMMAND_QUEUE_SIZE)
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &slots[pos & (COMMAND_QUEUE_SIZE - 1)];
+    int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      refused.fetch_add(1, std::memory_order_relaxed);
+      return 0;
+    } else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+  slot->cmd = cmd;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  if (wakeTask) xTaskNotifyGive(wakeTask);
+  return pos + 1;
+}
+
+bool CommandQueue::poll(uint32_t ticket, CommandResult& result) const {
+  if (ticket == 0) return false;
+  const Done& entry = done[ticket & (COMMAND_QUEUE_SIZE - 1)];
+  if (entry.ticket.load(std::memory_order_acquire) != ticket) return false;
+  result.id = entry.id.load(std::memory_order_relaxed);
+  result.order = entry.order.load(std::memory_order_relaxed);
+  uint32_t state = entry.state.load(std::memory_order_relaxed);
+  result.ok = state & 1;
+  result.mode = (ControlMode)((state >> 8) & 0xFF);
+  result.speed = (state >> 16) & 0xFF;
+  result.reason = (RunReason)(state >> 24);
+  // Still ours after the copy, so complete() did not reuse the entry meanwhile
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return entry.ticket.load(std::memory_order_relaxed) == ticket;
+}
+
+uint8_t CommandQueue::apply(ZoneManager& zones, OverrideManager& overrides, FanController& fan) {
+  uint8_t count = 0;
+  while (appliedCount < COMMAND_QUEUE_SIZE) {
+    Slot& slot = slots[tail & (COMMAND_QUEUE_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != tail + 1) break;   // empty
+    Command cmd = slot.cmd;
+    slot.sequence.store(tail + COMMAND_QUEUE_SIZE, std::memory_order_release);
+
+    Applied& entry = applied[appliedCount++];
+    entry.ticket = ++tail;
+    entry.zone = cmd.type == CMD_SET_MODE ? cmd.zone : 0;
+    memset(&entry.result, 0, sizeof(entry.result));
+    run(cmd, entry.result, zones, overrides, fan);
+    entry.result.order = ++order;
+    count++;
+  }
+  return count;
+}
+
+void CommandQueue::run(const Command& cmd, CommandResult& result, ZoneManager& zones,
+                       OverrideManager& overrides, FanController& fan) {
+  switch (cmd.type) {
+    case CMD_SET_MODE:
+      result.ok = zones.setMode(cmd.zone, cmd.mode, cmd.duration, cmd.speed);
+      break;
+    case CMD_SET_SPEED:
+      fan.setManualSpeed(cmd.speed);
+      result.ok = true;
+      break;
+    case CMD_ADD_OVERRIDE:
+      result.id = overrides.add(cmd.start, cmd.duration, cmd.mode, cmd.speed);
+      result.ok = result.id != 0;
+      if (result.ok) fan.requestUpdate();
+      break;
+    case CMD_CANCEL_OVERRIDE:
+      if (cmd.id == 0) {
+        overrides.clear();
+        result.ok = true;
+      } else {
+        result.ok = overrides.cancel(cmd.id);
+      }
+      if (result.ok) fan.requestUpdate();
+      break;
+  }
+}
+
+void CommandQueue::complete(const ZoneManager& zones) {
+  for (uint8_t i = 0; i < appliedCount; i++) {
+    Applied& entry = applied[i];
+    const FanController* target = zones.getFan(entry.zone);
+    if (target) {
+      entry.result.mode = target->getMode();
+      entry.result.speed = target->getCurrentSpeed();
+      entry.result.reason = target->getRunReason();
+    }
+    Done& slot = done[entry.ticket & (COMMAND_QUEUE_SIZE - 1)];
+    slot.ticket.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const CommandResult& result = entry.result;
+    slot.id.store(result.id, std::memory_order_relaxed);
+    slot.order.store(result.order, std::memory_order_relaxed);
+    slot.state.store((result.ok ? 1 : 0) | ((uint32_t)result.mode << 8) |
+                     ((uint32_t)result.speed << 16) | ((uint32_t)result.reason << 24),
+                     std::memory_order_relaxed);
+    slot.ticket.store(entry.ticket, std::memory_order_release);
+    completed.store(entry.ticket, std::memory_order_release);
+  }
+  appliedCount = 0;
+}
+
+size_t CommandQueue::formatJSON(const CommandResult& result, char* buf, size_t len) {
+  int n = snprintf(buf, len, "{\"success\":%s,\"mode\":\"%s\",\"speed\":%u,\"reason\":\"%s\"",
+                   result.ok ? "true" : "false", modeNames[result.mode], result.speed,
+                   FanController::reasonText(result.reason));
+  if (result.id && n > 0 && (size_t)n < len) {
+    n += snprintf(buf + n, len - n, ",\"id\":%lu", (unsigned long)result.id);
+  }
+  if (n > 0 && (size_t)n + 1 < len) {
+    buf[n++] = '}';
+    buf[n] = '\0';
+  }
+  return n > 0 ? min((size_t)n, len - 1) : 0;
+}
@@ -1,6 +1,126 @@
 #include "config.h"
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <atomic>
+
+// Save requests are counted; a save covers every request made before it
+// started reading config
+static std::atomic<uint32_t> saveRequested(0);
+static std::atomic<uint32_t> saveCompleted(0);
+static std::atomic<unsigned long> lastSaveRequest(0);
+static unsigned long savePendingSince = 0;   // loop() only
+static bool savePendingSeen = false;
+
+static bool writeConfig(const String& json);
+
+// CONFIG_RESTART values patched since boot, by section and key: saved and
+// returned by buildConfigJSON(), but config keeps what it started with, so
+// nothing running (WiFi, the MQTT client's server pointer) sees them change.
+// Under lockConfig().
+static JsonDocument restartPending;
+
+// Held while config is written as a whole: saves, PATCH and loop()'s decision
+static SemaphoreHandle_t configLock() {
+  static SemaphoreHandle_t lock = xSemaphoreCreateRecursiveMutex();
+  return lock;
+}
+
+void lockConfig() {
+  xSemaphoreTakeRecursive(configLock(), portMAX_DELAY);
+}
+
+void unlockConfig() {
+  xSemaphoreGiveRecursive(configLock());
+}
+
+// The scalar settings, by config.json section. Strings have their maximum
+// length as max. Everything else (power curve, schedule, rules, zones) is
+// handled on its own below.
+static const ConfigField configFields[] = {
+  { "wifi", "ssid", CONFIG_STRING, CONFIG_RESTART, &config.wifi_ssid, 0, 32, 0, "YOUR_WIFI" },
+  { "wifi", "password", CONFIG_STRING, CONFIG_RESTART | CONFIG_SECRET, &config.wifi_password, 0, 64, 0, "YOUR_PASSWORD" },
+  { "wifi", "hostname", CONFIG_STRING, CONFIG_RESTART, &config.hostname, 1, 32, 0, "cellar-fan" },
+  { "wifi", "use_static_ip", CONFIG_BOOL, CONFIG_RESTART, &config.use_static_ip, 0, 1, 0, nullptr },
+  { "wifi", "static_ip", CONFIG_STRING, CONFIG_RESTART, &config.static_ip, 0, 15, 0, "192.168.0.139" },
+  { "wifi", "gateway", CONFIG_STRING, CONFIG_RESTART, &config.gateway, 0, 15, 0, "192.168.0.1" },
+  { "wifi", "subnet", CONFIG_STRING, CONFIG_RESTART, &config.subnet, 0, 15, 0, "255.255.255.0" },
+
+  { "mqtt", "enabled", CONFIG_BOOL, CONFIG_RESTART, &config.mqtt_enabled, 0, 1, 0, nullptr },
+  { "mqtt", "broker", CONFIG_STRING, CONFIG_RESTART, &config.mqtt_broker, 0, 64, 0, "192.168.1.100" },
+  { "mqtt", "port", CONFIG_INT, CONFIG_RESTART, &config.mqtt_port, 1, 65535, 1883, nullptr },
+  { "mqtt", "user", CONFIG_STRING, CONFIG_RESTART, &config.mqtt_user, 0, 64, 0, "" },
+  { "mqtt", "password", CONFIG_STRING, CONFIG_RESTART | CONFIG_SECRET, &config.mqtt_password, 0, 64, 0, "" },
+
+  { "thresholds", "target_temp", CONFIG_FLOAT, 0, &config.target_temp, 0, 30, 18.0, nullptr },
+  { "thresholds", "target_humidity", CONFIG_FLOAT, 0, &config.target_humidity, 20, 95, 55.0, nullptr },
+  { "thresholds", "temp_differential", CONFIG_FLOAT, 0, &config.temp_differential, 0, 20, 3.0, nullptr },
+  { "thresholds", "humidity_differential", CONFIG_FLOAT, 0, &config.humidity_differential, 0, 50, 10.0, nullptr },
+  { "thresholds", "min_outside_temp", CONFIG_FLOAT, 0, &config.min_outside_temp, -30, 30, -5.0, nullptr },
+  { "thresholds", "min_cellar_temp", CONFIG_FLOAT, 0, &config.min_cellar_temp, -10, 25, 8.0, nullptr },
+  { "thresholds", "max_dew_point_increase", CONFIG_FLOAT, 0, &config.max_dew_point_increase, 0, 10, 3.0, nullptr },
+  { "thresholds", "adaptive_differentials", CONFIG_BOOL, 0, &config.adaptive_differentials, 0, 1, 0, nullptr },
+  { "thresholds", "min_dry_rate", CONFIG_FLOAT, 0, &config.min_dry_rate, 0, 10, 0.3, nullptr },
+  { "thresholds", "min_cool_rate", CONFIG_FLOAT, 0, &config.min_cool_rate, 0, 10, 0.5, nullptr },
+
+  { "fan", "low_speed", CONFIG_INT, 0, &config.low_speed, 0, 100, 60, nullptr },
+  { "fan", "high_speed", CONFIG_INT, 0, &config.high_speed, 0, 100, 100, nullptr },
+  { "fan", "min_run_time_sec", CONFIG_INT, 0, &config.min_run_time_sec, 0, 86400, 300, nullptr },
+  { "fan", "min_idle_time_sec", CONFIG_INT, 0, &config.min_idle_time_sec, 0, 86400, 180, nullptr },
+  { "fan", "modulate_speed", CONFIG_BOOL, 0, &config.modulate_speed, 0, 1, 0, nullptr },
+  { "fan", "min_speed", CONFIG_INT, 0, &config.min_speed, 0, 100, 30, nullptr },
+  { "fan", "speed_kp", CONFIG_FLOAT, 0, &config.speed_kp, 0, 100, 4.0, nullptr },
+  { "fan", "speed_ki", CONFIG_FLOAT, 0, &config.speed_ki, 0, 100, 6.0, nullptr },
+  { "fan", "airflow_m3h", CONFIG_FLOAT, 0, &config.airflow_m3h, 0, 5000, 250.0, nullptr },
+
+  { "circulation", "forced_interval_hours", CONFIG_INT, 0, &config.forced_interval_hours, 0, 168, 6, nullptr },
+  { "circulation", "forced_duration_min", CONFIG_INT, 0, &config.forced_duration_min, 0, 240, 10, nullptr },
+
+  { "planner", "enabled", CONFIG_BOOL, 0, &config.planner_enabled, 0, 1, 0, nullptr },
+};
+
+static const size_t configFieldCount = sizeof(configFields) / sizeof(configFields[0]);
+
+static void setFieldDefault(const ConfigField& field) {
+  switch (field.type) {
+    case CONFIG_BOOL: *(bool*)field.value = field.defaultNumber != 0; break;
+    case CONFIG_INT: *(int*)field.value = (int)field.defaultNumber; break;
+    case CONFIG_FLOAT: *(float*)field.value = field.defaultNumber; break;
+    case CONFIG_STRING: *(String*)field.value = field.defaultText; break;
+  }
+}
+
+// A value of the wrong type counts as missing, as with `doc[...] | default`
+static void readField(const ConfigField& field, JsonVariantConst value) {
+  switch (field.type) {
+    case CONFIG_BOOL:
+      if (value.is<bool>()) *(bool*)field.value = value.as<bool>(); else setFieldDefault(field);
+      break;
+    case CONFIG_INT:
+      if (value.is<int>()) *(int*)field.value = value.as<int>(); else setFieldDefault(field);
+      break;
+    case CONFIG_FLOAT:
+      if (value.is<float>()) *(float*)field.value = value.as<float>(); else setFieldDefault(field);
+      break;
+    case CONFIG_STRING:
+      if (value.is<const char*>()) *(String*)field.value = value.as<const char*>(); else setFieldDefault(field);
+      break;
+  }
+}
+
+// The field's value waiting for a restart, null if none
+static JsonVariantConst pendingValue(const ConfigField& field) {
+  if (!(field.flags & CONFIG_RESTART)) return JsonVariantConst();
+  return restartPending.as<JsonObjectConst>()[field.section][field.key];
+}
+
+static void writeField(const ConfigField& field, JsonVariant out) {
+  switch (field.type) {
+    case CONFIG_BOOL: out.set(*(const bool*)field.value); break;
+    case CONFIG_INT: out.set(*(const int*)field.value); break;
+    case CONFIG_FLOAT: out.set(*(const float*)field.value); break;
+    case CONFIG_STRING: out.set(*(const String*)field.value); break;
+  }
+}
 
 bool loadConfig() {
   // Check if LittleFS is mounted
@@ -10,7 +130,10 @@ bool loadConfig() {
   }
   Serial.println("✓ LittleFS mounted");
   
-  if (!LittleFS.exists("/config.json")) {
+  // A save that did not get to its rename
+  if (LittleFS.exists(CONFIG_TEMP_FILE)) LittleFS.remove(CONFIG_TEMP_FILE);
+  
+  if (!LittleFS.exists(CONFIG_FILE)) {
     Serial.println("⚠️  Config file not found at /config.json");
     
     // List files in LittleFS for debugging
@@ -23,38 +146,22 @@ bool loadConfig() {
     }
     
     // Set sensible defaults
-    config.wifi_ssid = "YOUR_WIFI";
-    config.wifi_password = "YOUR_PASSWORD";
-    config.hostname = "cellar-fan";
-    config.use_static_ip = false;
-    config.static_ip = "192.168.0.139";
-    config.gateway = "192.168.0.1";
-    config.subnet = "255.255.255.0";
-    config.mqtt_enabled = false;
-    config.mqtt_broker = "192.168.1.100";
-    config.mqtt_port = 1883;
-    config.mqtt_user = "";
-    config.mqtt_password = "";
-    config.target_temp = 18.0;
-    config.target_humidity = 55.0;
-    config.temp_differential = 3.0;
-    config.humidity_differential = 10.0;
-    config.min_outside_temp = -5.0;
-    config.min_cellar_temp = 8.0;
-    config.max_dew_point_increase = 3.0;
-    config.low_speed = 60;
-    config.high_speed = 100;
-    config.min_run_time_sec = 300;
-    config.min_idle_time_sec = 180;
-    config.forced_interval_hours = 6;
-    config.forced_duration_min = 10;
+    for (size_t i = 0; i < configFieldCount; i++) setFieldDefault(configFields[i]);
+    config.power_points = 2;
+    config.power_speed[0] = 10;
+    config.power_watts[0] = 16;
+    config.power_speed[1] = 100;
+    config.power_watts[1] = 40;
+    config.schedule.setDefaults();
+    config.rules.clear();
+    config.zone_count = 0;
     
     return false;
   }
   
   Serial.println("✓ Config file found");
   
-  File file = LittleFS.open("/config.json", "r");
+  File file = LittleFS.open(CONFIG_FILE, "r");
   if (!file) {
     Serial.println("❌ Failed to open config.json");
     return false;
@@ -69,86 +176,371 @@ bool loadConfig() {
     return false;
   }
   
-  // WiFi
-  config.wifi_ssid = doc["wifi"]["ssid"].as<String>();
-  config.wifi_password = doc["wifi"]["password"].as<String>();
-  config.hostname = doc["wifi"]["hostname"] | "cellar-fan";
-  config.use_static_ip = doc["wifi"]["use_static_ip"] | false;
-  config.static_ip = doc["wifi"]["static_ip"] | "192.168.0.139";
-  config.gateway = doc["wifi"]["gateway"] | "192.168.0.1";
-  config.subnet = doc["wifi"]["subnet"] | "255.255.255.0";
-  
-  // MQTT
-  config.mqtt_enabled = doc["mqtt"]["enabled"] | false;
-  config.mqtt_broker = doc["mqtt"]["broker"] | "192.168.1.100";
-  config.mqtt_port = doc["mqtt"]["port"] | 1883;
-  config.mqtt_user = doc["mqtt"]["user"] | "";
-  config.mqtt_password = doc["mqtt"]["password"] | "";
-  
-  // Thresholds
-  config.target_temp = doc["thresholds"]["target_temp"] | 18.0;
-  config.target_humidity = doc["thresholds"]["target_humidity"] | 55.0;
-  config.temp_differential = doc["thresholds"]["temp_differential"] | 3.0;
-  config.humidity_differential = doc["thresholds"]["humidity_differential"] | 10.0;
-  config.min_outside_temp = doc["thresholds"]["min_outside_temp"] | -5.0;
-  config.min_cellar_temp = doc["thresholds"]["min_cellar_temp"] | 8.0;
-  config.max_dew_point_increase = doc["thresholds"]["max_dew_point_increase"] | 3.0;
-  
-  // Fan
-  config.low_speed = doc["fan"]["low_speed"] | 60;
-  config.high_speed = doc["fan"]["high_speed"] | 100;
-  config.min_run_time_sec = doc["fan"]["min_run_time_sec"] | 300;
-  config.min_idle_time_sec = doc["fan"]["min_idle_time_sec"] | 180;
-  
-  // Circulation
-  config.forced_interval_hours = doc["circulation"]["forced_interval_hours"] | 6;
-  config.forced_duration_min = doc["circulation"]["forced_duration_min"] | 10;
+  // Scalar settings
+  for (size_t i = 0; i < configFieldCount; i++) {
+    const ConfigField& field = configFields[i];
+    readField(field, doc[field.section][field.key]);
+  }
+  
+  // Power curve: [[speed, watts], ...] in ascending speed
+  JsonArray curve = doc["fan"]["power_curve"];
+  config.power_points = 0;
+  for (JsonArray point : curve) {
+    if (config.power_points >= MAX_POWER_POINTS) break;
+    int speed = point[0] | 0;
+    if (speed <= 0 || speed > 100) continue;
+    if (config.power_points > 0 && speed <= config.power_speed[config.power_points - 1]) {
+      Serial.printf("⚠️  Ignoring power curve point at %d%%, speeds must ascend\n", speed);
+      continue;
+    }
+    config.power_speed[config.power_points] = speed;
+    config.power_watts[config.power_points] = point[1] | 0.0f;
+    config.power_points++;
+  }
+  if (curve.isNull()) {
+    config.power_points = 2;
+    config.power_speed[0] = 10;
+    config.power_watts[0] = 16;
+    config.power_speed[1] = 100;
+    config.power_watts[1] = 40;
+  }
+  
+  // Schedule
+  JsonObject schedule = doc["schedule"];
+  if (schedule.isNull()) {
+    config.schedule.setDefaults();
+  } else {
+    config.schedule.clear();
+    for (int c = 0; c < SCHEDULE_CLASSES; c++) {
+      ScheduleClass cls = (ScheduleClass)c;
+      for (JsonVariant rule : schedule[WeeklySchedule::className(cls)].as<JsonArray>()) {
+        config.schedule.addRule(cls, rule.as<String>());
+      }
+    }
+    for (JsonVariant date : schedule["holidays"].as<JsonArray>()) {
+      config.schedule.addHoliday(date.as<String>());
+    }
+    if (schedule["holiday_as"].is<const char*>()) {
+      config.schedule.setHolidayWeekday(schedule["holiday_as"].as<String>());
+    }
+  }
+  
+  // Rules (a rule that does not compile is left out, the others still apply)
+  config.rules.clear();
+  for (JsonObject rule : doc["rules"].as<JsonArray>()) {
+    String name = rule["name"] | ("rule" + String(config.rules.getCount() + 1));
+    String error;
+    if (!config.rules.addRule(name, rule["when"] | "", rule["then"].as<String>(), error)) {
+      Serial.printf("⚠️  Rule %s ignored: %s\n", name.c_str(), error.c_str());
+    }
+  }
+  
+  // Zones (ids from 1; zone 0 is the main fan)
+  config.zone_count = 0;
+  for (JsonObject zone : doc["zones"].as<JsonArray>()) {
+    if (config.zone_count >= MAX_ZONES - 1) {
+      Serial.printf("⚠️  Only %d zones supported, ignoring the rest\n", MAX_ZONES - 1);
+      break;
+    }
+    uint8_t id = config.zone_count + 1;
+    ZoneConfig& z = config.zones[config.zone_count];
+    z.name = zone["name"] | ("zone" + String(id));
+    z.relay_pin = zone["relay_pin"] | 0;
+    z.dimmer_pin = zone["dimmer_pin"] | 0;
+    z.sensor_channel = zone["sensor_channel"] | 0;
+    z.role = strcmp(zone["role"] | "independent", "follow") == 0 ? ZONE_FOLLOW : ZONE_INDEPENDENT;
+    z.follow = zone["follow"] | 0;
+    z.balance = zone["balance"] | 1.0;
+    
+    if (z.relay_pin == 0 || z.dimmer_pin == 0) {
+      Serial.printf("⚠️  Zone %s needs relay_pin and dimmer_pin, ignored\n", z.name.c_str());
+      continue;
+    }
+    if (z.sensor_channel == MUX_CHANNEL_EXTERNAL || z.sensor_channel > 7) {
+      Serial.printf("⚠️  Zone %s: invalid sensor_channel, using the main sensor\n", z.name.c_str());
+      z.sensor_channel = MUX_CHANNEL_INTERNAL;
+    }
+    if (z.role == ZONE_FOLLOW && z.follow >= id) {
+      Serial.printf("⚠️  Zone %s can only follow a lower zone id, made independent\n", z.name.c_str());
+      z.role = ZONE_INDEPENDENT;
+    }
+    config.zone_count++;
+  }
   
   return true;
 }
 
 bool saveConfig() {
+  // Only the snapshot is taken under the lock: a PATCH on the AsyncTCP task
+  // must not wait for the flash
+  lockConfig();
+  uint32_t requested = saveRequested.load();
   JsonDocument doc;
+  buildConfigJSON(doc, true);
+  String json;
+  serializeJson(doc, json);
+  unlockConfig();
+  doc.clear();
   
-  doc["wifi"]["ssid"] = config.wifi_ssid;
-  doc["wifi"]["password"] = config.wifi_password;
-  doc["wifi"]["hostname"] = config.hostname;
-  
-  doc["mqtt"]["enabled"] = config.mqtt_enabled;
-  doc["mqtt"]["broker"] = config.mqtt_broker;
-  doc["mqtt"]["port"] = config.mqtt_port;
-  doc["mqtt"]["user"] = config.mqtt_user;
-  doc["mqtt"]["password"] = config.mqtt_password;
-  
-  doc["thresholds"]["target_temp"] = config.target_temp;
-  doc["thresholds"]["target_humidity"] = config.target_humidity;
-  doc["thresholds"]["temp_differential"] = config.temp_differential;
-  doc["thresholds"]["humidity_differential"] = config.humidity_differential;
-  doc["thresholds"]["min_outside_temp"] = config.min_outside_temp;
-  doc["thresholds"]["min_cellar_temp"] = config.min_cellar_temp;
-  doc["thresholds"]["max_dew_point_increase"] = config.max_dew_point_increase;
-  
-  doc["fan"]["low_speed"] = config.low_speed;
-  doc["fan"]["high_speed"] = config.high_speed;
-  doc["fan"]["min_run_time_sec"] = config.min_run_time_sec;
-  doc["fan"]["min_idle_time_sec"] = config.min_idle_time_sec;
-  
-  doc["circulation"]["forced_interval_hours"] = config.forced_interval_hours;
-  doc["circulation"]["forced_duration_min"] = config.forced_duration_min;
-  
-  File file = LittleFS.open("/config.json", "w");
+  bool ok = writeConfig(json);
+  if (ok) saveCompleted.store(requested);
+  return ok;
+}
+
+void requestConfigSave() {
+  lastSaveRequest.store(millis());
+  saveRequested.fetch_add(1);
+}
+
+void updateConfigSave() {
+  if (saveRequested.load() == saveCompleted.load()) {
+    savePendingSeen = false;
+    return;
+  }
+  unsigned long now = millis();
+  if (!savePendingSeen) {
+    savePendingSeen = true;
+    savePendingSince = now;
+  }
+  if (now - lastSaveRequest.load() < CONFIG_SAVE_DELAY &&
+      now - savePendingSince < CONFIG_SAVE_MAX_DELAY) {
+    return;
+  }
+  // On failure, try again after another CONFIG_SAVE_MAX_DELAY
+  if (!saveConfig()) savePendingSince = now;
+}
+
+bool flushConfig() {
+  if (saveRequested.load() == saveCompleted.load()) return true;
+  return saveConfig();
+}
+
+void buildConfigJSON(JsonDocument& doc, bool secrets) {
+  lockConfig();
+  for (size_t i = 0; i < configFieldCount; i++) {
+    const ConfigField& field = configFields[i];
+    if (!secrets && (field.flags & CONFIG_SECRET)) continue;
+    JsonVariantConst pending = pendingValue(field);
+    if (pending.isNull()) {
+      writeField(field, doc[field.section][field.key]);
+    } else {
+      doc[field.section][field.key] = pending;
+    }
+  }
+  
+  JsonArray curve = doc["fan"]["power_curve"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.power_points; i++) {
+    JsonArray point = curve.add<JsonArray>();
+    point.add(config.power_speed[i]);
+    point.add(config.power_watts[i]);
+  }
+  
+  for (int c = 0; c < SCHEDULE_CLASSES; c++) {
+    ScheduleClass cls = (ScheduleClass)c;
+    JsonArray rules = doc["schedule"][WeeklySchedule::className(cls)].to<JsonArray>();
+    for (uint8_t i = 0; i < config.schedule.getRuleCount(cls); i++) {
+      rules.add(config.schedule.getRule(cls, i));
+    }
+  }
+  JsonArray holidays = doc["schedule"]["holidays"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.schedule.getHolidayCount(); i++) {
+    holidays.add(config.schedule.getHoliday(i));
+  }
+  doc["schedule"]["holiday_as"] = config.schedule.getHolidayWeekday();
+  
+  JsonArray rules = doc["rules"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.rules.getCount(); i++) {
+    JsonObject rule = rules.add<JsonObject>();
+    rule["name"] = config.rules.getRule(i).name;
+    rule["when"] = config.rules.getRule(i).when;
+    rule["then"] = config.rules.getAction(i);
+  }
+  
+  JsonArray zones = doc["zones"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.zone_count; i++) {
+    const ZoneConfig& z = config.zones[i];
+    JsonObject zone = zones.add<JsonObject>();
+    zone["name"] = z.name;
+    zone["relay_pin"] = z.relay_pin;
+    zone["dimmer_pin"] = z.dimmer_pin;
+    zone["sensor_channel"] = z.sensor_channel;
+    zone["role"] = z.role == ZONE_FOLLOW ? "follow" : "independent";
+    if (z.role == ZONE_FOLLOW) {
+      zone["follow"] = z.follow;
+      zone["balance"] = z.balance;
+    }
+  }
+  unlockConfig();
+}
+
+void buildConfigFilter(JsonDocument& filter) {
+  for (size_t i = 0; i < configFieldCount; i++) {
+    filter[configFields[i].section][configFields[i].key] = true;
+  }
+}
+
+static bool sameValue(const ConfigField& field, float number, const char* text) {
+  JsonVariantConst pending = pendingValue(field);
+  if (!pending.isNull()) {
+    switch (field.type) {
+      case CONFIG_BOOL: return pending.as<bool>() == (number != 0);
+      case CONFIG_INT: return pending.as<int>() == (int)number;
+      case CONFIG_FLOAT: return pending.as<float>() == number;
+      case CONFIG_STRING: return strcmp(pending.as<const char*>(), text) == 0;
+    }
+  }
+  switch (field.type) {
+    case CONFIG_BOOL: return *(const bool*)field.value == (number != 0);
+    case CONFIG_INT: return *(const int*)field.value == (int)number;
+    case CONFIG_FLOAT: return *(const float*)field.value == number;
+    case CONFIG_STRING: return *(const String*)field.value == text;
+  }
+  return false;
+}
+
+bool patchConfig(JsonObjectConst patch, JsonObject changes, String& error, bool& restart) {
+  struct Staged {
+    const ConfigField* field;
+    float number;
+    const char* text;
+  };
+  Staged staged[configFieldCount];
+  size_t count = 0;
+  restart = false;
+  
+  // Check everything before changing anything
+  for (size_t i = 0; i < configFieldCount; i++) {
+    const ConfigField& field = configFields[i];
+    JsonVariantConst value = patch[field.section][field.key];
+    if (value.isNull()) continue;
+    
+    Staged& s = staged[count];
+    s.field = &field;
+    s.number = 0;
+    s.text = nullptr;
+    String name = String(field.section) + "." + field.key;
+    switch (field.type) {
+      case CONFIG_BOOL:
+        if (!value.is<bool>()) {
+          error = name + " must be true or false";
+          return false;
+        }
+        s.number = value.as<bool>() ? 1 : 0;
+        break;
+      case CONFIG_INT:
+      case CONFIG_FLOAT:
+        if (field.type == CONFIG_INT ? !value.is<long>() : !value.is<float>()) {
+          error = name + (field.type == CONFIG_INT ? " must be an integer" : " must be a number");
+          return false;
+        }
+        s.number = value.as<float>();
+        if (s.number < field.min || s.number > field.max) {
+          int decimals = field.type == CONFIG_INT ? 0 : 1;
+          error = name + " must be between " + String(field.min, decimals) + " and " +
+                  String(field.max, decimals);
+          return false;
+        }
+        break;
+      case CONFIG_STRING:
+        if (!value.is<const char*>()) {
+          error = name + " must be a string";
+          return false;
+        }
+        s.text = value.as<const char*>();
+        if (strlen(s.text) < field.min || strlen(s.text) > field.max) {
+          error = name + " must be " + String((int)field.min) + " to " + String((int)field.max) + " characters";
+          return false;
+        }
+        break;
+    }
+    count++;
+  }
+  if (count == 0) {
+    error = "no known settings";
+    return false;
+  }
+  
+  // Settings that only make sense together, as they would be after the patch
+  auto valueOf = [&](const int* target) {
+    for (size_t i = 0; i < count; i++) {
+      if (staged[i].field->value == target) return (int)staged[i].number;
+    }
+    return *target;
+  };
+  if (valueOf(&config.low_speed) > valueOf(&config.high_speed)) {
+    error = "fan.low_speed must not exceed fan.high_speed";
+    return false;
+  }
+  
+  // All at once, so no decision sees half a patch
+  lockConfig();
+  for (size_t i = 0; i < count; i++) {
+    const Staged& s = staged[i];
+    const ConfigField& field = *s.field;
+    if (sameValue(field, s.number, s.text)) continue;
+    
+    JsonObject change = changes[field.section][field.key].to<JsonObject>();
+    JsonVariantConst pending = pendingValue(field);
+    if (field.flags & CONFIG_SECRET) {
+      change["changed"] = true;
+    } else if (!pending.isNull()) {
+      change["old"] = pending;
+    } else {
+      writeField(field, change["old"]);
+    }
+    
+    if (field.flags & CONFIG_RESTART) {
+      // For the file and the next start only, see restartPending
+      JsonVariant next = restartPending[field.section][field.key].to<JsonVariant>();
+      switch (field.type) {
+        case CONFIG_BOOL: next.set(s.number != 0); break;
+        case CONFIG_INT: next.set((int)s.number); break;
+        case CONFIG_FLOAT: next.set(s.number); break;
+        case CONFIG_STRING: next.set(String(s.text)); break;
+      }
+      if (!(field.flags & CONFIG_SECRET)) change["new"] = next;
+      restart = true;
+      continue;
+    }
+    switch (field.type) {
+      case CONFIG_BOOL: *(bool*)field.value = s.number != 0; break;
+      case CONFIG_INT: *(int*)field.value = (int)s.number; break;
+      case CONFIG_FLOAT: *(float*)field.value = s.number; break;
+      case CONFIG_STRING: *(String*)field.value = s.text; break;
+    }
+    if (!(field.flags & CONFIG_SECRET)) writeField(field, change["new"]);
+  }
+  unlockConfig();
+  return true;
+}
+
+// Writes json to CONFIG_TEMP_FILE and renames it over CONFIG_FILE, so a
+// reset mid-write leaves the old file intact
+static bool writeConfig(const String& json) {
+  if (json.length() == 0) {
+    Serial.println("❌ Failed to serialize config.json");
+    return false;
+  }
+  
+  File file = LittleFS.open(CONFIG_TEMP_FILE, "w");
   if (!file) {
     Serial.println("❌ Failed to open config.json for writing");
     return false;
   }
   
-  if (serializeJson(doc, file) == 0) {
+  size_t written = file.write((const uint8_t*)json.c_str(), json.length());
+  file.close();
+  if (written != json.length()) {
     Serial.println("❌ Failed to write config.json");
-    file.close();
+    LittleFS.remove(CONFIG_TEMP_FILE);
     return false;
   }
   
-  file.close();
+  if (!LittleFS.rename(CONFIG_TEMP_FILE, CONFIG_FILE)) {
+    Serial.println("❌ Failed to replace config.json");
+    LittleFS.remove(CONFIG_TEMP_FILE);
+    return false;
+  }
   Serial.println("✓ Configuration saved");
   return true;
 }
@@ -161,4 +553,33 @@ void printConfig() {
   Serial.printf("  Target Temp: %.1f°C\n", config.target_temp);
   Serial.printf("  Target Humidity: %.1f%%\n", config.target_humidity);
   Serial.printf("  Low Speed: %d%%, High Speed: %d%%\n", config.low_speed, config.high_speed);
+  Serial.printf("  Schedule: %u high, %u off rules, %u holidays\n",
+                config.schedule.getRuleCount(SCHEDULE_HIGH),
+                config.schedule.getRuleCount(SCHEDULE_OFF),
+                config.schedule.getHolidayCount());
+  if (config.modulate_speed) {
+    Serial.printf("  Speed Control: PI (min %d%%, Kp %.1f, Ki %.1f)\n",
+                  config.min_speed, config.speed_kp, config.speed_ki);
+  }
+  Serial.printf("  Fan: %.0f m3/h, %u power curve points\n",
+                config.airflow_m3h, config.power_points);
+  if (config.adaptive_differentials) {
+    Serial.printf("  Differentials: adaptive (min %.2f g/m3/h, %.2f°C/h)\n",
+                  config.min_dry_rate, config.min_cool_rate);
+  }
+  if (config.rules.getCount() > 0) {
+    Serial.printf("  Rules: %u (%u bytes of bytecode)\n",
+                  config.rules.getCount(), config.rules.getCodeSize());
+  }
+  if (config.planner_enabled) {
+    Serial.println("  Planner: Enabled (day-ahead plan for humidity runs)");
+  }
+  for (uint8_t i = 0; i < config.zone_count; i++) {
+    const ZoneConfig& z = config.zones[i];
+    if (z.role == ZONE_FOLLOW) {
+      Serial.printf("  Zone %u (%s): follows zone %u x %.2f\n", i + 1, z.name.c_str(), z.follow, z.balance);
+    } else {
+      Serial.printf("  Zone %u (%s): independent, sensor on mux %u\n", i + 1, z.name.c_str(), z.sensor_channel);
+    }
+  }
 }
\ No newline at end of file
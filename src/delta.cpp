@@ -0,0 +1,191 @@
+#include "delta.h"
+#include <mbedtls/sha256.h>
+
+static uint32_t readLE32(const uint8_t* p) {
+  return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+DeltaDecoder::DeltaDecoder() {
+  inflater = nullptr;
+  ring = nullptr;
+  ringSize = (size_t)1 << DELTA_WINDOW_BITS;
+  ringPos = 0;
+  inflated = false;
+  base = nullptr;
+  baseSize = 0;
+  phase = PHASE_OP;
+  op = DELTA_END;
+  fieldLen = 0;
+  fieldNeed = 0;
+  offset = 0;
+  remaining = 0;
+  error = nullptr;
+}
+
+DeltaDecoder::~DeltaDecoder() {
+  release();
+}
+
+bool DeltaDecoder::isPatch(const uint8_t* data, size_t len) {
+  if (len < sizeof(DeltaHeader)) return false;
+  DeltaHeader header;
+  memcpy(&header, data, sizeof(header));
+  return header.magic == DELTA_MAGIC && header.version == DELTA_VERSION;
+}
+
+bool DeltaDecoder::allocate() {
+  if (!inflater) inflater = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  if (!ring) ring = (uint8_t*)malloc(ringSize);
+  if (inflater && ring) return true;
+  release();
+  return false;
+}
+
+void DeltaDecoder::release() {
+  free(inflater);
+  free(ring);
+  inflater = nullptr;
+  ring = nullptr;
+}
+
+bool DeltaDecoder::begin(const DeltaHeader& header, const esp_partition_t* running) {
+  error = nullptr;
+  base = running;
+  baseSize = header.baseSize;
+  if (header.windowBits < 8 || header.windowBits > DELTA_WINDOW_BITS) {
+    error = "Patch window too large";
+    return false;
+  }
+  if (!base || baseSize > base->size) {
+    error = "Patch is for another firmware";
+    return false;
+  }
+
+  // The ring is free until decoding starts: use it to read the base
+  uint8_t hash[32];
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  for (uint32_t pos = 0; pos < baseSize; ) {
+    size_t n = min((size_t)(baseSize - pos), ringSize);
+    if (esp_partition_read(base, pos, ring, n) != ESP_OK) {
+      error = "Cannot read the running firmware";
+      break;
+    }
+    mbedtls_sha256_update(&sha, ring, n);
+    pos += n;
+  }
+  mbedtls_sha256_finish(&sha, hash);
+  mbedtls_sha256_free(&sha);
+  if (error) return false;
+  if (memcmp(hash, header.baseSha256, sizeof(hash)) != 0) {
+    error = "Patch is for another firmware";
+    return false;
+  }
+
+  tinfl_init(inflater);
+  ringPos = 0;
+  inflated = false;
+  phase = PHASE_OP;
+  return true;
+}
+
+bool DeltaDecoder::write(const uint8_t* data, size_t len, Sink sink, void* context) {
+  if (error) return false;
+  for (;;) {
+    if (inflated) {
+      if (len > 0) error = "Data after the end of the patch";
+      break;
+    }
+    size_t in = len;
+    size_t out = ringSize - ringPos;
+    tinfl_status status = tinfl_decompress(inflater, data, &in, ring, ring + ringPos, &out,
+                                           TINFL_FLAG_HAS_MORE_INPUT);
+    data += in;
+    len -= in;
+    if (out > 0 && !decode(ring + ringPos, out, sink, context)) break;
+    ringPos = (ringPos + out) & (ringSize - 1);
+    if (status < TINFL_STATUS_DONE) {
+      error = "Corrupt patch data";
+      break;
+    }
+    if (status == TINFL_STATUS_DONE) {
+      inflated = true;
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) {
+      break;
+    }
+  }
+  return error == nullptr;
+}
+
+bool DeltaDecoder::decode(const uint8_t* data, size_t len, Sink sink, void* context) {
+  while (len > 0) {
+    switch (phase) {
+      case PHASE_OP:
+        op = *data++;
+        len--;
+        fieldLen = 0;
+        fieldNeed = op == DELTA_ADD ? 8 : op == DELTA_INSERT ? 4 : 0;
+        if (op == DELTA_END) {
+          phase = PHASE_DONE;
+        } else if (fieldNeed == 0) {
+          error = "Unknown patch op";
+          return false;
+        } else {
+          phase = PHASE_FIELDS;
+        }
+        break;
+
+      case PHASE_FIELDS: {
+        size_t n = min(len, (size_t)(fieldNeed - fieldLen));
+        memcpy(fields + fieldLen, data, n);
+        fieldLen += n;
+        data += n;
+        len -= n;
+        if (fieldLen == fieldNeed && !startOp()) return false;
+        break;
+      }
+
+      case PHASE_PAYLOAD: {
+        size_t n = min(len, (size_t)remaining);
+        if (op == DELTA_INSERT) {
+          if (!sink(context, data, n)) return false;
+        } else {
+          n = min(n, sizeof(baseChunk));
+          if (esp_partition_read(base, offset, baseChunk, n) != ESP_OK) {
+            error = "Cannot read the running firmware";
+            return false;
+          }
+          for (size_t i = 0; i < n; i++) baseChunk[i] += data[i];
+          if (!sink(context, baseChunk, n)) return false;
+          offset += n;
+        }
+        data += n;
+        len -= n;
+        remaining -= n;
+        if (remaining == 0) phase = PHASE_OP;
+        break;
+      }
+
+      case PHASE_DONE:
+        error = "Data after the end of the patch";
+        return false;
+    }
+  }
+  return true;
+}
+
+bool DeltaDecoder::startOp() {
+  if (op == DELTA_ADD) {
+    offset = readLE32(fields);
+    remaining = readLE32(fields + 4);
+    if (offset > baseSize || remaining > baseSize - offset) {
+      error = "Patch reads past the running firmware";
+      return false;
+    }
+  } else {
+    remaining = readLE32(fields);
+  }
+  phase = remaining > 0 ? PHASE_PAYLOAD : PHASE_OP;
+  return true;
+}
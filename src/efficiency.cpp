@@ -0,0 +1,169 @@
+#include "efficiency.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+
+static const char* kindNames[] = { "dry", "cool" };
+
+EfficiencyEstimator::EfficiencyEstimator() {
+  memset(fits, 0, sizeof(fits));
+  persistent = false;
+  inRun = false;
+  runStart = 0;
+  lastUpdate = 0;
+  samples = 0;
+}
+
+void EfficiencyEstimator::begin() {
+  persistent = true;
+  if (load()) {
+    Serial.printf("✓ Run efficiency loaded: %lu runs measured\n",
+                  (unsigned long)fits[EFFICIENCY_DRY].runs);
+  }
+}
+
+void EfficiencyEstimator::update(const SensorData& internal, const SensorData& external,
+                                 int fanSpeed) {
+  unsigned long now = millis();
+
+  // A run with a gap in the data can't be measured
+  if (!internal.valid || !external.valid) {
+    inRun = false;
+    return;
+  }
+
+  float inAh = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity);
+  float outAh = SensorManagerBase::calculateAbsoluteHumidity(external.temperature, external.humidity);
+
+  if (inRun) {
+    // The fan just stopped: this reading is the state the run left
+    if (fanSpeed == 0) {
+      lastAh = inAh;
+      lastTemp = internal.temperature;
+      lastUpdate = now;
+      finishRun();
+      return;
+    }
+  } else if (fanSpeed > 0) {
+    inRun = true;
+    runStart = now;
+    startAh = inAh;
+    startTemp = internal.temperature;
+    gapSum[EFFICIENCY_DRY] = 0;
+    gapSum[EFFICIENCY_COOL] = 0;
+    speedSum = 0;
+    samples = 0;
+  } else {
+    return;
+  }
+
+  gapSum[EFFICIENCY_DRY] += inAh - outAh;
+  gapSum[EFFICIENCY_COOL] += internal.temperature - external.temperature;
+  speedSum += fanSpeed;
+  samples++;
+  lastAh = inAh;
+  lastTemp = internal.temperature;
+  lastUpdate = now;
+}
+
+void EfficiencyEstimator::finishRun() {
+  inRun = false;
+  float hours = (lastUpdate - runStart) / 3.6e6f;
+  if (hours * 60 < EFFICIENCY_MIN_RUN_MIN || samples == 0) return;
+
+  // Per hour at full speed, so low and high speed runs share one fit
+  float speed = speedSum / samples / 100.0f;
+  addRun(fits[EFFICIENCY_DRY], gapSum[EFFICIENCY_DRY] / samples,
+         (startAh - lastAh) / hours / speed);
+  addRun(fits[EFFICIENCY_COOL], gapSum[EFFICIENCY_COOL] / samples,
+         (startTemp - lastTemp) / hours / speed);
+
+  float intercept, slope;
+  if (getCoefficients(EFFICIENCY_DRY, intercept, slope)) {
+    Serial.printf("📈 Run efficiency: %.2f g/m3/h + %.2f/h x gap\n", intercept, slope);
+  }
+  if (persistent) save();
+}
+
+void EfficiencyEstimator::addRun(EfficiencyFit& fit, float gap, float rate) {
+  fit.sw = fit.sw * EFFICIENCY_FORGET + 1;
+  fit.sx = fit.sx * EFFICIENCY_FORGET + gap;
+  fit.sy = fit.sy * EFFICIENCY_FORGET + rate;
+  fit.sxx = fit.sxx * EFFICIENCY_FORGET + gap * gap;
+  fit.sxy = fit.sxy * EFFICIENCY_FORGET + gap * rate;
+  fit.runs++;
+}
+
+bool EfficiencyEstimator::getCoefficients(EfficiencyKind kind, float& intercept, float& slope) const {
+  const EfficiencyFit& fit = fits[kind];
+  if (fit.runs < EFFICIENCY_MIN_RUNS) return false;
+
+  // Weighted least squares; runs at nearly the same gap can't give a slope
+  float det = fit.sw * fit.sxx - fit.sx * fit.sx;
+  if (det < 0.01f * fit.sw * fit.sw) return false;
+  slope = (fit.sw * fit.sxy - fit.sx * fit.sy) / det;
+  intercept = (fit.sy - slope * fit.sx) / fit.sw;
+  return true;
+}
+
+bool EfficiencyEstimator::predict(EfficiencyKind kind, float gap, float& rate) const {
+  float intercept, slope;
+  if (!getCoefficients(kind, intercept, slope)) return false;
+  rate = intercept + slope * gap;
+  return true;
+}
+
+String EfficiencyEstimator::getJSON() const {
+  JsonDocument doc;
+  doc["adaptive"] = config.adaptive_differentials;
+  for (int k = 0; k < EFFICIENCY_KINDS; k++) {
+    JsonObject fit = doc[kindNames[k]].to<JsonObject>();
+    fit["runs"] = fits[k].runs;
+    float intercept, slope;
+    bool ready = getCoefficients((EfficiencyKind)k, intercept, slope);
+    fit["ready"] = ready;
+    if (ready) {
+      fit["intercept"] = intercept;
+      fit["slope"] = slope;
+      if (slope > 0) {
+        fit["break_even_gap"] = -intercept / slope;
+      }
+    }
+  }
+  doc["min_dry_rate"] = config.min_dry_rate;
+  doc["min_cool_rate"] = config.min_cool_rate;
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+bool EfficiencyEstimator::load() {
+  if (!LittleFS.exists(EFFICIENCY_FILE)) return false;
+  File file = LittleFS.open(EFFICIENCY_FILE, "r");
+  if (!file) return false;
+
+  uint32_t magic = 0;
+  bool ok = file.size() == sizeof(magic) + sizeof(fits) &&
+            file.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic) &&
+            magic == EFFICIENCY_MAGIC &&
+            file.read((uint8_t*)fits, sizeof(fits)) == sizeof(fits);
+  file.close();
+  if (!ok) {
+    memset(fits, 0, sizeof(fits));
+    Serial.println("⚠️ " EFFICIENCY_FILE " has an unknown format, starting over");
+  }
+  return ok;
+}
+
+bool EfficiencyEstimator::save() const {
+  File file = LittleFS.open(EFFICIENCY_FILE, "w");
+  if (!file) {
+    Serial.println("❌ Failed to open " EFFICIENCY_FILE " for writing");
+    return false;
+  }
+  uint32_t magic = EFFICIENCY_MAGIC;
+  file.write((const uint8_t*)&magic, sizeof(magic));
+  file.write((const uint8_t*)fits, sizeof(fits));
+  file.close();
+  return true;
+}
@@ -0,0 +1,195 @@
+#include "espota.h"
+#include <ESPmDNS.h>
+#include <MD5Builder.h>
+#include <Update.h>
+
+static String md5Hex(const String& text) {
+  MD5Builder md5;
+  md5.begin();
+  md5.add(text);
+  md5.calculate();
+  return md5.toString();
+}
+
+// What went wrong with the update itself, for the host and the display
+static const char* updateError(OtaUpdater& ota, bool firmware) {
+  const char* error = firmware ? ota.getProgress().error : Update.errorString();
+  return error ? error : "Update failed";
+}
+
+EspotaReceiver::EspotaReceiver(OtaUpdater& ota) : ota(ota) {
+  listening = false;
+  state = ESPOTA_IDLE;
+  nonce[0] = '\0';
+  challengedAt = 0;
+  command = ESPOTA_FLASH;
+  hostPort = 0;
+  size = 0;
+  md5[0] = '\0';
+}
+
+void EspotaReceiver::begin(const char* password, uint16_t port) {
+  passwordMd5 = password && password[0] ? md5Hex(password) : String();
+  listening = udp.begin(port);
+  // For the IDE's list of network ports; the hostname is announced with WiFi
+  MDNS.enableArduino(port, passwordMd5.length() > 0);
+}
+
+void EspotaReceiver::handle() {
+  if (!listening) return;
+  if (state == ESPOTA_WAIT_AUTH && millis() - challengedAt > ESPOTA_AUTH_WAIT_MS) {
+    state = ESPOTA_IDLE;
+  }
+  if (udp.parsePacket() <= 0) return;
+
+  char packet[128];
+  int len = udp.read((uint8_t*)packet, sizeof(packet) - 1);
+  if (len <= 0) return;
+  packet[len] = '\0';
+  if (state == ESPOTA_IDLE) {
+    onInvitation(packet);
+  } else {
+    onAuth(packet);
+  }
+}
+
+void EspotaReceiver::reply(const char* text) {
+  udp.beginPacket(udp.remoteIP(), udp.remotePort());
+  udp.write((const uint8_t*)text, strlen(text));
+  udp.endPacket();
+}
+
+void EspotaReceiver::onInvitation(const char* packet) {
+  int cmd;
+  unsigned int port;
+  unsigned long length;
+  char hash[33];
+  if (sscanf(packet, "%d %u %lu %32s", &cmd, &port, &length, hash) != 4 ||
+      (cmd != ESPOTA_FLASH && cmd != ESPOTA_FILESYSTEM) || port == 0 || port > 65535 ||
+      length == 0 || strlen(hash) != 32) {
+    return;
+  }
+  // One update at a time: the host gets no answer and gives up
+  if (ota.isReceiving() || Update.isRunning()) {
+    Serial.println("⚠️  OTA invitation ignored, an update is running");
+    return;
+  }
+
+  command = cmd;
+  host = udp.remoteIP();
+  hostPort = port;
+  size = length;
+  memcpy(md5, hash, sizeof(md5));
+  if (passwordMd5.length() == 0) {
+    reply("OK");
+    run();
+    return;
+  }
+
+  snprintf(nonce, sizeof(nonce), "%s", md5Hex(String(micros())).c_str());
+  char challenge[40];
+  snprintf(challenge, sizeof(challenge), "AUTH %s", nonce);
+  reply(challenge);
+  state = ESPOTA_WAIT_AUTH;
+  challengedAt = millis();
+}
+
+void EspotaReceiver::onAuth(const char* packet) {
+  state = ESPOTA_IDLE;
+  int cmd;
+  char cnonce[33];
+  char response[33];
+  if (sscanf(packet, "%d %32s %32s", &cmd, cnonce, response) != 3 || cmd != ESPOTA_AUTH) return;
+
+  // MD5(MD5(password) ":" nonce ":" cnonce), as espota.py computes it
+  String expected = md5Hex(passwordMd5 + ":" + nonce + ":" + cnonce);
+  if (!expected.equalsIgnoreCase(response)) {
+    reply("Authentication Failed");
+    Serial.println("❌ OTA authentication failed");
+    if (endHandler) endHandler("Auth Failed");
+    return;
+  }
+  host = udp.remoteIP();
+  reply("OK");
+  run();
+}
+
+void EspotaReceiver::run() {
+  bool firmware = command == ESPOTA_FLASH;
+  // The HTTP upload may have claimed the updater since the invitation
+  uint32_t session = firmware ? ota.begin(size, nullptr) : 0;
+  bool started = firmware ? session != 0 && ota.isReceiving() : Update.begin(size, U_SPIFFS);
+  if (!started) {
+    const char* error = firmware && session == 0 ? "Another update is running" : updateError(ota, firmware);
+    if (endHandler) endHandler(error);
+    return;
+  }
+  Serial.printf("🔄 OTA %s from %s, %lu bytes\n", firmware ? "firmware" : "filesystem",
+                host.toString().c_str(), (unsigned long)size);
+  if (startHandler) startHandler(firmware);
+  if (progressHandler) progressHandler(0, size);
+
+  WiFiClient client;
+  const char* error = client.connect(host, hostPort) ? receive(client, session) : "Connect Failed";
+  if (!error && !(firmware ? ota.end(session) : Update.end())) error = updateError(ota, firmware);
+  if (error && firmware) {
+    ota.abort(session, error);   // a no-op once end() failed
+  } else if (error) {
+    Update.abort();
+  }
+
+  // espota.py reports whatever comes back
+  client.print(error ? error : "OK");
+  client.stop();
+  if (endHandler) endHandler(error);
+  if (!error && !firmware) {
+    // Onto the new filesystem before anything is written to it
+    delay(100);
+    ESP.restart();
+  }
+}
+
+// Reads the file into the update (session 0: a filesystem image through
+// Update), acknowledging each piece with its length; null once all of it
+// arrived with the MD5 named in the invitation
+const char* EspotaReceiver::receive(WiFiClient& client, uint32_t session) {
+  bool firmware = session != 0;
+  static uint8_t buf[ESPOTA_CHUNK];
+  MD5Builder hash;
+  hash.begin();
+  uint32_t received = 0;
+  int last = 0;
+  uint8_t retries = 0;
+
+  while (received < size) {
+    unsigned long waitStart = millis();
+    int available = client.available();
+    while (available <= 0 && client.connected() && millis() - waitStart < ESPOTA_READ_WAIT_MS) {
+      delay(1);
+      available = client.available();
+    }
+    if (available <= 0) {
+      // The host may have missed the last acknowledgement
+      if (client.connected() && last > 0 && retries++ < ESPOTA_READ_RETRIES) {
+        client.printf("%d", last);
+        continue;
+      }
+      return "Receive Failed";
+    }
+    retries = 0;
+
+    size_t want = min((size_t)available, min(sizeof(buf), (size_t)(size - received)));
+    last = client.read(buf, want);
+    if (last <= 0) return "Receive Failed";
+    hash.add(buf, last);
+    bool ok = firmware ? ota.write(session, buf, last) : Update.write(buf, last) == (size_t)last;
+    if (!ok) return updateError(ota, firmware);
+    received += last;
+    client.printf("%d", last);
+    if (progressHandler) progressHandler(received, size);
+  }
+
+  hash.calculate();
+  if (!hash.toString().equalsIgnoreCase(md5)) return "MD5 mismatch";
+  return nullptr;
+}
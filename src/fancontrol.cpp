@@ -1,58 +1,85 @@
 #include "fancontrol.h"
 #include <time.h>
 
-FanController::FanController() {
+// The AC zero-cross detector is shared by all dimmer channels
+static bool acReady = false;
+static volatile uint32_t zeroCrossings = 0;
+
+// Called by the dimmer library's zero-cross interrupt
+static void IRAM_ATTR countZeroCrossing(void*) {
+  zeroCrossings = zeroCrossings + 1;
+}
+
+FanController::FanController(uint8_t relayPin, uint8_t dimmerPin, ControlMode& mode,
+                             unsigned long& overrideUntil)
+  : relayPin(relayPin), dimmerPin(dimmerPin), controlMode(mode), overrideUntil(overrideUntil) {
   currentSpeed = 0;
   runReason = REASON_OFF;
+  gate = GATE_NONE;
   lastStateChange = 0;
   lastForcedRun = 0;
   relayState = false;
+  relayCycles = 0;
   forcedRunActive = false;
   forcedRunStart = 0;
+  speedIntegral = 0;
+  lastModulation = 0;
+  updatePending = false;
+  changeBlocked = false;
+  wakeTask = nullptr;
+  planner = nullptr;
+  estimator = nullptr;
+  leader = nullptr;
+  balance = 1.0f;
+  activeRule = -1;
   dimmerChannel = nullptr;
 }
 
 bool FanController::begin() {
   // Initialize relay (active LOW)
-  pinMode(PIN_RELAY, OUTPUT);
-  digitalWrite(PIN_RELAY, HIGH); // OFF
-  Serial.println("✓ Relay initialized (OFF)");
-  
-  // Initialize RBDimmer library
-  rbdimmer_err_t err = rbdimmer_init();
-  if (err != RBDIMMER_OK) {
-    Serial.printf("❌ RBDimmer init failed: %d\n", err);
-    return false;
-  }
-  
-  // Register zero-cross detector (50Hz expected, 0 = auto-detect)
-  err = rbdimmer_register_zero_cross(PIN_DIMMER_ZC, 0, 50);
-  if (err != RBDIMMER_OK) {
-    Serial.printf("❌ Zero-cross registration failed: %d\n", err);
-    return false;
-  }
-  
-  // Wait for frequency detection
-  Serial.print("⏳ Detecting AC frequency");
-  for (int i = 0; i < 30; i++) {
-    delay(100);
-    Serial.print(".");
-    uint16_t freq = rbdimmer_get_frequency(0);
-    if (freq > 0) {
-      Serial.printf(" detected: %d Hz\n", freq);
-      break;
+  pinMode(relayPin, OUTPUT);
+  digitalWrite(relayPin, HIGH); // OFF
+  Serial.printf("✓ Relay initialized on pin %d (OFF)\n", relayPin);
+  
+  if (!acReady) {
+    // Initialize RBDimmer library
+    rbdimmer_err_t err = rbdimmer_init();
+    if (err != RBDIMMER_OK) {
+      Serial.printf("❌ RBDimmer init failed: %d\n", err);
+      return false;
+    }
+    
+    // Register zero-cross detector (50Hz expected, 0 = auto-detect)
+    err = rbdimmer_register_zero_cross(PIN_DIMMER_ZC, 0, 50);
+    if (err != RBDIMMER_OK) {
+      Serial.printf("❌ Zero-cross registration failed: %d\n", err);
+      return false;
+    }
+    
+    // Wait for frequency detection
+    Serial.print("⏳ Detecting AC frequency");
+    for (int i = 0; i < 30; i++) {
+      delay(100);
+      Serial.print(".");
+      uint16_t freq = rbdimmer_get_frequency(0);
+      if (freq > 0) {
+        Serial.printf(" detected: %d Hz\n", freq);
+        break;
+      }
     }
+    rbdimmer_set_callback(0, countZeroCrossing, nullptr);
+    acReady = true;
   }
   
   // Create dimmer channel with LINEAR curve (best for AC motors)
   rbdimmer_config_t dimmer_config = {
-    .gpio_pin = PIN_DIMMER_PSM,
+    .gpio_pin = dimmerPin,
     .phase = 0,
     .initial_level = 0,
     .curve_type = RBDIMMER_CURVE_LINEAR
   };
   
-  err = rbdimmer_create_channel(&dimmer_config, &dimmerChannel);
+  rbdimmer_err_t err = rbdimmer_create_channel(&dimmer_config, &dimmerChannel);
   if (err != RBDIMMER_OK) {
     Serial.printf("❌ Dimmer channel creation failed: %d\n", err);
     return false;
@@ -66,30 +93,57 @@ bool FanController::begin() {
 }
 
 void FanController::update(const SensorData& internal, const SensorData& external) {
+  updatePending = false;
+  
   // Handle manual override modes FIRST - don't require valid sensor data
-  if (currentMode == MODE_MANUAL_OFF) {
+  if (controlMode != MODE_AUTO) {
+    gate = GATE_MANUAL;
+  }
+  if (controlMode == MODE_MANUAL_OFF) {
     setFanSpeed(0, REASON_MANUAL_OVERRIDE);
     return;
-  } else if (currentMode == MODE_MANUAL_LOW) {
+  } else if (controlMode == MODE_MANUAL_LOW) {
     setFanSpeed(config.low_speed, REASON_MANUAL_OVERRIDE);
     return;
-  } else if (currentMode == MODE_MANUAL_HIGH) {
+  } else if (controlMode == MODE_MANUAL_HIGH) {
     setFanSpeed(config.high_speed, REASON_MANUAL_OVERRIDE);
     return;
-  } else if (currentMode == MODE_DIAGNOSTIC) {
+  } else if (controlMode == MODE_DIAGNOSTIC) {
     // Diagnostic mode - manual control only
     return;
   }
   
+  // A follower mirrors its leader, which was updated first in the same pass
+  // and already applied the safety checks and min run/idle times
+  if (leader) {
+    int speed = leader->getCurrentSpeed();
+    if (speed > 0) {
+      speed = constrain((int)(speed * balance + 0.5f), 1, 100);
+    }
+    gate = leader->getGate();
+    setFanSpeed(speed, leader->getRunReason());
+    return;
+  }
+  
   // For AUTO mode, validate sensor data
   if (!internal.valid || !external.valid) {
     Serial.println("⚠️ Invalid sensor data - stopping fan (AUTO mode)");
+    gate = GATE_SENSOR_INVALID;
     setFanSpeed(0, REASON_SAFETY_LIMIT);
     return;
   }
   
   // AUTO MODE LOGIC
   
+  // Priority 0: Site rules that stop the fan, ahead of everything else in AUTO
+  activeRule = rules.evaluate(config.rules, internal, external, currentSpeed);
+  const Rule* rule = activeRule >= 0 ? &config.rules.getRule(activeRule) : nullptr;
+  if (rule && rule->action == ACTION_OFF) {
+    gate = GATE_RULE;
+    setFanSpeed(0, REASON_OFF);
+    return;
+  }
+  
   // Priority 1: Check forced circulation
   if (checkForcedCirculation()) {
     if (!forcedRunActive) {
@@ -98,6 +152,7 @@ void FanController::update(const SensorData& internal, const SensorData& externa
       forcedRunStart = millis();
     }
     
+    gate = GATE_FORCED_CIRCULATION;
     setFanSpeed(config.low_speed, REASON_FORCED_CIRCULATION);
     
     // Check if duration completed
@@ -116,6 +171,7 @@ void FanController::update(const SensorData& internal, const SensorData& externa
   if (external.temperature < config.min_outside_temp) {
     Serial.printf("🛡️ Safety: Outside too cold (%.1f°C < %.1f°C)\n", 
                   external.temperature, config.min_outside_temp);
+    gate = GATE_OUTSIDE_COLD;
     setFanSpeed(0, REASON_SAFETY_LIMIT);
     return;
   }
@@ -123,6 +179,7 @@ void FanController::update(const SensorData& internal, const SensorData& externa
   if (internal.temperature < config.min_cellar_temp) {
     Serial.printf("🛡️ Safety: Cellar too cold (%.1f°C < %.1f°C)\n",
                   internal.temperature, config.min_cellar_temp);
+    gate = GATE_CELLAR_COLD;
     setFanSpeed(0, REASON_SAFETY_LIMIT);
     return;
   }
@@ -130,21 +187,38 @@ void FanController::update(const SensorData& internal, const SensorData& externa
   // Priority 3: Dew point protection
   if (!checkDewPointSafety(internal, external)) {
     Serial.println("🛡️ Safety: Dew point risk detected");
+    gate = GATE_DEW_POINT;
     setFanSpeed(0, REASON_SAFETY_LIMIT);
     return;
   }
   
-  // Priority 4: Check if ventilation is beneficial
-  if (shouldRun(internal, external)) {
-    // Determine speed based on schedule
-    int targetSpeed = isHighSpeedAllowed() ? config.high_speed : config.low_speed;
+  SpeedLimit limit = config.schedule.limitAt(time(nullptr));
+  
+  // Priority 3b: Site rules that run the fan, within the schedule's limit
+  if (rule) {
+    if (limit == LIMIT_OFF) {
+      gate = GATE_SCHEDULE_OFF;
+      setFanSpeed(0, REASON_OFF);
+    } else {
+      gate = GATE_RULE;
+      setFanSpeed(ruleSpeed(*rule, limit), REASON_RULE);
+    }
+    return;
+  }
+  
+  // Priority 4: Check if ventilation is beneficial and the schedule allows it
+  gate = GATE_NONE;
+  if (limit != LIMIT_OFF && shouldRun(internal, external)) {
+    // Determine speed based on schedule (the quiet-hours limit also caps PI)
+    int targetSpeed = (limit == LIMIT_HIGH) ? config.high_speed : config.low_speed;
+    if (config.modulate_speed) {
+      targetSpeed = modulatedSpeed(internal, external, targetSpeed);
+    }
     
     // Determine reason
     RunReason reason = REASON_OFF;
-    bool needsHumidity = (internal.humidity > config.target_humidity) && 
-                         (external.humidity < internal.humidity - config.humidity_differential);
-    bool needsTemp = (internal.temperature > config.target_temp) && 
-                     (external.temperature < internal.temperature - config.temp_differential);
+    bool needsHumidity = humidityBenefit(internal, external);
+    bool needsTemp = tempBenefit(internal, external);
     
     if (needsHumidity && needsTemp) {
       reason = REASON_BOTH;
@@ -156,45 +230,104 @@ void FanController::update(const SensorData& internal, const SensorData& externa
     
     setFanSpeed(targetSpeed, reason);
   } else {
+    // Only the schedule counts as a gate when there was a benefit to run for
+    if (limit == LIMIT_OFF && shouldRun(internal, external)) {
+      gate = GATE_SCHEDULE_OFF;
+    }
     setFanSpeed(0, REASON_OFF);
   }
 }
 
+int FanController::ruleSpeed(const Rule& rule, SpeedLimit limit) const {
+  int speed = rule.action == ACTION_HIGH ? config.high_speed :
+              rule.action == ACTION_LOW ? config.low_speed : rule.speed;
+  return limit == LIMIT_HIGH ? speed : min(speed, config.low_speed);
+}
+
 bool FanController::shouldRun(const SensorData& internal, const SensorData& external) {
-  // Check humidity benefit
-  bool humidityBenefit = (internal.humidity > config.target_humidity) && 
-                         (external.humidity < internal.humidity - config.humidity_differential);
-  
-  // Check temperature benefit
-  bool tempBenefit = (internal.temperature > config.target_temp) && 
-                     (external.temperature < internal.temperature - config.temp_differential);
-  
-  return humidityBenefit || tempBenefit;
+  return humidityBenefit(internal, external) || tempBenefit(internal, external);
 }
 
-bool FanController::isHighSpeedAllowed() const {
-  time_t now;
-  struct tm timeinfo;
-  
-  time(&now);
-  localtime_r(&now, &timeinfo);
-  
-  int hour = timeinfo.tm_hour;
-  int wday = timeinfo.tm_wday; // 0=Sunday, 1=Monday, ..., 6=Saturday
-  
-  // NEVER on weekends (Saturday=6, Sunday=0)
-  if (wday == 0 || wday == 6) {
-    return false;
+bool FanController::humidityBenefit(const SensorData& internal, const SensorData& external) const {
+  float inside = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity);
+  float outside = SensorManagerBase::calculateAbsoluteHumidity(external.temperature, external.humidity);
+  
+  // Once enough runs are measured, a run must be predicted to dry the cellar
+  // at min_dry_rate instead of clearing the fixed humidity_differential
+  float rate;
+  bool predicted = config.adaptive_differentials && estimator &&
+                   estimator->predict(EFFICIENCY_DRY, inside - outside, rate);
+  bool useful = predicted ? rate >= config.min_dry_rate : true;
+  
+  // A day-ahead plan picks the hours; outside air must still be drier than
+  // the cellar's in case the forecast was wrong
+  bool planned;
+  if (planner && planner->getPlanned(time(nullptr), planned)) {
+    return planned && outside < inside && useful;
   }
   
-  // Friday (5): Only 22:00-23:59
-  if (wday == 5) {
-    return (hour >= 22);
+  if (internal.humidity <= config.target_humidity) return false;
+  if (predicted) return outside < inside && useful;
+  return external.humidity < internal.humidity - config.humidity_differential;
+}
+
+bool FanController::tempBenefit(const SensorData& internal, const SensorData& external) const {
+  if (internal.temperature <= config.target_temp) return false;
+  
+  float gap = internal.temperature - external.temperature;
+  float rate;
+  if (config.adaptive_differentials && estimator &&
+      estimator->predict(EFFICIENCY_COOL, gap, rate)) {
+    return gap > 0 && rate >= config.min_cool_rate;
+  }
+  return gap > config.temp_differential;
+}
+
+int FanController::modulatedSpeed(const SensorData& internal, const SensorData& external,
+                                  int maxSpeed) {
+  unsigned long now = millis();
+  
+  // A gap means the fan was stopped or overridden: restart from the P term
+  float dtH = 0;
+  if (now - lastModulation <= 2 * DECISION_INTERVAL) {
+    dtH = (now - lastModulation) / 3600000.0f;
+  } else {
+    speedIntegral = 0;
+  }
+  lastModulation = now;
+  
+  // Error of whichever benefit applies (1°C counts as 1%RH), scaled by how
+  // much each volume of outside air can help: the share of the cellar's
+  // moisture it removes, or the temperature gap over 10°C
+  float error = 0;
+  float potential = 0.1f;
+  
+  if (humidityBenefit(internal, external)) {
+    float inside = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity);
+    float outside = SensorManagerBase::calculateAbsoluteHumidity(external.temperature, external.humidity);
+    error = internal.humidity - config.target_humidity;
+    potential = inside > 0 ? (inside - outside) / inside : 0;
+  }
+  if (tempBenefit(internal, external) && internal.temperature - config.target_temp > error) {
+    error = internal.temperature - config.target_temp;
+    potential = (internal.temperature - external.temperature) / 10.0f;
+  }
+  potential = constrain(potential, 0.1f, 1.0f);
+  
+  float lower = min(config.min_speed, maxSpeed);
+  float upper = maxSpeed;
+  float proportional = config.speed_kp * error / potential;
+  float output = proportional + speedIntegral;
+  
+  // Anti-windup: stop integrating while the output is pinned at a limit
+  if (output < upper && output > lower) {
+    speedIntegral += config.speed_ki * error / potential * dtH;
+    speedIntegral = constrain(speedIntegral, 0.0f, upper);
+    output = proportional + speedIntegral;
   }
   
-  // Monday-Thursday: 22:00-15:00 next day
-  // This means: hour >= 22 OR hour < 15
-  return (hour >= 22 || hour < 15);
+  int speed = (int)(output / SPEED_STEP + 0.5f) * SPEED_STEP;
+  return constrain(speed, (int)lower, (int)upper);
 }
 
 bool FanController::checkDewPointSafety(const SensorData& internal, const SensorData& external) const {
@@ -219,48 +352,63 @@ bool FanController::checkForcedCirculation() {
 }
 
 void FanController::setFanSpeed(int speed, RunReason reason) {
+  // Modulated level changes while running are not starts or stops
+  bool levelChange = config.modulate_speed && speed > 0 && currentSpeed > 0;
+  
   // Manual override bypasses anti-short-cycle protection
-  bool bypassProtection = (reason == REASON_MANUAL_OVERRIDE);
+  bool bypassProtection = (reason == REASON_MANUAL_OVERRIDE) || levelChange || leader;
   
   // Anti-short-cycle protection (unless manual override)
   if (!bypassProtection && speed != currentSpeed && !canChangeState()) {
-    Serial.println("⏱️ Too soon to change state - respecting min run/idle time");
+    if (!changeBlocked) {
+      Serial.println("⏱️ Too soon to change state - respecting min run/idle time");
+    }
+    changeBlocked = true;
+    gate = GATE_SHORT_CYCLE;
     return;
   }
+  changeBlocked = false;
   
   // Update speed if changed
   if (speed != currentSpeed) {
     currentSpeed = speed;
     runReason = reason;
-    lastStateChange = millis();
+    if (!levelChange) {
+      lastStateChange = millis();
+    }
     
     // Set relay
     setRelay(speed > 0);
-    
-    // Set dimmer (use 95% for 100% to avoid fluctuation at full power)
-    if (dimmerChannel) {
-      int dimmerLevel = (speed >= 100) ? 95 : speed;
-      rbdimmer_set_active(dimmerChannel, true);
-      rbdimmer_set_level(dimmerChannel, dimmerLevel);
-      if (speed >= 100) {
-        Serial.println("🔧 Dimmer set to 95% (requested 100% - avoiding fluctuation)");
-      } else {
-        Serial.printf("🔧 Dimmer set to %d%%\n", dimmerLevel);
-      }
-    }
+    applyLevel(speed);
     
     // Log change
     Serial.printf("💨 Fan: %d%% - %s\n", speed, getStatusText().c_str());
   }
 }
 
+void FanController::applyLevel(int speed) {
+  if (!dimmerChannel) return;
+  
+  // Cap the triac below full conduction to avoid fluctuation at full power
+  int dimmerLevel = min(speed, DIMMER_MAX_LEVEL);
+  rbdimmer_set_active(dimmerChannel, true);
+  rbdimmer_set_level(dimmerChannel, dimmerLevel);
+  if (speed > DIMMER_MAX_LEVEL) {
+    Serial.printf("🔧 Dimmer set to %d%% (requested %d%% - avoiding fluctuation)\n",
+                  dimmerLevel, speed);
+  } else {
+    Serial.printf("🔧 Dimmer set to %d%%\n", dimmerLevel);
+  }
+}
+
 void FanController::setRelay(bool state) {
   if (state != relayState) {
-    digitalWrite(PIN_RELAY, state ? LOW : HIGH); // Active LOW
+    digitalWrite(relayPin, state ? LOW : HIGH); // Active LOW
     relayState = state;
+    if (state) relayCycles++;
     Serial.printf("🔌 Relay %s (Pin %d = %s)\n", 
                   state ? "ON" : "OFF", 
-                  PIN_RELAY, 
+                  relayPin, 
                   state ? "LOW" : "HIGH");
   }
 }
@@ -278,24 +426,25 @@ bool FanController::canChangeState() const {
 }
 
 void FanController::setMode(ControlMode mode, unsigned long durationMin) {
-  currentMode = mode;
+  controlMode = mode;
   
   if (durationMin > 0) {
-    manualOverrideUntil = millis() + (durationMin * 60000UL);
+    overrideUntil = millis() + (durationMin * 60000UL);
     Serial.printf("⚙️ Mode set to %d for %lu minutes\n", mode, durationMin);
   } else {
-    manualOverrideUntil = 0;
+    overrideUntil = 0;
     Serial.printf("⚙️ Mode set to %d (permanent)\n", mode);
   }
   
   // Immediately apply manual modes
   forceUpdate();
+  requestUpdate();
 }
 
 void FanController::forceUpdate() {
-  Serial.printf("🔧 Force update - Mode: %d, CurrentSpeed: %d\n", currentMode, currentSpeed);
+  Serial.printf("🔧 Force update - Mode: %d, CurrentSpeed: %d\n", controlMode, currentSpeed);
   
-  switch (currentMode) {
+  switch (controlMode) {
     case MODE_MANUAL_OFF:
       Serial.println("  → Applying MODE_MANUAL_OFF (0%)");
       setFanSpeed(0, REASON_MANUAL_OVERRIDE);
@@ -319,20 +468,19 @@ void FanController::setManualSpeed(int speed) {
   if (speed > 100) speed = 100;
   
   if (dimmerChannel) {
-    int dimmerLevel = (speed >= 100) ? 95 : speed;
-    rbdimmer_set_active(dimmerChannel, true);
-    rbdimmer_set_level(dimmerChannel, dimmerLevel);
+    applyLevel(speed);
     
     currentSpeed = speed;
     setRelay(speed > 0);
     
     // Set to diagnostic mode to prevent update() from interfering
-    currentMode = MODE_DIAGNOSTIC;
+    controlMode = MODE_DIAGNOSTIC;
     runReason = REASON_MANUAL_OVERRIDE;
     lastStateChange = millis();
+    requestUpdate();
     
     if (speed >= 100) {
-      Serial.println("🎛️ Manual speed: 100% (triac at 95%)");
+      Serial.printf("🎛️ Manual speed: 100%% (triac at %d%%)\n", DIMMER_MAX_LEVEL);
     } else {
       Serial.printf("🎛️ Manual speed set: %d%%\n", speed);
     }
@@ -340,7 +488,15 @@ void FanController::setManualSpeed(int speed) {
 }
 
 String FanController::getStatusText() const {
-  switch (runReason) {
+  return reasonText(runReason);
+}
+
+uint32_t FanController::getZeroCrossings() {
+  return zeroCrossings;
+}
+
+const char* FanController::reasonText(RunReason reason) {
+  switch (reason) {
     case REASON_OFF: return "Off";
     case REASON_HUMIDITY: return "Dehumidifying";
     case REASON_TEMPERATURE: return "Cooling";
@@ -348,10 +504,27 @@ String FanController::getStatusText() const {
     case REASON_FORCED_CIRCULATION: return "Forced Circulation";
     case REASON_MANUAL_OVERRIDE: return "Manual Override";
     case REASON_SAFETY_LIMIT: return "Safety Limit";
+    case REASON_RULE: return "Site Rule";
     default: return "Unknown";
   }
 }
 
+const char* FanController::gateName(DecisionGate gate) {
+  switch (gate) {
+    case GATE_NONE: return "none";
+    case GATE_MANUAL: return "manual";
+    case GATE_SENSOR_INVALID: return "sensor_invalid";
+    case GATE_FORCED_CIRCULATION: return "forced_circulation";
+    case GATE_OUTSIDE_COLD: return "outside_cold";
+    case GATE_CELLAR_COLD: return "cellar_cold";
+    case GATE_DEW_POINT: return "dew_point";
+    case GATE_SCHEDULE_OFF: return "schedule_off";
+    case GATE_SHORT_CYCLE: return "short_cycle";
+    case GATE_RULE: return "rule";
+    default: return "unknown";
+  }
+}
+
 unsigned long FanController::getNextForcedRun() const {
   if (forcedRunActive) {
     return 0; // Currently running
@@ -369,4 +542,50 @@ unsigned long FanController::getNextForcedRun() const {
 
 unsigned long FanController::getTimeSinceStateChange() const {
   return (millis() - lastStateChange) / 1000; // seconds
-}
\ No newline at end of file
+}
+
+void FanController::requestUpdate() {
+  updatePending = true;
+  if (wakeTask) {
+    xTaskNotifyGive(wakeTask);
+  }
+}
+
+unsigned long FanController::getNextDeadline() const {
+  unsigned long now = millis();
+  // Periodic re-evaluation remains as a fallback and drives PI modulation
+  unsigned long deadline = now + DECISION_INTERVAL;
+  
+  // Deadlines already passed without a change (e.g. forced circulation
+  // while sensor data is invalid) leave the fallback in charge
+  auto earlier = [&](unsigned long at) {
+    if ((long)(at - now) > 0 && (long)(at - deadline) < 0) deadline = at;
+  };
+  
+  // A start or stop held back by min run/idle time
+  if (changeBlocked) {
+    unsigned long holdMs = (currentSpeed > 0 ? config.min_run_time_sec : config.min_idle_time_sec) * 1000UL;
+    earlier(lastStateChange + holdMs);
+  }
+  
+  if (controlMode == MODE_AUTO && !leader) {
+    // Forced circulation start or end
+    if (forcedRunActive) {
+      earlier(forcedRunStart + config.forced_duration_min * 60000UL);
+    } else {
+      earlier(lastForcedRun + config.forced_interval_hours * 3600000UL);
+    }
+    
+    // Speed schedule transition
+    time_t t = time(nullptr);
+    earlier(now + (unsigned long)(config.schedule.nextBoundary(t) - t) * 1000UL);
+    
+    // Next step of the ventilation plan
+    time_t step = planner ? planner->nextStep(t) : 0;
+    if (step > t) {
+      earlier(now + (unsigned long)(step - t) * 1000UL);
+    }
+  }
+  
+  return deadline;
+}
@@ -0,0 +1,271 @@
+#include "history.h"
+#include <LittleFS.h>
+#include "sensors.h"
+
+static const char* fieldNames[HISTORY_FIELDS] = {
+  "in_temp", "in_rh", "in_dp", "out_temp", "out_rh", "out_dp", "speed"
+};
+
+static const char* traceFiles[] = { TRACE_OLD_FILE, TRACE_FILE };
+
+HistoryStream::HistoryStream() {
+  static const HistoryField defaults[] = {
+    HISTORY_IN_TEMP, HISTORY_IN_RH, HISTORY_OUT_TEMP, HISTORY_OUT_RH, HISTORY_SPEED
+  };
+  fieldCount = sizeof(defaults) / sizeof(defaults[0]);
+  memcpy(fields, defaults, sizeof(defaults));
+  format = HISTORY_CSV;
+  from = 0;
+  to = 0xFFFFFFFF;
+  step = HISTORY_MIN_STEP;
+
+  fileIndex = 0;
+  recordCount = 0;
+  recordPos = 0;
+  anchorEpoch = 0;
+  anchorMs = 0;
+  speed = 0;
+
+  bucketOpen = false;
+  bucketStart = 0;
+  outLen = 0;
+  outPos = 0;
+  started = false;
+  done = false;
+}
+
+const char* HistoryStream::fieldName(HistoryField field) {
+  return field < HISTORY_FIELDS ? fieldNames[field] : "?";
+}
+
+bool HistoryStream::setFields(const String& list, String& error) {
+  uint8_t parsed = 0;
+  HistoryField result[HISTORY_FIELDS];
+  int start = 0;
+  while (start <= (int)list.length()) {
+    int comma = list.indexOf(',', start);
+    if (comma < 0) comma = list.length();
+    String name = list.substring(start, comma);
+    name.trim();
+    start = comma + 1;
+    if (name.length() == 0) continue;
+
+    int found = -1;
+    for (int i = 0; i < HISTORY_FIELDS; i++) {
+      if (name == fieldNames[i]) found = i;
+    }
+    if (found < 0) {
+      error = "unknown field '" + name + "'";
+      return false;
+    }
+    for (uint8_t i = 0; i < parsed; i++) {
+      if (result[i] == found) {
+        error = "field '" + name + "' given twice";
+        return false;
+      }
+    }
+    result[parsed++] = (HistoryField)found;
+  }
+  if (parsed == 0) {
+    error = "no fields";
+    return false;
+  }
+  memcpy(fields, result, parsed * sizeof(HistoryField));
+  fieldCount = parsed;
+  return true;
+}
+
+void HistoryStream::setRange(uint32_t from, uint32_t to, uint32_t step) {
+  this->from = from;
+  this->to = to;
+  this->step = max(step, (uint32_t)HISTORY_MIN_STEP);
+}
+
+uint32_t HistoryStream::chooseStep(uint32_t from, uint32_t to, uint32_t requested) {
+  uint32_t span = to > from ? to - from : 0;
+  uint32_t step = requested;
+  if (step == 0) {
+    // Whole minutes, so steps line up with the samples
+    step = (span / HISTORY_DEFAULT_POINTS + 59) / 60 * 60;
+  }
+  uint32_t fewest = span / HISTORY_MAX_POINTS + 1;
+  if (step < fewest) step = fewest;
+  return max(step, (uint32_t)HISTORY_MIN_STEP);
+}
+
+size_t HistoryStream::read(uint8_t* buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (outPos < outLen) {
+      size_t n = min(maxLen - written, outLen - outPos);
+      memcpy(buf + written, out + outPos, n);
+      written += n;
+      outPos += n;
+      continue;
+    }
+    if (done) break;
+
+    outLen = 0;
+    outPos = 0;
+    if (!started) {
+      writeHeader();
+      started = true;
+    }
+
+    // One record at a time while a row still fits, so the output buffer
+    // never has to grow
+    TraceRecord rec;
+    while (!done && outLen + HISTORY_ROW_MAX <= sizeof(out)) {
+      if (!nextRecord(rec)) {
+        finish();
+        break;
+      }
+      if (rec.type == TRACE_BOOT || rec.type == TRACE_CLOCK) {
+        anchorEpoch = rec.data.epoch;
+        anchorMs = rec.ms;
+        if (rec.type == TRACE_BOOT) speed = 0;
+      } else if (rec.type == TRACE_DECISION) {
+        speed = rec.value;
+      } else if (rec.type == TRACE_SAMPLE && anchorEpoch != 0) {
+        uint32_t epoch = anchorEpoch + (uint32_t)(rec.ms - anchorMs) / 1000;
+        if (epoch >= to) {
+          finish();
+        } else if (epoch >= from) {
+          add(rec, epoch);
+        }
+      }
+    }
+  }
+  return written;
+}
+
+bool HistoryStream::nextRecord(TraceRecord& rec) {
+  while (recordPos >= recordCount) {
+    if (!file) {
+      if (fileIndex >= sizeof(traceFiles) / sizeof(traceFiles[0])) return false;
+      file = LittleFS.open(traceFiles[fileIndex++], "r");
+      if (!file) continue;
+      TraceHeader header;
+      if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+          header.magic != TRACE_MAGIC || header.version != TRACE_VERSION ||
+          header.recordSize != sizeof(TraceRecord)) {
+        file.close();
+        continue;
+      }
+      // A rotated-in file goes on where the last one stopped, so the
+      // clock anchor carries over
+    }
+    size_t bytes = file.read((uint8_t*)records, sizeof(records));
+    recordCount = bytes / sizeof(TraceRecord);
+    recordPos = 0;
+    if (recordCount == 0) file.close();
+  }
+  rec = records[recordPos++];
+  return true;
+}
+
+void HistoryStream::add(const TraceRecord& rec, uint32_t epoch) {
+  uint32_t bucket = from + (epoch - from) / step * step;
+  if (bucketOpen && bucket != bucketStart) emitBucket();
+  if (!bucketOpen) {
+    bucketOpen = true;
+    bucketStart = bucket;
+    memset(count, 0, sizeof(count));
+  }
+
+  bool internal = rec.flags & TRACE_INTERNAL_VALID;
+  bool external = rec.flags & TRACE_EXTERNAL_VALID;
+  float inTemp = rec.data.centi[0] / 100.0f;
+  float inRh = rec.data.centi[1] / 100.0f;
+  float outTemp = rec.data.centi[2] / 100.0f;
+  float outRh = rec.data.centi[3] / 100.0f;
+
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    float value;
+    bool valid = internal;
+    switch (fields[i]) {
+      case HISTORY_IN_TEMP: value = inTemp; break;
+      case HISTORY_IN_RH: value = inRh; break;
+      case HISTORY_IN_DP: value = SensorManagerBase::calculateDewPoint(inTemp, inRh); break;
+      case HISTORY_OUT_TEMP: value = outTemp; valid = external; break;
+      case HISTORY_OUT_RH: value = outRh; valid = external; break;
+      case HISTORY_OUT_DP:
+        value = SensorManagerBase::calculateDewPoint(outTemp, outRh);
+        valid = external;
+        break;
+      default: value = speed; valid = true; break;
+    }
+    if (!valid) continue;
+    if (count[i] == 0) {
+      minimum[i] = maximum[i] = sum[i] = value;
+    } else {
+      minimum[i] = min(minimum[i], value);
+      maximum[i] = max(maximum[i], value);
+      sum[i] += value;
+    }
+    count[i]++;
+  }
+}
+
+static int16_t toCenti(float value) {
+  float scaled = value * 100.0f;
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32767.0f) return -32767;   // -32768 is HISTORY_NO_VALUE
+  return (int16_t)lroundf(scaled);
+}
+
+void HistoryStream::emitBucket() {
+  bucketOpen = false;
+  if (format == HISTORY_BINARY) {
+    memcpy(out + outLen, &bucketStart, sizeof(bucketStart));
+    outLen += sizeof(bucketStart);
+    for (uint8_t i = 0; i < fieldCount; i++) {
+      int16_t values[3] = { HISTORY_NO_VALUE, HISTORY_NO_VALUE, HISTORY_NO_VALUE };
+      if (count[i] > 0) {
+        values[0] = toCenti(minimum[i]);
+        values[1] = toCenti(sum[i] / count[i]);
+        values[2] = toCenti(maximum[i]);
+      }
+      memcpy(out + outLen, values, sizeof(values));
+      outLen += sizeof(values);
+    }
+    return;
+  }
+
+  char* text = (char*)out;
+  outLen += snprintf(text + outLen, sizeof(out) - outLen, "%lu", (unsigned long)bucketStart);
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    if (count[i] == 0) {
+      outLen += snprintf(text + outLen, sizeof(out) - outLen, ",,,");
+    } else {
+      outLen += snprintf(text + outLen, sizeof(out) - outLen, ",%.2f,%.2f,%.2f",
+                         minimum[i], sum[i] / count[i], maximum[i]);
+    }
+  }
+  out[outLen++] = '\n';
+}
+
+void HistoryStream::writeHeader() {
+  if (format == HISTORY_BINARY) {
+    HistoryHeader header = { HISTORY_MAGIC, HISTORY_VERSION, fieldCount, 0, from, step };
+    memcpy(out + outLen, &header, sizeof(header));
+    outLen += sizeof(header);
+    for (uint8_t i = 0; i < fieldCount; i++) out[outLen++] = fields[i];
+    while (outLen % 4) out[outLen++] = 0xFF;
+    return;
+  }
+
+  char* text = (char*)out;
+  outLen += snprintf(text + outLen, sizeof(out) - outLen, "time");
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    const char* name = fieldNames[fields[i]];
+    outLen += snprintf(text + outLen, sizeof(out) - outLen, ",%s_min,%s_mean,%s_max", name, name, name);
+  }
+  out[outLen++] = '\n';
+}
+
+void HistoryStream::finish() {
+  if (bucketOpen) emitBucket();
+  if (file) file.close();
+  done = true;
+}
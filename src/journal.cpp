@@ -0,0 +1,265 @@
+#include "journal.h"
+#include <LittleFS.h>
+#include <time.h>
+
+#define JOURNAL_PAGE_BYTES (JOURNAL_PAGE_RECORDS * sizeof(JournalRecord))
+
+static const char* modeNames[] = {"AUTO", "MANUAL_OFF", "MANUAL_LOW", "MANUAL_HIGH", "DIAGNOSTIC"};
+static const char* reasonNames[] = {
+  "off", "humidity", "temperature", "both", "forced", "manual", "safety", "rule"
+};
+
+static int16_t toCenti(float value) {
+  float scaled = value * 100.0f;
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32768.0f) return -32768;
+  return (int16_t)lroundf(scaled);
+}
+
+static uint32_t slotOf(uint32_t seq) {
+  return (seq - 1) % JOURNAL_SLOTS;
+}
+
+DecisionJournal::DecisionJournal() {
+  memset(page, 0, sizeof(page));
+  pageIndex = 0;
+  used = 0;
+  nextSeq = 1;
+  ready = false;
+  dirty = false;
+  merging = false;
+  booted = false;
+  lastFlush = 0;
+}
+
+bool DecisionJournal::begin() {
+  size_t fileSize = 0;
+  if (LittleFS.exists(JOURNAL_FILE)) {
+    File file = LittleFS.open(JOURNAL_FILE, "r");
+    if (file) {
+      fileSize = file.size();
+      if (fileSize % sizeof(JournalRecord) == 0 && fileSize <= JOURNAL_SLOTS * sizeof(JournalRecord)) {
+        recover(file, fileSize);
+      } else {
+        fileSize = 0;
+      }
+      file.close();
+    }
+  }
+
+  // Missing or foreign file: start over (stale records fail the check and
+  // are overwritten page by page)
+  if (fileSize == 0) {
+    File file = LittleFS.open(JOURNAL_FILE, "w");
+    if (!file) {
+      Serial.println("❌ Journal file could not be created");
+      return false;
+    }
+    file.close();
+  }
+
+  ready = true;
+  lastFlush = millis();
+  Serial.printf("✓ Decision journal ready (%lu records)\n",
+                (unsigned long)(nextSeq - getOldestSeq()));
+  return true;
+}
+
+void DecisionJournal::recover(File& file, size_t fileSize) {
+  // The page whose first record has the highest seq is the one being filled
+  uint32_t best = 0;
+  uint16_t bestPage = 0;
+  uint16_t pages = (fileSize + JOURNAL_PAGE_BYTES - 1) / JOURNAL_PAGE_BYTES;
+  for (uint16_t p = 0; p < pages; p++) {
+    JournalRecord rec;
+    if (!file.seek(p * JOURNAL_PAGE_BYTES) ||
+        file.read((uint8_t*)&rec, sizeof(rec)) != sizeof(rec)) break;
+    if (isValid(rec) && rec.seq > best && slotOf(rec.seq) == (uint32_t)p * JOURNAL_PAGE_RECORDS) {
+      best = rec.seq;
+      bestPage = p;
+    }
+  }
+  if (best == 0) return;
+
+  file.seek(bestPage * JOURNAL_PAGE_BYTES);
+  file.read((uint8_t*)page, sizeof(page));
+  used = 0;
+  while (used < JOURNAL_PAGE_RECORDS && isValid(page[used]) && page[used].seq == best + used) {
+    used++;
+  }
+  memset(&page[used], 0, (JOURNAL_PAGE_RECORDS - used) * sizeof(JournalRecord));
+  pageIndex = bestPage;
+  nextSeq = best + used;
+}
+
+uint8_t DecisionJournal::checksum(const JournalRecord& rec) {
+  const uint8_t* bytes = (const uint8_t*)&rec;
+  uint8_t sum = JOURNAL_VERSION;
+  for (size_t i = 0; i < offsetof(JournalRecord, check); i++) sum += bytes[i];
+  return sum;
+}
+
+bool DecisionJournal::isValid(const JournalRecord& rec) {
+  return rec.seq != 0 && rec.check == checksum(rec);
+}
+
+uint32_t DecisionJournal::getOldestSeq() const {
+  return nextSeq > JOURNAL_SLOTS ? nextSeq - JOURNAL_SLOTS : 1;
+}
+
+void DecisionJournal::update(const SensorData& internal, const SensorData& external,
+                             const FanController& fan) {
+  if (!ready) return;
+  unsigned long now = millis();
+
+  uint8_t flags = (internal.valid ? JOURNAL_INTERNAL_VALID : 0) |
+                  (external.valid ? JOURNAL_EXTERNAL_VALID : 0);
+  uint8_t speed = (uint8_t)constrain(fan.getCurrentSpeed(), 0, 255);
+
+  // Fold a repeat of the open record's decision into it
+  if (merging && used > 0) {
+    JournalRecord& last = page[used - 1];
+    if (last.mode == (uint8_t)currentMode && last.gate == (uint8_t)fan.getGate() &&
+        last.reason == (uint8_t)fan.getRunReason() && last.speed == speed &&
+        (last.flags & ~JOURNAL_BOOT) == flags &&
+        now - last.ms < JOURNAL_MERGE_MS && last.decisions < 0xFFFF) {
+      last.decisions++;
+      last.check = checksum(last);
+      dirty = true;
+      if (now - lastFlush >= JOURNAL_FLUSH_INTERVAL) flush();
+      return;
+    }
+  }
+
+  time_t epoch = time(nullptr);
+  JournalRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.epoch = epoch > CLOCK_VALID_EPOCH ? (uint32_t)epoch : 0;
+  rec.ms = now;
+  rec.centi[0] = toCenti(internal.temperature);
+  rec.centi[1] = toCenti(internal.humidity);
+  rec.centi[2] = toCenti(internal.dewPoint);
+  rec.centi[3] = toCenti(external.temperature);
+  rec.centi[4] = toCenti(external.humidity);
+  rec.centi[5] = toCenti(external.dewPoint);
+  rec.decisions = 1;
+  rec.mode = (uint8_t)currentMode;
+  rec.gate = (uint8_t)fan.getGate();
+  rec.reason = (uint8_t)fan.getRunReason();
+  rec.speed = speed;
+  rec.flags = flags | (booted ? 0 : JOURNAL_BOOT);
+  booted = true;
+  append(rec);
+
+  if (now - lastFlush >= JOURNAL_FLUSH_INTERVAL) flush();
+}
+
+void DecisionJournal::append(const JournalRecord& rec) {
+  // A full page is written once, when the next record needs a slot
+  if (used == JOURNAL_PAGE_RECORDS) {
+    if (dirty) writePage();
+    pageIndex = (pageIndex + 1) % JOURNAL_PAGES;
+    used = 0;
+    memset(page, 0, sizeof(page));
+  }
+
+  JournalRecord& slot = page[used];
+  slot = rec;
+  slot.seq = nextSeq;
+  slot.check = checksum(slot);
+  used++;
+  nextSeq++;
+  dirty = true;
+  merging = true;
+}
+
+void DecisionJournal::flush() {
+  lastFlush = millis();
+  if (ready && dirty) writePage();
+}
+
+bool DecisionJournal::writePage() {
+  // Only the filled part, so older records further on in the page stay readable
+  File file = LittleFS.open(JOURNAL_FILE, "r+");
+  if (!file || !file.seek(pageIndex * JOURNAL_PAGE_BYTES)) {
+    Serial.println("⚠️ Journal write failed");
+    return false;
+  }
+  size_t bytes = used * sizeof(JournalRecord);
+  size_t written = file.write((const uint8_t*)page, bytes);
+  file.close();
+  dirty = false;
+  return written == bytes;
+}
+
+size_t DecisionJournal::read(File& file, uint32_t seq, JournalRecord* out, size_t max) const {
+  // Snapshot of the writer's position; it may move on while we read
+  uint32_t end = nextSeq;
+  uint16_t ramPage = pageIndex;
+  uint32_t ramStart = end - used;
+  if (seq < getOldestSeq() || seq >= end) return 0;
+  if (max > end - seq) max = end - seq;
+
+  size_t n = 0;
+  while (n < max && seq + n < ramStart) {
+    uint32_t slot = slotOf(seq + n);
+    size_t count = min((size_t)(ramStart - (seq + n)), max - n);
+    count = min(count, (size_t)(JOURNAL_SLOTS - slot));
+    if (!file.seek(slot * sizeof(JournalRecord))) return n;
+    size_t got = file.read((uint8_t*)&out[n], count * sizeof(JournalRecord)) / sizeof(JournalRecord);
+    n += got;
+    if (got < count) return n;
+  }
+  while (n < max) {
+    uint32_t index = slotOf(seq + n) - (uint32_t)ramPage * JOURNAL_PAGE_RECORDS;
+    if (index >= JOURNAL_PAGE_RECORDS) break;
+    out[n++] = page[index];
+  }
+  return n;
+}
+
+uint32_t DecisionJournal::findEpoch(File& file, uint32_t epoch) const {
+  uint32_t lo = getOldestSeq();
+  uint32_t hi = nextSeq;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+
+    // Records without a clock take the time of the next one that has it
+    JournalRecord recs[8];
+    size_t count = read(file, mid, recs, 8);
+    uint32_t probe = 0;
+    for (size_t i = 0; i < count && probe == 0; i++) {
+      if (isValid(recs[i]) && recs[i].seq == mid + i) probe = recs[i].epoch;
+    }
+
+    if (probe != 0 && probe >= epoch) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+size_t DecisionJournal::formatJSON(const JournalRecord& rec, char* buf, size_t len) {
+  char in[48] = "null";
+  char out[48] = "null";
+  if (rec.flags & JOURNAL_INTERNAL_VALID) {
+    snprintf(in, sizeof(in), "{\"t\":%.2f,\"rh\":%.2f,\"dp\":%.2f}",
+             rec.centi[0] / 100.0f, rec.centi[1] / 100.0f, rec.centi[2] / 100.0f);
+  }
+  if (rec.flags & JOURNAL_EXTERNAL_VALID) {
+    snprintf(out, sizeof(out), "{\"t\":%.2f,\"rh\":%.2f,\"dp\":%.2f}",
+             rec.centi[3] / 100.0f, rec.centi[4] / 100.0f, rec.centi[5] / 100.0f);
+  }
+
+  int n = snprintf(buf, len,
+                   "{\"seq\":%lu,\"time\":%lu,\"ms\":%lu,\"decisions\":%u,\"mode\":\"%s\","
+                   "\"gate\":\"%s\",\"reason\":\"%s\",\"speed\":%u,\"in\":%s,\"out\":%s%s}",
+                   (unsigned long)rec.seq, (unsigned long)rec.epoch, (unsigned long)rec.ms,
+                   rec.decisions, rec.mode < 5 ? modeNames[rec.mode] : "?",
+                   FanController::gateName((DecisionGate)rec.gate),
+                   rec.reason < 8 ? reasonNames[rec.reason] : "?", rec.speed, in, out,
+                   (rec.flags & JOURNAL_BOOT) ? ",\"boot\":true" : "");
+  return n < 0 ? 0 : min((size_t)n, len - 1);
+}
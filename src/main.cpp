@@ -3,13 +3,23 @@
 #include <time.h>
 #include <LittleFS.h>
 #include <ESPmDNS.h>
-#include <ArduinoOTA.h>
 #include "config.h"
 #include "sensors.h"
 #include "fancontrol.h"
 #include "display.h"
 #include "webserver.h"
 #include "mqtt_client.h"
+#include "trace.h"
+#include "overrides.h"
+#include "planner.h"
+#include "efficiency.h"
+#include "usage.h"
+#include "journal.h"
+#include "zones.h"
+#include "commands.h"
+#include "metrics.h"
+#include "ota.h"
+#include "espota.h"
 
 // Global instances
 SystemConfig config;
@@ -21,11 +31,22 @@ FanController fanController;
 DisplayManager display;
 WebServerManager* webServer = nullptr;
 MQTTManager* mqttManager = nullptr;
+TraceRecorder traceRecorder;
+DecisionJournal decisionJournal;
+OverrideManager overrides;
+VentilationPlanner planner;
+EfficiencyEstimator efficiency;
+UsageMeter usage;
+ZoneManager zones;
+CommandQueue commands;
+OtaUpdater ota;
+EspotaReceiver espota(ota);
+LoopStats loopStats;
 
 // Timing variables
 unsigned long lastSensorRead = 0;
 unsigned long lastDisplayUpdate = 0;
-unsigned long lastDecision = 0;
+unsigned long nextDecision = 0;
 unsigned long lastMQTTPublish = 0;
 
 void setupWiFi() {
@@ -87,29 +108,39 @@ void setupWiFi() {
   delay(2000);
 }
 
+// Fan off and everything kept in RAM on flash, before new firmware replaces us
+void prepareForUpdate() {
+  fanController.setMode(MODE_MANUAL_OFF);
+  zones.stopAll();
+  traceRecorder.flush();
+  decisionJournal.flush();
+  usage.flush();
+  flushConfig();
+}
+
 void setupOTA() {
-  ArduinoOTA.setHostname(config.hostname.c_str());
-  ArduinoOTA.setPassword("cellar2024"); // Change this!
-  
-  ArduinoOTA.onStart([]() {
-    String type = (ArduinoOTA.getCommand() == U_FLASH) ? "firmware" : "filesystem";
-    Serial.println("\n🔄 OTA Update started: " + type);
+  espota.onStart([](bool firmware) {
+    const char* type = firmware ? "firmware" : "filesystem";
+    Serial.printf("\n🔄 OTA Update started: %s\n", type);
     display.clear();
-    display.showMessage("OTA Update", type.c_str(), "Please wait...");
-    
-    // Stop fan during update
-    fanController.setMode(MODE_MANUAL_OFF);
+    display.showMessage("OTA Update", type, "Please wait...");
+    prepareForUpdate();
   });
   
-  ArduinoOTA.onEnd([]() {
+  espota.onEnd([](const char* error) {
+    if (error) {
+      Serial.printf("❌ OTA Error: %s\n", error);
+      display.showMessage("OTA Error", error);
+      delay(3000);
+      return;
+    }
     Serial.println("\n✓ OTA Update complete!");
     display.showMessage("OTA Complete", "Rebooting...");
-    delay(1000);
   });
   
-  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+  espota.onProgress([](uint32_t progress, uint32_t total) {
     static unsigned int lastPct = 0;
-    unsigned int pct = (progress / (total / 100));
+    unsigned int pct = (uint64_t)progress * 100 / total;
     if (pct != lastPct && pct % 10 == 0) {
       Serial.printf("Progress: %u%%\n", pct);
       char msg[20];
@@ -119,20 +150,7 @@ void setupOTA() {
     }
   });
   
-  ArduinoOTA.onError([](ota_error_t error) {
-    Serial.printf("❌ OTA Error[%u]: ", error);
-    const char* errMsg = "Unknown Error";
-    if (error == OTA_AUTH_ERROR) errMsg = "Auth Failed";
-    else if (error == OTA_BEGIN_ERROR) errMsg = "Begin Failed";
-    else if (error == OTA_CONNECT_ERROR) errMsg = "Connect Failed";
-    else if (error == OTA_RECEIVE_ERROR) errMsg = "Receive Failed";
-    else if (error == OTA_END_ERROR) errMsg = "End Failed";
-    Serial.println(errMsg);
-    display.showMessage("OTA Error", errMsg);
-    delay(3000);
-  });
-  
-  ArduinoOTA.begin();
+  espota.begin("cellar2024"); // Change this!
   Serial.println("✓ OTA update ready");
 }
 
@@ -203,8 +221,34 @@ void setup() {
   } else {
     Serial.println("❌ Fan controller init failed");
   }
+  // Commands from the web and MQTT tasks wake loop() for an immediate decision
+  fanController.setWakeTask(xTaskGetCurrentTaskHandle());
+  commands.setWakeTask(xTaskGetCurrentTaskHandle());
+  
+  // Learned weather profile for the day-ahead plan
+  planner.begin();
+  fanController.setPlanner(&planner);
+  
+  // Measured moisture removal per run, for adaptive differentials
+  efficiency.begin();
+  fanController.setEstimator(&efficiency);
+  
+  // Further fans with their own channel, sensor and mode
+  zones.begin(sensors, fanController);
+  
+  // Runtime, energy and water removed, per day and month
+  usage.begin();
   delay(1000);
   
+  // Start recording decisions for host replay
+  traceRecorder.begin();
+  
+  // Why each decision was taken, queryable on site
+  decisionJournal.begin();
+  
+  // Restore commands scheduled before the reboot
+  overrides.begin();
+  
   // Connect to WiFi
   setupWiFi();
   
@@ -214,14 +258,17 @@ void setup() {
     
     // Initialize web server
     Serial.println("\n🌐 Starting web server...");
-    webServer = new WebServerManager(sensors, fanController);
+    webServer = new WebServerManager(sensors, fanController, overrides, planner, efficiency, usage, zones,
+                                     commands, ota);
+    webServer->setLoopStats(&loopStats);
     webServer->begin();
     
     // Initialize MQTT if enabled
     if (config.mqtt_enabled) {
       Serial.println("\n📡 Starting MQTT client...");
-      mqttManager = new MQTTManager(sensors, fanController);
+      mqttManager = new MQTTManager(sensors, fanController, overrides, usage, zones, commands);
       mqttManager->begin();
+      webServer->setMQTT(mqttManager);
     }
   }
   
@@ -265,7 +312,7 @@ void handleSerialCommands() {
     currentMode = MODE_AUTO;
     manualOverrideUntil = 0;
     Serial.println("🔄 Switched to AUTO mode");
-    fanController.update(sensors.getInternalData(), sensors.getExternalData());
+    fanController.requestUpdate();
     
   } else if (cmd == "status") {
     Serial.println("\n━━━ SYSTEM STATUS ━━━");
@@ -273,6 +320,13 @@ void handleSerialCommands() {
     Serial.printf("Relay Pin 5: %s\n", digitalRead(PIN_RELAY) == LOW ? "ON (LOW)" : "OFF (HIGH)");
     Serial.printf("WiFi: %s\n", WiFi.isConnected() ? WiFi.localIP().toString().c_str() : "Disconnected");
     Serial.printf("Uptime: %lu seconds\n", millis() / 1000);
+    Serial.printf("Trace: %lu records, %u bytes\n",
+                  (unsigned long)traceRecorder.getRecordCount(),
+                  (unsigned)traceRecorder.getFileSize());
+    Serial.printf("Journal: %lu decision records\n",
+                  (unsigned long)(decisionJournal.getNextSeq() - decisionJournal.getOldestSeq()));
+    Serial.printf("Scheduled overrides: %u\n", overrides.getCount());
+    Serial.printf("Usage: %s\n", usage.getSummaryJSON().c_str());
     Serial.println();
     
   } else if (cmd == "sensors") {
@@ -294,12 +348,21 @@ void handleSerialCommands() {
 
 void loop() {
   unsigned long now = millis();
+  uint32_t passStart = micros();
   
   // Handle serial commands for debugging
   handleSerialCommands();
   
-  // Handle OTA updates
-  ArduinoOTA.handle();
+  // Handle OTA updates pushed by PlatformIO / the Arduino IDE
+  espota.handle();
+  
+  // A firmware upload (POST /update or espota) was verified and answered
+  if (ota.isRebootDue()) {
+    Serial.println("\n✓ Firmware update complete, rebooting...");
+    display.showMessage("OTA Complete", "Rebooting...");
+    prepareForUpdate();
+    ESP.restart();
+  }
   
   // Handle MQTT
   if (mqttManager && config.mqtt_enabled) {
@@ -307,29 +370,67 @@ void loop() {
   }
   
   // Read sensors periodically
+  bool sampled = false;
   if (now - lastSensorRead >= SENSOR_READ_INTERVAL) {
     sensors.update();
     lastSensorRead = now;
+    sampled = true;
+  }
+  
+  // Mode, speed and override changes from the web server and MQTT; they
+  // request an update, so the decision below runs in this pass
+  commands.apply(zones, overrides, fanController);
+  
+  // Start a scheduled override when its time comes (only the earliest is
+  // checked; it wakes us through nextDecision below)
+  overrides.update(time(nullptr), fanController);
+  
+  // Check manual override timeout
+  if (currentMode != MODE_AUTO && manualOverrideUntil > 0) {
+    if (now >= manualOverrideUntil) {
+      Serial.println("⏰ Manual override expired, returning to AUTO");
+      currentMode = MODE_AUTO;
+      manualOverrideUntil = 0;
+      fanController.requestUpdate();
+    }
   }
   
-  // Run fan control logic
-  if (now - lastDecision >= DECISION_INTERVAL) {
+  // Run fan control logic on a new sample, a command or the controller's
+  // next deadline instead of polling
+  if (sampled || fanController.isUpdatePending() || zones.isUpdatePending() ||
+      (long)(now - nextDecision) >= 0) {
     SensorData internal = sensors.getInternalData();
     SensorData external = sensors.getExternalData();
     
-    // Check manual override timeout
-    if (currentMode != MODE_AUTO && manualOverrideUntil > 0) {
-      if (now >= manualOverrideUntil) {
-        Serial.println("⏰ Manual override expired, returning to AUTO");
-        currentMode = MODE_AUTO;
-        manualOverrideUntil = 0;
-      }
+    // A config PATCH lands between decisions, never inside one. Only the
+    // decision holds the lock; what writes to flash runs after it, so a
+    // PATCH on the AsyncTCP task never waits for LittleFS
+    lockConfig();
+    fanController.update(internal, external);
+    zones.update(internal, external);
+    
+    nextDecision = fanController.getNextDeadline();
+    zones.getNextDeadline(nextDecision);
+    if (manualOverrideUntil > 0 && (long)(manualOverrideUntil - nextDecision) < 0) {
+      nextDecision = manualOverrideUntil;
     }
+    unsigned long overrideDue;
+    if (overrides.getNextDeadline(overrideDue) && (long)(overrideDue - nextDecision) < 0) {
+      nextDecision = overrideDue;
+    }
+    unlockConfig();
     
-    // Update fan controller
-    fanController.update(internal, external);
-    lastDecision = now;
+    traceRecorder.update(internal, external, fanController);
+    decisionJournal.update(internal, external, fanController);
+    planner.update(internal, external, fanController.getCurrentSpeed());
+    efficiency.update(internal, external, fanController.getCurrentSpeed());
+    usage.update(internal, external, fanController);
+    if (webServer) webServer->update();
   }
+  commands.complete(zones);
+  
+  // Config changes from the web server, once they have settled
+  updateConfigSave();
   
   // Update display
   if (now - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
@@ -339,6 +440,23 @@ void loop() {
     lastDisplayUpdate = now;
   }
   
-  // Small delay to prevent watchdog issues
-  delay(10);
+  // Sleep until the next deadline or a command notification, but keep
+  // polling OTA, MQTT and serial
+  unsigned long wake = nextDecision;
+  if ((long)(lastSensorRead + SENSOR_READ_INTERVAL - wake) < 0) {
+    wake = lastSensorRead + SENSOR_READ_INTERVAL;
+  }
+  if ((long)(lastDisplayUpdate + DISPLAY_UPDATE_INTERVAL - wake) < 0) {
+    wake = lastDisplayUpdate + DISPLAY_UPDATE_INTERVAL;
+  }
+  long idleMs = constrain((long)(wake - millis()), 1L, (long)LOOP_IDLE_MAX);
+  
+  // Time spent working this pass, for /metrics
+  uint32_t passUs = micros() - passStart;
+  loopStats.passes++;
+  loopStats.lastUs = passUs;
+  loopStats.totalUs += passUs;
+  if (passUs > loopStats.maxUs) loopStats.maxUs = passUs;
+  
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idleMs));
 }
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include "metrics.h"
+#include <WiFi.h>
+#include "mqtt_client.h"
+
+static const SensorData location(const MetricsSources& s, uint8_t arg) {
+  return arg == 0 ? s.sensors->getInternalData() : s.sensors->getExternalData();
+}
+
+static bool readTemperature(const MetricsSources& s, uint8_t arg, double& v) {
+  SensorData data = location(s, arg);
+  v = data.temperature;
+  return data.valid;
+}
+
+static bool readHumidity(const MetricsSources& s, uint8_t arg, double& v) {
+  SensorData data = location(s, arg);
+  v = data.humidity;
+  return data.valid;
+}
+
+static bool readDewPoint(const MetricsSources& s, uint8_t arg, double& v) {
+  SensorData data = location(s, arg);
+  v = data.dewPoint;
+  return data.valid;
+}
+
+// Drivers without a barometer report 0
+static bool readPressure(const MetricsSources& s, uint8_t arg, double& v) {
+  SensorData data = location(s, arg);
+  v = data.pressure;
+  return data.valid && data.pressure > 0;
+}
+
+static bool readSensorValid(const MetricsSources& s, uint8_t arg, double& v) {
+  v = location(s, arg).valid ? 1 : 0;
+  return true;
+}
+
+static bool readI2CErrors(const MetricsSources& s, uint8_t, double& v) {
+  v = s.sensors->getI2CErrors();
+  return true;
+}
+
+static bool readSpeed(const MetricsSources& s, uint8_t, double& v) {
+  v = s.fan->getCurrentSpeed();
+  return true;
+}
+
+static bool readReason(const MetricsSources& s, uint8_t arg, double& v) {
+  v = s.fan->getRunReason() == (RunReason)arg ? 1 : 0;
+  return true;
+}
+
+static bool readMode(const MetricsSources& s, uint8_t arg, double& v) {
+  v = s.fan->getMode() == (ControlMode)arg ? 1 : 0;
+  return true;
+}
+
+static bool readRelayCycles(const MetricsSources& s, uint8_t, double& v) {
+  v = s.fan->getRelayCycles();
+  return true;
+}
+
+static bool readZeroCrossings(const MetricsSources&, uint8_t, double& v) {
+  v = FanController::getZeroCrossings();
+  return true;
+}
+
+static bool readRssi(const MetricsSources&, uint8_t, double& v) {
+  v = WiFi.RSSI();
+  return WiFi.status() == WL_CONNECTED;
+}
+
+static bool readFreeHeap(const MetricsSources&, uint8_t, double& v) {
+  v = ESP.getFreeHeap();
+  return true;
+}
+
+static bool readMinFreeHeap(const MetricsSources&, uint8_t, double& v) {
+  v = ESP.getMinFreeHeap();
+  return true;
+}
+
+static bool readUptime(const MetricsSources&, uint8_t, double& v) {
+  v = millis() / 1000;
+  return true;
+}
+
+static bool readLoopPasses(const MetricsSources& s, uint8_t, double& v) {
+  if (!s.loop) return false;
+  v = s.loop->passes;
+  return true;
+}
+
+static bool readLoopBusy(const MetricsSources& s, uint8_t, double& v) {
+  if (!s.loop) return false;
+  uint64_t us;
+  do {
+    us = s.loop->totalUs;
+  } while (us != s.loop->totalUs);
+  v = us / 1e6;
+  return true;
+}
+
+static bool readLoopLast(const MetricsSources& s, uint8_t, double& v) {
+  if (!s.loop) return false;
+  v = s.loop->lastUs / 1e6;
+  return true;
+}
+
+static bool readLoopMax(const MetricsSources& s, uint8_t, double& v) {
+  if (!s.loop) return false;
+  v = s.loop->maxUs / 1e6;
+  return true;
+}
+
+static bool readMqttConnected(const MetricsSources& s, uint8_t, double& v) {
+  if (!s.mqtt) return false;
+  v = s.mqtt->isConnected() ? 1 : 0;
+  return true;
+}
+
+static bool readMqttReconnects(const MetricsSources& s, uint8_t, double& v) {
+  if (!s.mqtt) return false;
+  v = s.mqtt->getReconnects();
+  return true;
+}
+
+static const Metric metrics[] = {
+  { "cellar_temperature_celsius", "location=\"internal\"", METRIC_GAUGE, "Air temperature", 0, readTemperature },
+  { "cellar_temperature_celsius", "location=\"external\"", METRIC_GAUGE, "Air temperature", 1, readTemperature },
+  { "cellar_humidity_percent", "location=\"internal\"", METRIC_GAUGE, "Relative humidity", 0, readHumidity },
+  { "cellar_humidity_percent", "location=\"external\"", METRIC_GAUGE, "Relative humidity", 1, readHumidity },
+  { "cellar_dew_point_celsius", "location=\"internal\"", METRIC_GAUGE, "Dew point", 0, readDewPoint },
+  { "cellar_dew_point_celsius", "location=\"external\"", METRIC_GAUGE, "Dew point", 1, readDewPoint },
+  { "cellar_pressure_hpa", "location=\"internal\"", METRIC_GAUGE, "Air pressure", 0, readPressure },
+  { "cellar_pressure_hpa", "location=\"external\"", METRIC_GAUGE, "Air pressure", 1, readPressure },
+  { "cellar_sensor_valid", "location=\"internal\"", METRIC_GAUGE, "1 if the last sensor read succeeded", 0, readSensorValid },
+  { "cellar_sensor_valid", "location=\"external\"", METRIC_GAUGE, "1 if the last sensor read succeeded", 1, readSensorValid },
+  { "cellar_i2c_errors_total", "", METRIC_COUNTER, "Failed multiplexer selects and sensor reads", 0, readI2CErrors },
+
+  { "cellar_fan_speed_percent", "", METRIC_GAUGE, "Main fan speed", 0, readSpeed },
+  { "cellar_fan_reason", "reason=\"off\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_OFF, readReason },
+  { "cellar_fan_reason", "reason=\"humidity\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_HUMIDITY, readReason },
+  { "cellar_fan_reason", "reason=\"temperature\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_TEMPERATURE, readReason },
+  { "cellar_fan_reason", "reason=\"both\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_BOTH, readReason },
+  { "cellar_fan_reason", "reason=\"forced_circulation\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_FORCED_CIRCULATION, readReason },
+  { "cellar_fan_reason", "reason=\"manual\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_MANUAL_OVERRIDE, readReason },
+  { "cellar_fan_reason", "reason=\"safety_limit\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_SAFETY_LIMIT, readReason },
+  { "cellar_fan_reason", "reason=\"rule\"", METRIC_GAUGE, "Why the main fan runs (1 = current)", REASON_RULE, readReason },
+  { "cellar_mode", "mode=\"auto\"", METRIC_GAUGE, "Control mode of the main fan (1 = current)", MODE_AUTO, readMode },
+  { "cellar_mode", "mode=\"off\"", METRIC_GAUGE, "Control mode of the main fan (1 = current)", MODE_MANUAL_OFF, readMode },
+  { "cellar_mode", "mode=\"low\"", METRIC_GAUGE, "Control mode of the main fan (1 = current)", MODE_MANUAL_LOW, readMode },
+  { "cellar_mode", "mode=\"high\"", METRIC_GAUGE, "Control mode of the main fan (1 = current)", MODE_MANUAL_HIGH, readMode },
+  { "cellar_mode", "mode=\"diagnostic\"", METRIC_GAUGE, "Control mode of the main fan (1 = current)", MODE_DIAGNOSTIC, readMode },
+  { "cellar_relay_cycles_total", "", METRIC_COUNTER, "Main fan relay switch-ons", 0, readRelayCycles },
+  { "cellar_dimmer_zero_crossings_total", "", METRIC_COUNTER, "Mains zero crossings seen by the dimmer (wraps at 2^32)", 0, readZeroCrossings },
+
+  { "cellar_wifi_rssi_dbm", "", METRIC_GAUGE, "WiFi signal strength", 0, readRssi },
+  { "cellar_heap_free_bytes", "", METRIC_GAUGE, "Free heap", 0, readFreeHeap },
+  { "cellar_heap_min_free_bytes", "", METRIC_GAUGE, "Lowest free heap since boot", 0, readMinFreeHeap },
+  { "cellar_uptime_seconds", "", METRIC_GAUGE, "Time since boot", 0, readUptime },
+  { "cellar_loop_passes_total", "", METRIC_COUNTER, "Control loop passes", 0, readLoopPasses },
+  { "cellar_loop_busy_seconds_total", "", METRIC_COUNTER, "Control loop time spent working, idle wait excluded", 0, readLoopBusy },
+  { "cellar_loop_last_seconds", "", METRIC_GAUGE, "Duration of the last control loop pass", 0, readLoopLast },
+  { "cellar_loop_max_seconds", "", METRIC_GAUGE, "Longest control loop pass since boot", 0, readLoopMax },
+  { "cellar_mqtt_connected", "", METRIC_GAUGE, "1 while connected to the MQTT broker", 0, readMqttConnected },
+  { "cellar_mqtt_reconnects_total", "", METRIC_COUNTER, "MQTT connections after the first", 0, readMqttReconnects },
+};
+
+static const size_t metricCount = sizeof(metrics) / sizeof(metrics[0]);
+
+MetricsStream::MetricsStream(const MetricsSources& sources) : sources(sources) {
+  index = 0;
+  family = nullptr;
+  outLen = 0;
+  outPos = 0;
+}
+
+size_t MetricsStream::getMetricCount() {
+  return metricCount;
+}
+
+size_t MetricsStream::read(uint8_t* buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (outPos < outLen) {
+      size_t n = min(maxLen - written, outLen - outPos);
+      memcpy(buf + written, out + outPos, n);
+      written += n;
+      outPos += n;
+      continue;
+    }
+    if (index >= metricCount) break;
+
+    outLen = 0;
+    outPos = 0;
+    while (index < metricCount && outLen + METRICS_LINE_MAX <= sizeof(out)) {
+      format(metrics[index++]);
+    }
+  }
+  return written;
+}
+
+void MetricsStream::format(const Metric& metric) {
+  double value;
+  if (!metric.read(sources, metric.arg, value)) return;
+
+  char* text = out + outLen;
+  size_t room = sizeof(out) - outLen;
+  int n = 0;
+  if (!family || strcmp(family, metric.name) != 0) {
+    family = metric.name;
+    n = snprintf(text, room, "# HELP %s %s\n# TYPE %s %s\n", metric.name, metric.help,
+                 metric.name, metric.type == METRIC_COUNTER ? "counter" : "gauge");
+  }
+  if (metric.labels[0]) {
+    n += snprintf(text + n, room - n, "%s{%s} %.10g\n", metric.name, metric.labels, value);
+  } else {
+    n += snprintf(text + n, room - n, "%s %.10g\n", metric.name, value);
+  }
+  outLen += min((size_t)n, room - 1);
+}
@@ -1,10 +1,15 @@
 #include "mqtt_client.h"
 
-MQTTManager::MQTTManager(SensorManager& sensors, FanController& fan)
-  : mqttClient(wifiClient), sensorManager(sensors), fanController(fan) {
+MQTTManager::MQTTManager(SensorManager& sensors, FanController& fan, OverrideManager& overrides,
+                         const UsageMeter& usage, ZoneManager& zones, CommandQueue& commands)
+  : mqttClient(wifiClient), sensorManager(sensors), fanController(fan), overrideManager(overrides),
+    usage(usage), zones(zones), commands(commands) {
   lastPublish = 0;
   lastReconnectAttempt = 0;
+  connects = 0;
   discoveryPublished = false;
+  publishedOverrides = 0;
+  pendingTicket = 0;
 }
 
 void MQTTManager::begin() {
@@ -13,7 +18,10 @@ void MQTTManager::begin() {
     return;
   }
   
+  // PubSubClient keeps the pointer. The MQTT fields are CONFIG_RESTART: a
+  // PATCH saves them for the next start and never rewrites these Strings
   mqttClient.setServer(config.mqtt_broker.c_str(), config.mqtt_port);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);   // override queue and usage exceed the 256 default
   mqttClient.setCallback([this](char* topic, byte* payload, unsigned int length) {
     this->callback(topic, payload, length);
   });
@@ -40,8 +48,17 @@ void MQTTManager::loop() {
     if (now - lastPublish >= MQTT_PUBLISH_INTERVAL) {
       publishSensors();
       publishStatus();
+      publishUsage();
+      if (zones.getCount() > 1) publishZones();
       lastPublish = now;
     }
+    
+    publishCommandResult();
+    
+    // Queue changes (from any source, or a command starting) right away
+    if (overrideManager.getVersion() != publishedOverrides) {
+      publishOverrides();
+    }
   }
 }
 
@@ -65,10 +82,14 @@ void MQTTManager::reconnect() {
   
   if (connected) {
     Serial.println("connected");
+    connects++;
     
     // Subscribe to command topic
     mqttClient.subscribe("cellar/fan/command");
     mqttClient.subscribe("cellar/mode/set");
+    mqttClient.subscribe("cellar/override/set");
+    mqttClient.subscribe("cellar/override/cancel");
+    mqttClient.subscribe("cellar/zone/set");
     
     // Publish discovery if not done yet
     if (!discoveryPublished) {
@@ -79,6 +100,7 @@ void MQTTManager::reconnect() {
     // Publish initial state
     publishSensors();
     publishStatus();
+    publishOverrides();
     
   } else {
     Serial.printf("failed, rc=%d\n", mqttClient.state());
@@ -94,18 +116,117 @@ void MQTTManager::callback(char* topic, byte* payload, unsigned int length) {
   Serial.printf("MQTT message [%s]: %s\n", topic, message.c_str());
   
   if (strcmp(topic, "cellar/mode/set") == 0) {
+    Command cmd = {};
+    cmd.type = CMD_SET_MODE;
+    cmd.zone = 0;
+    cmd.duration = 60;
     if (message == "auto") {
-      fanController.setMode(MODE_AUTO);
+      cmd.mode = MODE_AUTO;
+      cmd.duration = 0;
     } else if (message == "off") {
-      fanController.setMode(MODE_MANUAL_OFF, 60);
+      cmd.mode = MODE_MANUAL_OFF;
     } else if (message == "low") {
-      fanController.setMode(MODE_MANUAL_LOW, 60);
+      cmd.mode = MODE_MANUAL_LOW;
     } else if (message == "high") {
-      fanController.setMode(MODE_MANUAL_HIGH, 60);
+      cmd.mode = MODE_MANUAL_HIGH;
+    } else {
+      return;
     }
+    queueCommand(cmd);
+  } else if (strcmp(topic, "cellar/override/set") == 0) {
+    handleOverrideCommand(message);
+  } else if (strcmp(topic, "cellar/override/cancel") == 0) {
+    Command cmd = {};
+    cmd.type = CMD_CANCEL_OVERRIDE;
+    cmd.id = message == "all" ? 0 : message.toInt();
+    if (message != "all" && cmd.id == 0) return;
+    queueCommand(cmd);
+  } else if (strcmp(topic, "cellar/zone/set") == 0) {
+    handleZoneCommand(message);
   }
 }
 
+// {"zone":1,"mode":"high","duration":60}; "speed" for mode "speed"
+void MQTTManager::handleZoneCommand(const String& message) {
+  JsonDocument doc;
+  if (deserializeJson(doc, message)) {
+    Serial.println("⚠️ Zone command is not valid JSON");
+    return;
+  }
+  
+  ControlMode mode;
+  int zone = doc["zone"] | -1;
+  if (!OverrideManager::parseMode(doc["mode"] | "", mode) || zone < 0 || zone >= zones.getCount()) {
+    Serial.println("⚠️ Zone command needs a valid zone and mode");
+    return;
+  }
+  Command cmd = {};
+  cmd.type = CMD_SET_MODE;
+  cmd.zone = zone;
+  cmd.mode = mode;
+  cmd.duration = doc["duration"] | 0;
+  cmd.speed = constrain(doc["speed"] | 0, 0, 100);
+  queueCommand(cmd);
+}
+
+// {"mode":"high","start":"2026-11-02 22:00","duration":180} - "start" may also
+// be epoch seconds, or use "in" (minutes from now); "speed" for mode "speed"
+void MQTTManager::handleOverrideCommand(const String& message) {
+  JsonDocument doc;
+  if (deserializeJson(doc, message)) {
+    Serial.println("⚠️ Override command is not valid JSON");
+    return;
+  }
+  
+  ControlMode mode;
+  if (!OverrideManager::parseMode(doc["mode"] | "", mode)) {
+    Serial.println("⚠️ Override command has no valid mode");
+    return;
+  }
+  
+  time_t start = 0;
+  if (doc["start"].is<const char*>()) {
+    start = OverrideManager::parseTime(doc["start"].as<String>());
+  } else if (doc["start"].is<unsigned long>()) {
+    start = (time_t)doc["start"].as<unsigned long>();
+  } else if (doc["in"].is<int>()) {
+    start = time(nullptr) + doc["in"].as<int>() * 60L;
+  }
+  
+  Command cmd = {};
+  cmd.type = CMD_ADD_OVERRIDE;
+  cmd.start = start;
+  cmd.duration = doc["duration"] | 0;
+  cmd.mode = mode;
+  cmd.speed = constrain(doc["speed"] | 0, 0, 100);
+  queueCommand(cmd);
+}
+
+// Commands run on the control loop, which is also the task this callback
+// runs on, so the result is published from loop() once it is there
+void MQTTManager::queueCommand(const Command& cmd) {
+  uint32_t ticket = commands.push(cmd);
+  if (ticket == 0) {
+    Serial.println("⚠️ Command queue full, MQTT command dropped");
+    return;
+  }
+  pendingTicket = ticket;
+}
+
+void MQTTManager::publishCommandResult() {
+  CommandResult result;
+  if (pendingTicket == 0) return;
+  if (!commands.poll(pendingTicket, result)) {
+    if (commands.getCompleted() - pendingTicket >= COMMAND_QUEUE_SIZE) pendingTicket = 0;
+    return;
+  }
+  pendingTicket = 0;
+  char payload[128];
+  CommandQueue::formatJSON(result, payload, sizeof(payload));
+  mqttClient.publish("cellar/command/result", payload);
+  publishStatus();
+}
+
 void MQTTManager::publishDiscovery() {
   String deviceId = getDeviceId();
   String baseTopic = "homeassistant/sensor/cellar_fan_";
@@ -188,6 +309,23 @@ void MQTTManager::publishStatus() {
   mqttClient.publish("cellar/status", payload.c_str());
 }
 
+void MQTTManager::publishUsage() {
+  String payload = usage.getSummaryJSON();
+  mqttClient.publish("cellar/usage", payload.c_str(), true);
+}
+
+void MQTTManager::publishZones() {
+  String payload = zones.getJSON();
+  mqttClient.publish("cellar/zones", payload.c_str());
+}
+
+void MQTTManager::publishOverrides() {
+  String payload = overrideManager.getJSON();
+  if (mqttClient.publish("cellar/overrides", payload.c_str(), true)) {
+    publishedOverrides = overrideManager.getVersion();
+  }
+}
+
 String MQTTManager::getDeviceId() const {
   uint64_t chipid = ESP.getEfuseMac();
   char id[13];
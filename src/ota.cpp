@@ -0,0 +1,393 @@
+#include "ota.h"
+
+#define OTA_BLOCK_LAST 0x01    // end of the image: verify and finish
+#define OTA_BLOCK_ABORT 0x02   // give up: discard what was written
+
+static const char* stateNames[] = {"idle", "receiving", "success", "failed"};
+
+static bool parseDigest(const char* hex, uint8_t* out) {
+  if (strlen(hex) != 64) return false;
+  for (int i = 0; i < 32; i++) {
+    uint8_t byte = 0;
+    for (int j = 0; j < 2; j++) {
+      char c = hex[i * 2 + j];
+      byte <<= 4;
+      if (c >= '0' && c <= '9') byte |= c - '0';
+      else if (c >= 'a' && c <= 'f') byte |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') byte |= c - 'A' + 10;
+      else return false;
+    }
+    out[i] = byte;
+  }
+  return true;
+}
+
+OtaUpdater::OtaUpdater() {
+  freeBlocks = nullptr;
+  fullBlocks = nullptr;
+  doneQueue = nullptr;
+  current = nullptr;
+  partition = nullptr;
+  erased = 0;
+  verify = false;
+  firstBlock = false;
+  staging = nullptr;
+  staged = 0;
+  patchedSize = 0;
+  state.store(OTA_IDLE, std::memory_order_relaxed);
+  session.store(0, std::memory_order_relaxed);
+  received.store(0, std::memory_order_relaxed);
+  written.store(0, std::memory_order_relaxed);
+  error.store(nullptr, std::memory_order_relaxed);
+  rejected.store(false, std::memory_order_relaxed);
+  patching.store(false, std::memory_order_relaxed);
+  total = 0;
+  startMs = 0;
+  elapsedMs.store(0, std::memory_order_relaxed);
+  rebootAt = 0;
+  digest[0] = '\0';
+}
+
+bool OtaUpdater::startWriter() {
+  // Created on the first upload and kept: the task then just waits
+  if (freeBlocks) return true;
+  freeBlocks = xQueueCreate(OTA_BLOCKS, sizeof(Block*));
+  fullBlocks = xQueueCreate(OTA_BLOCKS, sizeof(Block*));
+  doneQueue = xQueueCreate(1, sizeof(bool));
+  if (!freeBlocks || !fullBlocks || !doneQueue ||
+      xTaskCreate(writerTask, "ota", OTA_WRITER_STACK, this, OTA_WRITER_PRIORITY, nullptr) != pdPASS) {
+    Serial.println("❌ OTA writer task could not be started");
+    return false;
+  }
+  return true;
+}
+
+bool OtaUpdater::allocateBlocks() {
+  for (int i = 0; i < OTA_BLOCKS; i++) {
+    Block* block = (Block*)malloc(sizeof(Block));
+    if (!block) {
+      freeBlocksAll();
+      return false;
+    }
+    xQueueSend(freeBlocks, &block, 0);
+  }
+  xQueueReceive(freeBlocks, &current, 0);
+  current->len = 0;
+  current->flags = 0;
+  return true;
+}
+
+void OtaUpdater::freeBlocksAll() {
+  Block* block;
+  while (xQueueReceive(freeBlocks, &block, 0) == pdTRUE) free(block);
+}
+
+uint32_t OtaUpdater::begin(size_t size, const char* expectedSha256) {
+  // Claimed in one step: the web server and espota may both try at once,
+  // and the one running keeps its blocks
+  uint8_t previous = state.load(std::memory_order_acquire);
+  do {
+    if (previous == OTA_RECEIVING || previous == OTA_SUCCESS) {   // busy, or about to reboot
+      Serial.println("⚠️  Firmware upload refused: another update is running");
+      return 0;
+    }
+  } while (!state.compare_exchange_weak(previous, OTA_RECEIVING, std::memory_order_acq_rel));
+  uint32_t id = session.load(std::memory_order_relaxed) + 1;
+  if (id == 0) id = 1;
+  session.store(id, std::memory_order_release);
+
+  error.store(nullptr, std::memory_order_relaxed);
+  rejected.store(false, std::memory_order_relaxed);
+  patching.store(false, std::memory_order_relaxed);
+  received.store(0, std::memory_order_relaxed);
+  written.store(0, std::memory_order_relaxed);
+  elapsedMs.store(0, std::memory_order_relaxed);
+  digest[0] = '\0';
+  total = size;
+  startMs = millis();
+
+  partition = esp_ota_get_next_update_partition(nullptr);
+  erased = 0;
+  firstBlock = true;
+  verify = expectedSha256 && expectedSha256[0];
+  if (verify && !parseDigest(expectedSha256, expected)) {
+    reject("Bad SHA-256 digest, expected 64 hex digits");
+  } else if (!partition) {
+    fail("No OTA partition");
+  } else if (Update.isRunning()) {
+    fail("A filesystem update is running");
+  } else if (!startWriter() || !allocateBlocks()) {
+    fail("Out of memory");
+  }
+  if (error.load(std::memory_order_relaxed)) {
+    state.store(OTA_FAILED, std::memory_order_release);
+    Serial.printf("❌ Firmware upload refused: %s\n", error.load(std::memory_order_relaxed));
+    return id;
+  }
+
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  Serial.printf("🔄 Firmware upload started%s\n", verify ? " (SHA-256 check)" : "");
+  return id;
+}
+
+bool OtaUpdater::owns(uint32_t id) const {
+  return id != 0 && session.load(std::memory_order_acquire) == id && isReceiving();
+}
+
+bool OtaUpdater::write(uint32_t id, const uint8_t* data, size_t len) {
+  if (!owns(id) || error.load(std::memory_order_acquire)) return false;
+  received.fetch_add(len, std::memory_order_relaxed);
+
+  while (len > 0) {
+    size_t n = min(len, (size_t)OTA_BLOCK_SIZE - current->len);
+    memcpy(current->data + current->len, data, n);
+    current->len += n;
+    data += n;
+    len -= n;
+    if (current->len < OTA_BLOCK_SIZE) break;
+
+    // Full sector: to the writer, and carry on in a free block. Waiting for
+    // one here is what slows the sender down to the flash's pace.
+    xQueueSend(fullBlocks, &current, portMAX_DELAY);
+    if (xQueueReceive(freeBlocks, &current, pdMS_TO_TICKS(OTA_BLOCK_WAIT_MS)) != pdTRUE) {
+      current = nullptr;
+      fail("Flash write timed out");
+      return false;
+    }
+    current->len = 0;
+    current->flags = 0;
+  }
+  return error.load(std::memory_order_acquire) == nullptr;
+}
+
+bool OtaUpdater::end(uint32_t id) {
+  return owns(id) && finish(OTA_BLOCK_LAST);
+}
+
+void OtaUpdater::abort(uint32_t id, const char* reason) {
+  if (!owns(id)) return;
+  fail(reason);
+  finish(OTA_BLOCK_ABORT);
+}
+
+bool OtaUpdater::finish(uint8_t flags) {
+  if (!isReceiving()) return false;
+
+  bool ok = false;
+  if (!current && xQueueReceive(freeBlocks, &current, pdMS_TO_TICKS(OTA_FINISH_WAIT_MS)) != pdTRUE) {
+    // The writer still holds every block; they are lost, not freed under it
+    fail("Flash write timed out");
+  } else {
+    current->flags = flags;
+    xQueueSend(fullBlocks, &current, portMAX_DELAY);
+    current = nullptr;
+    if (xQueueReceive(doneQueue, &ok, pdMS_TO_TICKS(OTA_FINISH_WAIT_MS)) == pdTRUE) {
+      freeBlocksAll();   // all of them are back by now
+    } else {
+      fail("Flash write timed out");
+    }
+  }
+
+  elapsedMs.store(max(1UL, millis() - startMs), std::memory_order_relaxed);
+  if (ok) {
+    rebootAt = millis() + OTA_REBOOT_DELAY;
+    state.store(OTA_SUCCESS, std::memory_order_release);
+    Serial.printf("✓ Firmware written: %lu bytes in %.1f s, SHA-256 %s\n",
+                  (unsigned long)written.load(std::memory_order_relaxed),
+                  elapsedMs.load(std::memory_order_relaxed) / 1000.0, digest);
+    if (patching.load(std::memory_order_relaxed)) {
+      Serial.printf("  from a %lu-byte delta patch\n", (unsigned long)received.load(std::memory_order_relaxed));
+    }
+  } else {
+    state.store(OTA_FAILED, std::memory_order_release);
+    Serial.printf("❌ Firmware upload failed: %s\n", error.load(std::memory_order_relaxed));
+  }
+  return ok;
+}
+
+void OtaUpdater::fail(const char* reason) {
+  // The first failure is the one reported
+  const char* none = nullptr;
+  error.compare_exchange_strong(none, reason, std::memory_order_acq_rel);
+}
+
+void OtaUpdater::reject(const char* reason) {
+  const char* none = nullptr;
+  if (error.compare_exchange_strong(none, reason, std::memory_order_acq_rel)) {
+    rejected.store(true, std::memory_order_release);
+  }
+}
+
+void OtaUpdater::writerTask(void* arg) {
+  OtaUpdater* ota = (OtaUpdater*)arg;
+  Block* block;
+  for (;;) {
+    if (xQueueReceive(ota->fullBlocks, &block, portMAX_DELAY) == pdTRUE) ota->writeBlock(block);
+  }
+}
+
+void OtaUpdater::writeBlock(Block* block) {
+  uint8_t flags = block->flags;
+  if (!(flags & OTA_BLOCK_ABORT) && block->len > 0 && !error.load(std::memory_order_acquire)) {
+    const uint8_t* data = block->data;
+    size_t len = block->len;
+    if (firstBlock) {
+      firstBlock = false;
+      size_t header = startPatch(data, len);
+      data += header;
+      len -= header;
+    }
+    if (error.load(std::memory_order_acquire)) {
+      // Refused by startPatch()
+    } else if (!patching.load(std::memory_order_relaxed)) {
+      program(data, len);
+    } else if (!patch.write(data, len, stageImage, this)) {
+      reject(patch.getError());   // after a flash error in stageImage(), that one stands
+    }
+  }
+  xQueueSend(freeBlocks, &block, portMAX_DELAY);
+  if (!(flags & (OTA_BLOCK_LAST | OTA_BLOCK_ABORT))) return;
+
+  if (patching.load(std::memory_order_relaxed)) finishPatch(!(flags & OTA_BLOCK_ABORT));
+  uint8_t hash[32];
+  mbedtls_sha256_finish(&sha, hash);
+  mbedtls_sha256_free(&sha);
+  bool ok = false;
+  if (!error.load(std::memory_order_acquire)) {
+    for (int i = 0; i < 32; i++) snprintf(digest + i * 2, 3, "%02x", hash[i]);
+    bool patched = patching.load(std::memory_order_relaxed);
+    esp_err_t err;
+    if (verify && memcmp(hash, expected, sizeof(hash)) != 0) {
+      reject("SHA-256 mismatch");
+    } else if (written.load(std::memory_order_relaxed) == 0) {
+      reject("Empty image");
+    } else if (patched && (written.load(std::memory_order_relaxed) != patchedSize ||
+                           memcmp(hash, patchedSha, sizeof(hash)) != 0)) {
+      reject("Patched image does not match the patch's SHA-256");
+    } else if ((err = esp_ota_set_boot_partition(partition)) != ESP_OK) {
+      reject(esp_err_to_name(err));   // ESP_ERR_OTA_VALIDATE_FAILED: a damaged image
+    } else {
+      ok = true;
+    }
+  }
+  xQueueSend(doneQueue, &ok, portMAX_DELAY);
+}
+
+// Returns the header length if the upload is a patch, 0 for an image
+size_t OtaUpdater::startPatch(const uint8_t* data, size_t len) {
+  if (!DeltaDecoder::isPatch(data, len)) return 0;
+  DeltaHeader header;
+  memcpy(&header, data, sizeof(header));
+  patching.store(true, std::memory_order_relaxed);
+  patchedSize = header.imageSize;
+  memcpy(patchedSha, header.imageSha256, sizeof(patchedSha));
+  staged = 0;
+
+  if (header.imageSize > partition->size) {
+    reject("Image larger than the OTA partition");
+  } else if (!(staging = (uint8_t*)malloc(OTA_BLOCK_SIZE)) || !patch.allocate()) {
+    fail("Out of memory");
+  } else if (!patch.begin(header, esp_ota_get_running_partition())) {
+    reject(patch.getError());
+  } else {
+    Serial.printf("🔄 Delta patch: %lu-byte image from the running firmware\n",
+                  (unsigned long)header.imageSize);
+  }
+  return sizeof(header);
+}
+
+// complete: the patch was all received, so it must have ended
+void OtaUpdater::finishPatch(bool complete) {
+  if (complete && !error.load(std::memory_order_acquire)) {
+    if (!patch.isComplete()) {
+      reject("Patch ends early");
+    } else if (staged > 0) {
+      program(staging, staged);
+    }
+  }
+  patch.release();
+  free(staging);
+  staging = nullptr;
+  staged = 0;
+}
+
+bool OtaUpdater::stageImage(void* context, const uint8_t* data, size_t len) {
+  OtaUpdater* ota = (OtaUpdater*)context;
+  if (ota->written.load(std::memory_order_relaxed) + ota->staged + len > ota->patchedSize) {
+    ota->reject("Patch makes a larger image than it says");
+    return false;
+  }
+  while (len > 0) {
+    size_t n = min(len, (size_t)OTA_BLOCK_SIZE - ota->staged);
+    memcpy(ota->staging + ota->staged, data, n);
+    ota->staged += n;
+    data += n;
+    len -= n;
+    if (ota->staged < OTA_BLOCK_SIZE) break;
+    ota->staged = 0;
+    if (!ota->program(ota->staging, OTA_BLOCK_SIZE)) return false;
+  }
+  return true;
+}
+
+// Writes image bytes at the end of what was written, erasing ahead
+bool OtaUpdater::program(const uint8_t* data, size_t len) {
+  size_t offset = written.load(std::memory_order_relaxed);
+  esp_err_t err = ESP_OK;
+  if (offset == 0 && data[0] != OTA_IMAGE_MAGIC) {
+    reject(patching.load(std::memory_order_relaxed) ? "Patched image is not an ESP32 app image" :
+                                                      "Not an ESP32 app image or delta patch");
+    return false;
+  }
+  if (offset + len > partition->size) {
+    reject("Image larger than the OTA partition");
+    return false;
+  }
+  while (err == ESP_OK && erased < offset + len) {
+    size_t size = min((size_t)OTA_ERASE_SIZE, partition->size - erased);
+    err = esp_partition_erase_range(partition, erased, size);
+    erased += size;
+  }
+  if (err == ESP_OK) err = esp_partition_write(partition, offset, data, len);
+  if (err != ESP_OK) {
+    fail(esp_err_to_name(err));
+    return false;
+  }
+  mbedtls_sha256_update(&sha, data, len);
+  written.store(offset + len, std::memory_order_relaxed);
+  return true;
+}
+
+OtaProgress OtaUpdater::getProgress() const {
+  OtaProgress progress;
+  progress.state = (OtaState)state.load(std::memory_order_acquire);
+  progress.received = received.load(std::memory_order_relaxed);
+  progress.written = written.load(std::memory_order_relaxed);
+  progress.total = total;
+  progress.elapsedMs = progress.state == OTA_RECEIVING ? millis() - startMs :
+                       elapsedMs.load(std::memory_order_relaxed);
+  progress.rate = progress.elapsedMs ? (uint64_t)progress.written * 1000 / progress.elapsedMs : 0;
+  const char* failure = error.load(std::memory_order_acquire);
+  progress.error = failure ? failure : "";
+  progress.rejected = rejected.load(std::memory_order_acquire);
+  progress.delta = patching.load(std::memory_order_relaxed);
+  progress.sha256 = progress.state == OTA_SUCCESS || progress.state == OTA_FAILED ? digest : "";
+  return progress;
+}
+
+size_t OtaUpdater::formatJSON(char* buf, size_t len) const {
+  OtaProgress progress = getProgress();
+  int n = snprintf(buf, len,
+                   "{\"state\":\"%s\",\"received\":%lu,\"written\":%lu,\"total\":%lu,"
+                   "\"elapsed_ms\":%lu,\"rate\":%lu,\"delta\":%s,\"sha256\":\"%s\",\"error\":\"%s\"}",
+                   stateNames[progress.state], (unsigned long)progress.received,
+                   (unsigned long)progress.written, (unsigned long)progress.total,
+                   (unsigned long)progress.elapsedMs, (unsigned long)progress.rate,
+                   progress.delta ? "true" : "false", progress.sha256, progress.error);
+  return n > 0 ? min((size_t)n, len - 1) : 0;
+}
+
+bool OtaUpdater::isRebootDue() const {
+  return state.load(std::memory_order_acquire) == OTA_SUCCESS && (long)(millis() - rebootAt) >= 0;
+}
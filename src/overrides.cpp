@@ -0,0 +1,280 @@
+#include "overrides.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <algorithm>
+
+OverrideManager::OverrideManager() {
+  count = 0;
+  nextId = 1;
+  version = 0;
+}
+
+void OverrideManager::begin() {
+  if (load()) {
+    Serial.printf("✓ Scheduled overrides loaded: %u queued\n", count);
+  }
+}
+
+bool OverrideManager::before(const ScheduledOverride& a, const ScheduledOverride& b) {
+  return a.start != b.start ? a.start < b.start : a.id < b.id;
+}
+
+void OverrideManager::siftUp(uint8_t i) {
+  while (i > 0) {
+    uint8_t parent = (i - 1) / 2;
+    if (!before(heap[i], heap[parent])) break;
+    std::swap(heap[i], heap[parent]);
+    i = parent;
+  }
+}
+
+void OverrideManager::siftDown(uint8_t i) {
+  while (true) {
+    uint8_t first = i;
+    uint8_t left = 2 * i + 1;
+    uint8_t right = left + 1;
+    if (left < count && before(heap[left], heap[first])) first = left;
+    if (right < count && before(heap[right], heap[first])) first = right;
+    if (first == i) break;
+    std::swap(heap[i], heap[first]);
+    i = first;
+  }
+}
+
+void OverrideManager::removeAt(uint8_t i) {
+  heap[i] = heap[--count];
+  if (i < count) {
+    siftDown(i);
+    siftUp(i);
+  }
+}
+
+bool OverrideManager::push(const ScheduledOverride& cmd) {
+  if (count >= MAX_OVERRIDES) return false;
+  heap[count] = cmd;
+  siftUp(count++);
+  if (cmd.id >= nextId) nextId = cmd.id + 1;
+  return true;
+}
+
+uint32_t OverrideManager::add(time_t start, unsigned long durationMin, ControlMode mode, int speed) {
+  if (start < CLOCK_VALID_EPOCH) {
+    Serial.println("⚠️ Override rejected: no valid start time (clock not synced?)");
+    return 0;
+  }
+  if (mode != MODE_AUTO && (durationMin < 1 || durationMin > MAX_OVERRIDE_MIN)) {
+    Serial.printf("⚠️ Override rejected: duration %lu min out of range\n", durationMin);
+    return 0;
+  }
+  if (count >= MAX_OVERRIDES) {
+    Serial.printf("⚠️ Override rejected: queue full (%d)\n", MAX_OVERRIDES);
+    return 0;
+  }
+
+  ScheduledOverride cmd;
+  cmd.id = nextId;
+  cmd.start = start;
+  cmd.durationMin = mode == MODE_AUTO ? 0 : durationMin;
+  cmd.mode = mode;
+  cmd.speed = mode == MODE_DIAGNOSTIC ? constrain(speed, 0, 100) : 0;
+  push(cmd);
+  version++;
+  save();
+
+  Serial.printf("📅 Override #%lu queued: %s for %u min at %ld\n", (unsigned long)cmd.id,
+                modeName(mode), cmd.durationMin, (long)start);
+  return cmd.id;
+}
+
+bool OverrideManager::cancel(uint32_t id) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (heap[i].id == id) {
+      removeAt(i);
+      version++;
+      save();
+      Serial.printf("📅 Override #%lu cancelled\n", (unsigned long)id);
+      return true;
+    }
+  }
+  return false;
+}
+
+void OverrideManager::clear() {
+  count = 0;
+  version++;
+  save();
+  Serial.println("📅 All scheduled overrides cancelled");
+}
+
+bool OverrideManager::update(time_t now, FanController& fan) {
+  if (count == 0 || now < CLOCK_VALID_EPOCH || heap[0].start > now) return false;
+
+  // Several can be due after a reboot: commands that already ended are
+  // dropped and the last one still running wins
+  bool started = false;
+  while (count > 0 && heap[0].start <= now) {
+    ScheduledOverride cmd = heap[0];
+    removeAt(0);
+    if (cmd.mode != MODE_AUTO && cmd.start + (time_t)cmd.durationMin * 60 <= now) {
+      Serial.printf("⚠️ Override #%lu ended while offline, skipped\n", (unsigned long)cmd.id);
+      continue;
+    }
+    Serial.printf("📅 Starting override #%lu: %s\n", (unsigned long)cmd.id, modeName(cmd.mode));
+    apply(cmd, now, fan);
+    started = true;
+  }
+  version++;
+  save();
+  return started;
+}
+
+void OverrideManager::apply(const ScheduledOverride& cmd, time_t now, FanController& fan) {
+  if (cmd.mode == MODE_AUTO) {
+    fan.setMode(MODE_AUTO);
+    return;
+  }
+
+  unsigned long remainingSec = cmd.start + (time_t)cmd.durationMin * 60 - now;
+  if (cmd.mode == MODE_DIAGNOSTIC) {
+    fan.setManualSpeed(cmd.speed);
+  } else {
+    fan.setMode(cmd.mode, (remainingSec + 59) / 60);
+  }
+  // End to the second, not the rounded-up minute
+  manualOverrideUntil = millis() + remainingSec * 1000UL;
+}
+
+bool OverrideManager::getNextDeadline(unsigned long& deadline) const {
+  time_t now = time(nullptr);
+  if (count == 0 || now < CLOCK_VALID_EPOCH) return false;
+  time_t wait = heap[0].start - now;
+  if (wait < 0) wait = 0;
+  if (wait > 3600) wait = 3600;  // keep millis() arithmetic well inside its range
+  deadline = millis() + (unsigned long)wait * 1000UL;
+  return true;
+}
+
+static void writeEntry(JsonObject entry, const ScheduledOverride& cmd) {
+  entry["id"] = cmd.id;
+  entry["start"] = (uint32_t)cmd.start;
+  entry["duration"] = cmd.durationMin;
+  entry["mode"] = OverrideManager::modeName(cmd.mode);
+  if (cmd.mode == MODE_DIAGNOSTIC) entry["speed"] = cmd.speed;
+}
+
+String OverrideManager::getJSON() const {
+  ScheduledOverride sorted[MAX_OVERRIDES];
+  std::copy(heap, heap + count, sorted);
+  std::sort(sorted, sorted + count, before);
+
+  JsonDocument doc;
+  JsonArray list = doc["overrides"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; i++) {
+    JsonObject entry = list.add<JsonObject>();
+    writeEntry(entry, sorted[i]);
+
+    struct tm info;
+    char local[20];
+    localtime_r(&sorted[i].start, &info);
+    strftime(local, sizeof(local), "%Y-%m-%d %H:%M", &info);
+    entry["local"] = local;
+  }
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+bool OverrideManager::load() {
+  if (!LittleFS.exists(OVERRIDES_FILE)) return false;
+
+  File file = LittleFS.open(OVERRIDES_FILE, "r");
+  if (!file) {
+    Serial.println("❌ Failed to open " OVERRIDES_FILE);
+    return false;
+  }
+
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error) {
+    Serial.printf("❌ Failed to parse " OVERRIDES_FILE ": %s\n", error.c_str());
+    return false;
+  }
+
+  count = 0;
+  nextId = doc["next_id"] | 1;
+  for (JsonObject entry : doc["overrides"].as<JsonArray>()) {
+    ControlMode mode;
+    if (!parseMode(entry["mode"] | "", mode)) continue;
+    ScheduledOverride cmd;
+    cmd.id = entry["id"] | 0;
+    cmd.start = (time_t)(entry["start"] | 0UL);
+    cmd.durationMin = entry["duration"] | 0;
+    cmd.mode = mode;
+    cmd.speed = entry["speed"] | 0;
+    if (cmd.id == 0 || !push(cmd)) continue;
+  }
+  version++;
+  return true;
+}
+
+bool OverrideManager::save() const {
+  JsonDocument doc;
+  doc["next_id"] = nextId;
+  JsonArray list = doc["overrides"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; i++) {
+    writeEntry(list.add<JsonObject>(), heap[i]);
+  }
+
+  File file = LittleFS.open(OVERRIDES_FILE, "w");
+  if (!file) {
+    Serial.println("❌ Failed to open " OVERRIDES_FILE " for writing");
+    return false;
+  }
+  serializeJson(doc, file);
+  file.close();
+  return true;
+}
+
+bool OverrideManager::parseMode(const String& name, ControlMode& mode) {
+  if (name == "auto") mode = MODE_AUTO;
+  else if (name == "off") mode = MODE_MANUAL_OFF;
+  else if (name == "low") mode = MODE_MANUAL_LOW;
+  else if (name == "high") mode = MODE_MANUAL_HIGH;
+  else if (name == "speed") mode = MODE_DIAGNOSTIC;
+  else return false;
+  return true;
+}
+
+const char* OverrideManager::modeName(ControlMode mode) {
+  switch (mode) {
+    case MODE_MANUAL_OFF: return "off";
+    case MODE_MANUAL_LOW: return "low";
+    case MODE_MANUAL_HIGH: return "high";
+    case MODE_DIAGNOSTIC: return "speed";
+    default: return "auto";
+  }
+}
+
+time_t OverrideManager::parseTime(const String& text) {
+  if (text.length() == 0) return 0;
+
+  bool digits = true;
+  for (unsigned int i = 0; i < text.length(); i++) {
+    if (!isdigit((unsigned char)text[i])) digits = false;
+  }
+  if (digits) return (time_t)strtoul(text.c_str(), nullptr, 10);
+
+  struct tm t;
+  memset(&t, 0, sizeof(t));
+  if (sscanf(text.c_str(), "%d-%d-%d%*c%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+             &t.tm_hour, &t.tm_min) != 5) {
+    return 0;
+  }
+  t.tm_year -= 1900;
+  t.tm_mon -= 1;
+  t.tm_isdst = -1;
+  time_t result = mktime(&t);
+  return result > 0 ? result : 0;
+}
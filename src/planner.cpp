@@ -0,0 +1,363 @@
+#include "planner.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <math.h>
+
+#define PLAN_STEP_H (PLAN_STEP_MIN / 60.0f)
+#define PLAN_START_COST 0.1f   // fan hours a start is worth avoiding
+#define PLAN_OVER_COST 4.0f    // per g/m3 above the limit, per step
+#define PLAN_BIAS_HOURS 6.0f   // how fast today's deviation from the profile fades
+
+VentilationPlanner::VentilationPlanner() {
+  memset(profile, 0, sizeof(profile));
+  model.ingress = 0.05f;
+  model.exchange = 0.5f;
+  model.hours = 0;
+  persistent = false;
+  hourKey = -1;
+  firstSample = 0;
+  lastSample = 0;
+  samples = 0;
+  runHours = 0;
+  lastUpdate = 0;
+  lastSpeed = 0;
+  lastOutTemp = 0;
+  lastOutAh = 0;
+  inAhLast = 0;
+  inTempLast = 0;
+  hoursSinceSave = 0;
+  planning = false;
+  stage = -1;
+  planValid = false;
+  planStart = 0;
+  planRunHours = 0;
+  planMicros = 0;
+}
+
+void VentilationPlanner::begin() {
+  persistent = true;
+  if (load()) {
+    Serial.printf("✓ Planner history loaded: %lu h learned\n", (unsigned long)model.hours);
+  }
+}
+
+int VentilationPlanner::seasonOf(const struct tm& t) {
+  return ((t.tm_mon + 1) % 12) / 3;   // Dec-Feb, Mar-May, Jun-Aug, Sep-Nov
+}
+
+void VentilationPlanner::update(const SensorData& internal, const SensorData& external,
+                                int fanSpeed) {
+  unsigned long nowMs = millis();
+  float dtH = min(nowMs - lastUpdate, 60000UL) / 3.6e6f;
+  if (hourKey >= 0) runHours += dtH * lastSpeed / 100.0f;
+  lastUpdate = nowMs;
+  lastSpeed = fanSpeed;
+
+  time_t now = time(nullptr);
+  if (now > CLOCK_VALID_EPOCH && internal.valid && external.valid) {
+    struct tm t;
+    localtime_r(&now, &t);
+    int key = t.tm_yday * 24 + t.tm_hour;
+    if (key != hourKey) {
+      if (hourKey >= 0) closeHour(now);
+      hourKey = key;
+      firstSample = now;
+      outTempSum = 0;
+      outAhSum = 0;
+      samples = 0;
+      runHours = 0;
+      inAhFirst = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity);
+    }
+
+    lastOutTemp = external.temperature;
+    lastOutAh = SensorManagerBase::calculateAbsoluteHumidity(external.temperature, external.humidity);
+    inTempLast = internal.temperature;
+    inAhLast = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity);
+    outTempSum += lastOutTemp;
+    outAhSum += lastOutAh;
+    samples++;
+    lastSample = now;
+
+    // First plan as soon as there is a reading
+    if (!planValid && !planning) startPlan(now);
+  }
+
+  if (planning) stepPlan();
+}
+
+void VentilationPlanner::closeHour(time_t now) {
+  // Hours with gaps (boot, sensor failures) teach nothing
+  float coveredH = (lastSample - firstSample) / 3600.0f;
+  if (coveredH >= 0.75f && samples > 0) {
+    struct tm t;
+    localtime_r(&firstSample, &t);
+    ProfileCell& cell = profile[seasonOf(t)][t.tm_wday][t.tm_hour];
+
+    // Running mean for the first weeks, then an average over about a month
+    float alpha = cell.samples < 4 ? 1.0f / (cell.samples + 1) : 0.25f;
+    float temp = outTempSum / samples;
+    float ah = outAhSum / samples;
+    cell.temp += (int16_t)lroundf(alpha * (temp * 100.0f - cell.temp));
+    cell.ah += (int16_t)lroundf(alpha * (ah * 100.0f - cell.ah));
+    if (cell.samples < 255) cell.samples++;
+
+    float inAhMean = (inAhFirst + inAhLast) / 2;
+    learn((inAhLast - inAhFirst) / coveredH, runHours / coveredH, inAhMean - ah);
+    model.hours++;
+
+    if (persistent && ++hoursSinceSave >= PLAN_SAVE_HOURS) {
+      save();
+      hoursSinceSave = 0;
+    }
+  }
+
+  startPlan(now);
+}
+
+void VentilationPlanner::learn(float rate, float runFrac, float gap) {
+  if (runFrac < 0.02f) {
+    model.ingress += 0.1f * (constrain(rate, -0.5f, 1.0f) - model.ingress);
+  } else if (runFrac >= 0.1f && gap > 0.3f) {
+    // rate = ingress - exchange * runFrac * gap
+    float exchange = (model.ingress - rate) / (runFrac * gap);
+    model.exchange += 0.1f * (constrain(exchange, 0.0f, 4.0f) - model.exchange);
+  }
+}
+
+bool VentilationPlanner::forecast(time_t at, float& temp, float& ah) const {
+  struct tm t;
+  localtime_r(&at, &t);
+  int season = seasonOf(t);
+  const ProfileCell& cell = profile[season][t.tm_wday][t.tm_hour];
+  if (cell.samples > 0) {
+    temp = cell.temp / 100.0f;
+    ah = cell.ah / 100.0f;
+    return true;
+  }
+
+  // Not seen on this weekday yet: the same hour on the others
+  float tempSum = 0, ahSum = 0;
+  int n = 0;
+  for (int d = 0; d < 7; d++) {
+    const ProfileCell& other = profile[season][d][t.tm_hour];
+    if (other.samples > 0) {
+      tempSum += other.temp;
+      ahSum += other.ah;
+      n++;
+    }
+  }
+  if (n == 0) return false;
+  temp = tempSum / n / 100.0f;
+  ah = ahSum / n / 100.0f;
+  return true;
+}
+
+void VentilationPlanner::startPlan(time_t now) {
+  workStart = now - now % (PLAN_STEP_MIN * 60);
+
+  // Today's deviation from the profile, fading over the horizon; without a
+  // profile for an hour the current reading is held
+  float biasTemp = 0, biasAh = 0;
+  float temp, ah;
+  if (forecast(now, temp, ah)) {
+    biasTemp = lastOutTemp - temp;
+    biasAh = lastOutAh - ah;
+  }
+
+  for (int s = 0; s < PLAN_STEPS; s++) {
+    time_t at = workStart + s * PLAN_STEP_MIN * 60 + PLAN_STEP_MIN * 30;
+    float fade = expf(-(at - now) / 3600.0f / PLAN_BIAS_HOURS);
+    if (forecast(at, temp, ah)) {
+      temp += biasTemp * fade;
+      ah += biasAh * fade;
+    } else {
+      temp = lastOutTemp;
+      ah = lastOutAh;
+    }
+    outAh[s] = ah;
+
+    time_t until;
+    SpeedLimit limit = config.schedule.evaluate(at, until);   // limitAt()'s cache is the decision's
+    if (limit == LIMIT_OFF || temp < config.min_outside_temp) {
+      removal[s] = 0;
+    } else {
+      float speed = (limit == LIMIT_HIGH ? config.high_speed : config.low_speed) / 100.0f;
+      removal[s] = 1.0f - expf(-model.exchange * speed * PLAN_STEP_H);
+    }
+  }
+
+  workAh = inAhLast;
+  workLimit = SensorManagerBase::calculateAbsoluteHumidity(inTempLast, config.target_humidity);
+  workLo = min(workAh, workLimit) - 1.5f;
+  memset(value[PLAN_STEPS % 2], 0, sizeof(value[0]));
+  stage = PLAN_STEPS - 1;
+  workMicros = 0;
+  planning = true;
+}
+
+float VentilationPlanner::advance(float ah, int step, bool run) const {
+  ah += model.ingress * PLAN_STEP_H;
+  if (run) {
+    ah -= removal[step] * (ah - outAh[step]);
+  }
+  return ah;
+}
+
+float VentilationPlanner::lookup(int parity, float ah, int wasRunning) const {
+  float x = (ah - workLo) / PLAN_BIN_G;
+  if (x <= 0) return value[parity][0][wasRunning];
+  if (x >= PLAN_BINS - 1) return value[parity][PLAN_BINS - 1][wasRunning];
+  int i = (int)x;
+  float f = x - i;
+  return value[parity][i][wasRunning] * (1 - f) + value[parity][i + 1][wasRunning] * f;
+}
+
+void VentilationPlanner::stepPlan() {
+  unsigned long start = micros();
+
+  // Backward induction: value = fewest fan hours from this step to the end
+  for (int n = 0; n < PLAN_STEPS_PER_CALL && stage >= 0; n++, stage--) {
+    int cur = stage % 2;
+    int next = 1 - cur;
+    // Running only helps while outside air is drier than the cellar's
+    bool canRun = removal[stage] > 0;
+    for (int b = 0; b < PLAN_BINS; b++) {
+      float ah = workLo + b * PLAN_BIN_G;
+      uint8_t bits = 0;
+      float idleAh = advance(ah, stage, false);
+      float runAh = advance(ah, stage, true);
+      for (int prev = 0; prev < 2; prev++) {
+        float best = PLAN_OVER_COST * max(0.0f, idleAh - workLimit) + lookup(next, idleAh, 0);
+        if (canRun && outAh[stage] < ah) {
+          float cost = PLAN_STEP_H + (prev ? 0 : PLAN_START_COST) +
+                       PLAN_OVER_COST * max(0.0f, runAh - workLimit) + lookup(next, runAh, 1);
+          if (cost < best) {
+            best = cost;
+            bits |= 1 << prev;
+          }
+        }
+        value[cur][b][prev] = best;
+      }
+      policy[stage][b] = bits;
+    }
+  }
+
+  workMicros += micros() - start;
+  if (stage < 0) finishPlan();
+}
+
+void VentilationPlanner::finishPlan() {
+  // Forward pass from the cellar's actual state
+  memset(planBits, 0, sizeof(planBits));
+  planRunHours = 0;
+  float ah = workAh;
+  int prev = lastSpeed > 0;
+  for (int s = 0; s < PLAN_STEPS; s++) {
+    int b = constrain((int)lroundf((ah - workLo) / PLAN_BIN_G), 0, PLAN_BINS - 1);
+    bool run = policy[s][b] & (1 << prev);
+    if (run) {
+      planBits[s / 32] |= 1UL << (s % 32);
+      planRunHours += PLAN_STEP_H;
+    }
+    ah = advance(ah, s, run);
+    planAh[s] = ah;
+    prev = run;
+  }
+
+  planStart = workStart;
+  planLimit = workLimit;
+  planMicros = workMicros;
+  planValid = true;
+  planning = false;
+  Serial.printf("🗓️ Plan: %.2f h of ventilation in the next 24 h (%lu µs)\n",
+                planRunHours, planMicros);
+}
+
+bool VentilationPlanner::getPlanned(time_t now, bool& run) const {
+  if (!config.planner_enabled || !planValid || model.hours < PLAN_MIN_HOURS) return false;
+  long step = (now - planStart) / (PLAN_STEP_MIN * 60);
+  if (now < planStart || step >= PLAN_STEPS) return false;
+  run = planBits[step / 32] & (1UL << (step % 32));
+  return true;
+}
+
+time_t VentilationPlanner::nextStep(time_t now) const {
+  bool run;
+  if (!getPlanned(now, run)) return 0;
+  return now - (now - planStart) % (PLAN_STEP_MIN * 60) + PLAN_STEP_MIN * 60;
+}
+
+String VentilationPlanner::getJSON() const {
+  JsonDocument doc;
+  doc["enabled"] = config.planner_enabled;
+  doc["learning"] = model.hours < PLAN_MIN_HOURS;
+  doc["model"]["ingress"] = model.ingress;
+  doc["model"]["exchange"] = model.exchange;
+  doc["model"]["hours"] = model.hours;
+
+  int cells = 0;
+  for (int s = 0; s < PROFILE_SEASONS; s++) {
+    for (int d = 0; d < 7; d++) {
+      for (int h = 0; h < 24; h++) {
+        if (profile[s][d][h].samples > 0) cells++;
+      }
+    }
+  }
+  doc["profile_hours"] = cells;
+
+  if (planValid) {
+    JsonObject plan = doc["plan"].to<JsonObject>();
+    plan["start"] = (uint32_t)planStart;
+    plan["step_minutes"] = PLAN_STEP_MIN;
+    plan["runtime_h"] = planRunHours;
+    plan["limit_ah"] = planLimit;
+    plan["compute_us"] = planMicros;
+
+    char run[PLAN_STEPS + 1];
+    JsonArray predicted = plan["predicted_ah"].to<JsonArray>();
+    for (int s = 0; s < PLAN_STEPS; s++) {
+      run[s] = planBits[s / 32] & (1UL << (s % 32)) ? '1' : '0';
+      predicted.add(lroundf(planAh[s] * 100) / 100.0f);
+    }
+    run[PLAN_STEPS] = '\0';
+    plan["run"] = run;
+  }
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+bool VentilationPlanner::load() {
+  if (!LittleFS.exists(PLANNER_FILE)) return false;
+  File file = LittleFS.open(PLANNER_FILE, "r");
+  if (!file) return false;
+
+  uint32_t magic = 0;
+  MoistureModel saved;
+  bool ok = file.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic) && magic == PLANNER_MAGIC &&
+            file.read((uint8_t*)&saved, sizeof(saved)) == sizeof(saved) &&
+            file.size() == sizeof(magic) + sizeof(saved) + sizeof(profile);
+  if (ok) {
+    file.read((uint8_t*)profile, sizeof(profile));
+    model = saved;
+  } else {
+    Serial.println("⚠️ " PLANNER_FILE " has an unknown format, starting over");
+  }
+  file.close();
+  return ok;
+}
+
+bool VentilationPlanner::save() const {
+  File file = LittleFS.open(PLANNER_FILE, "w");
+  if (!file) {
+    Serial.println("❌ Failed to open " PLANNER_FILE " for writing");
+    return false;
+  }
+  uint32_t magic = PLANNER_MAGIC;
+  file.write((const uint8_t*)&magic, sizeof(magic));
+  file.write((const uint8_t*)&model, sizeof(model));
+  file.write((const uint8_t*)profile, sizeof(profile));
+  file.close();
+  return true;
+}
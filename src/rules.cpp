@@ -0,0 +1,407 @@
+#include "rules.h"
+#include "config.h"
+#include "sensors.h"
+#include <math.h>
+#include <time.h>
+
+static const char* inputNames[RULE_INPUTS] = {
+  "in.temp", "in.rh", "in.dp", "in.ah", "out.temp", "out.rh", "out.dp", "out.ah",
+  "in.temp_rate", "in.rh_rate", "hour", "weekday", "speed"
+};
+
+// Recursive descent over the condition text, emitting postfix bytecode as it
+// goes; the stack depth is tracked so evaluation never needs to check it
+class RuleCompiler {
+public:
+  RuleCompiler(RuleProgram& program, const char* text)
+    : p(program), s(text), pos(0), depth(0), inputs(0) {}
+
+  bool compile(String& err) {
+    if (!parseOr()) {
+      err = error;
+      return false;
+    }
+    skipSpace();
+    if (s[pos] != '\0') {
+      err = "unexpected '" + String(s + pos) + "'";
+      return false;
+    }
+    return true;
+  }
+
+  uint16_t getInputs() const { return inputs; }
+
+private:
+  RuleProgram& p;
+  const char* s;
+  size_t pos;
+  int depth;
+  uint16_t inputs;
+  String error;
+
+  bool fail(const String& message) {
+    if (error.length() == 0) error = message;
+    return false;
+  }
+
+  void skipSpace() {
+    while (s[pos] == ' ' || s[pos] == '\t') pos++;
+  }
+
+  static bool isWordChar(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.';
+  }
+
+  // Operator or keyword at the current position (keywords as whole words)
+  bool match(const char* token) {
+    skipSpace();
+    size_t n = strlen(token);
+    if (strncmp(s + pos, token, n) != 0) return false;
+    if (isalpha((unsigned char)token[0]) && isWordChar(s[pos + n])) return false;
+    pos += n;
+    return true;
+  }
+
+  bool emit(uint8_t byte) {
+    if (p.codeSize >= RULE_CODE_BYTES) return fail("rules too long");
+    p.code[p.codeSize++] = byte;
+    return true;
+  }
+
+  // Net stack effect of an instruction just emitted
+  bool push() {
+    if (++depth > RULE_STACK) return fail("expression too deep");
+    return true;
+  }
+  void pop(int n = 1) { depth -= n; }
+
+  bool binary(RuleOp op) {
+    pop();
+    return emit(op);
+  }
+
+  bool constant(float value) {
+    uint8_t index = 0;
+    while (index < p.constCount && p.consts[index] != value) index++;
+    if (index == p.constCount) {
+      if (p.constCount >= RULE_MAX_CONSTS) return fail("too many constants");
+      p.consts[p.constCount++] = value;
+    }
+    return emit(OP_CONST) && emit(index) && push();
+  }
+
+  bool parseOr() {
+    if (!parseAnd()) return false;
+    while (match("||") || match("or")) {
+      if (!parseAnd() || !binary(OP_OR)) return false;
+    }
+    return true;
+  }
+
+  bool parseAnd() {
+    if (!parseNot()) return false;
+    while (match("&&") || match("and")) {
+      if (!parseNot() || !binary(OP_AND)) return false;
+    }
+    return true;
+  }
+
+  bool parseNot() {
+    skipSpace();
+    if (match("not") || (s[pos] == '!' && s[pos + 1] != '=' && match("!"))) {
+      return parseNot() && emit(OP_NOT);
+    }
+    return parseComparison();
+  }
+
+  bool parseComparison() {
+    if (!parseSum()) return false;
+    static const struct { const char* token; RuleOp op; } ops[] = {
+      {"<=", OP_LE}, {">=", OP_GE}, {"==", OP_EQ}, {"!=", OP_NE}, {"<", OP_LT}, {">", OP_GT}
+    };
+    for (const auto& c : ops) {
+      if (match(c.token)) return parseSum() && binary(c.op);
+    }
+    return true;
+  }
+
+  bool parseSum() {
+    if (!parseTerm()) return false;
+    while (true) {
+      if (match("+")) {
+        if (!parseTerm() || !binary(OP_ADD)) return false;
+      } else if (match("-")) {
+        if (!parseTerm() || !binary(OP_SUB)) return false;
+      } else {
+        return true;
+      }
+    }
+  }
+
+  bool parseTerm() {
+    if (!parseUnary()) return false;
+    while (true) {
+      if (match("*")) {
+        if (!parseUnary() || !binary(OP_MUL)) return false;
+      } else if (match("/")) {
+        if (!parseUnary() || !binary(OP_DIV)) return false;
+      } else {
+        return true;
+      }
+    }
+  }
+
+  bool parseUnary() {
+    if (match("-")) return parseUnary() && emit(OP_NEG);
+    return parsePrimary();
+  }
+
+  bool parsePrimary() {
+    skipSpace();
+    if (match("(")) {
+      if (!parseOr()) return false;
+      return match(")") || fail("missing ')'");
+    }
+
+    char c = s[pos];
+    if (isdigit((unsigned char)c) || c == '.') {
+      char* end;
+      float value = strtof(s + pos, &end);
+      pos = end - s;
+      return constant(value);
+    }
+
+    size_t start = pos;
+    while (isWordChar(s[pos])) pos++;
+    String word = String(s + start).substring(0, pos - start);
+    if (word.length() == 0) {
+      return fail(s[pos] ? "unexpected '" + String(s[pos]) + "'" : String("unexpected end"));
+    }
+
+    if (match("(")) {
+      RuleOp op;
+      int args;
+      if (word == "abs") { op = OP_ABS; args = 1; }
+      else if (word == "min") { op = OP_MIN; args = 2; }
+      else if (word == "max") { op = OP_MAX; args = 2; }
+      else return fail("unknown function " + word);
+      for (int i = 0; i < args; i++) {
+        if (i > 0 && !match(",")) return fail(word + "() takes " + String(args) + " arguments");
+        if (!parseOr()) return false;
+      }
+      if (!match(")")) return fail("missing ')'");
+      pop(args - 1);
+      return emit(op);
+    }
+
+    for (uint8_t i = 0; i < RULE_INPUTS; i++) {
+      if (word == inputNames[i]) {
+        inputs |= 1 << i;
+        return emit(OP_INPUT) && emit(i) && push();
+      }
+    }
+    return fail("unknown input " + word);
+  }
+};
+
+RuleProgram::RuleProgram() {
+  generation = 0;
+  clear();
+}
+
+void RuleProgram::clear() {
+  count = 0;
+  codeSize = 0;
+  constCount = 0;
+  inputs = 0;
+  generation++;
+}
+
+bool RuleProgram::addRule(const String& name, const String& when, const String& then, String& error) {
+  if (count >= RULE_MAX) {
+    error = "only " + String(RULE_MAX) + " rules supported";
+    return false;
+  }
+
+  Rule& rule = rules[count];
+  rule.speed = 0;
+  if (then == "off") {
+    rule.action = ACTION_OFF;
+  } else if (then == "low") {
+    rule.action = ACTION_LOW;
+  } else if (then == "high") {
+    rule.action = ACTION_HIGH;
+  } else if (then.toInt() >= 1 && then.toInt() <= 100) {
+    rule.action = ACTION_SPEED;
+    rule.speed = then.toInt();
+  } else {
+    error = "action must be off, low, high or a speed 1-100";
+    return false;
+  }
+
+  // On failure the partial code and constants are dropped again
+  uint16_t codeMark = codeSize;
+  uint8_t constMark = constCount;
+  RuleCompiler compiler(*this, when.c_str());
+  if (!compiler.compile(error)) {
+    codeSize = codeMark;
+    constCount = constMark;
+    return false;
+  }
+
+  rule.name = name;
+  rule.when = when;
+  rule.codeStart = codeMark;
+  rule.codeLength = codeSize - codeMark;
+  rule.inputs = compiler.getInputs();
+  inputs |= rule.inputs;
+  count++;
+  generation++;
+  return true;
+}
+
+String RuleProgram::getAction(uint8_t i) const {
+  switch (rules[i].action) {
+    case ACTION_OFF: return "off";
+    case ACTION_LOW: return "low";
+    case ACTION_HIGH: return "high";
+    default: return String(rules[i].speed);
+  }
+}
+
+const char* RuleProgram::inputName(RuleInput input) {
+  return input < RULE_INPUTS ? inputNames[input] : "?";
+}
+
+bool RuleProgram::run(uint8_t i, const float* values) const {
+  const Rule& rule = rules[i];
+  for (uint8_t in = 0; in < RULE_INPUTS; in++) {
+    if ((rule.inputs & (1 << in)) && isnan(values[in])) return false;
+  }
+
+  float stack[RULE_STACK];
+  int sp = 0;
+  const uint8_t* pc = code + rule.codeStart;
+  const uint8_t* end = pc + rule.codeLength;
+  while (pc < end) {
+    float b;
+    switch (*pc++) {
+      case OP_CONST: stack[sp++] = consts[*pc++]; break;
+      case OP_INPUT: stack[sp++] = values[*pc++]; break;
+      case OP_ADD: b = stack[--sp]; stack[sp - 1] += b; break;
+      case OP_SUB: b = stack[--sp]; stack[sp - 1] -= b; break;
+      case OP_MUL: b = stack[--sp]; stack[sp - 1] *= b; break;
+      case OP_DIV: b = stack[--sp]; stack[sp - 1] /= b; break;
+      case OP_NEG: stack[sp - 1] = -stack[sp - 1]; break;
+      case OP_LT: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] < b; break;
+      case OP_LE: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] <= b; break;
+      case OP_GT: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] > b; break;
+      case OP_GE: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] >= b; break;
+      case OP_EQ: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] == b; break;
+      case OP_NE: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] != b; break;
+      case OP_AND: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] != 0 && b != 0; break;
+      case OP_OR: b = stack[--sp]; stack[sp - 1] = stack[sp - 1] != 0 || b != 0; break;
+      case OP_NOT: stack[sp - 1] = stack[sp - 1] == 0; break;
+      case OP_ABS: stack[sp - 1] = fabsf(stack[sp - 1]); break;
+      case OP_MIN: b = stack[--sp]; stack[sp - 1] = min(stack[sp - 1], b); break;
+      case OP_MAX: b = stack[--sp]; stack[sp - 1] = max(stack[sp - 1], b); break;
+      default: return false;
+    }
+  }
+  // A division by zero gives NaN or inf; NaN does not hold
+  return sp == 1 && stack[0] != 0 && !isnan(stack[0]);
+}
+
+RuleEngine::RuleEngine() {
+  for (uint8_t i = 0; i < RULE_INPUTS; i++) values[i] = NAN;
+  memset(results, 0, sizeof(results));
+  fresh = true;
+  generation = 0;
+  runs = 0;
+  reuses = 0;
+  historyCount = 0;
+  historyHead = 0;
+}
+
+void RuleEngine::track(const SensorData& internal, unsigned long now) {
+  // A gap in the samples (invalid sensor) restarts the history
+  if (historyCount > 0 && now - history[historyHead].ms > 2 * RULE_RATE_STEP) {
+    historyCount = 0;
+  }
+  if (historyCount > 0 && now - history[historyHead].ms < RULE_RATE_STEP) return;
+
+  historyHead = (historyHead + 1) % RULE_RATE_SAMPLES;
+  history[historyHead] = {now, internal.temperature, internal.humidity};
+  if (historyCount < RULE_RATE_SAMPLES) historyCount++;
+}
+
+float RuleEngine::rate(bool humidity, const SensorData& internal, unsigned long now) const {
+  if (historyCount == 0) return NAN;
+  const RateSample& oldest = history[(historyHead + RULE_RATE_SAMPLES - (historyCount - 1)) % RULE_RATE_SAMPLES];
+  unsigned long age = now - oldest.ms;
+  if (age < RULE_RATE_MIN_AGE) return NAN;
+  float change = humidity ? internal.humidity - oldest.rh : internal.temperature - oldest.temp;
+  return change / (age / 3600000.0f);
+}
+
+int RuleEngine::evaluate(const RuleProgram& program, const SensorData& internal,
+                         const SensorData& external, int speed) {
+  if (program.getCount() == 0) return -1;
+  unsigned long now = millis();
+  uint16_t used = program.getInputs();
+
+  if (program.getGeneration() != generation) {
+    generation = program.getGeneration();
+    fresh = true;
+  }
+
+  float next[RULE_INPUTS];
+  memcpy(next, values, sizeof(next));
+  if (used & ((1 << INPUT_IN_TEMP_RATE) | (1 << INPUT_IN_RH_RATE))) {
+    track(internal, now);
+    next[INPUT_IN_TEMP_RATE] = rate(false, internal, now);
+    next[INPUT_IN_RH_RATE] = rate(true, internal, now);
+  }
+  next[INPUT_IN_TEMP] = internal.temperature;
+  next[INPUT_IN_RH] = internal.humidity;
+  next[INPUT_IN_DP] = internal.dewPoint;
+  next[INPUT_OUT_TEMP] = external.temperature;
+  next[INPUT_OUT_RH] = external.humidity;
+  next[INPUT_OUT_DP] = external.dewPoint;
+  next[INPUT_SPEED] = speed;
+  if (used & (1 << INPUT_IN_AH)) {
+    next[INPUT_IN_AH] = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity);
+  }
+  if (used & (1 << INPUT_OUT_AH)) {
+    next[INPUT_OUT_AH] = SensorManagerBase::calculateAbsoluteHumidity(external.temperature, external.humidity);
+  }
+  if (used & ((1 << INPUT_HOUR) | (1 << INPUT_WEEKDAY))) {
+    time_t wall = time(nullptr);
+    if (wall > CLOCK_VALID_EPOCH) {
+      struct tm t;
+      localtime_r(&wall, &t);
+      next[INPUT_HOUR] = t.tm_hour + t.tm_min / 60.0f;
+      next[INPUT_WEEKDAY] = t.tm_wday == 0 ? 7 : t.tm_wday;
+    }
+  }
+
+  // Bitwise, so an input that stays unknown (NaN) counts as unchanged
+  uint16_t changed = 0;
+  for (uint8_t i = 0; i < RULE_INPUTS; i++) {
+    if (memcmp(&next[i], &values[i], sizeof(float)) != 0) changed |= 1 << i;
+  }
+  memcpy(values, next, sizeof(values));
+
+  int match = -1;
+  for (uint8_t i = 0; i < program.getCount(); i++) {
+    if (fresh || (program.getRule(i).inputs & changed)) {
+      results[i] = program.run(i, values);
+      runs++;
+    } else {
+      reuses++;
+    }
+    if (results[i] && match < 0) match = i;
+  }
+  fresh = false;
+  return match;
+}
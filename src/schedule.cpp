@@ -0,0 +1,218 @@
+#include "schedule.h"
+
+static const char* dayNames[] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat" };
+
+static int parseDay(const char* s) {
+  for (int d = 0; d < 7; d++) {
+    if (strncmp(s, dayNames[d], 3) == 0) return d;
+  }
+  return -1;
+}
+
+// "mon", "mon-fri", "fri-mon", "sat,sun", "daily" or "*" to a bit per weekday
+static uint8_t parseDays(const String& spec) {
+  if (spec == "daily" || spec == "*") return 0x7F;
+
+  uint8_t mask = 0;
+  int start = 0;
+  while (start < (int)spec.length()) {
+    int comma = spec.indexOf(',', start);
+    if (comma < 0) comma = spec.length();
+    String part = spec.substring(start, comma);
+    int dash = part.indexOf('-');
+    int from = parseDay(part.c_str());
+    int to = dash > 0 ? parseDay(part.c_str() + dash + 1) : from;
+    if (from < 0 || to < 0) return 0;
+    for (int d = from; ; d = (d + 1) % 7) {
+      mask |= 1 << d;
+      if (d == to) break;
+    }
+    start = comma + 1;
+  }
+  return mask;
+}
+
+static int parseMinutes(const char* s) {
+  int h, m;
+  if (sscanf(s, "%d:%d", &h, &m) != 2 || h < 0 || m < 0 || m > 59) return -1;
+  int minutes = h * 60 + m;
+  return minutes <= 24 * 60 ? minutes : -1;
+}
+
+WeeklySchedule::WeeklySchedule() {
+  clear();
+}
+
+void WeeklySchedule::clear() {
+  memset(bits, 0, sizeof(bits));
+  for (int c = 0; c < SCHEDULE_CLASSES; c++) {
+    for (int i = 0; i < SCHEDULE_MAX_RULES; i++) rules[c][i] = "";
+    ruleCount[c] = 0;
+  }
+  holidayCount = 0;
+  holidayWeekday = 0;  // holidays run on the Sunday schedule
+  cacheFrom = 0;
+  cacheUntil = 0;
+  cached = LIMIT_LOW;
+}
+
+void WeeklySchedule::setDefaults() {
+  clear();
+  addRule(SCHEDULE_HIGH, "mon-thu 00:00-15:00");
+  addRule(SCHEDULE_HIGH, "mon-fri 22:00-24:00");
+}
+
+bool WeeklySchedule::addRule(ScheduleClass cls, const String& rule) {
+  if (ruleCount[cls] >= SCHEDULE_MAX_RULES) {
+    Serial.printf("⚠️ Schedule: too many %s rules, ignoring \"%s\"\n", className(cls), rule.c_str());
+    return false;
+  }
+
+  int space = rule.indexOf(' ');
+  int dash = rule.lastIndexOf('-');
+  uint8_t days = space > 0 ? parseDays(rule.substring(0, space)) : 0;
+  int from = dash > space ? parseMinutes(rule.c_str() + space + 1) : -1;
+  int to = dash > space ? parseMinutes(rule.c_str() + dash + 1) : -1;
+  if (days == 0 || from < 0 || to < 0) {
+    Serial.printf("⚠️ Schedule: cannot parse \"%s\"\n", rule.c_str());
+    return false;
+  }
+
+  int startSlot = from / SCHEDULE_SLOT_MIN;
+  int endSlot = to / SCHEDULE_SLOT_MIN;
+  int count = endSlot > startSlot ? endSlot - startSlot : endSlot + SCHEDULE_SLOTS_PER_DAY - startSlot;
+  setSlots(cls, days, startSlot, count);
+
+  rules[cls][ruleCount[cls]++] = rule;
+  cacheUntil = 0;
+  return true;
+}
+
+void WeeklySchedule::setSlots(ScheduleClass cls, uint8_t dayMask, int startSlot, int slotCount) {
+  for (int d = 0; d < 7; d++) {
+    if (!(dayMask & (1 << d))) continue;
+    for (int i = 0; i < slotCount; i++) {
+      int slot = (d * SCHEDULE_SLOTS_PER_DAY + startSlot + i) % SCHEDULE_SLOTS;
+      bits[cls][slot / 32] |= 1UL << (slot % 32);
+    }
+  }
+}
+
+bool WeeklySchedule::addHoliday(const String& date) {
+  if (holidayCount >= SCHEDULE_MAX_HOLIDAYS) {
+    Serial.printf("⚠️ Schedule: too many holidays, ignoring %s\n", date.c_str());
+    return false;
+  }
+  int y = 0, m, d;
+  if (sscanf(date.c_str(), "%d-%d-%d", &y, &m, &d) != 3) {
+    y = 0;
+    if (sscanf(date.c_str(), "%d-%d", &m, &d) != 2) m = 0;
+  }
+  if (m < 1 || m > 12 || d < 1 || d > 31) {
+    Serial.printf("⚠️ Schedule: cannot parse holiday %s\n", date.c_str());
+    return false;
+  }
+  holidays[holidayCount++] = { (uint16_t)y, (uint8_t)m, (uint8_t)d };
+  cacheUntil = 0;
+  return true;
+}
+
+bool WeeklySchedule::setHolidayWeekday(const String& day) {
+  int d = parseDay(day.c_str());
+  if (d < 0) return false;
+  holidayWeekday = d;
+  cacheUntil = 0;
+  return true;
+}
+
+bool WeeklySchedule::isHoliday(const struct tm& t) const {
+  for (uint8_t i = 0; i < holidayCount; i++) {
+    const Holiday& h = holidays[i];
+    if (h.month == t.tm_mon + 1 && h.day == t.tm_mday &&
+        (h.year == 0 || h.year == t.tm_year + 1900)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+SpeedLimit WeeklySchedule::slotLimit(int slot) const {
+  uint32_t mask = 1UL << (slot % 32);
+  if (bits[SCHEDULE_OFF][slot / 32] & mask) return LIMIT_OFF;
+  if (bits[SCHEDULE_HIGH][slot / 32] & mask) return LIMIT_HIGH;
+  return LIMIT_LOW;
+}
+
+SpeedLimit WeeklySchedule::evaluate(time_t now, time_t& until) const {
+  struct tm t;
+  localtime_r(&now, &t);
+  int day = isHoliday(t) ? holidayWeekday : t.tm_wday;
+  int slot = (t.tm_hour * 60 + t.tm_min) / SCHEDULE_SLOT_MIN;
+  int base = day * SCHEDULE_SLOTS_PER_DAY;
+  SpeedLimit limit = slotLimit(base + slot);
+
+  // The run of equal slots ends at a transition or at midnight, where the
+  // holiday status may change; mktime() keeps this right across DST
+  int end = slot + 1;
+  while (end < SCHEDULE_SLOTS_PER_DAY && slotLimit(base + end) == limit) end++;
+  struct tm boundary = t;
+  boundary.tm_hour = 0;
+  boundary.tm_min = end * SCHEDULE_SLOT_MIN;
+  boundary.tm_sec = 0;
+  boundary.tm_isdst = -1;
+  until = mktime(&boundary);
+  if (until <= now) until = now + 60;
+  return limit;
+}
+
+SpeedLimit WeeklySchedule::limitAt(time_t now) {
+  if (now < cacheFrom || now >= cacheUntil) {
+    cached = evaluate(now, cacheUntil);
+    cacheFrom = now;
+  }
+  return cached;
+}
+
+time_t WeeklySchedule::nextBoundary(time_t now) {
+  limitAt(now);
+  return cacheUntil;
+}
+
+time_t WeeklySchedule::nextChange(time_t now) const {
+  time_t until;
+  SpeedLimit current = evaluate(now, until);
+  time_t horizon = now + 8 * 86400;
+  while (until < horizon) {
+    time_t next;
+    if (evaluate(until, next) != current) return until;
+    until = next;
+  }
+  return 0;
+}
+
+String WeeklySchedule::getHoliday(uint8_t i) const {
+  char buf[16];
+  const Holiday& h = holidays[i];
+  if (h.year) {
+    snprintf(buf, sizeof(buf), "%04u-%02u-%02u", h.year, h.month, h.day);
+  } else {
+    snprintf(buf, sizeof(buf), "%02u-%02u", h.month, h.day);
+  }
+  return String(buf);
+}
+
+String WeeklySchedule::getHolidayWeekday() const {
+  return String(dayNames[holidayWeekday]);
+}
+
+const char* WeeklySchedule::className(ScheduleClass cls) {
+  return cls == SCHEDULE_OFF ? "off" : "high";
+}
+
+const char* WeeklySchedule::limitName(SpeedLimit limit) {
+  switch (limit) {
+    case LIMIT_OFF: return "off";
+    case LIMIT_HIGH: return "high";
+    default: return "low";
+  }
+}
@@ -0,0 +1,364 @@
+#include "sensor_drivers.h"
+
+// BMx280 registers
+#define BMX280_REG_CALIB_TP 0x88
+#define BMX280_REG_CALIB_H1 0xA1
+#define BMX280_REG_CHIP_ID 0xD0
+#define BMX280_REG_RESET 0xE0
+#define BMX280_REG_CALIB_H2 0xE1
+#define BMX280_REG_CTRL_HUM 0xF2
+#define BMX280_REG_CTRL_MEAS 0xF4
+#define BMX280_REG_CONFIG 0xF5
+#define BMX280_REG_DATA 0xF7
+
+// Forced mode, temperature x1, pressure x4, humidity x1, IIR filter off.
+// We sample every few seconds, so the filter and X16 oversampling only cost
+// conversion time and current.
+#define BMX280_CTRL_MEAS_FORCED ((1 << 5) | (3 << 2) | 0x01)
+#define BMX280_CTRL_HUM_X1 0x01
+
+// Shared by AHT20 and SHT4x: CRC-8, polynomial 0x31, init 0xFF
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static bool writeBytes(TwoWire* wire, uint8_t addr, const uint8_t* data, size_t len) {
+  wire->beginTransmission(addr);
+  wire->write(data, len);
+  return wire->endTransmission() == 0;
+}
+
+static bool readBytes(TwoWire* wire, uint8_t addr, uint8_t* data, size_t len) {
+  if (wire->requestFrom(addr, (uint8_t)len) != len) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    data[i] = wire->read();
+  }
+  return true;
+}
+
+// Register pointer write + repeated start + burst read
+static bool readRegs(TwoWire* wire, uint8_t addr, uint8_t reg, uint8_t* data, size_t len) {
+  wire->beginTransmission(addr);
+  wire->write(reg);
+  if (wire->endTransmission(false) != 0) {
+    return false;
+  }
+  return readBytes(wire, addr, data, len);
+}
+
+// ============================================================================
+// Bmx280
+// ============================================================================
+
+Bmx280::Bmx280() : wire(nullptr), addr(0), chipId(0) {
+}
+
+bool Bmx280::begin(TwoWire& w, uint8_t a) {
+  wire = &w;
+  addr = a;
+  chipId = 0;
+
+  uint8_t id;
+  if (!readRegs(wire, addr, BMX280_REG_CHIP_ID, &id, 1)) {
+    return false;
+  }
+  if (id != 0x58 && id != 0x60) {
+    return false;
+  }
+
+  const uint8_t reset[] = {BMX280_REG_RESET, 0xB6};
+  writeBytes(wire, addr, reset, sizeof(reset));
+  delay(5);
+
+  chipId = id;
+  if (!readCalibration()) {
+    chipId = 0;
+    return false;
+  }
+
+  if (hasHumidity()) {
+    const uint8_t ctrlHum[] = {BMX280_REG_CTRL_HUM, BMX280_CTRL_HUM_X1};
+    writeBytes(wire, addr, ctrlHum, sizeof(ctrlHum));
+  }
+
+  // Filter off, stays in sleep mode until trigger()
+  const uint8_t cfg[] = {BMX280_REG_CONFIG, 0x00};
+  return writeBytes(wire, addr, cfg, sizeof(cfg));
+}
+
+bool Bmx280::readCalibration() {
+  uint8_t c[24];
+  if (!readRegs(wire, addr, BMX280_REG_CALIB_TP, c, sizeof(c))) {
+    return false;
+  }
+
+  dig_T1 = (uint16_t)(c[1] << 8 | c[0]);
+  dig_T2 = (int16_t)(c[3] << 8 | c[2]);
+  dig_T3 = (int16_t)(c[5] << 8 | c[4]);
+  dig_P1 = (uint16_t)(c[7] << 8 | c[6]);
+  dig_P2 = (int16_t)(c[9] << 8 | c[8]);
+  dig_P3 = (int16_t)(c[11] << 8 | c[10]);
+  dig_P4 = (int16_t)(c[13] << 8 | c[12]);
+  dig_P5 = (int16_t)(c[15] << 8 | c[14]);
+  dig_P6 = (int16_t)(c[17] << 8 | c[16]);
+  dig_P7 = (int16_t)(c[19] << 8 | c[18]);
+  dig_P8 = (int16_t)(c[21] << 8 | c[20]);
+  dig_P9 = (int16_t)(c[23] << 8 | c[22]);
+
+  if (!hasHumidity()) {
+    return true;
+  }
+
+  uint8_t h[7];
+  if (!readRegs(wire, addr, BMX280_REG_CALIB_H1, &dig_H1, 1) ||
+      !readRegs(wire, addr, BMX280_REG_CALIB_H2, h, sizeof(h))) {
+    return false;
+  }
+
+  dig_H2 = (int16_t)(h[1] << 8 | h[0]);
+  dig_H3 = h[2];
+  dig_H4 = (int16_t)((int8_t)h[3] * 16 | (h[4] & 0x0F));
+  dig_H5 = (int16_t)((int8_t)h[5] * 16 | (h[4] >> 4));
+  dig_H6 = (int8_t)h[6];
+  return true;
+}
+
+uint16_t Bmx280::conversionTimeMs() const {
+  // Datasheet max: 1.25 + 2.3*osrs_t + (2.3*osrs_p + 0.575) [+ (2.3*osrs_h + 0.575)]
+  return hasHumidity() ? 17 : 14;
+}
+
+bool Bmx280::trigger() {
+  if (!chipId) return false;
+  const uint8_t meas[] = {BMX280_REG_CTRL_MEAS, BMX280_CTRL_MEAS_FORCED};
+  return writeBytes(wire, addr, meas, sizeof(meas));
+}
+
+bool Bmx280::read(SensorSample& out, bool withHumidity) {
+  if (!chipId) return false;
+  withHumidity = withHumidity && hasHumidity();
+
+  // One burst: press[3] temp[3] (hum[2])
+  uint8_t d[8];
+  if (!readRegs(wire, addr, BMX280_REG_DATA, d, withHumidity ? 8 : 6)) {
+    return false;
+  }
+
+  int32_t adc_P = (int32_t)((uint32_t)d[0] << 12 | (uint32_t)d[1] << 4 | d[2] >> 4);
+  int32_t adc_T = (int32_t)((uint32_t)d[3] << 12 | (uint32_t)d[4] << 4 | d[5] >> 4);
+  if (adc_T == 0x80000 || adc_P == 0x80000) {
+    return false;  // Measurement skipped / not finished
+  }
+
+  // Bosch reference compensation (datasheet section 4.2.3 / 8.2)
+  int32_t var1 = ((((adc_T >> 3) - ((int32_t)dig_T1 << 1))) * ((int32_t)dig_T2)) >> 11;
+  int32_t var2 = (((((adc_T >> 4) - ((int32_t)dig_T1)) *
+                    ((adc_T >> 4) - ((int32_t)dig_T1))) >> 12) * ((int32_t)dig_T3)) >> 14;
+  int32_t t_fine = var1 + var2;
+  out.temperature = ((t_fine * 5 + 128) >> 8) / 100.0f;
+
+  int64_t p1 = ((int64_t)t_fine) - 128000;
+  int64_t p2 = p1 * p1 * (int64_t)dig_P6;
+  p2 = p2 + ((p1 * (int64_t)dig_P5) * 131072);
+  p2 = p2 + (((int64_t)dig_P4) * 34359738368LL);
+  p1 = ((p1 * p1 * (int64_t)dig_P3) / 256) + ((p1 * (int64_t)dig_P2) * 4096);
+  p1 = ((((int64_t)1) * 140737488355328LL) + p1) * ((int64_t)dig_P1) / 8589934592LL;
+  if (p1 == 0) {
+    return false;
+  }
+  int64_t p = 1048576 - adc_P;
+  p = (((p * 2147483648LL) - p2) * 3125) / p1;
+  p1 = (((int64_t)dig_P9) * (p / 8192) * (p / 8192)) / 33554432;
+  p2 = (((int64_t)dig_P8) * p) / 524288;
+  p = ((p + p1 + p2) / 256) + (((int64_t)dig_P7) * 16);
+  out.pressure = (float)p / 256.0f / 100.0f;
+
+  if (withHumidity) {
+    int32_t adc_H = (int32_t)((uint32_t)d[6] << 8 | d[7]);
+    int32_t v = t_fine - ((int32_t)76800);
+    v = (((((adc_H << 14) - (((int32_t)dig_H4) << 20) - (((int32_t)dig_H5) * v)) +
+           ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)dig_H6)) >> 10) * (((v * ((int32_t)dig_H3)) >> 11) +
+              ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)dig_H2) + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)dig_H1)) >> 4);
+    v = v < 0 ? 0 : v;
+    v = v > 419430400 ? 419430400 : v;
+    out.humidity = (float)(v >> 12) / 1024.0f;
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Sht4x
+// ============================================================================
+
+Sht4x::Sht4x() : wire(nullptr), addr(0) {
+}
+
+bool Sht4x::begin(TwoWire& w, uint8_t a) {
+  wire = &w;
+  addr = a;
+
+  const uint8_t softReset = 0x94;
+  if (!writeBytes(wire, addr, &softReset, 1)) {
+    return false;
+  }
+  delay(2);
+
+  // Serial number read doubles as presence check
+  const uint8_t readSerial = 0x89;
+  uint8_t s[6];
+  if (!writeBytes(wire, addr, &readSerial, 1)) {
+    return false;
+  }
+  delay(1);
+  if (!readBytes(wire, addr, s, sizeof(s))) {
+    return false;
+  }
+  return crc8(s, 2) == s[2] && crc8(s + 3, 2) == s[5];
+}
+
+bool Sht4x::trigger() {
+  const uint8_t measureHighPrecision = 0xFD;
+  return writeBytes(wire, addr, &measureHighPrecision, 1);
+}
+
+bool Sht4x::read(SensorSample& out) {
+  uint8_t d[6];
+  if (!readBytes(wire, addr, d, sizeof(d))) {
+    return false;
+  }
+  if (crc8(d, 2) != d[2] || crc8(d + 3, 2) != d[5]) {
+    return false;
+  }
+
+  uint16_t rawT = (uint16_t)(d[0] << 8 | d[1]);
+  uint16_t rawH = (uint16_t)(d[3] << 8 | d[4]);
+  out.temperature = -45.0f + 175.0f * rawT / 65535.0f;
+  float rh = -6.0f + 125.0f * rawH / 65535.0f;
+  out.humidity = rh < 0.0f ? 0.0f : (rh > 100.0f ? 100.0f : rh);
+  return true;
+}
+
+// ============================================================================
+// Aht20
+// ============================================================================
+
+Aht20::Aht20() : wire(nullptr), addr(0) {
+}
+
+bool Aht20::begin(TwoWire& w, uint8_t a) {
+  wire = &w;
+  addr = a;
+
+  const uint8_t softReset = 0xBA;
+  if (!writeBytes(wire, addr, &softReset, 1)) {
+    return false;
+  }
+  delay(20);
+
+  uint8_t status;
+  if (!readBytes(wire, addr, &status, 1)) {
+    return false;
+  }
+  if (!(status & 0x08)) {
+    const uint8_t calibrate[] = {0xBE, 0x08, 0x00};
+    writeBytes(wire, addr, calibrate, sizeof(calibrate));
+    delay(10);
+  }
+  return true;
+}
+
+bool Aht20::trigger() {
+  const uint8_t measure[] = {0xAC, 0x33, 0x00};
+  return writeBytes(wire, addr, measure, sizeof(measure));
+}
+
+bool Aht20::read(SensorSample& out) {
+  uint8_t d[7];
+  if (!readBytes(wire, addr, d, sizeof(d))) {
+    return false;
+  }
+  if ((d[0] & 0x80) || crc8(d, 6) != d[6]) {
+    return false;  // Still busy or corrupted
+  }
+
+  uint32_t rawH = ((uint32_t)d[1] << 12) | ((uint32_t)d[2] << 4) | (d[3] >> 4);
+  uint32_t rawT = (((uint32_t)d[3] & 0x0F) << 16) | ((uint32_t)d[4] << 8) | d[5];
+  out.humidity = rawH * 100.0f / 1048576.0f;
+  out.temperature = rawT * 200.0f / 1048576.0f - 50.0f;
+  return true;
+}
+
+// ============================================================================
+// Driver combinations
+// ============================================================================
+
+bool AhtBmpDriver::begin(TwoWire& wire, uint8_t bmpAddr) {
+  bmpPresent = bmp.begin(wire, bmpAddr);
+  bool ahtPresent = aht.begin(wire);
+  return ahtPresent && bmpPresent;
+}
+
+bool AhtBmpDriver::sample(SensorSample& out) {
+  // Start both conversions, wait once for the slower one, then burst-read each
+  if (!aht.trigger()) return false;
+  bool bmpTriggered = bmpPresent && bmp.trigger();
+  delay(aht.conversionTimeMs());
+
+  if (!aht.read(out)) return false;
+  out.pressure = 0;
+  if (bmpTriggered) {
+    SensorSample p;
+    if (bmp.read(p, false)) {
+      out.pressure = p.pressure;
+    }
+  }
+  return true;
+}
+
+bool Bme280Driver::begin(TwoWire& wire, uint8_t bmeAddr) {
+  return bme.begin(wire, bmeAddr) && bme.hasHumidity();
+}
+
+bool Bme280Driver::sample(SensorSample& out) {
+  if (!bme.trigger()) return false;
+  delay(bme.conversionTimeMs());
+  return bme.read(out, true);
+}
+
+bool Sht4xBmpDriver::begin(TwoWire& wire, uint8_t bmpAddr) {
+  bmpPresent = bmp.begin(wire, bmpAddr);
+  bool shtPresent = sht.begin(wire);
+  return shtPresent && bmpPresent;
+}
+
+bool Sht4xBmpDriver::sample(SensorSample& out) {
+  if (!sht.trigger()) return false;
+  bool bmpTriggered = bmpPresent && bmp.trigger();
+  uint16_t wait = sht.conversionTimeMs();
+  if (bmpTriggered && bmp.conversionTimeMs() > wait) {
+    wait = bmp.conversionTimeMs();
+  }
+  delay(wait);
+
+  if (!sht.read(out)) return false;
+  out.pressure = 0;
+  if (bmpTriggered) {
+    SensorSample p;
+    if (bmp.read(p, false)) {
+      out.pressure = p.pressure;
+    }
+  }
+  return true;
+}
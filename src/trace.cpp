@@ -0,0 +1,170 @@
+#include "trace.h"
+#include <LittleFS.h>
+#include <time.h>
+
+static int16_t toCenti(float value) {
+  float scaled = value * 100.0f;
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32768.0f) return -32768;
+  return (int16_t)lroundf(scaled);
+}
+
+TraceRecorder::TraceRecorder() {
+  buffered = 0;
+  fileBytes = 0;
+  records = 0;
+  ready = false;
+  lastSample = 0;
+  lastClock = 0;
+  lastFlush = 0;
+  clockValid = false;
+  lastMode = MODE_AUTO;
+  lastSpeed = -1;
+  lastReason = REASON_OFF;
+}
+
+bool TraceRecorder::begin() {
+  File file = LittleFS.open(TRACE_FILE, "r");
+  bool compatible = false;
+  if (file) {
+    TraceHeader header;
+    compatible = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 header.magic == TRACE_MAGIC &&
+                 header.version == TRACE_VERSION &&
+                 header.recordSize == sizeof(TraceRecord);
+    fileBytes = file.size();
+    file.close();
+  }
+
+  if (!compatible && !startFile()) {
+    Serial.println("❌ Trace file could not be created");
+    return false;
+  }
+
+  ready = true;
+  lastMode = currentMode;
+  recordClock(TRACE_BOOT, millis());
+  Serial.printf("✓ Trace recorder ready (%u bytes)\n", (unsigned)fileBytes);
+  return true;
+}
+
+bool TraceRecorder::startFile() {
+  File file = LittleFS.open(TRACE_FILE, "w");
+  if (!file) return false;
+  TraceHeader header = { TRACE_MAGIC, TRACE_VERSION, sizeof(TraceRecord) };
+  file.write((const uint8_t*)&header, sizeof(header));
+  file.close();
+  fileBytes = sizeof(header);
+  return true;
+}
+
+void TraceRecorder::recordClock(uint8_t type, unsigned long now) {
+  time_t epoch = time(nullptr);
+  clockValid = epoch > CLOCK_VALID_EPOCH;
+
+  TraceRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.type = type;
+  rec.ms = now;
+  rec.data.epoch = clockValid ? (uint32_t)epoch : 0;
+  append(rec);
+  lastClock = now;
+}
+
+void TraceRecorder::update(const SensorData& internal, const SensorData& external,
+                           const FanController& fan) {
+  if (!ready) return;
+  unsigned long now = millis();
+
+  // Re-anchor wall time once NTP has synced, then hourly for drift
+  if (now - lastClock >= TRACE_CLOCK_INTERVAL ||
+      (!clockValid && time(nullptr) > CLOCK_VALID_EPOCH)) {
+    recordClock(TRACE_CLOCK, now);
+  }
+
+  bool modeChanged = currentMode != lastMode;
+  bool decisionChanged = fan.getCurrentSpeed() != lastSpeed || fan.getRunReason() != lastReason;
+
+  if (modeChanged) {
+    TraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.type = TRACE_MODE;
+    rec.flags = (uint8_t)currentMode;
+    rec.ms = now;
+    if (manualOverrideUntil > now) {
+      rec.value = (uint16_t)min((manualOverrideUntil - now) / 60000UL, 65535UL);
+    }
+    append(rec);
+    lastMode = currentMode;
+  }
+
+  // Inputs are logged at a reduced rate, and always alongside a change so the
+  // replay sees exactly what the decision saw
+  if (modeChanged || decisionChanged || now - lastSample >= TRACE_SAMPLE_INTERVAL) {
+    TraceRecord rec;
+    rec.type = TRACE_SAMPLE;
+    rec.flags = (internal.valid ? TRACE_INTERNAL_VALID : 0) |
+                (external.valid ? TRACE_EXTERNAL_VALID : 0);
+    rec.value = 0;
+    rec.ms = now;
+    rec.data.centi[0] = toCenti(internal.temperature);
+    rec.data.centi[1] = toCenti(internal.humidity);
+    rec.data.centi[2] = toCenti(external.temperature);
+    rec.data.centi[3] = toCenti(external.humidity);
+    append(rec);
+    lastSample = now;
+  }
+
+  if (decisionChanged) {
+    TraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.type = TRACE_DECISION;
+    rec.flags = (uint8_t)fan.getRunReason();
+    rec.value = (uint16_t)fan.getCurrentSpeed();
+    rec.ms = now;
+    append(rec);
+    lastSpeed = fan.getCurrentSpeed();
+    lastReason = fan.getRunReason();
+  }
+
+  if (now - lastFlush >= TRACE_FLUSH_INTERVAL) {
+    flush();
+  }
+}
+
+void TraceRecorder::append(const TraceRecord& rec) {
+  buffer[buffered++] = rec;
+  records++;
+  if (buffered >= TRACE_BUFFER_RECORDS) {
+    flush();
+  }
+}
+
+void TraceRecorder::flush() {
+  lastFlush = millis();
+  if (!ready || buffered == 0) return;
+
+  size_t bytes = buffered * sizeof(TraceRecord);
+  if (fileBytes + bytes > TRACE_MAX_BYTES) {
+    LittleFS.remove(TRACE_OLD_FILE);
+    LittleFS.rename(TRACE_FILE, TRACE_OLD_FILE);
+    if (!startFile()) {
+      Serial.println("❌ Trace rotation failed");
+      buffered = 0;
+      return;
+    }
+    Serial.println("🔄 Trace rotated");
+  }
+
+  // One append per batch keeps flash wear and LittleFS metadata updates low
+  File file = LittleFS.open(TRACE_FILE, "a");
+  if (!file) {
+    Serial.println("⚠️ Trace append failed");
+    buffered = 0;
+    return;
+  }
+  size_t written = file.write((const uint8_t*)buffer, bytes);
+  file.close();
+  fileBytes += written;
+  buffered = 0;
+}
@@ -0,0 +1,243 @@
+#include "usage.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+
+static const char* reasonKeys[USAGE_REASONS] = {
+  "off", "humidity", "temperature", "both", "forced", "manual", "safety", "rule"
+};
+
+static uint32_t runningSeconds(const UsageCounters& c) {
+  uint32_t seconds = 0;
+  for (int i = 0; i < USAGE_SPEED_BANDS; i++) seconds += c.speedSeconds[i];
+  return seconds;
+}
+
+UsageMeter::UsageMeter() {
+  memset(&total, 0, sizeof(total));
+  memset(days, 0, sizeof(days));
+  memset(months, 0, sizeof(months));
+  dayHead = 0;
+  monthHead = 0;
+  persistent = false;
+  dirty = false;
+  lastUpdate = 0;
+  carryMs = 0;
+  lastSave = 0;
+  lastSpeed = 0;
+  lastReason = REASON_OFF;
+}
+
+void UsageMeter::begin() {
+  persistent = true;
+  lastSave = millis();
+  if (load()) {
+    Serial.printf("✓ Usage counters loaded: %.1f h, %.2f kWh total\n",
+                  runningSeconds(total) / 3600.0f, total.energyWh / 1000.0);
+  }
+}
+
+float UsageMeter::fanWatts(int speed) {
+  if (speed <= 0 || config.power_points == 0) return 0;
+
+  // Piecewise linear between the configured points, flat beyond them
+  const uint8_t n = config.power_points;
+  if (speed <= config.power_speed[0]) return config.power_watts[0];
+  for (uint8_t i = 1; i < n; i++) {
+    if (speed <= config.power_speed[i]) {
+      float t = (float)(speed - config.power_speed[i - 1]) /
+                (config.power_speed[i] - config.power_speed[i - 1]);
+      return config.power_watts[i - 1] + t * (config.power_watts[i] - config.power_watts[i - 1]);
+    }
+  }
+  return config.power_watts[n - 1];
+}
+
+void UsageMeter::add(UsageCounters& c, uint32_t seconds, double wh, double water) const {
+  c.reasonSeconds[lastReason % USAGE_REASONS] += seconds;
+  c.speedSeconds[constrain((lastSpeed - 1) / 10, 0, USAGE_SPEED_BANDS - 1)] += seconds;
+  c.energyWh += wh;
+  c.waterG += water;
+}
+
+void UsageMeter::countStart() {
+  total.starts++;
+  if (days[dayHead].key) days[dayHead].counters.starts++;
+  if (months[monthHead].key) months[monthHead].counters.starts++;
+}
+
+bool UsageMeter::rollover(time_t now) {
+  struct tm t;
+  localtime_r(&now, &t);
+  uint32_t month = (t.tm_year + 1900) * 100 + t.tm_mon + 1;
+  uint32_t day = month * 100 + t.tm_mday;
+  bool changed = false;
+
+  if (days[dayHead].key != day) {
+    if (days[dayHead].key) dayHead = (dayHead + 1) % USAGE_DAYS;
+    memset(&days[dayHead], 0, sizeof(UsagePeriod));
+    days[dayHead].key = day;
+    changed = true;
+  }
+  if (months[monthHead].key != month) {
+    if (months[monthHead].key) monthHead = (monthHead + 1) % USAGE_MONTHS;
+    memset(&months[monthHead], 0, sizeof(UsagePeriod));
+    months[monthHead].key = month;
+    changed = true;
+  }
+  return changed;
+}
+
+void UsageMeter::update(const SensorData& internal, const SensorData& external,
+                        const FanController& fan) {
+  unsigned long now = millis();
+  unsigned long elapsed = now - lastUpdate + carryMs;
+  lastUpdate = now;
+  uint32_t seconds = elapsed / 1000;
+  carryMs = elapsed % 1000;
+
+  // The interval since the last decision ran in the state chosen then
+  if (lastSpeed > 0 && seconds > 0) {
+    double hours = seconds / 3600.0;
+    double wh = fanWatts(lastSpeed) * hours;
+    double water = 0;
+    if (internal.valid && external.valid) {
+      float gap = SensorManagerBase::calculateAbsoluteHumidity(internal.temperature, internal.humidity) -
+                  SensorManagerBase::calculateAbsoluteHumidity(external.temperature, external.humidity);
+      water = config.airflow_m3h * lastSpeed / 100.0 * gap * hours;
+    }
+    add(total, seconds, wh, water);
+    if (days[dayHead].key) add(days[dayHead].counters, seconds, wh, water);
+    if (months[monthHead].key) add(months[monthHead].counters, seconds, wh, water);
+    dirty = true;
+  }
+
+  // Periods need the wall clock; until NTP syncs only the total counts
+  time_t wall = time(nullptr);
+  bool newPeriod = wall > CLOCK_VALID_EPOCH && rollover(wall);
+
+  int speed = fan.getCurrentSpeed();
+  if (speed > 0 && lastSpeed == 0) {
+    countStart();
+    dirty = true;
+  }
+  lastSpeed = speed;
+  lastReason = fan.getRunReason();
+
+  if (persistent && dirty && (newPeriod || now - lastSave >= USAGE_SAVE_INTERVAL)) {
+    save();
+  }
+}
+
+void UsageMeter::flush() {
+  if (persistent && dirty) save();
+}
+
+static void countersJSON(JsonObject obj, const UsageCounters& c, bool detail) {
+  obj["runtime_h"] = runningSeconds(c) / 3600.0f;
+  obj["energy_kwh"] = c.energyWh / 1000.0;
+  obj["water_kg"] = c.waterG / 1000.0;
+  obj["starts"] = c.starts;
+  if (!detail) return;
+
+  JsonObject reasons = obj["by_reason"].to<JsonObject>();
+  for (int i = 0; i < USAGE_REASONS; i++) {
+    if (c.reasonSeconds[i]) reasons[reasonKeys[i]] = c.reasonSeconds[i] / 3600.0f;
+  }
+  JsonObject speeds = obj["by_speed"].to<JsonObject>();
+  for (int i = 0; i < USAGE_SPEED_BANDS; i++) {
+    if (!c.speedSeconds[i]) continue;
+    char band[8];
+    snprintf(band, sizeof(band), "%d-%d", i * 10 + 1, (i + 1) * 10);
+    speeds[band] = c.speedSeconds[i] / 3600.0f;
+  }
+}
+
+String UsageMeter::getJSON(bool history) const {
+  JsonDocument doc;
+  if (history) {
+    // Newest first
+    JsonArray dayList = doc["days"].to<JsonArray>();
+    for (int i = 0; i < USAGE_DAYS; i++) {
+      const UsagePeriod& p = days[(dayHead + USAGE_DAYS - i) % USAGE_DAYS];
+      if (!p.key) break;
+      JsonObject entry = dayList.add<JsonObject>();
+      entry["day"] = p.key;
+      countersJSON(entry, p.counters, false);
+    }
+    JsonArray monthList = doc["months"].to<JsonArray>();
+    for (int i = 0; i < USAGE_MONTHS; i++) {
+      const UsagePeriod& p = months[(monthHead + USAGE_MONTHS - i) % USAGE_MONTHS];
+      if (!p.key) break;
+      JsonObject entry = monthList.add<JsonObject>();
+      entry["month"] = p.key;
+      countersJSON(entry, p.counters, false);
+    }
+  } else {
+    countersJSON(doc["total"].to<JsonObject>(), total, true);
+    if (days[dayHead].key) {
+      doc["today"]["day"] = days[dayHead].key;
+      countersJSON(doc["today"].as<JsonObject>(), days[dayHead].counters, true);
+    }
+    if (months[monthHead].key) {
+      doc["month"]["month"] = months[monthHead].key;
+      countersJSON(doc["month"].as<JsonObject>(), months[monthHead].counters, true);
+    }
+  }
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+String UsageMeter::getSummaryJSON() const {
+  JsonDocument doc;
+  countersJSON(doc["total"].to<JsonObject>(), total, false);
+  if (days[dayHead].key) countersJSON(doc["today"].to<JsonObject>(), days[dayHead].counters, false);
+  if (months[monthHead].key) countersJSON(doc["month"].to<JsonObject>(), months[monthHead].counters, false);
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+bool UsageMeter::load() {
+  if (!LittleFS.exists(USAGE_FILE)) return false;
+  File file = LittleFS.open(USAGE_FILE, "r");
+  if (!file) return false;
+
+  uint32_t magic = 0;
+  bool ok = file.size() == sizeof(magic) + sizeof(total) + sizeof(days) + sizeof(months) + 2 &&
+            file.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic) && magic == USAGE_MAGIC;
+  if (ok) {
+    file.read((uint8_t*)&total, sizeof(total));
+    file.read((uint8_t*)days, sizeof(days));
+    file.read((uint8_t*)months, sizeof(months));
+    file.read(&dayHead, 1);
+    file.read(&monthHead, 1);
+    dayHead %= USAGE_DAYS;
+    monthHead %= USAGE_MONTHS;
+  } else {
+    Serial.println("⚠️ " USAGE_FILE " has an unknown format, starting over");
+  }
+  file.close();
+  return ok;
+}
+
+bool UsageMeter::save() {
+  lastSave = millis();
+  File file = LittleFS.open(USAGE_FILE, "w");
+  if (!file) {
+    Serial.println("❌ Failed to open " USAGE_FILE " for writing");
+    return false;
+  }
+  uint32_t magic = USAGE_MAGIC;
+  file.write((const uint8_t*)&magic, sizeof(magic));
+  file.write((const uint8_t*)&total, sizeof(total));
+  file.write((const uint8_t*)days, sizeof(days));
+  file.write((const uint8_t*)months, sizeof(months));
+  file.write(&dayHead, 1);
+  file.write(&monthHead, 1);
+  file.close();
+  dirty = false;
+  return true;
+}
@@ -1,10 +1,46 @@
 #include "webserver.h"
+#include <LittleFS.h>
+#include "trace.h"
+#include "journal.h"
+#include "history.h"
+#include "dashboard.h"
+#include <memory>
 
-WebServerManager::WebServerManager(SensorManager& sensors, FanController& fan)
-  : server(80), sensorManager(sensors), fanController(fan) {
+// The page only changes with a firmware update: browsers keep it but check
+// the ETag on every visit, which costs a 304 without the body
+#define DASHBOARD_CACHE_CONTROL "no-cache"
+
+WebServerManager::WebServerManager(SensorManager& sensors, FanController& fan,
+                                   OverrideManager& overrides, const VentilationPlanner& planner,
+                                   const EfficiencyEstimator& efficiency, const UsageMeter& usage,
+                                   ZoneManager& zones, CommandQueue& commands, OtaUpdater& ota)
+  : server(80), events("/api/events"), sensorManager(sensors), fanController(fan),
+    overrideManager(overrides), planner(planner), efficiency(efficiency), usage(usage), zones(zones),
+    commands(commands), ota(ota) {
+  eventsLock = xSemaphoreCreateRecursiveMutex();
+  eventClientCount = 0;
+  memset(sectionHash, 0, sizeof(sectionHash));
+  eventId = 0;
+  
+  statusLock = xSemaphoreCreateMutex();
+  statusJSON[0] = '\0';
+  statusLength = 0;
+  statusVersion = 0;
+  statusTag = random(0x7FFFFFFF);
+  lastSystemRefresh = 0;
+  systemRssi = 0;
+  systemUptime = 0;
+  systemHeap = 0;
+  lastOtaEvent = 0;
+  
+  metricsSources.sensors = &sensors;
+  metricsSources.fan = &fan;
+  metricsSources.mqtt = nullptr;
+  metricsSources.loop = nullptr;
 }
 
 void WebServerManager::begin() {
+  update();   // first snapshot, before any request
   setupRoutes();
   server.begin();
   Serial.println("✓ Web server started on port 80");
@@ -13,384 +49,265 @@ void WebServerManager::begin() {
 }
 
 void WebServerManager::setupRoutes() {
-  // Main page
+  // Main page: web/index.html, gzipped into flash at build time
   server.on("/", HTTP_GET, [this](AsyncWebServerRequest *request){
-    request->send(200, "text/html", getMainHTML());
+    handleDashboard(request);
   });
   
   // API: Get status
   server.on("/api/status", HTTP_GET, [this](AsyncWebServerRequest *request){
-    request->send(200, "application/json", getStatusJSON());
+    handleStatus(request);
+  });
+  
+  // Push channel for the dashboard (see publishEvents)
+  events.onConnect([this](AsyncEventSourceClient *client){
+    xSemaphoreTakeRecursive(eventsLock, portMAX_DELAY);
+    bool full = eventClientCount >= EVENTS_MAX_CLIENTS;
+    if (!full) eventClients[eventClientCount++] = client;
+    xSemaphoreGiveRecursive(eventsLock);
+    if (full) {
+      client->close();
+      return;
+    }
+    client->send(getStatusJSON().c_str(), "status", eventId);
+  });
+  events.onDisconnect([this](AsyncEventSourceClient *client){
+    xSemaphoreTakeRecursive(eventsLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < eventClientCount; i++) {
+      if (eventClients[i] == client) {
+        eventClients[i] = eventClients[--eventClientCount];
+        break;
+      }
+    }
+    xSemaphoreGiveRecursive(eventsLock);
   });
+  server.addHandler(&events);
   
-  // API: Get config
+  // API: Get config (all of config.json except passwords)
   server.on("/api/config", HTTP_GET, [this](AsyncWebServerRequest *request){
     request->send(200, "application/json", getConfigJSON());
   });
   
+  // API: Get compiled speed schedule
+  server.on("/api/schedule", HTTP_GET, [this](AsyncWebServerRequest *request){
+    request->send(200, "application/json", getScheduleJSON());
+  });
+  
+  // API: Site rules, their bytecode size and which one decides now
+  server.on("/api/rules", HTTP_GET, [this](AsyncWebServerRequest *request){
+    request->send(200, "application/json", getRulesJSON());
+  });
+  
+  // API: Learned moisture model and the day-ahead ventilation plan
+  server.on("/api/plan", HTTP_GET, [this](AsyncWebServerRequest *request){
+    request->send(200, "application/json", planner.getJSON());
+  });
+  
+  // API: Measured run efficiency fits (adaptive differentials)
+  server.on("/api/efficiency", HTTP_GET, [this](AsyncWebServerRequest *request){
+    request->send(200, "application/json", efficiency.getJSON());
+  });
+  
+  // API: Runtime, energy and water removed (?history=1 for days and months)
+  server.on("/api/usage", HTTP_GET, [this](AsyncWebServerRequest *request){
+    bool history = request->hasParam("history") && request->getParam("history")->value() != "0";
+    request->send(200, "application/json", usage.getJSON(history));
+  });
+  
   // API: Set mode
   server.on("/api/mode", HTTP_POST, [this](AsyncWebServerRequest *request){
     handleSetMode(request);
   });
   
-  // API: Set config
+  // API: Set config (form: target_temp, target_humidity)
   server.on("/api/config", HTTP_POST, [this](AsyncWebServerRequest *request){
     handleSetConfig(request);
   });
   
+  // API: Change any settings with a JSON body shaped like config.json
+  server.on("/api/config", HTTP_PATCH,
+    [this](AsyncWebServerRequest *request){
+      handlePatchConfig(request);
+    },
+    nullptr,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+      // Assembled in _tempObject, which the server frees with the request
+      if (total > CONFIG_PATCH_MAX) return;
+      if (index == 0) {
+        request->_tempObject = malloc(total + 1);
+        if (!request->_tempObject) return;
+      }
+      if (!request->_tempObject || index + len > total) return;
+      char *body = (char *)request->_tempObject;
+      memcpy(body + index, data, len);
+      if (index + len == total) body[total] = '\0';
+    }
+  );
+  
   // API: Manual speed control
   server.on("/api/speed", HTTP_POST, [this](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
-      int speed = request->getParam("value", true)->value().toInt();
-      fanController.setManualSpeed(speed);
-      request->send(200, "application/json", "{\"success\":true}");
+      Command cmd = {};
+      cmd.type = CMD_SET_SPEED;
+      cmd.speed = constrain(request->getParam("value", true)->value().toInt(), 0L, 100L);
+      sendCommand(request, cmd);
     } else {
       request->send(400, "application/json", "{\"error\":\"Missing value parameter\"}");
     }
   });
   
-  // OTA Upload
+  // API: All fans (zone 0 is the main fan) and a manual mode per zone
+  server.on("/api/zones", HTTP_GET, [this](AsyncWebServerRequest *request){
+    request->send(200, "application/json", zones.getJSON());
+  });
+  
+  // API: Outcome of a queued mode, speed or override command by its ticket
+  server.on("/api/commands", HTTP_GET, [this](AsyncWebServerRequest *request){
+    handleGetCommand(request);
+  });
+  
+  server.on("/api/zones/mode", HTTP_POST, [this](AsyncWebServerRequest *request){
+    handleSetZoneMode(request);
+  });
+  
+  // API: Scheduled overrides (list, add, cancel by ?id= or ?id=all)
+  server.on("/api/overrides", HTTP_GET, [this](AsyncWebServerRequest *request){
+    request->send(200, "application/json", overrideManager.getJSON());
+  });
+  
+  server.on("/api/overrides", HTTP_POST, [this](AsyncWebServerRequest *request){
+    handleAddOverride(request);
+  });
+  
+  server.on("/api/overrides", HTTP_DELETE, [this](AsyncWebServerRequest *request){
+    handleCancelOverride(request);
+  });
+  
+  // API: Download decision trace for host replay (?old=1 for the rotated file)
+  server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request){
+    const char* path = request->hasParam("old") ? TRACE_OLD_FILE : TRACE_FILE;
+    if (!LittleFS.exists(path)) {
+      request->send(404, "application/json", "{\"error\":\"No trace recorded\"}");
+      return;
+    }
+    request->send(LittleFS, path, "application/octet-stream", true);
+  });
+  
+  // API: Decision journal by time range (?from=&to= epoch or local time, &limit=)
+  server.on("/api/journal", HTTP_GET, [this](AsyncWebServerRequest *request){
+    handleJournal(request);
+  });
+  
+  // API: Sensor and fan history from the trace, aggregated per step
+  // (?from=&to= epoch or local time, &step= s, &fields=, &format=csv|bin)
+  server.on("/api/history", HTTP_GET, [this](AsyncWebServerRequest *request){
+    handleHistory(request);
+  });
+  
+  // Prometheus scrape target (see metrics.h)
+  server.on("/metrics", HTTP_GET, [this](AsyncWebServerRequest *request){
+    handleMetrics(request);
+  });
+  
+  // Firmware upload (see ota.h); progress also as "ota" events
   server.on("/update", HTTP_POST, 
-    [](AsyncWebServerRequest *request){
-      bool shouldReboot = !Update.hasError();
-      AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", 
-        shouldReboot ? "OK - Rebooting..." : "FAIL");
-      response->addHeader("Connection", "close");
-      request->send(response);
-      if (shouldReboot) {
-        delay(1000);
-        ESP.restart();
-      }
+    [this](AsyncWebServerRequest *request){
+      handleOTAResult(request);
     },
     [this](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final){
       handleOTAUpload(request, filename, index, data, len, final);
     }
   );
   
+  // API: Progress of the running or last firmware upload
+  server.on("/api/ota", HTTP_GET, [this](AsyncWebServerRequest *request){
+    char json[OTA_JSON_MAX];
+    ota.formatJSON(json, sizeof(json));
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  });
+  
   // 404 handler
   server.onNotFound([](AsyncWebServerRequest *request){
     request->send(404, "text/plain", "Not found");
   });
 }
 
-String WebServerManager::getMainHTML() const {
-  String html = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-  <meta charset="UTF-8">
-  <meta name="viewport" content="width=device-width, initial-scale=1.0">
-  <title>Cellar Ventilation Control</title>
-  <style>
-    * { margin: 0; padding: 0; box-sizing: border-box; }
-    body { 
-      font-family: Arial, sans-serif; 
-      background: linear-gradient(135deg, #667eea 0%, #764ba2 100%);
-      min-height: 100vh;
-      padding: 20px;
-    }
-    .container { 
-      max-width: 800px; 
-      margin: 0 auto; 
-      background: white;
-      border-radius: 15px;
-      box-shadow: 0 10px 40px rgba(0,0,0,0.2);
-      overflow: hidden;
-    }
-    .header {
-      background: linear-gradient(135deg, #667eea 0%, #764ba2 100%);
-      color: white;
-      padding: 30px;
-      text-align: center;
-    }
-    .header h1 { font-size: 28px; margin-bottom: 5px; }
-    .header p { opacity: 0.9; font-size: 14px; }
-    .content { padding: 20px; }
-    .card {
-      background: #f8f9fa;
-      border-radius: 10px;
-      padding: 20px;
-      margin-bottom: 20px;
-      border-left: 4px solid #667eea;
-    }
-    .card h2 {
-      font-size: 18px;
-      margin-bottom: 15px;
-      color: #333;
-    }
-    .sensor-grid {
-      display: grid;
-      grid-template-columns: repeat(auto-fit, minmax(200px, 1fr));
-      gap: 15px;
-      margin-top: 10px;
-    }
-    .sensor-item {
-      background: white;
-      padding: 15px;
-      border-radius: 8px;
-      text-align: center;
-    }
-    .sensor-label {
-      font-size: 12px;
-      color: #666;
-      text-transform: uppercase;
-      margin-bottom: 5px;
-    }
-    .sensor-value {
-      font-size: 24px;
-      font-weight: bold;
-      color: #667eea;
-    }
-    .sensor-unit {
-      font-size: 14px;
-      color: #999;
-    }
-    .fan-status {
-      display: flex;
-      align-items: center;
-      justify-content: space-between;
-      background: white;
-      padding: 20px;
-      border-radius: 8px;
-      margin-top: 10px;
-    }
-    .fan-status.on { border-left: 4px solid #28a745; }
-    .fan-status.off { border-left: 4px solid #dc3545; }
-    .status-indicator {
-      width: 20px;
-      height: 20px;
-      border-radius: 50%;
-      margin-right: 10px;
-    }
-    .status-on { background: #28a745; animation: pulse 2s infinite; }
-    .status-off { background: #dc3545; }
-    @keyframes pulse {
-      0%, 100% { opacity: 1; }
-      50% { opacity: 0.5; }
-    }
-    .controls {
-      display: grid;
-      grid-template-columns: repeat(auto-fit, minmax(150px, 1fr));
-      gap: 10px;
-      margin-top: 15px;
-    }
-    button {
-      padding: 12px 20px;
-      border: none;
-      border-radius: 8px;
-      font-size: 14px;
-      font-weight: bold;
-      cursor: pointer;
-      transition: all 0.3s;
-    }
-    .btn-primary {
-      background: #667eea;
-      color: white;
-    }
-    .btn-primary:hover {
-      background: #5568d3;
-      transform: translateY(-2px);
-    }
-    .btn-success {
-      background: #28a745;
-      color: white;
-    }
-    .btn-warning {
-      background: #ffc107;
-      color: #333;
-    }
-    .btn-danger {
-      background: #dc3545;
-      color: white;
-    }
-    button:disabled {
-      opacity: 0.5;
-      cursor: not-allowed;
-    }
-    .footer {
-      text-align: center;
-      padding: 20px;
-      color: #666;
-      font-size: 12px;
-    }
-    .update-time {
-      text-align: right;
-      color: #999;
-      font-size: 12px;
-      margin-top: 10px;
-    }
-  </style>
-</head>
-<body>
-  <div class="container">
-    <div class="header">
-      <h1>🌡️ Cellar Ventilation Control</h1>
-      <p>Smart Climate Management System</p>
-    </div>
-    
-    <div class="content">
-      <!-- Sensor Data Card -->
-      <div class="card">
-        <h2>📊 Environmental Conditions</h2>
-        <div class="sensor-grid">
-          <div class="sensor-item">
-            <div class="sensor-label">Internal Temp</div>
-            <div class="sensor-value" id="temp-in">--</div>
-            <div class="sensor-unit">°C</div>
-          </div>
-          <div class="sensor-item">
-            <div class="sensor-label">Internal Humidity</div>
-            <div class="sensor-value" id="humid-in">--</div>
-            <div class="sensor-unit">%</div>
-          </div>
-          <div class="sensor-item">
-            <div class="sensor-label">External Temp</div>
-            <div class="sensor-value" id="temp-out">--</div>
-            <div class="sensor-unit">°C</div>
-          </div>
-          <div class="sensor-item">
-            <div class="sensor-label">External Humidity</div>
-            <div class="sensor-value" id="humid-out">--</div>
-            <div class="sensor-unit">%</div>
-          </div>
-        </div>
-        <div class="update-time">Last update: <span id="last-update">--</span></div>
-      </div>
-      
-      <!-- Fan Status Card -->
-      <div class="card">
-        <h2>💨 Fan Status</h2>
-        <div class="fan-status" id="fan-status">
-          <div style="display: flex; align-items: center;">
-            <div class="status-indicator" id="status-led"></div>
-            <div>
-              <div style="font-weight: bold; font-size: 18px;" id="fan-state">--</div>
-              <div style="color: #666; font-size: 14px;" id="fan-reason">--</div>
-            </div>
-          </div>
-          <div style="font-size: 32px; font-weight: bold; color: #667eea;" id="fan-speed">--%</div>
-        </div>
-      </div>
-      
-      <!-- Control Card -->
-      <div class="card">
-        <h2>🎛️ Manual Control</h2>
-        <div style="margin-bottom: 10px; color: #666; font-size: 14px;">
-          Current Mode: <strong id="current-mode">AUTO</strong>
-        </div>
-        <div class="controls">
-          <button class="btn-primary" onclick="setMode('auto')">AUTO</button>
-          <button class="btn-danger" onclick="setMode('off')">OFF</button>
-          <button class="btn-warning" onclick="setMode('low')">LOW (60%)</button>
-          <button class="btn-success" onclick="setMode('high')">HIGH (100%)</button>
-        </div>
-      </div>
-      
-      <!-- Info Card -->
-      <div class="card">
-        <h2>ℹ️ System Information</h2>
-        <div style="display: grid; gap: 10px; font-size: 14px;">
-          <div style="display: flex; justify-content: space-between;">
-            <span>WiFi Signal:</span>
-            <strong id="wifi-signal">--</strong>
-          </div>
-          <div style="display: flex; justify-content: space-between;">
-            <span>Uptime:</span>
-            <strong id="uptime">--</strong>
-          </div>
-          <div style="display: flex; justify-content: space-between;">
-            <span>Free Memory:</span>
-            <strong id="free-mem">--</strong>
-          </div>
-        </div>
-      </div>
-    </div>
-    
-    <div class="footer">
-      Smart Cellar Ventilation System v1.0.0
-    </div>
-  </div>
-
-  <script>
-    function updateData() {
-      fetch('/api/status')
-        .then(response => response.json())
-        .then(data => {
-          // Update sensors
-          document.getElementById('temp-in').textContent = data.internal.temperature.toFixed(1);
-          document.getElementById('humid-in').textContent = Math.round(data.internal.humidity);
-          document.getElementById('temp-out').textContent = data.external.temperature.toFixed(1);
-          document.getElementById('humid-out').textContent = Math.round(data.external.humidity);
-          
-          // Update fan status
-          const fanStatus = document.getElementById('fan-status');
-          const statusLed = document.getElementById('status-led');
-          
-          if (data.fan.speed > 0) {
-            fanStatus.className = 'fan-status on';
-            statusLed.className = 'status-indicator status-on';
-            document.getElementById('fan-state').textContent = 'RUNNING';
-          } else {
-            fanStatus.className = 'fan-status off';
-            statusLed.className = 'status-indicator status-off';
-            document.getElementById('fan-state').textContent = 'STOPPED';
-          }
-          
-          document.getElementById('fan-speed').textContent = data.fan.speed + '%';
-          document.getElementById('fan-reason').textContent = data.fan.reason;
-          document.getElementById('current-mode').textContent = data.mode;
-          
-          // Update system info
-          document.getElementById('wifi-signal').textContent = data.wifi_rssi + ' dBm';
-          document.getElementById('uptime').textContent = formatUptime(data.uptime);
-          document.getElementById('free-mem').textContent = Math.round(data.free_heap / 1024) + ' KB';
-          document.getElementById('last-update').textContent = new Date().toLocaleTimeString();
-        })
-        .catch(error => console.error('Error:', error));
-    }
-    
-    function setMode(mode) {
-      const formData = new FormData();
-      formData.append('mode', mode);
-      formData.append('duration', mode === 'auto' ? '0' : '60');
-      
-      fetch('/api/mode', {
-        method: 'POST',
-        body: formData
-      })
-      .then(response => response.json())
-      .then(data => {
-        if (data.success) {
-          updateData();
-        }
-      })
-      .catch(error => console.error('Error:', error));
-    }
-    
-    function formatUptime(seconds) {
-      const days = Math.floor(seconds / 86400);
-      const hours = Math.floor((seconds % 86400) / 3600);
-      const minutes = Math.floor((seconds % 3600) / 60);
-      
-      if (days > 0) return `${days}d ${hours}h`;
-      if (hours > 0) return `${hours}h ${minutes}m`;
-      return `${minutes}m`;
-    }
-    
-    // Update every 3 seconds
-    setInterval(updateData, 3000);
-    updateData();
-  </script>
-</body>
-</html>
-  )rawliteral";
-  
-  return html;
+void WebServerManager::handleDashboard(AsyncWebServerRequest *request) {
+  // If-None-Match may list several tags or mark ours weak (W/"...")
+  if (request->hasHeader("If-None-Match") &&
+      request->header("If-None-Match").indexOf(DASHBOARD_ETAG) >= 0) {
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", DASHBOARD_ETAG);
+    response->addHeader("Cache-Control", DASHBOARD_CACHE_CONTROL);
+    request->send(response);
+    return;
+  }
+  
+  // Streamed straight from flash, no heap copy of the page
+  AsyncWebServerResponse *response =
+      request->beginResponse(200, "text/html", DASHBOARD_GZ, DASHBOARD_GZ_LEN);
+  response->addHeader("Content-Encoding", "gzip");
+  response->addHeader("ETag", DASHBOARD_ETAG);
+  response->addHeader("Cache-Control", DASHBOARD_CACHE_CONTROL);
+  request->send(response);
 }
 
 String WebServerManager::getStatusJSON() const {
+  xSemaphoreTake(statusLock, portMAX_DELAY);
+  String output(statusJSON);
+  xSemaphoreGive(statusLock);
+  return output;
+}
+
+void WebServerManager::handleStatus(AsyncWebServerRequest *request) {
+  char etag[24];
+  xSemaphoreTake(statusLock, portMAX_DELAY);
+  snprintf(etag, sizeof(etag), "\"%08lx-%lu\"", (unsigned long)statusTag, (unsigned long)statusVersion);
+  bool unchanged = request->hasHeader("If-None-Match") &&
+                   request->header("If-None-Match").indexOf(etag) >= 0;
+  // The response owns a copy: the snapshot may change while it is sent
+  String body = unchanged ? String() : String(statusJSON);
+  xSemaphoreGive(statusLock);
+  
+  AsyncWebServerResponse *response = unchanged ? request->beginResponse(304) :
+      request->beginResponse(200, "application/json", body);
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+void WebServerManager::update() {
+  unsigned long now = millis();
+  bool system = statusVersion == 0 || now - lastSystemRefresh >= STATUS_SYSTEM_INTERVAL;
+  if (system) {
+    lastSystemRefresh = now;
+    systemRssi = WiFi.RSSI();
+    systemUptime = now / 1000;
+    systemHeap = ESP.getFreeHeap();
+  }
+  
   JsonDocument doc;
+  buildStatus(doc);
+  char next[STATUS_JSON_MAX];
+  size_t length = serializeJson(doc, next, sizeof(next));
+  if (length >= sizeof(next) - 1) {
+    Serial.println("⚠️ Status JSON does not fit STATUS_JSON_MAX");
+    return;
+  }
+  if (length != statusLength || memcmp(next, statusJSON, length) != 0) {
+    xSemaphoreTake(statusLock, portMAX_DELAY);
+    memcpy(statusJSON, next, length + 1);
+    statusLength = length;
+    statusVersion++;
+    xSemaphoreGive(statusLock);
+  }
   
+  publishEvents(doc, system);
+}
+
+void WebServerManager::buildStatus(JsonDocument& doc) const {
   SensorData internal = sensorManager.getInternalData();
   SensorData external = sensorManager.getExternalData();
   
@@ -408,28 +325,143 @@ String WebServerManager::getStatusJSON() const {
   
   doc["fan"]["speed"] = fanController.getCurrentSpeed();
   doc["fan"]["reason"] = fanController.getStatusText();
+  doc["fan"]["gate"] = FanController::gateName(fanController.getGate());
+  if (fanController.getActiveRule() >= 0) {
+    doc["fan"]["rule"] = config.rules.getRule(fanController.getActiveRule()).name;
+  }
   
   const char* modeNames[] = {"AUTO", "MANUAL_OFF", "MANUAL_LOW", "MANUAL_HIGH", "DIAGNOSTIC"};
   doc["mode"] = modeNames[currentMode];
   
-  doc["wifi_rssi"] = WiFi.RSSI();
-  doc["uptime"] = millis() / 1000;
-  doc["free_heap"] = ESP.getFreeHeap();
+  doc["wifi_rssi"] = systemRssi;
+  doc["uptime"] = systemUptime;
+  doc["free_heap"] = systemHeap;
+}
+
+static uint32_t fnv1a(const char* data, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+void WebServerManager::publishEvents(JsonDocument& doc, bool system) {
+  // Sections are compared by a hash of their JSON, not kept as text. The
+  // hashes follow every update, listened to or not: a client connecting
+  // later gets the current status, and the next delta has to be against it.
+  static const char* sections[EVENTS_SECTIONS] = {"internal", "external", "fan", "mode"};
+  bool listening = eventClientCount > 0;
+  JsonDocument delta;
+  for (int i = 0; i < EVENTS_SECTIONS; i++) {
+    char buf[256];
+    size_t len = serializeJson(doc[sections[i]], buf, sizeof(buf));
+    uint32_t hash = fnv1a(buf, len);
+    if (hash != sectionHash[i]) {
+      sectionHash[i] = hash;
+      if (listening) delta[sections[i]] = doc[sections[i]];
+    }
+  }
+  if (!listening) return;
+  
+  if (system) {
+    delta["wifi_rssi"] = doc["wifi_rssi"];
+    delta["uptime"] = doc["uptime"];
+    delta["free_heap"] = doc["free_heap"];
+  }
+  if (delta.size() == 0) return;
+  
+  dropSlowClients();
+  String message;
+  serializeJson(delta, message);
+  events.send(message.c_str(), "delta", ++eventId);
+}
+
+void WebServerManager::dropSlowClients() {
+  xSemaphoreTakeRecursive(eventsLock, portMAX_DELAY);
+  // close() may run onDisconnect right here, which moves the last entry into
+  // the closed one's place; going backwards, that entry was already checked
+  for (int i = eventClientCount - 1; i >= 0; i--) {
+    if (i < eventClientCount && eventClients[i]->packetsWaiting() >= EVENTS_CLIENT_BACKLOG) {
+      Serial.println("⚠️ Event stream client too slow, disconnecting");
+      eventClients[i]->close();
+    }
+  }
+  xSemaphoreGiveRecursive(eventsLock);
+}
+
+String WebServerManager::getConfigJSON() const {
+  JsonDocument doc;
+  buildConfigJSON(doc, false);
   
   String output;
   serializeJson(doc, output);
   return output;
 }
 
-String WebServerManager::getConfigJSON() const {
+String WebServerManager::getRulesJSON() const {
   JsonDocument doc;
+  const RuleEngine& engine = fanController.getRuleEngine();
   
-  doc["target_temp"] = config.target_temp;
-  doc["target_humidity"] = config.target_humidity;
-  doc["temp_differential"] = config.temp_differential;
-  doc["humidity_differential"] = config.humidity_differential;
-  doc["low_speed"] = config.low_speed;
-  doc["high_speed"] = config.high_speed;
+  doc["code_bytes"] = config.rules.getCodeSize();
+  doc["active"] = fanController.getActiveRule();
+  doc["runs"] = engine.getRuns();
+  doc["reuses"] = engine.getReuses();
+  
+  JsonArray list = doc["rules"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.rules.getCount(); i++) {
+    const Rule& rule = config.rules.getRule(i);
+    JsonObject entry = list.add<JsonObject>();
+    entry["name"] = rule.name;
+    entry["when"] = rule.when;
+    entry["then"] = config.rules.getAction(i);
+    entry["bytes"] = rule.codeLength;
+    JsonArray inputs = entry["inputs"].to<JsonArray>();
+    for (uint8_t in = 0; in < RULE_INPUTS; in++) {
+      if (rule.inputs & (1 << in)) inputs.add(RuleProgram::inputName((RuleInput)in));
+    }
+  }
+  
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+String WebServerManager::getScheduleJSON() const {
+  JsonDocument doc;
+  time_t now = time(nullptr);
+  
+  doc["slot_minutes"] = SCHEDULE_SLOT_MIN;
+  time_t until;
+  // Not limitAt(): its cache belongs to loop()
+  doc["current"] = WeeklySchedule::limitName(config.schedule.evaluate(now, until));
+  doc["next_change"] = (uint32_t)config.schedule.nextChange(now);
+  doc["holiday_as"] = config.schedule.getHolidayWeekday();
+  
+  // One bit per slot from Sunday 00:00, LSB first, as hex bytes
+  static const char hexDigits[] = "0123456789abcdef";
+  for (int c = 0; c < SCHEDULE_CLASSES; c++) {
+    ScheduleClass cls = (ScheduleClass)c;
+    const uint32_t* words = config.schedule.bitmap(cls);
+    char hex[SCHEDULE_SLOTS / 4 + 1];
+    for (int i = 0; i < SCHEDULE_SLOTS / 8; i++) {
+      uint8_t byte = words[i / 4] >> ((i % 4) * 8);
+      hex[i * 2] = hexDigits[byte >> 4];
+      hex[i * 2 + 1] = hexDigits[byte & 0x0F];
+    }
+    hex[SCHEDULE_SLOTS / 4] = '\0';
+    doc["bitmaps"][WeeklySchedule::className(cls)] = hex;
+    
+    JsonArray rules = doc["rules"][WeeklySchedule::className(cls)].to<JsonArray>();
+    for (uint8_t i = 0; i < config.schedule.getRuleCount(cls); i++) {
+      rules.add(config.schedule.getRule(cls, i));
+    }
+  }
+  
+  JsonArray holidays = doc["holidays"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.schedule.getHolidayCount(); i++) {
+    holidays.add(config.schedule.getHoliday(i));
+  }
   
   String output;
   serializeJson(doc, output);
@@ -449,64 +481,448 @@ void WebServerManager::handleSetMode(AsyncWebServerRequest *request) {
     duration = request->getParam("duration", true)->value().toInt();
   }
   
+  Command cmd = {};
+  cmd.type = CMD_SET_MODE;
+  cmd.zone = 0;
   if (mode == "auto") {
-    fanController.setMode(MODE_AUTO);
+    cmd.mode = MODE_AUTO;
+    duration = 0;
   } else if (mode == "off") {
-    fanController.setMode(MODE_MANUAL_OFF, duration);
+    cmd.mode = MODE_MANUAL_OFF;
   } else if (mode == "low") {
-    fanController.setMode(MODE_MANUAL_LOW, duration);
+    cmd.mode = MODE_MANUAL_LOW;
   } else if (mode == "high") {
-    fanController.setMode(MODE_MANUAL_HIGH, duration);
+    cmd.mode = MODE_MANUAL_HIGH;
   } else {
     request->send(400, "application/json", "{\"error\":\"Invalid mode\"}");
     return;
   }
+  cmd.duration = duration;
+  sendCommand(request, cmd);
+}
+
+// Queues cmd for the control loop and replies 202 with its ticket at once:
+// waiting here would stall every other connection on the AsyncTCP task. The
+// outcome is read from /api/commands/<ticket>.
+void WebServerManager::sendCommand(AsyncWebServerRequest *request, const Command& cmd) {
+  uint32_t ticket = commands.push(cmd);
+  if (ticket == 0) {
+    request->send(503, "application/json", "{\"error\":\"Command queue full, try again\"}");
+    return;
+  }
   
-  request->send(200, "application/json", "{\"success\":true}");
+  char body[64];
+  snprintf(body, sizeof(body), "{\"success\":true,\"queued\":true,\"ticket\":%lu}", (unsigned long)ticket);
+  request->send(202, "application/json", body);
 }
 
-void WebServerManager::handleSetConfig(AsyncWebServerRequest *request) {
-  // Handle config updates
-  bool changed = false;
+// 200 with the outcome once the loop completed the command, 202 while it is
+// queued, 410 if it completed so long ago that its result was overwritten
+void WebServerManager::handleGetCommand(AsyncWebServerRequest *request) {
+  const String& url = request->url();
+  int slash = url.lastIndexOf('/');
+  uint32_t ticket = strtoul(url.c_str() + slash + 1, nullptr, 10);
+  if (slash < 0 || ticket == 0 || (int32_t)(ticket - commands.getIssued()) > 0) {
+    request->send(404, "application/json", "{\"error\":\"No such command\"}");
+    return;
+  }
   
-  if (request->hasParam("target_temp", true)) {
-    config.target_temp = request->getParam("target_temp", true)->value().toFloat();
-    changed = true;
+  CommandResult result;
+  if (commands.poll(ticket, result)) {
+    char body[128];
+    CommandQueue::formatJSON(result, body, sizeof(body));
+    request->send(200, "application/json", body);
+  } else if ((int32_t)(commands.getCompleted() - ticket) >= COMMAND_QUEUE_SIZE) {
+    request->send(410, "application/json", "{\"error\":\"Result no longer kept\"}");
+  } else {
+    request->send(202, "application/json", "{\"success\":true,\"queued\":true}");
+  }
+}
+
+void WebServerManager::handleSetZoneMode(AsyncWebServerRequest *request) {
+  ControlMode mode;
+  if (!request->hasParam("zone", true) || !request->hasParam("mode", true) ||
+      !OverrideManager::parseMode(request->getParam("mode", true)->value(), mode)) {
+    request->send(400, "application/json", "{\"error\":\"Missing zone or invalid mode\"}");
+    return;
   }
   
-  if (request->hasParam("target_humidity", true)) {
-    config.target_humidity = request->getParam("target_humidity", true)->value().toFloat();
-    changed = true;
+  unsigned long duration = 0;
+  if (request->hasParam("duration", true)) {
+    duration = request->getParam("duration", true)->value().toInt();
+  }
+  int speed = 0;
+  if (request->hasParam("speed", true)) {
+    speed = request->getParam("speed", true)->value().toInt();
   }
   
-  if (changed) {
-    saveConfig();
-    request->send(200, "application/json", "{\"success\":true}");
-  } else {
+  int zone = request->getParam("zone", true)->value().toInt();
+  if (zone < 0 || zone >= zones.getCount()) {
+    request->send(404, "application/json", "{\"error\":\"No such zone\"}");
+    return;
+  }
+  
+  Command cmd = {};
+  cmd.type = CMD_SET_MODE;
+  cmd.zone = zone;
+  cmd.mode = mode;
+  cmd.duration = duration;
+  cmd.speed = constrain(speed, 0, 100);
+  sendCommand(request, cmd);
+}
+
+void WebServerManager::handleSetConfig(AsyncWebServerRequest *request) {
+  // The form fields of the old settings page, validated like a PATCH
+  JsonDocument patch;
+  if (request->hasParam("target_temp", true)) {
+    patch["thresholds"]["target_temp"] = request->getParam("target_temp", true)->value().toFloat();
+  }
+  if (request->hasParam("target_humidity", true)) {
+    patch["thresholds"]["target_humidity"] = request->getParam("target_humidity", true)->value().toFloat();
+  }
+  if (patch.isNull()) {
     request->send(400, "application/json", "{\"error\":\"No parameters to update\"}");
+    return;
+  }
+  
+  JsonDocument changes;
+  String error;
+  bool restart;
+  if (!patchConfig(patch.as<JsonObjectConst>(), changes.to<JsonObject>(), error, restart)) {
+    JsonDocument reply;
+    reply["error"] = error;
+    String output;
+    serializeJson(reply, output);
+    request->send(400, "application/json", output);
+    return;
+  }
+  if (changes.as<JsonObject>().size() > 0) {
+    // Written by loop() once the changes settle, not on this task
+    requestConfigSave();
+    fanController.requestUpdate();
+  }
+  request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebServerManager::handlePatchConfig(AsyncWebServerRequest *request) {
+  const char *body = (const char *)request->_tempObject;
+  if (!body) {
+    request->send(413, "application/json", "{\"error\":\"Body missing or too large\"}");
+    return;
+  }
+  
+  // Only the known settings are kept, so a large or unexpected body costs
+  // no more than a full patch
+  JsonDocument filter;
+  buildConfigFilter(filter);
+  JsonDocument patch;
+  DeserializationError parseError = deserializeJson(patch, body, DeserializationOption::Filter(filter));
+  JsonDocument reply;
+  if (parseError || !patch.is<JsonObject>()) {
+    reply["error"] = String("Invalid JSON: ") + (parseError ? parseError.c_str() : "not an object");
+    String output;
+    serializeJson(reply, output);
+    request->send(400, "application/json", output);
+    return;
+  }
+  
+  String error;
+  bool restart;
+  JsonObject changes = reply["changes"].to<JsonObject>();
+  if (!patchConfig(patch.as<JsonObjectConst>(), changes, error, restart)) {
+    reply.clear();
+    reply["error"] = error;
+    String output;
+    serializeJson(reply, output);
+    request->send(400, "application/json", output);
+    return;
+  }
+  if (changes.size() > 0) {
+    requestConfigSave();
+    fanController.requestUpdate();
+  }
+  reply["success"] = true;
+  reply["restart_required"] = restart;
+  String output;
+  serializeJson(reply, output);
+  request->send(200, "application/json", output);
+}
+
+void WebServerManager::handleAddOverride(AsyncWebServerRequest *request) {
+  ControlMode mode;
+  if (!request->hasParam("mode", true) ||
+      !OverrideManager::parseMode(request->getParam("mode", true)->value(), mode)) {
+    request->send(400, "application/json", "{\"error\":\"Missing or invalid mode\"}");
+    return;
+  }
+  
+  // Absolute start (epoch or local "YYYY-MM-DD HH:MM") or minutes from now
+  time_t start = 0;
+  if (request->hasParam("start", true)) {
+    start = OverrideManager::parseTime(request->getParam("start", true)->value());
+  } else if (request->hasParam("in", true)) {
+    start = time(nullptr) + request->getParam("in", true)->value().toInt() * 60L;
+  }
+  
+  unsigned long duration = 0;
+  if (request->hasParam("duration", true)) {
+    duration = request->getParam("duration", true)->value().toInt();
+  }
+  int speed = 0;
+  if (request->hasParam("speed", true)) {
+    speed = request->getParam("speed", true)->value().toInt();
+  }
+  
+  Command cmd = {};
+  cmd.type = CMD_ADD_OVERRIDE;
+  cmd.start = start;
+  cmd.duration = duration;
+  cmd.mode = mode;
+  cmd.speed = constrain(speed, 0, 100);
+  sendCommand(request, cmd);
+}
+
+void WebServerManager::handleCancelOverride(AsyncWebServerRequest *request) {
+  if (!request->hasParam("id")) {
+    request->send(400, "application/json", "{\"error\":\"Missing id parameter\"}");
+    return;
   }
+  
+  String id = request->getParam("id")->value();
+  Command cmd = {};
+  cmd.type = CMD_CANCEL_OVERRIDE;
+  cmd.id = id == "all" ? 0 : id.toInt();
+  if (id != "all" && cmd.id == 0) {
+    request->send(404, "application/json", "{\"error\":\"No such override\"}");
+    return;
+  }
+  sendCommand(request, cmd);
 }
 
+// The upload a /update request started, kept on the request (_tempObject,
+// freed with it): 0 if ota refused to start one
+struct OtaUploadSession {
+  uint32_t session;
+};
+
 void WebServerManager::handleOTAUpload(AsyncWebServerRequest *request, String filename, 
                                        size_t index, uint8_t *data, size_t len, bool final) {
   if (!index) {
     Serial.printf("OTA Update Start: %s\n", filename.c_str());
-    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-      Update.printError(Serial);
-    }
+    String digest = request->hasHeader("X-Update-SHA256") ? request->header("X-Update-SHA256") :
+                    request->hasArg("sha256") ? request->arg("sha256") : String();
+    OtaUploadSession *upload = (OtaUploadSession *)malloc(sizeof(OtaUploadSession));
+    if (!upload) return;
+    free(request->_tempObject);
+    request->_tempObject = upload;
+    upload->session = ota.begin(request->contentLength(), digest.c_str());
+    uint32_t session = upload->session;
+    // A dropped connection never gets to final
+    request->onDisconnect([this, session]() {
+      ota.abort(session, "Connection lost");
+    });
   }
   
-  if (!Update.hasError()) {
-    if (Update.write(data, len) != len) {
-      Update.printError(Serial);
-    }
+  OtaUploadSession *upload = (OtaUploadSession *)request->_tempObject;
+  if (!upload || upload->session == 0) return;
+  // Refused once the upload failed: the rest of the body is dropped
+  ota.write(upload->session, data, len);
+  if (final) ota.end(upload->session);
+  publishOtaProgress(final);
+}
+
+void WebServerManager::handleOTAResult(AsyncWebServerRequest *request) {
+  OtaUploadSession *upload = (OtaUploadSession *)request->_tempObject;
+  if (!upload) {
+    request->send(400, "text/plain", "FAIL: No firmware in the request");
+    return;
+  }
+  if (upload->session == 0) {
+    request->send(409, "text/plain", "FAIL: Another update is running");
+    return;
   }
   
-  if (final) {
-    if (Update.end(true)) {
-      Serial.printf("Update Success: %u bytes\n", index + len);
-    } else {
-      Update.printError(Serial);
+  // The reboot is loop()'s, once this reply is out
+  OtaProgress progress = ota.getProgress();
+  bool ok = progress.state == OTA_SUCCESS;
+  String body = ok ? String("OK - Rebooting...") : String("FAIL: ") + (progress.error ? progress.error : "Upload incomplete");
+  int code = ok ? 200 : progress.rejected ? 400 : 500;
+  AsyncWebServerResponse *response = request->beginResponse(code, "text/plain", body);
+  if (progress.sha256[0]) response->addHeader("X-Update-SHA256", progress.sha256);
+  response->addHeader("Connection", "close");
+  request->send(response);
+}
+
+void WebServerManager::publishOtaProgress(bool force) {
+  unsigned long now = millis();
+  if (!force && now - lastOtaEvent < OTA_PROGRESS_INTERVAL) return;
+  lastOtaEvent = now;
+  if (eventClientCount == 0) return;
+  char json[OTA_JSON_MAX];
+  ota.formatJSON(json, sizeof(json));
+  events.send(json, "ota");
+}
+
+// Journal query state, kept alive by the response filler
+struct JournalStream {
+  File file;
+  uint32_t seq;
+  uint32_t end;
+  uint32_t to;
+  uint32_t remaining;
+  bool started;
+  bool first;
+  bool done;
+  char text[8 * (JOURNAL_JSON_MAX + 2) + 4];
+  size_t textLen;
+  size_t textPos;
+};
+
+void WebServerManager::handleJournal(AsyncWebServerRequest *request) {
+  auto stream = std::make_shared<JournalStream>();
+  stream->file = LittleFS.open(JOURNAL_FILE, "r");
+  if (!stream->file) {
+    request->send(404, "application/json", "{\"error\":\"No journal recorded\"}");
+    return;
+  }
+  
+  // Default: the last 24 hours, or everything while the clock is unset
+  time_t now = time(nullptr);
+  uint32_t from = now > CLOCK_VALID_EPOCH ? now - 86400 : 0;
+  if (request->hasParam("from")) {
+    from = OverrideManager::parseTime(request->getParam("from")->value());
+  }
+  stream->to = 0xFFFFFFFF;
+  if (request->hasParam("to")) {
+    stream->to = OverrideManager::parseTime(request->getParam("to")->value());
+  }
+  stream->remaining = JOURNAL_QUERY_LIMIT;
+  if (request->hasParam("limit")) {
+    stream->remaining = constrain(request->getParam("limit")->value().toInt(), 1L, (long)JOURNAL_QUERY_LIMIT);
+  }
+  
+  stream->seq = from ? decisionJournal.findEpoch(stream->file, from) : decisionJournal.getOldestSeq();
+  stream->end = decisionJournal.getNextSeq();
+  stream->started = false;
+  stream->first = true;
+  stream->done = false;
+  stream->textLen = 0;
+  stream->textPos = 0;
+  
+  // Streamed a few records at a time: the file is never loaded whole
+  request->send(request->beginChunkedResponse("application/json",
+    [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      size_t written = 0;
+      while (written < maxLen) {
+        if (stream->textPos < stream->textLen) {
+          size_t n = min(maxLen - written, stream->textLen - stream->textPos);
+          memcpy(buffer + written, stream->text + stream->textPos, n);
+          written += n;
+          stream->textPos += n;
+          continue;
+        }
+        if (stream->done) break;
+        
+        stream->textLen = 0;
+        stream->textPos = 0;
+        if (!stream->started) {
+          stream->text[stream->textLen++] = '[';
+          stream->started = true;
+        }
+        
+        JournalRecord recs[8];
+        size_t count = 0;
+        if (stream->remaining > 0 && stream->seq < stream->end) {
+          count = decisionJournal.read(stream->file, stream->seq, recs,
+                                       min((uint32_t)8, stream->end - stream->seq));
+        }
+        for (size_t i = 0; i < count && stream->remaining > 0; i++) {
+          const JournalRecord& rec = recs[i];
+          if (!DecisionJournal::isValid(rec) || rec.seq != stream->seq + i) continue;
+          if (rec.epoch > stream->to) {
+            stream->remaining = 0;
+            break;
+          }
+          if (stream->first) {
+            stream->first = false;
+          } else {
+            stream->text[stream->textLen++] = ',';
+          }
+          stream->text[stream->textLen++] = '\n';
+          stream->textLen += DecisionJournal::formatJSON(rec, stream->text + stream->textLen,
+                                                         sizeof(stream->text) - stream->textLen);
+          stream->remaining--;
+        }
+        stream->seq += count;
+        
+        if (count == 0 || stream->remaining == 0) {
+          stream->text[stream->textLen++] = '\n';
+          stream->text[stream->textLen++] = ']';
+          stream->done = true;
+          stream->file.close();
+        }
+      }
+      return written;
+    }));
+}
+
+void WebServerManager::handleHistory(AsyncWebServerRequest *request) {
+  auto stream = std::make_shared<HistoryStream>();
+  
+  // Default: the last 24 hours; without a clock the range must be given
+  time_t now = time(nullptr);
+  bool clockValid = now > CLOCK_VALID_EPOCH;
+  if (!clockValid && (!request->hasParam("from") || !request->hasParam("to"))) {
+    request->send(503, "application/json", "{\"error\":\"Clock not set, give from and to\"}");
+    return;
+  }
+  uint32_t to = clockValid ? now : 0;
+  if (request->hasParam("to")) {
+    to = OverrideManager::parseTime(request->getParam("to")->value());
+  }
+  uint32_t from = to > 86400 ? to - 86400 : 0;
+  if (request->hasParam("from")) {
+    from = OverrideManager::parseTime(request->getParam("from")->value());
+  }
+  if (from >= to) {
+    request->send(400, "application/json", "{\"error\":\"from must be before to\"}");
+    return;
+  }
+  
+  uint32_t step = 0;
+  if (request->hasParam("step")) {
+    step = max(0L, request->getParam("step")->value().toInt());
+  }
+  stream->setRange(from, to, HistoryStream::chooseStep(from, to, step));
+  
+  if (request->hasParam("fields")) {
+    String error;
+    if (!stream->setFields(request->getParam("fields")->value(), error)) {
+      request->send(400, "application/json", "{\"error\":\"" + error + "\"}");
+      return;
     }
   }
-}
\ No newline at end of file
+  
+  bool binary = request->hasParam("format") && request->getParam("format")->value() == "bin";
+  stream->setFormat(binary ? HISTORY_BINARY : HISTORY_CSV);
+  
+  // Aggregated while streaming: neither the trace nor the result is held
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+    binary ? "application/octet-stream" : "text/csv",
+    [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return stream->read(buffer, maxLen);
+    });
+  response->addHeader("X-History-Step", String(stream->getStep()));
+  request->send(response);
+}
+
+void WebServerManager::handleMetrics(AsyncWebServerRequest *request) {
+  auto stream = std::make_shared<MetricsStream>(metricsSources);
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+    "text/plain; version=0.0.4; charset=utf-8",
+    [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return stream->read(buffer, maxLen);
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
@@ -0,0 +1,125 @@
+#include "zones.h"
+#include <ArduinoJson.h>
+
+static const char* modeNames[] = {"AUTO", "MANUAL_OFF", "MANUAL_LOW", "MANUAL_HIGH", "DIAGNOSTIC"};
+
+ZoneManager::ZoneManager() {
+  sensors = nullptr;
+  mainFan = nullptr;
+  count = 0;
+}
+
+void ZoneManager::begin(SensorManager& sensorManager, FanController& main) {
+  sensors = &sensorManager;
+  mainFan = &main;
+
+  for (uint8_t i = 0; i < config.zone_count; i++) {
+    const ZoneConfig& zc = config.zones[i];
+    Zone& zone = zones[count];
+    zone.mode = MODE_AUTO;
+    zone.overrideUntil = 0;
+    zone.sensor = -1;
+    if (zc.role == ZONE_INDEPENDENT && zc.sensor_channel != MUX_CHANNEL_INTERNAL) {
+      zone.sensor = sensorManager.addZoneSensor(zc.sensor_channel);
+    }
+
+    zone.fan = new FanController(zc.relay_pin, zc.dimmer_pin, zone.mode, zone.overrideUntil);
+    if (!zone.fan->begin()) {
+      Serial.printf("❌ Zone %u (%s) fan init failed\n", i + 1, zc.name.c_str());
+    }
+    zone.fan->setWakeTask(xTaskGetCurrentTaskHandle());
+    if (zc.role == ZONE_FOLLOW) {
+      zone.fan->setLeader(fanOf(zc.follow), zc.balance);
+    }
+    count++;
+    Serial.printf("✓ Zone %u (%s) ready\n", i + 1, zc.name.c_str());
+  }
+}
+
+FanController* ZoneManager::fanOf(uint8_t id) const {
+  if (id == 0) return mainFan;
+  if (id <= count) return zones[id - 1].fan;
+  return nullptr;
+}
+
+void ZoneManager::update(const SensorData& internal, const SensorData& external) {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < count; i++) {
+    Zone& zone = zones[i];
+    if (zone.mode != MODE_AUTO && zone.overrideUntil > 0 && now >= zone.overrideUntil) {
+      Serial.printf("⏰ Zone %u override expired, returning to AUTO\n", i + 1);
+      zone.mode = MODE_AUTO;
+      zone.overrideUntil = 0;
+    }
+    SensorData indoor = zone.sensor >= 0 ? sensors->getZoneData(zone.sensor) : internal;
+    zone.fan->update(indoor, external);
+  }
+}
+
+bool ZoneManager::isUpdatePending() const {
+  for (uint8_t i = 0; i < count; i++) {
+    if (zones[i].fan->isUpdatePending()) return true;
+  }
+  return false;
+}
+
+void ZoneManager::getNextDeadline(unsigned long& deadline) const {
+  for (uint8_t i = 0; i < count; i++) {
+    const Zone& zone = zones[i];
+    unsigned long due = zone.fan->getNextDeadline();
+    if ((long)(due - deadline) < 0) deadline = due;
+    if (zone.overrideUntil > 0 && (long)(zone.overrideUntil - deadline) < 0) {
+      deadline = zone.overrideUntil;
+    }
+  }
+}
+
+bool ZoneManager::setMode(uint8_t id, ControlMode mode, unsigned long durationMin, int speed) {
+  FanController* fan = fanOf(id);
+  if (!fan) return false;
+  // setMode() sets the timeout (and clears an old one) for every mode
+  fan->setMode(mode, durationMin);
+  if (mode == MODE_DIAGNOSTIC) fan->setManualSpeed(speed);
+  return true;
+}
+
+void ZoneManager::stopAll() {
+  for (uint8_t i = 0; i < count; i++) {
+    zones[i].fan->setMode(MODE_MANUAL_OFF);
+  }
+}
+
+String ZoneManager::getJSON() const {
+  JsonDocument doc;
+  JsonArray list = doc.to<JsonArray>();
+  unsigned long now = millis();
+
+  for (uint8_t id = 0; id <= count; id++) {
+    const FanController* fan = fanOf(id);
+    JsonObject entry = list.add<JsonObject>();
+    entry["id"] = id;
+    entry["name"] = id == 0 ? "main" : config.zones[id - 1].name.c_str();
+    if (id > 0 && config.zones[id - 1].role == ZONE_FOLLOW) {
+      entry["follow"] = config.zones[id - 1].follow;
+      entry["balance"] = config.zones[id - 1].balance;
+    }
+    entry["mode"] = modeNames[fan->getMode()];
+    if (fan->getMode() != MODE_AUTO && fan->getOverrideUntil() > now) {
+      entry["override_min"] = (fan->getOverrideUntil() - now) / 60000;
+    }
+    entry["speed"] = fan->getCurrentSpeed();
+    entry["reason"] = fan->getStatusText();
+    entry["gate"] = FanController::gateName(fan->getGate());
+
+    if (id > 0 && zones[id - 1].sensor >= 0) {
+      SensorData indoor = sensors->getZoneData(zones[id - 1].sensor);
+      entry["indoor"]["temperature"] = indoor.temperature;
+      entry["indoor"]["humidity"] = indoor.humidity;
+      entry["indoor"]["valid"] = indoor.valid;
+    }
+  }
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
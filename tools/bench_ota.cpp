@@ -0,0 +1,264 @@
+// Host benchmark: time to upload a firmware image through POST /update, with
+// the handler the firmware had before OtaUpdater and with WebServerManager's
+// route, over the same modelled link and flash.
+//
+//   pio run -e bench_ota
+//   .pio/build/bench_ota/program [--size BYTES] [--rate KBPS] [--scale X]
+//
+//   --size BYTES    image size (default 1228800, 1.2 MB)
+//   --rate KBPS     link rate in KB/s (default 150, WiFi to an ESP32 HTTP server)
+//   --scale X       runs X times faster than the model (default 0.1); the
+//                   times shown are scaled back
+//
+// Model: the body arrives in 1436-byte TCP segments at the link rate, and at
+// most a receive window (lwIP's default 5744 bytes) ahead of what the upload
+// handler has taken, so a handler that blocks on flash stalls the sender.
+// Flash costs 45 ms per 4 KB sector erase, 150 ms per 64 KB block erase and
+// 0.7 ms per 256-byte page written, typical figures for the QSPI flash on
+// ESP32 modules.
+//
+// Cases:
+//   inline      every segment written to Update in the handler, as before;
+//               Update erases and writes a sector each time its buffer fills
+//   pipelined   OtaUpdater: sector blocks hashed and written to the OTA
+//               partition by its task, erased ahead in 64 KB blocks, with
+//               the image's SHA-256 checked
+//   delta       a patch (tools/delta_encoder.h) from that image to a next
+//               release: 6 KB of new code at 40%, and every 1000th word
+//               after it changed, as moved addresses do. Through the same
+//               route, decoded against the running image by the writer
+//   mismatch    a wrong X-Update-SHA256 is refused and nothing is booted
+// Exits 1 if an image arrives corrupted or the mismatch is accepted.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <vector>
+#include <esp_ota_ops.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+#include "webserver.h"
+#include "journal.h"
+#include "trace.h"
+#include "ota.h"
+#include "delta_encoder.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+DecisionJournal decisionJournal;
+TraceRecorder traceRecorder;
+
+#define LINK_WINDOW 5744
+#define FLASH_SECTOR_ERASE_US 45000
+#define FLASH_BLOCK_ERASE_US 150000
+#define FLASH_PROGRAM_US 700
+#define RELEASE_INSERT 6144
+#define RELEASE_WORD_STRIDE 1000
+
+struct UploadResult {
+  int code;
+  double seconds;
+  uint32_t erases;
+  bool intact;
+  bool finished;
+};
+
+// The /update upload handler before OtaUpdater
+static void legacyUpload(AsyncWebServerRequest* request, const String& filename, size_t index,
+                         uint8_t* data, size_t len, bool final) {
+  (void)request;
+  (void)filename;
+  if (!index) {
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) Update.printError(Serial);
+  }
+  if (!Update.hasError()) {
+    if (Update.write(data, len) != len) Update.printError(Serial);
+  }
+  if (final) {
+    if (!Update.end(true)) Update.printError(Serial);
+  }
+}
+
+// legacy: the image ends up in Update, else in the OTA partition. body is
+// the image, or a patch that makes it.
+static UploadResult upload(AsyncWebServer& server, bool legacy, const std::string& image,
+                           const std::string& body, const char* digest, double scale) {
+  AsyncWebServerRequest request(HTTP_POST, "/update");
+  request.simSetBody(body);
+  if (digest) request.simAddHeader("X-Update-SHA256", digest);
+
+  simResetBootPartition();
+  uint32_t erases = simFlashErases();
+  auto start = std::chrono::steady_clock::now();
+  server.simRequest(request);
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  UploadResult result;
+  result.code = request.simResponseCode();
+  result.seconds = wallS / scale;
+  result.erases = simFlashErases() - erases;
+  if (legacy) {
+    const std::vector<uint8_t>& written = Update.simImage();
+    result.finished = Update.isFinished();
+    result.intact = written.size() == image.size() && !memcmp(written.data(), image.data(), image.size());
+  } else {
+    const std::vector<uint8_t>& written = simPartitionData();
+    result.finished = simBootPartition() != nullptr;
+    result.intact = written.size() >= image.size() && !memcmp(written.data(), image.data(), image.size());
+  }
+  return result;
+}
+
+static void print(const char* name, const UploadResult& r, size_t size) {
+  printf("%-10s %4d  %8.1f  %8.1f  %6u  %s\n", name, r.code, r.seconds, size / 1024.0 / r.seconds,
+         (unsigned)r.erases, r.intact ? "✓" : "❌");
+}
+
+static uint32_t nextRandom(uint32_t& seed) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 16;
+}
+
+static void hexDigest(const std::string& data, char* out) {
+  uint8_t hash[32];
+  deltaSha256(data, hash);
+  for (int i = 0; i < 32; i++) snprintf(out + i * 2, 3, "%02x", hash[i]);
+}
+
+// The image after a small change to the source
+static std::string nextRelease(const std::string& image) {
+  uint32_t seed = 777;
+  size_t at = image.size() * 2 / 5;
+  std::string code(RELEASE_INSERT, '\0');
+  for (char& c : code) c = (char)nextRandom(seed);
+  std::string release = image.substr(0, at) + code + image.substr(at);
+  for (size_t i = at + code.size(); i + 4 <= release.size(); i += RELEASE_WORD_STRIDE) {
+    uint32_t word;
+    memcpy(&word, &release[i], 4);
+    word += RELEASE_INSERT;
+    memcpy(&release[i], &word, 4);
+  }
+  return release;
+}
+
+static void usage() {
+  printf("usage: bench_ota [--size BYTES] [--rate KBPS] [--scale X]\n");
+}
+
+int main(int argc, char** argv) {
+  size_t size = 1228800;
+  uint32_t rateKBps = 150;
+  double scale = 0.1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+      size = max(1L, atol(argv[++i]));
+    } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+      rateKBps = max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--scale") && i + 1 < argc) {
+      scale = atof(argv[++i]);
+      if (scale <= 0) scale = 0.1;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  // An app image: magic byte, then noise
+  std::string image(size, '\0');
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < size; i++) image[i] = (char)nextRandom(seed);
+  image[0] = (char)0xE9;
+  char digest[65];
+  hexDigest(image, digest);
+
+  std::string release = nextRelease(image);
+  char releaseDigest[65];
+  hexDigest(release, releaseDigest);
+  std::string patch;
+  DeltaStats stats;
+  if (!buildDelta(image, release, patch, stats)) {
+    printf("❌ Compression failed\n");
+    return 1;
+  }
+  char wrong[65];
+  memcpy(wrong, digest, sizeof(wrong));
+  wrong[0] = wrong[0] == '0' ? '1' : '0';
+
+  Serial.setMuted(true);
+  LittleFS.begin(true);
+  loadConfig();
+  SensorManager sensors;
+  FanController fan;
+  OverrideManager overrides;
+  VentilationPlanner planner;
+  EfficiencyEstimator efficiency;
+  UsageMeter usageMeter;
+  ZoneManager zones;
+  sensors.begin();
+  fan.begin();
+  zones.begin(sensors, fan);
+  CommandQueue commands;
+  OtaUpdater ota;
+  WebServerManager web(sensors, fan, overrides, planner, efficiency, usageMeter, zones, commands, ota);
+  web.begin();
+  AsyncWebServer* server = AsyncWebServer::simOnPort(80);
+  if (!server) {
+    Serial.setMuted(false);
+    printf("❌ Web server did not start\n");
+    return 1;
+  }
+  AsyncWebServer legacy(8080);
+  legacy.on("/update", HTTP_POST, [](AsyncWebServerRequest* request) {
+    request->send(200, "text/plain", Update.hasError() ? "FAIL" : "OK - Rebooting...");
+  }, legacyUpload);
+
+  // Untimed: a wrong digest must leave nothing to boot
+  UploadResult mismatch = upload(*server, false, image, image, wrong, 1);
+  OtaProgress refused = ota.getProgress();
+
+  uint32_t rate = (uint32_t)(rateKBps * 1024 / scale);
+  server->simSetLink(rate, LINK_WINDOW);
+  legacy.simSetLink(rate, LINK_WINDOW);
+  simSetFlashTiming((uint32_t)(FLASH_SECTOR_ERASE_US * scale), (uint32_t)(FLASH_BLOCK_ERASE_US * scale),
+                    (uint32_t)(FLASH_PROGRAM_US * scale));
+  UploadResult before = upload(legacy, true, image, image, nullptr, scale);
+  UploadResult after = upload(*server, false, image, image, digest, scale);
+  OtaProgress verified = ota.getProgress();
+  // Rebooted into that image, which takes the patch to the next release
+  server->end();
+  simSetRunningImage((const uint8_t*)image.data(), image.size());
+  OtaUpdater rebootedOta;
+  WebServerManager rebooted(sensors, fan, overrides, planner, efficiency, usageMeter, zones, commands,
+                            rebootedOta);
+  rebooted.begin();
+  server = AsyncWebServer::simOnPort(80);
+  server->simSetLink(rate, LINK_WINDOW);
+  UploadResult delta = upload(*server, false, release, patch, releaseDigest, scale);
+  OtaProgress patched = rebootedOta.getProgress();
+  Serial.setMuted(false);
+
+  printf("\n%-10s %4s  %8s  %8s  %6s\n", "Case", "Code", "Seconds", "KB/s", "Erases");
+  print("inline", before, size);
+  print("pipelined", after, size);
+  print("delta", delta, release.size());
+
+  bool refusedOk = mismatch.code == 400 && !mismatch.finished && refused.state == OTA_FAILED;
+  bool deltaOk = delta.intact && delta.code == 200 && delta.finished && patched.state == OTA_SUCCESS &&
+                 patched.delta && !strcmp(patched.sha256, releaseDigest);
+  bool ok = before.intact && after.intact && after.code == 200 && after.finished &&
+            verified.state == OTA_SUCCESS &&
+            !strcmp(verified.sha256, digest) && deltaOk && refusedOk;
+  printf("\n━━━ OTA BENCH SUMMARY ━━━\n");
+  printf("Image:          %u bytes over a %u KB/s link (%.1f s alone)\n", (unsigned)size,
+         (unsigned)rateKBps, size / 1024.0 / rateKBps);
+  printf("Upload time:    %.1f s -> %.1f s (%.0f%% less)\n", before.seconds, after.seconds,
+         100.0 * (1 - after.seconds / before.seconds));
+  printf("SHA-256:        %s %s\n", verified.sha256, !strcmp(verified.sha256, digest) ? "✓" : "❌");
+  printf("Delta patch:    %u bytes (%.1f%% of the release), %.1f s, %.0f%% less than the full image %s\n",
+         (unsigned)patch.size(), 100.0 * patch.size() / release.size(), delta.seconds,
+         100.0 * (1 - delta.seconds / after.seconds), deltaOk ? "✓" : "❌");
+  printf("Wrong digest:   %d \"%s\", not booted %s\n", mismatch.code, refused.error, refusedOk ? "✓" : "❌");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Host benchmark: I2C bus time per sample for each sensor driver combination.
+//
+//   pio run -e bench_sensor_bus && .pio/build/bench_sensor_bus/program
+//
+// Runs the real drivers from src/sensor_drivers.cpp against register-level
+// device models on the simulated bus (sim/) and reports, per location and
+// sample, the number of transactions, bytes on the wire, SCL time at 100 kHz
+// and wall latency including conversion waits and the mux settle delay.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "sensor_drivers.h"
+#include "sim_i2c_devices.h"
+
+#define MUX_ADDR 0x70
+#define BOSCH_ADDR 0x77
+#define SAMPLES 100
+
+struct BenchResult {
+  const char* name;
+  double transactions;
+  double bytes;
+  double busUs;
+  double latencyMs;
+  SensorSample last;
+  bool decoded;
+  bool ok;
+};
+
+static SimTca9548a mux;
+static SimMuxedDevice boschPort(mux);
+static SimMuxedDevice ahtPort(mux);
+static SimMuxedDevice shtPort(mux);
+
+static void selectMuxChannel(uint8_t channel) {
+  // Same sequence as SensorManagerBase::selectMuxChannel
+  Wire.beginTransmission(MUX_ADDR);
+  Wire.write(1 << channel);
+  Wire.endTransmission();
+  delay(10);
+}
+
+static void finish(BenchResult& r, uint64_t startUs, int samples) {
+  const SimI2cStats& s = Wire.stats();
+  r.transactions = (double)s.transactions / samples;
+  r.bytes = (double)s.bytes / samples;
+  r.busUs = (double)Wire.busTimeUs() / samples;
+  r.latencyMs = (double)(sim::nowUs() - startUs) / 1000.0 / samples;
+}
+
+template <typename Driver>
+static BenchResult runDriver() {
+  BenchResult r;
+  memset(&r, 0, sizeof(r));
+  r.name = Driver::name();
+
+  Driver drivers[2];
+  r.ok = true;
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    selectMuxChannel(ch);
+    r.ok = drivers[ch].begin(Wire, BOSCH_ADDR) && r.ok;
+  }
+
+  r.decoded = true;
+  Wire.resetStats();
+  uint64_t start = sim::nowUs();
+  for (int i = 0; i < SAMPLES; i++) {
+    for (uint8_t ch = 0; ch < 2; ch++) {
+      selectMuxChannel(ch);
+      r.ok = drivers[ch].sample(r.last) && r.ok;
+    }
+  }
+  finish(r, start, SAMPLES * 2);
+  return r;
+}
+
+// The previous SensorManager path (Adafruit_AHTX0::getEvent polling the busy
+// flag every 10 ms, Adafruit_BMP280::readPressure re-reading temperature for
+// t_fine, BMP280 free-running in MODE_NORMAL), replayed transaction by
+// transaction on the same bus.
+static BenchResult runLegacy() {
+  BenchResult r;
+  memset(&r, 0, sizeof(r));
+  r.name = "legacy AHTX0+BMP280 lib";
+  r.ok = true;
+
+  Wire.resetStats();
+  uint64_t start = sim::nowUs();
+  for (int i = 0; i < SAMPLES; i++) {
+    for (uint8_t ch = 0; ch < 2; ch++) {
+      selectMuxChannel(ch);
+
+      const uint8_t trigger[] = {0xAC, 0x33, 0x00};
+      Wire.beginTransmission(AHT20_ADDR);
+      Wire.write(trigger, sizeof(trigger));
+      Wire.endTransmission();
+      for (int poll = 0; poll < 8; poll++) {  // ~80 ms conversion
+        delay(10);
+        Wire.requestFrom((uint8_t)AHT20_ADDR, (uint8_t)1);
+        Wire.read();
+      }
+      Wire.requestFrom((uint8_t)AHT20_ADDR, (uint8_t)6);
+      while (Wire.available()) Wire.read();
+
+      const uint8_t regs[] = {0xFA, 0xF7};  // temperature, then pressure
+      for (int n = 0; n < 2; n++) {
+        Wire.beginTransmission(BOSCH_ADDR);
+        Wire.write(regs[n]);
+        Wire.endTransmission();
+        Wire.requestFrom((uint8_t)BOSCH_ADDR, (uint8_t)3);
+        while (Wire.available()) Wire.read();
+      }
+    }
+  }
+  finish(r, start, SAMPLES * 2);
+  return r;
+}
+
+static void print(const BenchResult& r) {
+  printf("%-24s %6.1f %7.1f %9.0f %10.1f", r.name, r.transactions, r.bytes, r.busUs, r.latencyMs);
+  if (r.decoded) {
+    printf("   %6.2f C %6.2f %% %8.2f hPa", r.last.temperature, r.last.humidity, r.last.pressure);
+  }
+  printf("%s\n", r.ok ? "" : "   (errors)");
+}
+
+int main() {
+  SimAht20 aht[2];
+  SimSht4x sht[2];
+  SimBmx280 bmp[2] = {SimBmx280(0x58), SimBmx280(0x58)};
+  SimBmx280 bme[2] = {SimBmx280(0x60), SimBmx280(0x60)};
+
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    aht[ch].setReading(ch ? 8.5f : 14.2f, ch ? 81.0f : 63.5f);
+    sht[ch].setReading(ch ? 8.5f : 14.2f, ch ? 81.0f : 63.5f);
+  }
+
+  Wire.begin();
+  Wire.setClock(100000);
+  Wire.attach(MUX_ADDR, &mux);
+  Wire.attach(AHT20_ADDR, &ahtPort);
+  Wire.attach(SHT4X_ADDR, &shtPort);
+  Wire.attach(BOSCH_ADDR, &boschPort);
+
+  printf("I2C bus per location sample @ %u Hz (mux select included)\n\n", Wire.getClock());
+  printf("%-24s %6s %7s %9s %10s   %s\n", "driver", "xfers", "bytes", "bus us", "latency ms", "last reading");
+
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    ahtPort.bind(ch, &aht[ch]);
+    boschPort.bind(ch, &bmp[ch]);
+  }
+  print(runLegacy());
+  print(runDriver<AhtBmpDriver>());
+
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    ahtPort.bind(ch, nullptr);
+    boschPort.bind(ch, &bme[ch]);
+  }
+  print(runDriver<Bme280Driver>());
+
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    shtPort.bind(ch, &sht[ch]);
+    boschPort.bind(ch, &bmp[ch]);
+  }
+  print(runDriver<Sht4xBmpDriver>());
+
+  return 0;
+}
@@ -0,0 +1,189 @@
+// Host benchmark: cost of GET /api/status through WebServerManager's routes,
+// in requests per second and heap allocations per request.
+//
+//   pio run -e bench_status
+//   .pio/build/bench_status/program [--fs DIR] [--requests N]
+//
+//   --fs DIR        config.json from DIR (default .pio/simfs)
+//   --requests N    requests per case (default 200000)
+//
+// Cases:
+//   rebuild      the status document is built and serialized for every
+//                request, as the handler did before the snapshot cache
+//   snapshot     update() once, then every request copies the snapshot
+//   conditional  requests carry the snapshot's ETag and get 304, as a
+//                polling dashboard does while nothing changes
+//
+// Allocations are counted by wrapping the C allocator (glibc only; elsewhere
+// only the rate is shown). The sim's String is std::string, which keeps
+// short strings inline, so the device allocates somewhat more than this.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+#include "webserver.h"
+#include "journal.h"
+#include "trace.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+DecisionJournal decisionJournal;
+TraceRecorder traceRecorder;
+
+#if defined(__GLIBC__)
+#define BENCH_COUNTS_HEAP 1
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static bool counting = false;
+static uint64_t allocations = 0;
+static uint64_t allocatedBytes = 0;
+
+extern "C" void* malloc(size_t size) {
+  if (counting) { allocations++; allocatedBytes += size; }
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  if (counting) { allocations++; allocatedBytes += count * size; }
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+  if (counting) { allocations++; allocatedBytes += size; }
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) {
+  __libc_free(ptr);
+}
+#else
+#define BENCH_COUNTS_HEAP 0
+static bool counting = false;
+static uint64_t allocations = 0;
+static uint64_t allocatedBytes = 0;
+#endif
+
+struct BenchResult {
+  double perSecond;
+  double allocationsPerRequest;
+  double bytesPerRequest;
+  int code;
+  size_t bodyLength;
+};
+
+static BenchResult run(AsyncWebServer& server, WebServerManager& web, long requests,
+                       bool rebuild, const String& etag) {
+  BenchResult result = {0, 0, 0, 0, 0};
+  allocations = 0;
+  allocatedBytes = 0;
+  counting = true;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < requests; i++) {
+    if (rebuild) web.update();
+    AsyncWebServerRequest request(HTTP_GET, "/api/status");
+    if (etag.length() > 0) request.simAddHeader("If-None-Match", etag);
+    server.simRequest(request);
+    if (i == 0) {
+      result.code = request.simResponseCode();
+      result.bodyLength = request.simResponseBody().size();
+    }
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  counting = false;
+  result.perSecond = requests / wallS;
+  result.allocationsPerRequest = (double)allocations / requests;
+  result.bytesPerRequest = (double)allocatedBytes / requests;
+  return result;
+}
+
+static void print(const char* name, const BenchResult& r) {
+  printf("%-12s %4d %6u  %10.0f", name, r.code, (unsigned)r.bodyLength, r.perSecond);
+  if (BENCH_COUNTS_HEAP) {
+    printf("  %8.1f  %9.0f", r.allocationsPerRequest, r.bytesPerRequest);
+  }
+  printf("\n");
+}
+
+static void usage() {
+  printf("usage: bench_status [--fs DIR] [--requests N]\n");
+}
+
+int main(int argc, char** argv) {
+  long requests = 200000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--fs") && i + 1 < argc) {
+      LittleFS.simSetRoot(argv[++i]);
+    } else if (!strcmp(argv[i], "--requests") && i + 1 < argc) {
+      requests = max(1L, atol(argv[++i]));
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  Serial.setMuted(true);
+  LittleFS.begin(true);
+  loadConfig();
+  SensorManager sensors;
+  FanController fan;
+  OverrideManager overrides;
+  VentilationPlanner planner;
+  EfficiencyEstimator efficiency;
+  UsageMeter usageMeter;
+  ZoneManager zones;
+  sensors.begin();
+  fan.begin();
+  zones.begin(sensors, fan);
+  CommandQueue commands;
+  OtaUpdater ota;
+  WebServerManager web(sensors, fan, overrides, planner, efficiency, usageMeter, zones, commands, ota);
+  web.begin();
+  Serial.setMuted(false);
+
+  AsyncWebServer* server = AsyncWebServer::simOnPort(80);
+  if (!server) {
+    printf("❌ Web server did not start\n");
+    return 1;
+  }
+
+  // The ETag of the current snapshot, as a browser would have kept it
+  AsyncWebServerRequest first(HTTP_GET, "/api/status");
+  server->simRequest(first);
+  String etag = first.simResponseHeader("ETag");
+  if (first.simResponseCode() != 200 || etag.length() == 0) {
+    printf("❌ /api/status returned %d without an ETag\n", first.simResponseCode());
+    return 1;
+  }
+
+  Serial.setMuted(true);
+  BenchResult rebuild = run(*server, web, requests, true, String());
+  BenchResult snapshot = run(*server, web, requests, false, String());
+  BenchResult conditional = run(*server, web, requests, false, etag);
+  Serial.setMuted(false);
+
+  printf("\n%-12s %4s %6s  %10s", "Case", "Code", "Bytes", "Req/s");
+  if (BENCH_COUNTS_HEAP) printf("  %8s  %9s", "Allocs", "Heap B");
+  printf("\n");
+  print("rebuild", rebuild);
+  print("snapshot", snapshot);
+  print("conditional", conditional);
+
+  printf("\n━━━ STATUS BENCH SUMMARY ━━━\n");
+  printf("Requests:       %ld per case, ETag %s\n", requests, etag.c_str());
+  printf("Snapshot:       %.1fx the rate of rebuilding\n", snapshot.perSecond / rebuild.perSecond);
+  printf("Conditional:    %.1fx the rate of rebuilding\n", conditional.perSecond / rebuild.perSecond);
+  if (BENCH_COUNTS_HEAP) {
+    printf("Heap churn:     %.0f -> %.0f bytes per request (%.0f with If-None-Match)\n",
+           rebuild.bytesPerRequest, snapshot.bytesPerRequest, conditional.bytesPerRequest);
+  }
+  return 0;
+}
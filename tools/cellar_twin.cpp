@@ -0,0 +1,387 @@
+// Host tool: physical model of the cellar run in closed loop with the
+// unmodified FanController, to compare control strategies over years of
+// weather on condensation risk, humidity and fan energy.
+//
+//   pio run -e cellar_twin
+//   .pio/build/cellar_twin/program [options] [--fs DIR]...
+//
+//   --fs DIR            strategy to simulate: DIR/config.json, or the firmware
+//                       defaults if DIR has none (repeatable; default
+//                       .pio/simfs). A "fan off" run is always added.
+//   --years N           simulated duration (default 10)
+//   --start EPOCH       wall clock at boot, UTC seconds (default 2026-01-01)
+//   --weather FILE      recorded outdoor weather, CSV "hours,out_temp,out_rh"
+//                       (firmware_sim scenarios also work), looped to cover
+//                       the duration (default: synthetic weather)
+//   --seed N            synthetic weather seed (default 1)
+//   --climate MEAN:SWING  outdoor annual mean and half-range, °C (default 10:9)
+//   --ground MEAN:SWING   ground temperature at the walls, °C (default 11:3)
+//   --volume M3         cellar air volume (default 60)
+//   --flow M3H          fan airflow at 100% speed (default 250)
+//   --infiltration ACH  air changes per hour with the fan off (default 0.2)
+//   --ingress G/H       moisture entering the walls from the ground (default 15)
+//   --fan-watts W       electrical power at 100% speed (default 40)
+//   --goal RH           humidity the cellar should stay below (default 70)
+//
+// Model, integrated on the DECISION_INTERVAL grid:
+//   - cellar air: one well-mixed volume; temperature and absolute humidity
+//     relax towards outside air at the ventilation rate (infiltration plus fan
+//     airflow, proportional to speed) and towards the wall surface
+//   - walls: a lumped heat capacity coupled to the ground, and a moisture
+//     buffer whose equilibrium RH exchanges vapour with the air and is fed by
+//     ground moisture
+//   - condensation: air above saturation at the wall temperature deposits the
+//     excess on the walls
+//   - energy: a phase-cut fan draws W * (0.4 + 0.6 * speed / 100) while on
+//
+// The sensors read the model exactly; millis() restarts at 0 for every
+// strategy, as after a boot.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <math.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+#include "planner.h"
+#include "efficiency.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+
+#define MAGNUS_A 17.27f
+#define MAGNUS_B 237.7f
+#define AIR_HEAT_CAPACITY 1.206f   // kJ/(m3 K)
+
+struct CellarParams {
+  float volume;         // m3
+  float fanFlow;        // m3/h at 100%
+  float infiltration;   // air changes per hour
+  float airWallTauH;    // air temperature relaxation towards the walls
+  float wallHeat;       // kJ/K, wall layer that follows the air
+  float groundTauH;     // wall temperature relaxation towards the ground
+  float groundMean, groundSwing;
+  float surface;        // m3/h, vapour exchange between walls and air
+  float buffer;         // g of wall moisture between 0 and 100% RH
+  float ingress;        // g/h into the walls from the ground
+  float fanWatts;
+};
+
+struct CellarState {
+  float airTemp;
+  float airAh;          // g/m3
+  float wallTemp;
+  float wallRh;         // 0..1, equilibrium RH of the wall moisture buffer
+};
+
+struct WeatherRow {
+  double hours;
+  float temp, rh;
+};
+
+struct RunResult {
+  const char* name;
+  double runH;
+  double energyKWh;
+  double aboveH;
+  double mouldH;
+  double condensingH;
+  double condensedKg;
+  double rhSum;
+  uint32_t starts;
+  uint64_t steps;
+};
+
+static CellarParams model = {
+  60, 250, 0.2f, 0.3f, 15000, 48, 11, 3, 200, 50000, 15, 40
+};
+static std::vector<WeatherRow> weather;
+static float climateMean = 10, climateSwing = 9;
+static float goal = 70;
+static uint32_t seed = 1;
+static time_t startEpoch = 1767225600;  // 2026-01-01 00:00 UTC
+
+static float absoluteHumidity(float temp, float rh) {
+  float es = 6.112f * expf(MAGNUS_A * temp / (MAGNUS_B + temp));
+  return es * rh * 2.1674f / (273.15f + temp);
+}
+
+static float relativeHumidity(float temp, float ah) {
+  float rh = 100.0f * ah / absoluteHumidity(temp, 100.0f);
+  return rh > 100.0f ? 100.0f : rh;
+}
+
+static bool loadWeather(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    double hours;
+    float v[4];
+    int n = sscanf(line, "%lf,%f,%f,%f,%f", &hours, &v[0], &v[1], &v[2], &v[3]);
+    // firmware_sim scenarios carry the inside readings first
+    if (n == 3) weather.push_back({ hours, v[0], v[1] });
+    else if (n == 5) weather.push_back({ hours, v[2], v[3] });
+  }
+  fclose(f);
+  return weather.size() >= 2;
+}
+
+// Outdoor weather, advanced once per simulated minute
+class WeatherSource {
+public:
+  WeatherSource() : rng(seed), noise(0.0f, 1.0f), anomaly(0), dryness(0), cursor(0) {}
+
+  void at(double hours, float& temp, float& rh) {
+    if (!weather.empty()) {
+      recorded(hours, temp, rh);
+    } else {
+      synthetic(hours, temp, rh);
+    }
+  }
+
+private:
+  std::mt19937 rng;
+  std::normal_distribution<float> noise;
+  float anomaly;    // passing fronts, °C
+  float dryness;    // dew point depression anomaly, °C
+  size_t cursor;
+
+  void recorded(double hours, float& temp, float& rh) {
+    double span = weather.back().hours - weather.front().hours;
+    double h = weather.front().hours + fmod(hours, span);
+    if (h < weather[cursor].hours) cursor = 0;
+    while (cursor + 2 < weather.size() && weather[cursor + 1].hours <= h) cursor++;
+    const WeatherRow& a = weather[cursor];
+    const WeatherRow& b = weather[cursor + 1];
+    float t = (float)((h - a.hours) / (b.hours - a.hours));
+    temp = a.temp + (b.temp - a.temp) * t;
+    rh = a.rh + (b.rh - a.rh) * t;
+  }
+
+  // Seasonal and diurnal cycles with fronts as a 3-day AR(1) process. The dew
+  // point follows the daily mean, so nights are damp and afternoons dry.
+  void synthetic(double hours, float& temp, float& rh) {
+    const float dtH = 1.0f / 60.0f;
+    anomaly += -anomaly * dtH / 72.0f + 0.35f * sqrtf(dtH) * noise(rng);
+    dryness += -dryness * dtH / 36.0f + 0.25f * sqrtf(dtH) * noise(rng);
+
+    double day = startDay() + hours / 24.0;
+    float season = -cosf((float)(2 * M_PI * (day - 15) / 365.25));
+    float mean = climateMean + climateSwing * season + anomaly;
+    float diurnal = sinf((float)(2 * M_PI * (fmod(hours, 24.0) - 9) / 24.0));
+    temp = mean + (3.0f + 2.0f * season) * diurnal;
+    float dew = mean - (3.0f + 1.5f * season) - fabsf(dryness);
+    if (dew > temp) dew = temp;
+    rh = 100.0f * absoluteHumidity(dew, 100.0f) * (273.15f + dew) /
+         (absoluteHumidity(temp, 100.0f) * (273.15f + temp));
+  }
+
+  double startDay() const {
+    struct tm info;
+    gmtime_r(&startEpoch, &info);
+    return info.tm_yday + info.tm_hour / 24.0;
+  }
+};
+
+static float groundTemp(double hours) {
+  struct tm info;
+  gmtime_r(&startEpoch, &info);
+  double day = info.tm_yday + hours / 24.0;
+  // The ground lags the air by about two months
+  return model.groundMean - model.groundSwing * cosf((float)(2 * M_PI * (day - 75) / 365.25));
+}
+
+// Advances the cellar by dtH hours at fan speed; returns grams condensed
+static float stepCellar(CellarState& s, float dtH, int speed, float outTemp, float outAh,
+                        float ground) {
+  float flow = model.infiltration * model.volume + model.fanFlow * speed / 100.0f;
+  float exchange = fminf(flow / model.volume * dtH, 1.0f);
+
+  float toWall = dtH / model.airWallTauH * (s.airTemp - s.wallTemp);
+  s.airTemp += exchange * (outTemp - s.airTemp) - toWall;
+  s.wallTemp += dtH / model.groundTauH * (ground - s.wallTemp) +
+                toWall * model.volume * AIR_HEAT_CAPACITY / model.wallHeat;
+
+  float wallSat = absoluteHumidity(s.wallTemp, 100.0f);
+  float released = model.surface * (s.wallRh * wallSat - s.airAh) * dtH;
+  s.airAh += exchange * (outAh - s.airAh) + released / model.volume;
+  s.wallRh += (model.ingress * dtH - released) / model.buffer;
+
+  float condensed = 0;
+  if (s.airAh > wallSat) {
+    condensed = (s.airAh - wallSat) * model.volume;
+    s.airAh = wallSat;
+    s.wallRh += condensed / model.buffer;
+  }
+  // Beyond saturation the walls are wet and the excess drains away
+  if (s.wallRh > 1.0f) s.wallRh = 1.0f;
+  if (s.wallRh < 0.0f) s.wallRh = 0.0f;
+  return condensed;
+}
+
+static void readSensor(SensorData& data, float temp, float rh, unsigned long now) {
+  data.temperature = temp;
+  data.humidity = rh;
+  data.dewPoint = SensorManagerBase::calculateDewPoint(temp, rh);
+  data.valid = true;
+  data.lastUpdate = now;
+}
+
+static RunResult run(const char* name, bool fanEnabled, double years) {
+  RunResult r;
+  memset(&r, 0, sizeof(r));
+  r.name = name;
+
+  // A fresh planner and estimator per strategy, learning from the boot on
+  // (not persisted)
+  FanController fan;
+  VentilationPlanner planner;
+  EfficiencyEstimator efficiency;
+  fan.setPlanner(&planner);
+  fan.setEstimator(&efficiency);
+  currentMode = fanEnabled ? MODE_AUTO : MODE_MANUAL_OFF;
+  manualOverrideUntil = 0;
+  sim::setNowUs(0);
+  sim::setEpoch(startEpoch);
+
+  WeatherSource source;
+  float ground = groundTemp(0);
+  CellarState s;
+  s.airTemp = ground;
+  s.wallTemp = ground;
+  s.wallRh = 0.75f;
+  s.airAh = s.wallRh * absoluteHumidity(ground, 100.0f);
+
+  SensorData internal, external;
+  float outTemp = 0, outRh = 0, outAh = 0;
+  const float dtH = DECISION_INTERVAL / 3.6e6f;
+  const uint64_t steps = (uint64_t)(years * 365.25 * 86400000.0 / DECISION_INTERVAL);
+  const uint64_t stepsPerMinute = 60000 / DECISION_INTERVAL;
+  int prevSpeed = 0;
+
+  for (uint64_t i = 0; i < steps; i++) {
+    uint64_t ms = i * DECISION_INTERVAL;
+    sim::setNowUs(ms * 1000);
+    double hours = ms / 3.6e6;
+    if (i % stepsPerMinute == 0) {
+      source.at(hours, outTemp, outRh);
+      outAh = absoluteHumidity(outTemp, outRh);
+      ground = groundTemp(hours);
+      readSensor(external, outTemp, outRh, millis());
+    }
+    external.lastUpdate = millis();
+
+    float rh = relativeHumidity(s.airTemp, s.airAh);
+    readSensor(internal, s.airTemp, rh, millis());
+    fan.update(internal, external);
+    int speed = fan.getCurrentSpeed();
+    planner.update(internal, external, speed);
+    efficiency.update(internal, external, speed);
+
+    if (speed > 0) {
+      r.runH += dtH;
+      r.energyKWh += model.fanWatts * (0.4f + 0.6f * speed / 100.0f) * dtH / 1000.0f;
+      if (prevSpeed == 0) r.starts++;
+    }
+    prevSpeed = speed;
+
+    float condensed = stepCellar(s, dtH, speed, outTemp, outAh, ground);
+    float surfaceRh = relativeHumidity(s.wallTemp, s.airAh);
+    r.rhSum += rh;
+    if (rh > goal) r.aboveH += dtH;
+    if (surfaceRh >= 80.0f) r.mouldH += dtH;
+    if (condensed > 0) {
+      r.condensingH += dtH;
+      r.condensedKg += condensed / 1000.0f;
+    }
+  }
+  r.steps = steps;
+  return r;
+}
+
+static bool parsePair(const char* s, float& a, float& b) {
+  return sscanf(s, "%f:%f", &a, &b) == 2;
+}
+
+static void usage() {
+  printf("usage: cellar_twin [--fs DIR]... [--years N] [--start EPOCH] [--weather FILE]\n"
+         "                   [--seed N] [--climate MEAN:SWING] [--ground MEAN:SWING]\n"
+         "                   [--volume M3] [--flow M3H] [--infiltration ACH]\n"
+         "                   [--ingress G/H] [--fan-watts W] [--goal RH]\n");
+}
+
+int main(int argc, char** argv) {
+  double years = 10;
+  std::vector<const char*> strategies;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    bool ok = true;
+    if (!strcmp(argv[i], "--fs") && hasValue) strategies.push_back(argv[++i]);
+    else if (!strcmp(argv[i], "--years") && hasValue) years = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--start") && hasValue) startEpoch = (time_t)strtoll(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--weather") && hasValue) {
+      const char* path = argv[++i];
+      if (!loadWeather(path)) {
+        printf("❌ Cannot read weather %s\n", path);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "--seed") && hasValue) seed = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--climate") && hasValue) ok = parsePair(argv[++i], climateMean, climateSwing);
+    else if (!strcmp(argv[i], "--ground") && hasValue) ok = parsePair(argv[++i], model.groundMean, model.groundSwing);
+    else if (!strcmp(argv[i], "--volume") && hasValue) model.volume = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--flow") && hasValue) model.fanFlow = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--infiltration") && hasValue) model.infiltration = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--ingress") && hasValue) model.ingress = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--fan-watts") && hasValue) model.fanWatts = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--goal") && hasValue) goal = atof(argv[++i]);
+    else ok = false;
+    if (!ok || model.volume <= 0 || years <= 0) {
+      usage();
+      return 1;
+    }
+  }
+  if (strategies.empty()) strategies.push_back(".pio/simfs");
+
+  // Same local time zone as the device (setupWiFi)
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+
+  printf("🔧 %.1f years of %s, %.0f m3 cellar, fan %.0f m3/h\n", years,
+         weather.empty() ? "synthetic weather" : "recorded weather", model.volume, model.fanFlow);
+
+  std::vector<RunResult> results;
+  auto start = std::chrono::steady_clock::now();
+  Serial.setMuted(true);
+  results.push_back(run("fan off", false, years));
+  for (const char* dir : strategies) {
+    LittleFS.simSetRoot(dir);
+    bool fromFile = loadConfig();
+    results.push_back(run(fromFile ? dir : "firmware defaults", true, years));
+  }
+  Serial.setMuted(false);
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t totalSteps = 0;
+  for (const RunResult& r : results) totalSteps += r.steps;
+  printf("✓ %.2f s wall, %.0fx real time\n", wallS,
+         wallS > 0 ? totalSteps * (DECISION_INTERVAL / 1000.0) / wallS : 0);
+
+  printf("\n━━━ PER YEAR (goal %.0f%% RH) ━━━\n", goal);
+  printf("%-24s %8s %7s %7s %8s %9s %8s %9s %7s\n", "strategy", "fan h", "starts", "kWh",
+         "mean RH", "above h", "mould h", "condens h", "kg");
+  for (const RunResult& r : results) {
+    printf("%-24.24s %8.0f %7.0f %7.1f %7.1f%% %9.0f %8.0f %9.0f %7.1f\n", r.name,
+           r.runH / years, r.starts / years, r.energyKWh / years,
+           r.steps ? r.rhSum / r.steps : 0, r.aboveH / years, r.mouldH / years,
+           r.condensingH / years, r.condensedKg / years);
+  }
+  printf("\nmould h: wall surface at or above 80%% RH; condens h/kg: air saturated at the walls\n");
+  return 0;
+}
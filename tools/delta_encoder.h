@@ -0,0 +1,198 @@
+#ifndef DELTA_ENCODER_H
+#define DELTA_ENCODER_H
+
+// Host-side builder of delta patches (see delta.h), bsdiff-style: every run
+// of the new image that lines up with the base, give or take a few changed
+// bytes, becomes a DELTA_ADD of the bytewise difference, which is mostly
+// zeros; what has no counterpart becomes a DELTA_INSERT. The op stream is
+// then deflated with a window the device's ring can hold.
+//
+// Matches are found through a hash of every 8-byte run of the base. An exact
+// match is grown backwards and then forwards across mismatches for as long
+// as at least half the bytes still agree, like bsdiff's extension.
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <mbedtls/sha256.h>
+#include "delta.h"
+
+#define DELTA_SEED 8            // bytes hashed to find a match
+#define DELTA_MIN_MATCH 16      // shorter exact matches are inserted instead
+#define DELTA_HASH_BITS 20
+#define DELTA_CANDIDATES 64     // base positions tried per new position
+#define DELTA_MAX_MISMATCH 64   // extension gives up this far past its best
+
+struct DeltaStats {
+  uint32_t adds;
+  uint32_t inserts;
+  uint64_t addBytes;
+  uint64_t insertBytes;
+  uint64_t opBytes;      // op stream before deflate
+};
+
+inline void deltaSha256(const std::string& data, uint8_t* out) {
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  mbedtls_sha256_update(&sha, (const uint8_t*)data.data(), data.size());
+  mbedtls_sha256_finish(&sha, out);
+  mbedtls_sha256_free(&sha);
+}
+
+inline void deltaPutLE32(std::string& out, uint32_t v) {
+  for (int i = 0; i < 4; i++) out.push_back((char)(v >> (i * 8)));
+}
+
+inline uint32_t deltaSeedHash(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - DELTA_HASH_BITS));
+}
+
+struct DeltaRun {
+  size_t newStart;
+  size_t oldStart;   // SIZE_MAX: insert
+  size_t len;
+};
+
+// Runs covering all of newImage, in order
+inline std::vector<DeltaRun> findDeltaRuns(const std::string& oldImage, const std::string& newImage) {
+  const uint8_t* o = (const uint8_t*)oldImage.data();
+  const uint8_t* n = (const uint8_t*)newImage.data();
+  size_t oldSize = oldImage.size();
+  size_t newSize = newImage.size();
+
+  std::vector<uint32_t> heads((size_t)1 << DELTA_HASH_BITS, UINT32_MAX);
+  std::vector<uint32_t> chain(oldSize, UINT32_MAX);
+  for (size_t i = 0; i + DELTA_SEED <= oldSize; i++) {
+    uint32_t h = deltaSeedHash(o + i);
+    chain[i] = heads[h];
+    heads[h] = (uint32_t)i;
+  }
+
+  std::vector<DeltaRun> runs;
+  size_t pending = 0;       // start of new bytes not covered yet
+  size_t shift = 0;         // oldStart - newStart of the last match
+  bool shifted = false;
+  size_t p = 0;
+  while (p + DELTA_SEED <= newSize) {
+    size_t bestOld = 0;
+    size_t bestLen = 0;
+    auto consider = [&](size_t candidate) {
+      if (candidate >= oldSize) return;
+      size_t len = 0;
+      size_t limit = std::min(oldSize - candidate, newSize - p);
+      while (len < limit && o[candidate + len] == n[p + len]) len++;
+      if (len > bestLen) {
+        bestLen = len;
+        bestOld = candidate;
+      }
+    };
+    // The last match's alignment first: code after a change usually keeps it
+    if (shifted) consider(p + shift);
+    uint32_t candidate = heads[deltaSeedHash(n + p)];
+    for (int tries = 0; candidate != UINT32_MAX && tries < DELTA_CANDIDATES; tries++) {
+      consider(candidate);
+      candidate = chain[candidate];
+    }
+    if (bestLen < DELTA_MIN_MATCH) {
+      p++;
+      continue;
+    }
+
+    // Backwards over the bytes not covered yet, exact only
+    while (p > pending && bestOld > 0 && o[bestOld - 1] == n[p - 1]) {
+      p--;
+      bestOld--;
+      bestLen++;
+    }
+    // Forwards across changed bytes while at least half still agree
+    size_t end = bestLen;
+    long score = 0;
+    long bestScore = 0;
+    for (size_t i = bestLen; p + i < newSize && bestOld + i < oldSize && i - end < DELTA_MAX_MISMATCH; i++) {
+      score += o[bestOld + i] == n[p + i] ? 1 : -1;
+      if (score > bestScore) {
+        bestScore = score;
+        end = i + 1;
+      }
+    }
+
+    if (p > pending) runs.push_back({pending, SIZE_MAX, p - pending});
+    DeltaRun* last = runs.empty() ? nullptr : &runs.back();
+    if (last && last->oldStart != SIZE_MAX && last->newStart + last->len == p &&
+        last->oldStart + last->len == bestOld) {
+      last->len += end;   // carries on where the last one stopped
+    } else {
+      runs.push_back({p, bestOld, end});
+    }
+    p += end;
+    pending = p;
+    shift = bestOld - (p - end);
+    shifted = true;
+  }
+  if (pending < newSize) runs.push_back({pending, SIZE_MAX, newSize - pending});
+  return runs;
+}
+
+// Builds the patch that turns oldImage into newImage; false if zlib fails
+inline bool buildDelta(const std::string& oldImage, const std::string& newImage, std::string& patch,
+                       DeltaStats& stats) {
+  memset(&stats, 0, sizeof(stats));
+  std::string ops;
+  for (const DeltaRun& run : findDeltaRuns(oldImage, newImage)) {
+    if (run.oldStart == SIZE_MAX) {
+      ops.push_back((char)DELTA_INSERT);
+      deltaPutLE32(ops, (uint32_t)run.len);
+      ops.append(newImage, run.newStart, run.len);
+      stats.inserts++;
+      stats.insertBytes += run.len;
+    } else {
+      ops.push_back((char)DELTA_ADD);
+      deltaPutLE32(ops, (uint32_t)run.oldStart);
+      deltaPutLE32(ops, (uint32_t)run.len);
+      for (size_t i = 0; i < run.len; i++) {
+        ops.push_back((char)(uint8_t)(newImage[run.newStart + i] - oldImage[run.oldStart + i]));
+      }
+      stats.adds++;
+      stats.addBytes += run.len;
+    }
+  }
+  ops.push_back((char)DELTA_END);
+  stats.opBytes = ops.size();
+
+  DeltaHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = DELTA_MAGIC;
+  header.version = DELTA_VERSION;
+  header.windowBits = DELTA_WINDOW_BITS;
+  header.baseSize = (uint32_t)oldImage.size();
+  header.imageSize = (uint32_t)newImage.size();
+  deltaSha256(oldImage, header.baseSha256);
+  deltaSha256(newImage, header.imageSha256);
+  patch.assign((const char*)&header, sizeof(header));
+
+  // Raw deflate; zlib keeps its distances inside the window
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -DELTA_WINDOW_BITS, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  std::vector<uint8_t> out(deflateBound(&stream, ops.size()));
+  stream.next_in = (Bytef*)ops.data();
+  stream.avail_in = (uInt)ops.size();
+  stream.next_out = out.data();
+  stream.avail_out = (uInt)out.size();
+  int result = deflate(&stream, Z_FINISH);
+  size_t compressed = out.size() - stream.avail_out;
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) return false;
+  patch.append((const char*)out.data(), compressed);
+  return true;
+}
+
+#endif
@@ -0,0 +1,56 @@
+# Build step: gzips web/index.html into a C array for WebServerManager, with
+# a strong ETag from the compressed bytes.
+#
+# Runs as a PlatformIO pre-script (extra_scripts) and writes
+# <build dir>/generated/dashboard.h, which is added to the include path.
+# Outside PlatformIO: python3 tools/embed_dashboard.py web/index.html out.h
+
+import gzip
+import hashlib
+import os
+import sys
+
+
+def embed(source, target):
+    with open(source, "rb") as f:
+        html = f.read()
+    # mtime=0 keeps the output, and so the ETag, the same for the same page
+    data = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha256(data).hexdigest()[:16]
+
+    lines = [
+        "// Generated by tools/embed_dashboard.py from %s, do not edit" % os.path.basename(source),
+        "#ifndef DASHBOARD_H",
+        "#define DASHBOARD_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "#define DASHBOARD_ETAG \"\\\"%s\\\"\"" % etag,
+        "#define DASHBOARD_GZ_LEN %d   // %d bytes uncompressed" % (len(data), len(html)),
+        "",
+        "static const uint8_t DASHBOARD_GZ[] PROGMEM = {",
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines += ["};", "", "#endif", ""]
+    text = "\n".join(lines)
+
+    # Unchanged output keeps its timestamp, so nothing recompiles
+    if os.path.exists(target):
+        with open(target) as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(target) or ".", exist_ok=True)
+    with open(target, "w") as f:
+        f.write(text)
+    print("Dashboard: %d -> %d bytes gzipped, ETag %s" % (len(html), len(data), etag))
+
+
+if __name__ == "__main__" and len(sys.argv) == 3:
+    embed(sys.argv[1], sys.argv[2])
+else:
+    Import("env")  # noqa: F821 (SCons)
+    generated = os.path.join(env.subst("$BUILD_DIR"), "generated")  # noqa: F821
+    embed(os.path.join(env.subst("$PROJECT_DIR"), "web", "index.html"),  # noqa: F821
+          os.path.join(generated, "dashboard.h"))
+    env.Append(CPPPATH=[generated])  # noqa: F821
@@ -0,0 +1,251 @@
+// Host simulator: runs the unmodified firmware (src/main.cpp setup()/loop())
+// against the hardware stand-ins in sim/ with scripted sensor inputs.
+//
+//   pio run -e native && .pio/build/native/program [options]
+//
+//   --days N          simulated duration (default 30)
+//   --step-ms N       minimum simulated time per loop() pass, incl. the idle
+//                     wait at the end of loop() (default 1000; 1 = real pacing)
+//   --scenario FILE   CSV "hours,in_temp,in_rh,out_temp,out_rh", linearly
+//                     interpolated, last row held (default: synthetic weather)
+//   --start EPOCH     wall clock at boot, UTC seconds (default 2026-01-01)
+//   --fs DIR          LittleFS root on the host (default .pio/simfs)
+//   --offline         boot without a WiFi link (no web server, OTA or MQTT)
+//   --verbose         show the firmware's serial output
+//
+// Readings are fed through the AHT20/SHT4x models behind the TCA9548A, so the
+// real drivers and SensorManager are exercised. Pressure comes from the
+// BMP280 model and is fixed. Bme280Driver builds run, but its humidity and
+// temperature are the model's constant datasheet values.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+#include "sim_i2c_devices.h"
+
+void setup();
+void loop();
+extern FanController fanController;
+
+struct ScenarioRow {
+  double hours;
+  float inTemp, inHumidity, outTemp, outHumidity;
+};
+
+static std::vector<ScenarioRow> scenario;
+
+static SimTca9548a mux;
+static SimMuxedDevice boschPort(mux);
+static SimMuxedDevice ahtPort(mux);
+static SimMuxedDevice shtPort(mux);
+static SimBmx280 boschInternal(0x58), boschExternal(0x58);
+static SimBmx280 bmeInternal(0x60), bmeExternal(0x60);
+static SimAht20 ahtInternal, ahtExternal;
+static SimSht4x shtInternal, shtExternal;
+
+static bool loadScenario(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    ScenarioRow r;
+    if (sscanf(line, "%lf,%f,%f,%f,%f", &r.hours, &r.inTemp, &r.inHumidity,
+               &r.outTemp, &r.outHumidity) == 5) {
+      scenario.push_back(r);
+    }
+  }
+  fclose(f);
+  return !scenario.empty();
+}
+
+// Synthetic weather: a damp cellar with a slow weekly swing, outside air with
+// a diurnal cycle (coldest and most humid before dawn) and passing fronts.
+static ScenarioRow syntheticAt(double hours) {
+  ScenarioRow r;
+  double day = hours / 24.0;
+  double diurnal = sin(2 * M_PI * (hours - 9.0) / 24.0);
+  double front = sin(2 * M_PI * day / 5.3);
+  r.hours = hours;
+  r.inTemp = 13.0 + 0.4 * sin(2 * M_PI * day / 7.0);
+  r.inHumidity = 72.0 + 5.0 * sin(2 * M_PI * day / 7.0 + 1.0);
+  r.outTemp = 6.0 + 5.0 * diurnal + 3.0 * front;
+  r.outHumidity = 78.0 - 18.0 * diurnal + 6.0 * front;
+  if (r.outHumidity > 99) r.outHumidity = 99;
+  return r;
+}
+
+static ScenarioRow scenarioAt(double hours) {
+  if (scenario.empty()) return syntheticAt(hours);
+  if (hours <= scenario.front().hours) return scenario.front();
+  for (size_t i = 1; i < scenario.size(); i++) {
+    const ScenarioRow& a = scenario[i - 1];
+    const ScenarioRow& b = scenario[i];
+    if (hours <= b.hours) {
+      float t = (float)((hours - a.hours) / (b.hours - a.hours));
+      ScenarioRow r;
+      r.hours = hours;
+      r.inTemp = a.inTemp + (b.inTemp - a.inTemp) * t;
+      r.inHumidity = a.inHumidity + (b.inHumidity - a.inHumidity) * t;
+      r.outTemp = a.outTemp + (b.outTemp - a.outTemp) * t;
+      r.outHumidity = a.outHumidity + (b.outHumidity - a.outHumidity) * t;
+      return r;
+    }
+  }
+  return scenario.back();
+}
+
+static void attachSensors() {
+  Wire.detachAll();
+  Wire.attach(MUX_ADDR, &mux);
+  bool bme = strcmp(SensorManager::driverName(), Bme280Driver::name()) == 0;
+  boschPort.bind(MUX_CHANNEL_INTERNAL, bme ? &bmeInternal : &boschInternal);
+  boschPort.bind(MUX_CHANNEL_EXTERNAL, bme ? &bmeExternal : &boschExternal);
+  ahtPort.bind(MUX_CHANNEL_INTERNAL, &ahtInternal);
+  ahtPort.bind(MUX_CHANNEL_EXTERNAL, &ahtExternal);
+  shtPort.bind(MUX_CHANNEL_INTERNAL, &shtInternal);
+  shtPort.bind(MUX_CHANNEL_EXTERNAL, &shtExternal);
+  Wire.attach(BMP280_ADDR_INTERNAL, &boschPort);
+  Wire.attach(0x38, &ahtPort);
+  Wire.attach(0x44, &shtPort);
+}
+
+static void applyScenario(double hours) {
+  ScenarioRow r = scenarioAt(hours);
+  ahtInternal.setReading(r.inTemp, r.inHumidity);
+  ahtExternal.setReading(r.outTemp, r.outHumidity);
+  shtInternal.setReading(r.inTemp, r.inHumidity);
+  shtExternal.setReading(r.outTemp, r.outHumidity);
+}
+
+static void usage() {
+  printf("usage: firmware_sim [--days N] [--step-ms N] [--scenario FILE] [--start EPOCH]\n"
+         "                    [--fs DIR] [--offline] [--verbose]\n");
+}
+
+int main(int argc, char** argv) {
+  double days = 30;
+  unsigned long stepMs = 1000;
+  bool offline = false;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--days") && hasValue) {
+      days = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--step-ms") && hasValue) {
+      stepMs = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--scenario") && hasValue) {
+      const char* path = argv[++i];
+      if (!loadScenario(path)) {
+        printf("❌ Cannot read scenario %s\n", path);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--start") && hasValue) {
+      sim::setEpoch((time_t)strtoll(argv[++i], nullptr, 10));
+    } else if (!strcmp(argv[i], "--fs") && hasValue) {
+      LittleFS.simSetRoot(argv[++i]);
+    } else if (!strcmp(argv[i], "--offline")) {
+      offline = true;
+    } else if (!strcmp(argv[i], "--verbose")) {
+      verbose = true;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (stepMs < 1) stepMs = 1;
+
+  attachSensors();
+  applyScenario(0);
+  WiFi.simSetLink(!offline);
+  Serial.setMuted(!verbose);
+
+  printf("🔧 Simulating %.1f days, %lu ms per loop pass, driver %s, %s\n",
+         days, stepMs, SensorManager::driverName(),
+         scenario.empty() ? "synthetic weather" : "scripted scenario");
+
+  auto wallStart = std::chrono::steady_clock::now();
+  setup();
+  uint64_t bootUs = sim::nowUs();
+
+  const uint64_t endUs = bootUs + (uint64_t)(days * 86400.0 * 1e6);
+  const uint64_t stepUs = (uint64_t)stepMs * 1000;
+  uint64_t iterations = 0;
+  uint64_t loopNsTotal = 0;
+  uint64_t loopNsMax = 0;
+  // Percentiles from an evenly strided sample of at most 2^20 passes
+  std::vector<uint32_t> loopNs;
+  loopNs.reserve(1 << 20);
+  const uint64_t sampleStride = (endUs - bootUs) / stepUs / loopNs.capacity() + 1;
+
+  uint64_t relayOnUs = 0;
+  uint64_t levelUs = 0;   // integral of dimmer level (percent * us)
+  uint32_t relayStarts = 0;
+  bool relayOn = false;
+  unsigned long lastMinute = (unsigned long)-1;
+
+  while (sim::nowUs() < endUs) {
+    uint64_t passStart = sim::nowUs();
+
+    // Inputs change slowly: refresh the device models once per simulated minute
+    unsigned long minute = (unsigned long)((passStart - bootUs) / 60000000ULL);
+    if (minute != lastMinute) {
+      applyScenario((passStart - bootUs) / 3.6e9);
+      lastMinute = minute;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    loop();
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    loopNsTotal += ns;
+    if (ns > loopNsMax) loopNsMax = ns;
+    if (iterations % sampleStride == 0) loopNs.push_back((uint32_t)std::min<uint64_t>(ns, UINT32_MAX));
+    iterations++;
+
+    // Fast-forward the rest of the pass (loop() already spent its idle wait)
+    uint64_t spent = sim::nowUs() - passStart;
+    if (spent < stepUs) sim::advanceUs(stepUs - spent);
+    uint64_t passUs = sim::nowUs() - passStart;
+
+    // Relay is active LOW
+    bool on = sim::pinState(PIN_RELAY) == LOW;
+    if (on && !relayOn) relayStarts++;
+    relayOn = on;
+    if (on) {
+      relayOnUs += passUs;
+      rbdimmer_channel_t* ch = sim_rbdimmer_channel(0);
+      if (ch) levelUs += (uint64_t)rbdimmer_get_level(ch) * passUs;
+    }
+  }
+
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double simS = (sim::nowUs() - bootUs) / 1e6;
+
+  std::sort(loopNs.begin(), loopNs.end());
+  uint32_t p50 = loopNs.empty() ? 0 : loopNs[loopNs.size() / 2];
+  uint32_t p99 = loopNs.empty() ? 0 : loopNs[loopNs.size() * 99 / 100];
+
+  Serial.setMuted(false);
+  printf("\n━━━ SIMULATION SUMMARY ━━━\n");
+  printf("Simulated:     %.2f days in %.2f s wall (%.0fx real time)\n", simS / 86400, wallS,
+         wallS > 0 ? simS / wallS : 0);
+  printf("loop() passes: %llu\n", (unsigned long long)iterations);
+  printf("loop() cost:   mean %.0f ns, p50 %u ns, p99 %u ns, max %llu ns (host)\n",
+         iterations ? (double)loopNsTotal / iterations : 0, p50, p99, (unsigned long long)loopNsMax);
+  printf("Fan runtime:   %.1f h (%.1f%%), %u starts, mean level %.0f%%\n", relayOnUs / 3.6e9,
+         simS > 0 ? 100.0 * relayOnUs / 1e6 / simS : 0, relayStarts,
+         relayOnUs ? (double)levelUs / relayOnUs : 0);
+  printf("Sensor bus:    %u transactions, %.1f s SCL time\n", Wire.stats().transactions,
+         Wire.busTimeUs() / 1e6);
+  printf("Final state:   %s\n", fanController.getStatusText().c_str());
+  return 0;
+}
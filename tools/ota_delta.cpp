@@ -0,0 +1,104 @@
+// Host tool: builds a delta patch that turns the firmware a device runs into
+// a new one, and checks it by applying it through OtaUpdater on the
+// simulator before writing it out.
+//
+//   pio run -e ota_delta
+//   .pio/build/ota_delta/program OLD.bin NEW.bin PATCH
+//
+//   OLD.bin   the image the devices run, exactly as flashed (keep each
+//             release's .pio/build/az-delivery-devkit-v4/firmware.bin)
+//   NEW.bin   the image to update to
+//   PATCH     written only if it applied and produced NEW.bin
+//
+// Then POST the patch to /update like an image (see README, OTA Updates). A
+// device running anything other than OLD.bin refuses it and keeps running.
+// Exits 1 if an image cannot be read or the patch does not apply.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string>
+#include <esp_ota_ops.h>
+#include "ota.h"
+#include "delta_encoder.h"
+
+#define SEGMENT 1436   // TCP segment, as the upload handler gets them
+
+static OtaUpdater ota;
+
+static bool readFile(const char* path, std::string& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    printf("❌ Cannot open %s\n", path);
+    return false;
+  }
+  char buf[65536];
+  size_t n;
+  out.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static bool isImage(const char* path, const std::string& image) {
+  if (!image.empty() && (uint8_t)image[0] == OTA_IMAGE_MAGIC) return true;
+  printf("❌ %s is not an ESP32 app image\n", path);
+  return false;
+}
+
+// As the device would: old image running, patch streamed into OtaUpdater
+static bool applyPatch(const std::string& oldImage, const std::string& newImage,
+                       const std::string& patch, OtaProgress& progress) {
+  simSetRunningImage((const uint8_t*)oldImage.data(), oldImage.size());
+  simResetBootPartition();
+  Serial.setMuted(true);
+  uint32_t session = ota.begin(patch.size(), nullptr);
+  bool ok = session != 0 && ota.isReceiving();
+  for (size_t i = 0; ok && i < patch.size(); i += SEGMENT) {
+    ok = ota.write(session, (const uint8_t*)patch.data() + i, std::min((size_t)SEGMENT, patch.size() - i));
+  }
+  ok = ota.end(session) && ok;
+  Serial.setMuted(false);
+  progress = ota.getProgress();
+  const std::vector<uint8_t>& written = simPartitionData();
+  return ok && simBootPartition() && progress.written == newImage.size() &&
+         !memcmp(written.data(), newImage.data(), newImage.size());
+}
+
+int main(int argc, char** argv) {
+  if (argc != 4) {
+    printf("usage: ota_delta OLD.bin NEW.bin PATCH\n");
+    return 1;
+  }
+  std::string oldImage, newImage;
+  if (!readFile(argv[1], oldImage) || !readFile(argv[2], newImage)) return 1;
+  if (!isImage(argv[1], oldImage) || !isImage(argv[2], newImage)) return 1;
+
+  std::string patch;
+  DeltaStats stats;
+  if (!buildDelta(oldImage, newImage, patch, stats)) {
+    printf("❌ Compression failed\n");
+    return 1;
+  }
+  OtaProgress progress;
+  if (!applyPatch(oldImage, newImage, patch, progress)) {
+    printf("❌ The patch does not reproduce %s: %s\n", argv[2], progress.error);
+    return 1;
+  }
+
+  FILE* f = fopen(argv[3], "wb");
+  if (!f || fwrite(patch.data(), 1, patch.size(), f) != patch.size() || fclose(f) != 0) {
+    printf("❌ Cannot write %s\n", argv[3]);
+    return 1;
+  }
+
+  printf("━━━ DELTA PATCH ━━━\n");
+  printf("Base:      %s, %u bytes\n", argv[1], (unsigned)oldImage.size());
+  printf("Image:     %s, %u bytes\n", argv[2], (unsigned)newImage.size());
+  printf("Ops:       %u add (%llu bytes), %u insert (%llu bytes), %llu bytes before deflate\n",
+         (unsigned)stats.adds, (unsigned long long)stats.addBytes, (unsigned)stats.inserts,
+         (unsigned long long)stats.insertBytes, (unsigned long long)stats.opBytes);
+  printf("Patch:     %s, %u bytes (%.1f%% of the image)\n", argv[3], (unsigned)patch.size(),
+         100.0 * patch.size() / newImage.size());
+  printf("Applied:   ✓ SHA-256 %s\n", progress.sha256);
+  return 0;
+}
@@ -0,0 +1,187 @@
+// Host tool: evaluates a site rule set (rules.h) over recorded traces or
+// synthetic weather and reports what the rules would do and what they cost.
+//
+//   pio run -e rule_bench
+//   .pio/build/rule_bench/program [--fs DIR] [--when EXPR]... [--passes N] [trace.bin...]
+//
+//   --fs DIR     rules from DIR/config.json (default .pio/simfs)
+//   --when EXPR  extra "off" rule, e.g. --when "out.rh > 90" (repeatable)
+//   --passes N   timed passes over the inputs (default 20)
+//
+// Inputs are the SAMPLE records of the traces (GET /api/trace), in the order
+// given, with the wall clock from their BOOT/CLOCK records; without traces a
+// week of synthetic samples at SENSOR_READ_INTERVAL is used. Each sample is
+// one RuleEngine::evaluate(), as in FanController::update(), so the report
+// shows how often a rule decides and how many condition runs the per-input
+// result cache saves. The fan speed input stays 0.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include "config.h"
+#include "sensors.h"
+#include "rules.h"
+#include "trace.h"
+#include "trace_file.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+
+struct BenchSample {
+  uint32_t ms;
+  time_t epoch;      // time() at ms == 0 for this sample's boot, 0 if unsynced
+  SensorData internal;
+  SensorData external;
+};
+
+static SensorData makeData(float temp, float rh, uint32_t ms) {
+  SensorData data;
+  data.temperature = temp;
+  data.humidity = rh;
+  data.dewPoint = SensorManagerBase::calculateDewPoint(temp, rh);
+  data.valid = true;
+  data.lastUpdate = ms;
+  return data;
+}
+
+static void fromTraces(const std::vector<TraceRecord>& recs, std::vector<BenchSample>& out) {
+  time_t epoch = 0;
+  for (const TraceRecord& rec : recs) {
+    if (rec.type == TRACE_BOOT || rec.type == TRACE_CLOCK) {
+      epoch = rec.data.epoch ? (time_t)rec.data.epoch - (time_t)(rec.ms / 1000) : 0;
+    } else if (rec.type == TRACE_SAMPLE &&
+               (rec.flags & TRACE_INTERNAL_VALID) && (rec.flags & TRACE_EXTERNAL_VALID)) {
+      out.push_back({rec.ms, epoch,
+                     makeData(rec.data.centi[0] / 100.0f, rec.data.centi[1] / 100.0f, rec.ms),
+                     makeData(rec.data.centi[2] / 100.0f, rec.data.centi[3] / 100.0f, rec.ms)});
+    }
+  }
+}
+
+static void synthetic(std::vector<BenchSample>& out) {
+  const time_t start = 1767225600;   // 2026-01-01
+  for (uint32_t ms = 0; ms < 7 * 86400000UL; ms += SENSOR_READ_INTERVAL) {
+    float day = ms / 86400000.0f;
+    float phase = 2 * M_PI * day;
+    float outTemp = 4 + 5 * sinf(phase - 2.0f) + 2 * sinf(phase / 3.1f);
+    float outRh = 80 - 12 * sinf(phase - 2.0f) + 8 * sinf(phase / 1.7f);
+    float inTemp = 11 + 0.5f * sinf(phase / 4);
+    float inRh = 68 + 6 * sinf(phase / 2.3f);
+    out.push_back({ms, start,
+                   makeData(inTemp, constrain(inRh, 0.0f, 100.0f), ms),
+                   makeData(outTemp, constrain(outRh, 0.0f, 100.0f), ms)});
+  }
+}
+
+// Evaluates every sample once; hits[i] counts samples where rule i decided
+static void pass(const std::vector<BenchSample>& samples, RuleEngine& engine,
+                 std::vector<uint32_t>* hits, uint32_t* none) {
+  for (const BenchSample& s : samples) {
+    sim::setNowUs((uint64_t)s.ms * 1000);
+    sim::setEpoch(s.epoch);
+    int rule = engine.evaluate(config.rules, s.internal, s.external, 0);
+    if (hits) {
+      if (rule >= 0) (*hits)[rule]++;
+      else (*none)++;
+    }
+  }
+}
+
+static void usage() {
+  printf("usage: rule_bench [--fs DIR] [--when EXPR]... [--passes N] [trace.bin...]\n");
+}
+
+int main(int argc, char** argv) {
+  std::vector<const char*> files;
+  std::vector<const char*> extra;
+  int passes = 20;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--fs") && i + 1 < argc) {
+      LittleFS.simSetRoot(argv[++i]);
+    } else if (!strcmp(argv[i], "--when") && i + 1 < argc) {
+      extra.push_back(argv[++i]);
+    } else if (!strcmp(argv[i], "--passes") && i + 1 < argc) {
+      passes = max(1, atoi(argv[++i]));
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 1;
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+
+  // Same local time zone as the device (setupWiFi)
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+
+  Serial.setMuted(true);
+  bool fromFile = loadConfig();
+  Serial.setMuted(false);
+  for (size_t i = 0; i < extra.size(); i++) {
+    String error;
+    String name = "cli" + String((int)i + 1);
+    if (!config.rules.addRule(name, extra[i], "off", error)) {
+      printf("❌ %s: %s\n", extra[i], error.c_str());
+      return 1;
+    }
+  }
+  if (config.rules.getCount() == 0) {
+    printf("❌ No rules in %s and none given with --when\n",
+           fromFile ? "config.json" : "the firmware defaults");
+    return 1;
+  }
+
+  std::vector<BenchSample> samples;
+  if (files.empty()) {
+    synthetic(samples);
+    printf("🔧 Inputs: %u synthetic samples (7 days)\n", (unsigned)samples.size());
+  } else {
+    std::vector<TraceRecord> recs;
+    for (const char* path : files) {
+      if (!loadTraceFile(path, recs)) return 1;
+    }
+    fromTraces(recs, samples);
+    printf("🔧 Inputs: %u valid samples from %u trace(s)\n",
+           (unsigned)samples.size(), (unsigned)files.size());
+  }
+  if (samples.empty()) {
+    printf("❌ No samples to evaluate\n");
+    return 1;
+  }
+
+  // Decisions, with the result cache counters of a single pass
+  std::vector<uint32_t> hits(config.rules.getCount(), 0);
+  uint32_t none = 0;
+  RuleEngine counted;
+  Serial.setMuted(true);
+  pass(samples, counted, &hits, &none);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++) {
+    RuleEngine engine;
+    pass(samples, engine, nullptr, nullptr);
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Serial.setMuted(false);
+
+  printf("\n%-12s %-6s %5s  %9s  %s\n", "Rule", "Then", "Bytes", "Decides", "When");
+  for (uint8_t i = 0; i < config.rules.getCount(); i++) {
+    const Rule& rule = config.rules.getRule(i);
+    printf("%-12s %-6s %5u  %8.2f%%  %s\n", rule.name.c_str(), config.rules.getAction(i).c_str(),
+           rule.codeLength, 100.0 * hits[i] / samples.size(), rule.when.c_str());
+  }
+  printf("%-12s %-6s %5s  %8.2f%%\n", "(none)", "", "", 100.0 * none / samples.size());
+
+  uint64_t conditions = (uint64_t)counted.getRuns() + counted.getReuses();
+  printf("\n━━━ RULE BENCH SUMMARY ━━━\n");
+  printf("Program:        %u rules, %u bytes of bytecode\n",
+         config.rules.getCount(), config.rules.getCodeSize());
+  printf("Conditions run: %u of %llu (%.1f%% reused from the cache)\n", counted.getRuns(),
+         (unsigned long long)conditions, conditions ? 100.0 * counted.getReuses() / conditions : 0);
+  printf("Evaluate:       %.0f ns per sample (host, %d passes)\n",
+         wallS * 1e9 / ((double)samples.size() * passes), passes);
+  return 0;
+}
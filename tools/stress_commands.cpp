@@ -0,0 +1,225 @@
+// Host stress test of the command queue (commands.h): producer threads push
+// mode and speed commands while a consumer thread applies them to a real
+// FanController and completes them, as loop() does.
+//
+//   pio run -e stress_commands
+//   .pio/build/stress_commands/program [--producers N] [--commands N] [--window N]
+//
+//   --producers N   producer threads (default 4)
+//   --commands N    commands per producer (default 200000)
+//   --window N      results a producer waits for at once (default 8); more
+//                   than COMMAND_QUEUE_SIZE in total also exercises refusals
+//
+// Checks, and exits 1 on a failure:
+//   - every accepted command is applied exactly once
+//   - each producer's commands are applied in the order it pushed them
+//   - results match their command (a cancel of an unknown override fails)
+//   - the fan ends in the state of the last command applied
+// Results collected too late are counted, not failed: the queue only keeps
+// the last COMMAND_QUEUE_SIZE of them.
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "config.h"
+#include "fancontrol.h"
+#include "overrides.h"
+#include "zones.h"
+#include "commands.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+
+typedef std::chrono::steady_clock Clock;
+
+struct ProducerStats {
+  uint64_t accepted = 0;
+  uint64_t refused = 0;
+  uint64_t results = 0;
+  uint64_t lost = 0;
+  uint64_t failures = 0;
+  uint32_t lastTicket = 0;
+  Command lastCommand = {};
+  std::vector<uint32_t> latencyUs;
+};
+
+struct Pending {
+  uint32_t ticket;
+  Command cmd;
+  Clock::time_point pushed;
+};
+
+static Command makeCommand(unsigned producer, uint64_t i) {
+  static const ControlMode modes[] = { MODE_AUTO, MODE_MANUAL_OFF, MODE_MANUAL_LOW, MODE_MANUAL_HIGH };
+  Command cmd = {};
+  switch ((i + producer) % 8) {
+    case 0:
+    case 3:
+      cmd.type = CMD_SET_SPEED;
+      cmd.speed = (uint8_t)((i * 7 + producer) % 101);
+      break;
+    case 5:
+      cmd.type = CMD_CANCEL_OVERRIDE;
+      cmd.id = 1000000 + producer;   // never exists
+      break;
+    default:
+      cmd.type = CMD_SET_MODE;
+      cmd.zone = 0;
+      cmd.mode = modes[(i / 8 + producer) % 4];
+      cmd.duration = cmd.mode == MODE_AUTO ? 0 : 60;
+      break;
+  }
+  return cmd;
+}
+
+static bool expectedOk(const Command& cmd) {
+  return cmd.type != CMD_CANCEL_OVERRIDE;
+}
+
+static void producer(CommandQueue& queue, unsigned id, uint64_t count, unsigned window,
+                     ProducerStats& stats) {
+  std::vector<Pending> pending;
+  uint32_t lastOrder = 0;
+  uint64_t next = 0;
+
+  while (next < count || !pending.empty()) {
+    if (next < count && pending.size() < window) {
+      Command cmd = makeCommand(id, next);
+      uint32_t ticket = queue.push(cmd);
+      if (ticket == 0) {
+        stats.refused++;
+        std::this_thread::yield();
+      } else {
+        stats.accepted++;
+        stats.lastTicket = ticket;
+        stats.lastCommand = cmd;
+        pending.push_back({ticket, cmd, Clock::now()});
+        next++;
+      }
+    }
+
+    // Oldest first: results are completed in ticket order
+    while (!pending.empty()) {
+      CommandResult result;
+      const Pending& oldest = pending.front();
+      if (queue.poll(oldest.ticket, result)) {
+        stats.results++;
+        stats.latencyUs.push_back((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - oldest.pushed).count());
+        // Tickets of one producer rise, so their apply order must too
+        if (result.order <= lastOrder || result.ok != expectedOk(oldest.cmd)) stats.failures++;
+        lastOrder = result.order;
+      } else if ((int32_t)(queue.getCompleted() - oldest.ticket) >= COMMAND_QUEUE_SIZE) {
+        stats.lost++;
+      } else {
+        break;
+      }
+      pending.erase(pending.begin());
+    }
+    if (pending.size() >= window) std::this_thread::yield();
+  }
+}
+
+static void usage() {
+  printf("usage: stress_commands [--producers N] [--commands N] [--window N]\n");
+}
+
+int main(int argc, char** argv) {
+  unsigned producers = 4;
+  uint64_t perProducer = 200000;
+  unsigned window = 8;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--producers") && i + 1 < argc) {
+      producers = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--commands") && i + 1 < argc) {
+      perProducer = std::max(1L, atol(argv[++i]));
+    } else if (!strcmp(argv[i], "--window") && i + 1 < argc) {
+      window = std::max(1, atoi(argv[++i]));
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  Serial.setMuted(true);
+  SensorManager sensors;
+  FanController fan;
+  OverrideManager overrides;
+  ZoneManager zones;
+  fan.begin();
+  zones.begin(sensors, fan);
+  CommandQueue queue;
+
+  printf("🔧 %u producers x %llu commands, window %u, queue %d\n", producers,
+         (unsigned long long)perProducer, window, COMMAND_QUEUE_SIZE);
+
+  std::atomic<bool> running(true);
+  uint64_t applied = 0;
+  uint64_t batches = 0;
+  std::thread consumer([&]() {
+    // Like loop(): apply, (decide), complete; until the producers are done
+    // and nothing is left
+    for (;;) {
+      bool last = !running.load();
+      uint8_t n = queue.apply(zones, overrides, fan);
+      queue.complete(zones);
+      applied += n;
+      if (n) batches++;
+      if (last && n == 0) break;
+      if (n == 0) std::this_thread::yield();
+    }
+  });
+
+  std::vector<ProducerStats> stats(producers);
+  std::vector<std::thread> threads;
+  auto start = Clock::now();
+  for (unsigned p = 0; p < producers; p++) {
+    threads.emplace_back(producer, std::ref(queue), p, perProducer, window, std::ref(stats[p]));
+  }
+  for (auto& t : threads) t.join();
+  running = false;
+  consumer.join();
+  double wallS = std::chrono::duration<double>(Clock::now() - start).count();
+  Serial.setMuted(false);
+
+  ProducerStats total;
+  const ProducerStats* newest = nullptr;
+  for (const ProducerStats& s : stats) {
+    total.accepted += s.accepted;
+    total.refused += s.refused;
+    total.results += s.results;
+    total.lost += s.lost;
+    total.failures += s.failures;
+    total.latencyUs.insert(total.latencyUs.end(), s.latencyUs.begin(), s.latencyUs.end());
+    if (!newest || (int32_t)(s.lastTicket - newest->lastTicket) > 0) newest = &s;
+  }
+  std::sort(total.latencyUs.begin(), total.latencyUs.end());
+
+  // The fan must be where the highest ticket left it
+  ControlMode expectedMode = newest->lastCommand.type == CMD_SET_SPEED ? MODE_DIAGNOSTIC :
+                             newest->lastCommand.mode;
+  bool finalOk = newest->lastCommand.type == CMD_CANCEL_OVERRIDE || fan.getMode() == expectedMode;
+  bool countOk = applied == total.accepted && queue.getRefused() == total.refused;
+
+  printf("\n━━━ COMMAND QUEUE STRESS SUMMARY ━━━\n");
+  printf("Accepted:       %llu (%.0f per second), %llu refused while full\n",
+         (unsigned long long)total.accepted, total.accepted / wallS,
+         (unsigned long long)total.refused);
+  printf("Applied:        %llu in %llu batches %s\n", (unsigned long long)applied,
+         (unsigned long long)batches, countOk ? "✓" : "❌");
+  printf("Results:        %llu collected, %llu collected too late\n",
+         (unsigned long long)total.results, (unsigned long long)total.lost);
+  if (!total.latencyUs.empty()) {
+    printf("Latency:        p50 %u us, p99 %u us, max %u us (push to result)\n",
+           total.latencyUs[total.latencyUs.size() / 2],
+           total.latencyUs[total.latencyUs.size() * 99 / 100], total.latencyUs.back());
+  }
+  printf("Order/results:  %llu mismatches %s\n", (unsigned long long)total.failures,
+         total.failures == 0 ? "✓" : "❌");
+  printf("Final state:    mode %d, expected %d %s\n", fan.getMode(), expectedMode, finalOk ? "✓" : "❌");
+  return countOk && finalOk && total.failures == 0 ? 0 : 1;
+}
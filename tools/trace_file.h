@@ -0,0 +1,34 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+// Host-side reader for traces downloaded from GET /api/trace (see trace.h)
+
+#include <stdio.h>
+#include <vector>
+#include "trace.h"
+
+// Appends the records of one trace file; files given in order concatenate
+inline bool loadTraceFile(const char* path, std::vector<TraceRecord>& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    printf("❌ Cannot open %s\n", path);
+    return false;
+  }
+  TraceHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != TRACE_MAGIC ||
+      header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+    printf("❌ %s is not a version %d trace\n", path, TRACE_VERSION);
+    fclose(f);
+    return false;
+  }
+  size_t before = out.size();
+  TraceRecord rec;
+  while (fread(&rec, sizeof(rec), 1, f) == 1) {
+    out.push_back(rec);
+  }
+  fclose(f);
+  printf("✓ %s: %u records\n", path, (unsigned)(out.size() - before));
+  return true;
+}
+
+#endif
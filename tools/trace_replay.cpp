@@ -0,0 +1,261 @@
+// Host tool: replays traces recorded on the device (GET /api/trace) through
+// the unmodified FanController::update() and compares its decisions with the
+// ones the device made.
+//
+//   pio run -e trace_replay
+//   .pio/build/trace_replay/program [--fs DIR] [--diverge N] trace.old trace.bin
+//
+// Files are replayed in the order given. The candidate configuration is read
+// from DIR/config.json (default .pio/simfs), falling back to the firmware
+// defaults, so a config or firmware change can be checked against real data
+// before it ships. Between records the controller is stepped at its own
+// deadlines (FanController::getNextDeadline(), at most DECISION_INTERVAL
+// apart) with the last recorded inputs held; every BOOT record starts a fresh
+// controller with millis() back at 0, as on the device.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <vector>
+#include "config.h"
+#include "sensors.h"
+#include "fancontrol.h"
+#include "trace.h"
+#include "trace_file.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+
+// The device acts on a deadline at its next loop() pass; a record that soon
+// after a deadline is that decision
+#define WAKE_SLACK_MS 1000
+
+static const char* reasonNames[] = {
+  "Off", "Humidity", "Temperature", "Both", "Forced", "Manual", "Safety", "Rule"
+};
+
+struct ReplayStats {
+  uint64_t ticks;
+  uint64_t agree;
+  uint64_t spanMs;
+  uint64_t recordedOnMs;
+  uint64_t replayedOnMs;
+  uint32_t recordedStarts;
+  uint32_t replayedStarts;
+  uint32_t boots;
+  uint32_t divergences;
+};
+
+static ReplayStats stats;
+static FanController* fan = nullptr;
+static SensorData internal, external;
+static int recordedSpeed = 0;
+static int recordedReason = REASON_OFF;
+static int prevRecorded = 0;
+static int prevReplayed = 0;
+static uint32_t prevTickMs = 0;
+static uint32_t nextTickMs = 0;
+static bool haveTick = false;
+static bool diverged = false;
+static uint32_t maxDivergences = 10;
+
+static void setWallClock(uint32_t epoch, uint32_t ms) {
+  // time() = epoch at millis() == ms; unsynced devices count from 1970
+  sim::setEpoch(epoch ? (time_t)epoch - (time_t)(ms / 1000) : 0);
+}
+
+static void formatTime(char* buf, size_t len) {
+  time_t now = time(nullptr);
+  struct tm info;
+  localtime_r(&now, &info);
+  strftime(buf, len, "%Y-%m-%d %H:%M", &info);
+}
+
+static void startSegment(uint32_t ms, uint32_t epoch) {
+  delete fan;
+  fan = new FanController();
+  currentMode = MODE_AUTO;
+  manualOverrideUntil = 0;
+  internal = SensorData();
+  external = SensorData();
+  recordedSpeed = 0;
+  recordedReason = REASON_OFF;
+  prevRecorded = 0;
+  prevReplayed = 0;
+  haveTick = false;
+  diverged = false;
+  sim::setNowUs((uint64_t)ms * 1000);
+  setWallClock(epoch, ms);
+}
+
+static void tick(uint32_t ms) {
+  sim::setNowUs((uint64_t)ms * 1000);
+
+  // The state chosen at the previous tick held until now
+  if (haveTick) {
+    uint32_t dt = ms - prevTickMs;
+    stats.spanMs += dt;
+    if (prevRecorded > 0) stats.recordedOnMs += dt;
+    if (prevReplayed > 0) stats.replayedOnMs += dt;
+  }
+
+  fan->update(internal, external);
+  int replayed = fan->getCurrentSpeed();
+
+  stats.ticks++;
+  if (replayed == recordedSpeed) {
+    stats.agree++;
+    diverged = false;
+  } else if (!diverged) {
+    diverged = true;
+    stats.divergences++;
+    if (stats.divergences <= maxDivergences) {
+      char when[32];
+      formatTime(when, sizeof(when));
+      printf("  %s  in %.1f°C %.0f%%  out %.1f°C %.0f%%  device %d%% (%s)  replay %d%% (%s)\n",
+             when, internal.temperature, internal.humidity,
+             external.temperature, external.humidity,
+             recordedSpeed, reasonNames[recordedReason % 8],
+             replayed, reasonNames[fan->getRunReason() % 8]);
+    }
+  }
+
+  if (recordedSpeed > 0 && prevRecorded == 0) stats.recordedStarts++;
+  if (replayed > 0 && prevReplayed == 0) stats.replayedStarts++;
+  prevRecorded = recordedSpeed;
+  prevReplayed = replayed;
+  prevTickMs = ms;
+  nextTickMs = (uint32_t)fan->getNextDeadline();
+  haveTick = true;
+}
+
+static void applySample(const TraceRecord& rec) {
+  internal.temperature = rec.data.centi[0] / 100.0f;
+  internal.humidity = rec.data.centi[1] / 100.0f;
+  internal.dewPoint = SensorManagerBase::calculateDewPoint(internal.temperature, internal.humidity);
+  internal.valid = rec.flags & TRACE_INTERNAL_VALID;
+  internal.lastUpdate = rec.ms;
+  external.temperature = rec.data.centi[2] / 100.0f;
+  external.humidity = rec.data.centi[3] / 100.0f;
+  external.dewPoint = SensorManagerBase::calculateDewPoint(external.temperature, external.humidity);
+  external.valid = rec.flags & TRACE_EXTERNAL_VALID;
+  external.lastUpdate = rec.ms;
+}
+
+static void replay(const std::vector<TraceRecord>& recs) {
+  size_t i = 0;
+  while (i < recs.size()) {
+    if (recs[i].type == TRACE_BOOT) {
+      startSegment(recs[i].ms, recs[i].data.epoch);
+      stats.boots++;
+      i++;
+      continue;
+    }
+    if (!fan) {
+      // Rotated file without its BOOT: wall clock unknown until a CLOCK record
+      startSegment(recs[i].ms, 0);
+    }
+
+    // Decisions the device made on held inputs between recorded events
+    uint32_t ms = recs[i].ms;
+    if (haveTick) {
+      while ((int32_t)(ms - nextTickMs) > WAKE_SLACK_MS) {
+        tick(nextTickMs);
+      }
+    }
+
+    // Everything stamped with the same ms belongs to one decision
+    bool decision = false;
+    int diagnosticSpeed = -1;
+    while (i < recs.size() && recs[i].ms == ms && recs[i].type != TRACE_BOOT) {
+      const TraceRecord& rec = recs[i];
+      switch (rec.type) {
+        case TRACE_CLOCK:
+          setWallClock(rec.data.epoch, rec.ms);
+          break;
+        case TRACE_SAMPLE:
+          applySample(rec);
+          decision = true;
+          break;
+        case TRACE_MODE:
+          currentMode = (ControlMode)rec.flags;
+          decision = true;
+          break;
+        case TRACE_DECISION:
+          recordedSpeed = rec.value;
+          recordedReason = rec.flags;
+          if (currentMode == MODE_DIAGNOSTIC) diagnosticSpeed = rec.value;
+          decision = true;
+          break;
+      }
+      i++;
+    }
+
+    if (decision) {
+      // Diagnostic speeds are operator input, not a controller decision
+      if (diagnosticSpeed >= 0) {
+        sim::setNowUs((uint64_t)ms * 1000);
+        fan->setManualSpeed(diagnosticSpeed);
+      }
+      tick(ms);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--fs") && i + 1 < argc) {
+      LittleFS.simSetRoot(argv[++i]);
+    } else if (!strcmp(argv[i], "--diverge") && i + 1 < argc) {
+      maxDivergences = strtoul(argv[++i], nullptr, 10);
+    } else if (argv[i][0] == '-') {
+      printf("usage: trace_replay [--fs DIR] [--diverge N] trace.bin...\n");
+      return 1;
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty()) {
+    printf("usage: trace_replay [--fs DIR] [--diverge N] trace.bin...\n");
+    return 1;
+  }
+
+  std::vector<TraceRecord> recs;
+  for (const char* path : files) {
+    if (!loadTraceFile(path, recs)) return 1;
+  }
+
+  // Same local time zone as the device (setupWiFi)
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+
+  Serial.setMuted(true);
+  bool fromFile = loadConfig();
+  Serial.setMuted(false);
+  printf("🔧 Config: %s (target %.1f%%, differential %.1f%%, min run %ds)\n",
+         fromFile ? "config.json" : "firmware defaults",
+         config.target_humidity, config.humidity_differential, config.min_run_time_sec);
+
+  printf("\nFirst divergences (device vs replay):\n");
+  Serial.setMuted(true);
+  auto start = std::chrono::steady_clock::now();
+  replay(recs);
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Serial.setMuted(false);
+  delete fan;
+
+  double spanH = stats.spanMs / 3.6e6;
+  printf("\n━━━ REPLAY SUMMARY ━━━\n");
+  printf("Trace span:     %.1f h over %u boot(s), %llu decisions\n", spanH, stats.boots,
+         (unsigned long long)stats.ticks);
+  printf("Replay speed:   %.3f s wall (%.0fx real time)\n", wallS,
+         wallS > 0 ? stats.spanMs / 1000.0 / wallS : 0);
+  printf("Agreement:      %.2f%% of decisions, %u divergent stretches\n",
+         stats.ticks ? 100.0 * stats.agree / stats.ticks : 0, stats.divergences);
+  printf("Fan runtime:    device %.1f h, %u starts | replay %.1f h, %u starts\n",
+         stats.recordedOnMs / 3.6e6, stats.recordedStarts,
+         stats.replayedOnMs / 3.6e6, stats.replayedStarts);
+  return 0;
+}
@@ -0,0 +1,548 @@
+// Host tool: sweeps SystemConfig thresholds over a recorded trace and reports
+// the Pareto front of fan runtime against hours above the humidity goal.
+//
+//   pio run -e tuner
+//   .pio/build/tuner/program [options] trace.old trace.bin
+//
+//   --fs DIR          base config.json (default .pio/simfs, else defaults)
+//   --goal RH         humidity the cellar should stay below (default: base
+//                     target_humidity)
+//   --target-rh A:B:S, --diff A:B:S, --dew A:B:S, --min-run A:B:S
+//                     sweep ranges (defaults 50:70:1, 2:16:1, 0.5:5:0.5,
+//                     120:1200:120)
+//   --max-above H     accept up to H hours above goal (default: baseline's)
+//   --ach N           air changes per hour at 100% speed (default: fitted
+//                     from the trace, else 1.0)
+//   --tau H           wall moisture buffering time constant (default 12 h)
+//   --threads N       worker threads (default: all cores)
+//   --out FILE        also write the chosen config.json fragment to FILE
+//
+// The AUTO branch of FanController::update() is mirrored here in branch-free
+// form over struct-of-arrays candidate state, so one pass over the trace
+// advances thousands of configs per tick in SIMD lanes, with the candidate
+// range split across threads.
+//
+// The trace only holds what the cellar did under the device's decisions.
+// Candidates that run the fan differently get a first-order correction: the
+// moisture the fan would have removed or not (outside air exchange at --ach,
+// in absolute humidity) relaxes back towards the recorded trajectory with
+// time constant --tau. Temperature is taken as recorded. Check the chosen
+// values with trace_replay before deploying them.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "config.h"
+#include "sensors.h"
+#include "trace.h"
+#include "trace_file.h"
+
+SystemConfig config;
+ControlMode currentMode = MODE_AUTO;
+unsigned long manualOverrideUntil = 0;
+
+#define TICK_VALID 0x01
+#define TICK_BOOT 0x02
+#define TICK_HIGH_ALLOWED 0x04
+#define TICK_TEMP_BENEFIT 0x08
+#define TICK_SAFETY 0x10
+#define TICK_QUIET 0x20
+
+// Magnus-Tetens constants, as in SensorManagerBase::calculateDewPoint
+#define MAGNUS_A 17.27f
+#define MAGNUS_B 237.7f
+
+struct Range {
+  float from, to, step;
+  int count() const { return step > 0 && to >= from ? (int)floorf((to - from) / step + 1.001f) : 1; }
+  float at(int i) const { return from + step * i; }
+};
+
+// One entry per decision tick, shared read-only by all workers
+struct Timeline {
+  std::vector<uint32_t> ms;
+  std::vector<float> dtH;         // hours the decision at this tick holds
+  std::vector<float> inAh;        // recorded cellar absolute humidity (g/m3)
+  std::vector<float> outAh;
+  std::vector<float> rhPerAh;     // cellar RH per g/m3 at the recorded temperature
+  std::vector<float> inMagnus;    // a*T/(b+T) for the cellar temperature
+  std::vector<float> outRh;
+  std::vector<float> outDew;
+  std::vector<uint8_t> flags;
+  std::vector<uint8_t> mode;
+  std::vector<uint8_t> recordedSpeed;
+
+  size_t size() const { return ms.size(); }
+};
+
+// Candidate configs and their simulation state, one array per field
+struct Candidates {
+  std::vector<float> targetRh, diff, dewMax;
+  std::vector<uint32_t> minRunMs;
+
+  std::vector<int32_t> speed;
+  std::vector<uint32_t> lastChange, lastForced, forcedStart;
+  std::vector<int32_t> forcedActive;
+  std::vector<float> delta;       // moisture offset from the recorded cellar (g/m3)
+
+  std::vector<float> runH, aboveH;
+  std::vector<int32_t> starts;
+
+  void resize(size_t n) {
+    targetRh.resize(n); diff.resize(n); dewMax.resize(n); minRunMs.resize(n);
+    speed.assign(n, 0); lastChange.assign(n, 0); lastForced.assign(n, 0);
+    forcedStart.assign(n, 0); forcedActive.assign(n, 0); delta.assign(n, 0);
+    runH.assign(n, 0); aboveH.assign(n, 0); starts.assign(n, 0);
+  }
+  size_t size() const { return targetRh.size(); }
+};
+
+struct Params {
+  float goal;
+  float ach;
+  float tauH;
+  uint32_t minIdleMs;
+  uint32_t forcedIntervalMs;
+  uint32_t forcedDurationMin;
+  int lowSpeed;
+  int highSpeed;
+};
+
+static float absoluteHumidity(float temp, float rh) {
+  float es = 6.112f * expf(MAGNUS_A * temp / (MAGNUS_B + temp));
+  return es * rh * 2.1674f / (273.15f + temp);
+}
+
+// Expands the trace onto the device's decision grid, holding inputs between
+// samples (same stepping as trace_replay)
+static void buildTimeline(const std::vector<TraceRecord>& recs, Timeline& tl) {
+  time_t epochBase = 0;
+  float inT = 0, inRh = 0, outT = 0, outRh = 0;
+  uint8_t valid = 0, mode = MODE_AUTO, recSpeed = 0;
+  bool boot = true;
+  bool haveTick = false;
+  uint32_t lastTick = 0;
+
+  auto push = [&](uint32_t ms) {
+    if (haveTick) {
+      uint32_t gap = ms - lastTick;
+      // Lost records (power cut before a flush): do not integrate over the hole
+      tl.dtH.back() = gap <= 10 * DECISION_INTERVAL ? gap / 3.6e6f : 0;
+    }
+    float ah = absoluteHumidity(inT, inRh);
+    uint8_t f = valid ? TICK_VALID : 0;
+    if (boot) f |= TICK_BOOT;
+    time_t wall = epochBase + ms / 1000;
+    SpeedLimit limit = config.schedule.limitAt(wall);
+    if (limit == LIMIT_HIGH) f |= TICK_HIGH_ALLOWED;
+    if (limit == LIMIT_OFF) f |= TICK_QUIET;
+    if (inT > config.target_temp && outT < inT - config.temp_differential) f |= TICK_TEMP_BENEFIT;
+    if (outT < config.min_outside_temp || inT < config.min_cellar_temp) f |= TICK_SAFETY;
+
+    tl.ms.push_back(ms);
+    tl.dtH.push_back(0);
+    tl.inAh.push_back(ah);
+    tl.outAh.push_back(absoluteHumidity(outT, outRh));
+    tl.rhPerAh.push_back(ah > 0 ? inRh / ah : 0);
+    tl.inMagnus.push_back(MAGNUS_A * inT / (MAGNUS_B + inT));
+    tl.outRh.push_back(outRh);
+    tl.outDew.push_back(SensorManagerBase::calculateDewPoint(outT, outRh));
+    tl.flags.push_back(f);
+    tl.mode.push_back(mode);
+    tl.recordedSpeed.push_back(recSpeed);
+    boot = false;
+    haveTick = true;
+    lastTick = ms;
+  };
+
+  size_t i = 0;
+  while (i < recs.size()) {
+    const TraceRecord& first = recs[i];
+    if (first.type == TRACE_BOOT) {
+      epochBase = first.data.epoch ? (time_t)first.data.epoch - first.ms / 1000 : 0;
+      valid = 0;
+      mode = MODE_AUTO;
+      recSpeed = 0;
+      boot = true;
+      haveTick = false;
+      i++;
+      continue;
+    }
+
+    uint32_t ms = first.ms;
+    if (haveTick) {
+      for (uint32_t next = lastTick + DECISION_INTERVAL; (int32_t)(ms - next) > 0; next += DECISION_INTERVAL) {
+        push(next);
+      }
+    }
+
+    bool decision = false;
+    for (; i < recs.size() && recs[i].ms == ms && recs[i].type != TRACE_BOOT; i++) {
+      const TraceRecord& rec = recs[i];
+      if (rec.type == TRACE_CLOCK) {
+        epochBase = rec.data.epoch ? (time_t)rec.data.epoch - rec.ms / 1000 : 0;
+      } else if (rec.type == TRACE_SAMPLE) {
+        inT = rec.data.centi[0] / 100.0f;
+        inRh = rec.data.centi[1] / 100.0f;
+        outT = rec.data.centi[2] / 100.0f;
+        outRh = rec.data.centi[3] / 100.0f;
+        valid = (rec.flags & (TRACE_INTERNAL_VALID | TRACE_EXTERNAL_VALID)) ==
+                (TRACE_INTERNAL_VALID | TRACE_EXTERNAL_VALID);
+        decision = true;
+      } else if (rec.type == TRACE_MODE) {
+        mode = rec.flags;
+        decision = true;
+      } else if (rec.type == TRACE_DECISION) {
+        recSpeed = (uint8_t)rec.value;
+        decision = true;
+      }
+    }
+    if (decision) push(ms);
+  }
+}
+
+// Air exchange rate from the trace: while the device ran, the cellar's
+// absolute humidity moves towards outside at ach * speed
+static bool fitAirChanges(const Timeline& tl, float& ach) {
+  double sxx = 0, sxy = 0, sx = 0, sy = 0;
+  int n = 0, running = 0;
+  for (size_t t = 0; t + 1 < tl.size(); t++) {
+    if (tl.dtH[t] <= 0 || (tl.flags[t + 1] & TICK_BOOT) || !(tl.flags[t] & TICK_VALID)) continue;
+    if (tl.inAh[t + 1] == tl.inAh[t]) continue;  // held input, not a new sample
+    double x = tl.recordedSpeed[t] / 100.0 * (tl.outAh[t] - tl.inAh[t]);
+    double y = (tl.inAh[t + 1] - tl.inAh[t]) / tl.dtH[t];
+    sxx += x * x; sxy += x * y; sx += x; sy += y;
+    n++;
+    if (tl.recordedSpeed[t] > 0) running++;
+  }
+  if (running < 20) return false;
+  double denom = n * sxx - sx * sx;
+  if (denom <= 0) return false;
+  double slope = (n * sxy - sx * sy) / denom;
+  if (slope < 0.05 || slope > 20) return false;
+  ach = (float)slope;
+  return true;
+}
+
+// Advances candidates [c0, c1) through the whole timeline
+static void simulate(const Timeline& tl, Candidates& cs, const Params& p, size_t c0, size_t c1) {
+  float* targetRh = cs.targetRh.data();
+  float* diff = cs.diff.data();
+  float* dewMax = cs.dewMax.data();
+  uint32_t* minRunMs = cs.minRunMs.data();
+  int32_t* speed = cs.speed.data();
+  uint32_t* lastChange = cs.lastChange.data();
+  uint32_t* lastForced = cs.lastForced.data();
+  uint32_t* forcedStart = cs.forcedStart.data();
+  int32_t* forcedActive = cs.forcedActive.data();
+  float* delta = cs.delta.data();
+  float* runH = cs.runH.data();
+  float* aboveH = cs.aboveH.data();
+  int32_t* starts = cs.starts.data();
+
+  // Locals, so stores to the state arrays cannot alias them
+  const float goal = p.goal;
+  const uint32_t minIdleMs = p.minIdleMs;
+  const uint32_t forcedIntervalMs = p.forcedIntervalMs;
+  const uint32_t forcedDurationMs = p.forcedDurationMin * 60000U;
+  const int32_t lowSpeed = p.lowSpeed;
+
+  for (size_t t = 0; t < tl.size(); t++) {
+    const uint32_t now = tl.ms[t];
+    const uint8_t f = tl.flags[t];
+    const float dtH = tl.dtH[t];
+    const float inAh = tl.inAh[t];
+    const float outAh = tl.outAh[t];
+    const float rhPerAh = tl.rhPerAh[t];
+    const float inMagnus = tl.inMagnus[t];
+    const float outRh = tl.outRh[t];
+    const float outDew = tl.outDew[t];
+    const float recordedFlow = tl.recordedSpeed[t] / 100.0f * (inAh - outAh);
+    const int32_t valid = (f & TICK_VALID) != 0;
+    // Safety limits and the schedule's off slots both block benefit runs
+    const int32_t safety = (f & (TICK_SAFETY | TICK_QUIET)) != 0;
+    const int32_t tempBenefit = (f & TICK_TEMP_BENEFIT) != 0;
+    const int32_t runSpeed = (f & TICK_HIGH_ALLOWED) ? p.highSpeed : p.lowSpeed;
+    const int32_t isAuto = tl.mode[t] == MODE_AUTO;
+    int32_t manualSpeed = 0;
+    switch (tl.mode[t]) {
+      case MODE_MANUAL_LOW: manualSpeed = p.lowSpeed; break;
+      case MODE_MANUAL_HIGH: manualSpeed = p.highSpeed; break;
+      case MODE_DIAGNOSTIC: manualSpeed = tl.recordedSpeed[t]; break;
+      default: break;
+    }
+    const float exchange = p.ach * dtH;
+    const float relax = dtH / p.tauH;
+
+    if (f & TICK_BOOT) {
+      // Fresh FanController: millis() and all timers restart
+      for (size_t c = c0; c < c1; c++) {
+        speed[c] = 0;
+        lastChange[c] = 0;
+        lastForced[c] = 0;
+        forcedStart[c] = 0;
+        forcedActive[c] = 0;
+      }
+    }
+
+    // Candidates are independent and the state vectors distinct
+#pragma GCC ivdep
+    for (size_t c = c0; c < c1; c++) {
+      // Every array is loaded and stored unconditionally so the body if-converts
+      float d = delta[c];
+      int32_t current = speed[c];
+      uint32_t changedAt = lastChange[c];
+      uint32_t forcedAt = lastForced[c];
+      uint32_t forcedFrom = forcedStart[c];
+      int32_t forcedOn = forcedActive[c];
+      uint32_t runMs = minRunMs[c];
+
+      float ah = inAh + d;
+      float rh = ah * rhPerAh;
+      float alpha = inMagnus + logf(fmaxf(rh, 0.1f) / 100.0f);
+      float dewIn = MAGNUS_B * alpha / (MAGNUS_A - alpha);
+
+      // Forced circulation (only reached in AUTO with valid data)
+      int32_t evaluate = isAuto & valid;
+      int32_t forcedDue = evaluate & ((now - forcedAt) >= forcedIntervalMs);
+      forcedFrom = (forcedDue & (forcedOn == 0)) ? now : forcedFrom;
+      int32_t forcedDone = forcedDue & ((now - forcedFrom) >= forcedDurationMs);
+      forcedOn = (evaluate & forcedDue & (forcedDone ^ 1)) | ((evaluate ^ 1) & forcedOn);
+      forcedAt = forcedDone ? now : forcedAt;
+
+      int32_t dewRisk = (outDew - dewIn) > dewMax[c];
+      int32_t humidityBenefit = (rh > targetRh[c]) & (outRh < rh - diff[c]);
+      int32_t runWanted = (humidityBenefit | tempBenefit) & ((safety | dewRisk) ^ 1);
+      int32_t autoWant = forcedDue ? lowSpeed : (valid & runWanted) * runSpeed;
+      int32_t want = isAuto ? autoWant : manualSpeed;
+
+      // setFanSpeed(): anti-short-cycle unless manual
+      uint32_t minMs = current > 0 ? runMs : minIdleMs;
+      int32_t allowed = (isAuto ^ 1) | ((now - changedAt) >= minMs);
+      int32_t change = (want != current) & allowed;
+      starts[c] += change & (current == 0) & (want > 0);
+      current = change ? want : current;
+      changedAt = change ? now : changedAt;
+
+      // Integrate until the next tick
+      runH[c] += current > 0 ? dtH : 0.0f;
+      aboveH[c] += rh > goal ? dtH : 0.0f;
+      float flow = current / 100.0f * (ah - outAh);
+      d += -exchange * (flow - recordedFlow) - d * relax;
+
+      delta[c] = d;
+      speed[c] = current;
+      lastChange[c] = changedAt;
+      lastForced[c] = forcedAt;
+      forcedStart[c] = forcedFrom;
+      forcedActive[c] = forcedOn;
+    }
+  }
+}
+
+static bool parseRange(const char* s, Range& r) {
+  return sscanf(s, "%f:%f:%f", &r.from, &r.to, &r.step) == 3 && r.step > 0 && r.to >= r.from;
+}
+
+static void usage() {
+  printf("usage: tuner [--fs DIR] [--goal RH] [--target-rh A:B:S] [--diff A:B:S] [--dew A:B:S]\n"
+         "             [--min-run A:B:S] [--max-above H] [--ach N] [--tau H] [--threads N]\n"
+         "             [--out FILE] trace.bin...\n");
+}
+
+int main(int argc, char** argv) {
+  Range targetRange = { 50, 70, 1 };
+  Range diffRange = { 2, 16, 1 };
+  Range dewRange = { 0.5f, 5, 0.5f };
+  Range minRunRange = { 120, 1200, 120 };
+  float goal = -1, maxAbove = -1, ach = -1, tauH = 12;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  const char* outPath = nullptr;
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    bool ok = true;
+    if (!strcmp(argv[i], "--fs") && hasValue) LittleFS.simSetRoot(argv[++i]);
+    else if (!strcmp(argv[i], "--goal") && hasValue) goal = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--target-rh") && hasValue) ok = parseRange(argv[++i], targetRange);
+    else if (!strcmp(argv[i], "--diff") && hasValue) ok = parseRange(argv[++i], diffRange);
+    else if (!strcmp(argv[i], "--dew") && hasValue) ok = parseRange(argv[++i], dewRange);
+    else if (!strcmp(argv[i], "--min-run") && hasValue) ok = parseRange(argv[++i], minRunRange);
+    else if (!strcmp(argv[i], "--max-above") && hasValue) maxAbove = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--ach") && hasValue) ach = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--tau") && hasValue) tauH = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--threads") && hasValue) threads = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(argv[i], "--out") && hasValue) outPath = argv[++i];
+    else if (argv[i][0] != '-') files.push_back(argv[i]);
+    else ok = false;
+    if (!ok) {
+      usage();
+      return 1;
+    }
+  }
+  if (files.empty()) {
+    usage();
+    return 1;
+  }
+
+  std::vector<TraceRecord> recs;
+  for (const char* path : files) {
+    if (!loadTraceFile(path, recs)) return 1;
+  }
+
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  Serial.setMuted(true);
+  bool fromFile = loadConfig();
+  Serial.setMuted(false);
+
+  Timeline tl;
+  buildTimeline(recs, tl);
+  if (tl.size() < 2) {
+    printf("❌ Trace holds no decisions\n");
+    return 1;
+  }
+
+  Params p;
+  p.goal = goal > 0 ? goal : config.target_humidity;
+  bool fitted = false;
+  if (ach > 0) {
+    p.ach = ach;
+  } else {
+    fitted = fitAirChanges(tl, p.ach);
+    if (!fitted) p.ach = 1.0f;
+  }
+  p.tauH = tauH > 0 ? tauH : 12;
+  p.minIdleMs = config.min_idle_time_sec * 1000U;
+  p.forcedIntervalMs = config.forced_interval_hours * 3600000U;
+  p.forcedDurationMin = config.forced_duration_min;
+  p.lowSpeed = config.low_speed;
+  p.highSpeed = config.high_speed;
+
+  // Candidate 0 is the base config, the rest the full grid
+  Candidates cs;
+  size_t total = 1 + (size_t)targetRange.count() * diffRange.count() * dewRange.count() * minRunRange.count();
+  cs.resize(total);
+  cs.targetRh[0] = config.target_humidity;
+  cs.diff[0] = config.humidity_differential;
+  cs.dewMax[0] = config.max_dew_point_increase;
+  cs.minRunMs[0] = config.min_run_time_sec * 1000U;
+  size_t c = 1;
+  for (int a = 0; a < targetRange.count(); a++)
+    for (int b = 0; b < diffRange.count(); b++)
+      for (int d = 0; d < dewRange.count(); d++)
+        for (int m = 0; m < minRunRange.count(); m++, c++) {
+          cs.targetRh[c] = targetRange.at(a);
+          cs.diff[c] = diffRange.at(b);
+          cs.dewMax[c] = dewRange.at(d);
+          cs.minRunMs[c] = (uint32_t)lroundf(minRunRange.at(m)) * 1000U;
+        }
+
+  printf("🔧 Base: %s, goal %.1f%%, %s %.2f air changes/h, walls %.0f h\n",
+         fromFile ? "config.json" : "firmware defaults", p.goal,
+         fitted ? "fitted" : (ach > 0 ? "given" : "default"), p.ach, p.tauH);
+  if (config.modulate_speed) {
+    printf("⚠️ modulate_speed is set: candidates are simulated with low/high speeds only\n");
+  }
+  if (config.adaptive_differentials) {
+    printf("⚠️ adaptive_differentials is set: candidates are simulated with fixed differentials\n");
+  }
+  if (config.planner_enabled) {
+    printf("⚠️ planner is enabled: candidates are simulated with reactive humidity runs only\n");
+  }
+  printf("🔧 %u candidates x %u decisions on %u threads\n",
+         (unsigned)total, (unsigned)tl.size(), threads);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  size_t chunk = (total + threads - 1) / threads;
+  for (unsigned w = 0; w < threads; w++) {
+    size_t c0 = w * chunk;
+    size_t c1 = std::min(total, c0 + chunk);
+    if (c0 >= c1) break;
+    workers.emplace_back(simulate, std::cref(tl), std::ref(cs), std::cref(p), c0, c1);
+  }
+  for (auto& w : workers) w.join();
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  double spanH = 0;
+  double recordedRunH = 0;
+  for (size_t t = 0; t < tl.size(); t++) {
+    spanH += tl.dtH[t];
+    if (tl.recordedSpeed[t] > 0) recordedRunH += tl.dtH[t];
+  }
+  printf("✓ %.2f s wall, %.0f M candidate-decisions/s\n", wallS,
+         wallS > 0 ? total * (double)tl.size() / wallS / 1e6 : 0);
+
+  // Pareto front: no other candidate has both less runtime and fewer hours above
+  std::vector<size_t> order(total);
+  for (size_t i = 0; i < total; i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (cs.runH[a] != cs.runH[b]) return cs.runH[a] < cs.runH[b];
+    return cs.aboveH[a] < cs.aboveH[b];
+  });
+  std::vector<size_t> front;
+  float bestAbove = INFINITY;
+  for (size_t i : order) {
+    if (cs.aboveH[i] < bestAbove) {
+      front.push_back(i);
+      bestAbove = cs.aboveH[i];
+    }
+  }
+
+  float allowed = maxAbove >= 0 ? maxAbove : cs.aboveH[0];
+  size_t chosen = 0;
+  for (size_t i : front) {
+    if (cs.aboveH[i] <= allowed) {
+      chosen = i;
+      break;
+    }
+  }
+
+  printf("\n━━━ PARETO FRONT (%u of %u) over %.1f h ━━━\n", (unsigned)front.size(), (unsigned)total, spanH);
+  printf("runtime h  above h  starts  target  diff  dew   min_run\n");
+  size_t stride = front.size() > 20 ? front.size() / 20 + 1 : 1;
+  for (size_t k = 0; k < front.size(); k++) {
+    size_t i = front[k];
+    if (k % stride != 0 && i != chosen && k + 1 != front.size()) continue;
+    printf("%9.1f %8.1f %7d  %6.1f %5.1f %4.1f %8u%s\n", cs.runH[i], cs.aboveH[i], cs.starts[i],
+           cs.targetRh[i], cs.diff[i], cs.dewMax[i], cs.minRunMs[i] / 1000,
+           i == chosen ? "  <- chosen" : "");
+  }
+  printf("\nBase config:  %.1f h runtime (device recorded %.1f h), %.1f h above goal, %d starts\n",
+         cs.runH[0], recordedRunH, cs.aboveH[0], cs.starts[0]);
+  printf("Chosen:       %.1f h runtime, %.1f h above goal, %d starts\n\n",
+         cs.runH[chosen], cs.aboveH[chosen], cs.starts[chosen]);
+
+  char fragment[512];
+  snprintf(fragment, sizeof(fragment),
+           "{\n"
+           "  \"thresholds\": {\n"
+           "    \"target_humidity\": %.1f,\n"
+           "    \"humidity_differential\": %.1f,\n"
+           "    \"max_dew_point_increase\": %.1f\n"
+           "  },\n"
+           "  \"fan\": {\n"
+           "    \"min_run_time_sec\": %u\n"
+           "  }\n"
+           "}\n",
+           cs.targetRh[chosen], cs.diff[chosen], cs.dewMax[chosen], cs.minRunMs[chosen] / 1000);
+  printf("%s", fragment);
+
+  if (outPath) {
+    FILE* f = fopen(outPath, "w");
+    if (!f) {
+      printf("❌ Cannot write %s\n", outPath);
+      return 1;
+    }
+    fputs(fragment, f);
+    fclose(f);
+    printf("✓ Written to %s\n", outPath);
+  }
+  return 0;
+}